@@ -27,9 +27,10 @@
  *    it in the license file.
  */
 
+#include <array>
+#include <boost/container/small_vector.hpp>
 #include <cstring>
 #include <limits>
-#include <vector>
 
 #include "mongo/base/data_view.h"
 #include "mongo/bson/bson_depth.h"
@@ -166,6 +167,25 @@ private:
     BSONVersion _version;
 };
 
+/**
+ * The size of the value of each type of element whose value is always the same size (after its
+ * field name), or -1 for the other types, whose value has to be looked at.  Most elements are one
+ * of these, so this saves a trip through the switch in validateElementInfo().
+ */
+const std::array<int8_t, 256> kFixedValueSizes = [] {
+    std::array<int8_t, 256> sizes;
+    sizes.fill(-1);
+    for (auto type : {MinKey, MaxKey, jstNULL, Undefined}) {
+        sizes[static_cast<uint8_t>(type)] = 0;
+    }
+    sizes[jstOID] = OID::kOIDSize;
+    sizes[NumberInt] = sizeof(int32_t);
+    for (auto type : {NumberDouble, NumberLong, bsonTimestamp, Date}) {
+        sizes[type] = sizeof(int64_t);
+    }
+    return sizes;
+}();
+
 struct ValidationState {
     enum State { BeginObj = 1, WithinObj, EndObj, BeginCodeWScope, EndCodeWScope, Done };
 };
@@ -218,23 +238,14 @@ Status validateElementInfo(Buffer* buffer,
     if (!status.isOK())
         return status;
 
-    switch (type) {
-        case MinKey:
-        case MaxKey:
-        case jstNULL:
-        case Undefined:
-            return Status::OK();
-
-        case jstOID:
-            if (!buffer->skip(OID::kOIDSize))
-                return makeError("invalid bson", idElem, *elemName);
-            return Status::OK();
-
-        case NumberInt:
-            if (!buffer->skip(sizeof(int32_t)))
-                return makeError("invalid bson", idElem, *elemName);
-            return Status::OK();
+    const int fixedValueSize = kFixedValueSizes[static_cast<uint8_t>(type)];
+    if (fixedValueSize >= 0) {
+        if (fixedValueSize > 0 && !buffer->skip(fixedValueSize))
+            return makeError("invalid bson", idElem, *elemName);
+        return Status::OK();
+    }
 
+    switch (type) {
         case Bool:
             uint8_t val;
             if (!buffer->readNumber(&val))
@@ -243,14 +254,6 @@ Status validateElementInfo(Buffer* buffer,
                 return makeError("invalid boolean value", idElem, *elemName);
             return Status::OK();
 
-        case NumberDouble:
-        case NumberLong:
-        case bsonTimestamp:
-        case Date:
-            if (!buffer->skip(sizeof(int64_t)))
-                return makeError("invalid bson", idElem, *elemName);
-            return Status::OK();
-
         case NumberDecimal:
             if (!buffer->skip(sizeof(Decimal128::Value)))
                 return makeError("Invalid bson", idElem, *elemName);
@@ -306,9 +309,11 @@ Status validateElementInfo(Buffer* buffer,
     }
 }
 
-Status validateBSONIterative(Buffer* buffer) {
-    std::vector<ValidationObjectFrame> frames;
-    frames.reserve(16);
+// Deep enough for almost all documents, without allocating.
+using ValidationObjectFrames = boost::container::small_vector<ValidationObjectFrame, 32>;
+
+Status validateBSONIterative(Buffer* buffer, ValidationObjectFrames& frames) {
+    frames.clear();
     ValidationObjectFrame* curr = nullptr;
     ValidationState::State state = ValidationState::BeginObj;
 
@@ -421,7 +426,8 @@ Status validateBSON(const char* originalBuffer, uint64_t maxLength, BSONVersion
     }
 
     Buffer buf(originalBuffer, maxLength, version);
-    return validateBSONIterative(&buf);
+    ValidationObjectFrames frames;
+    return validateBSONIterative(&buf, frames);
 }
 
 }  // namespace mongo
@@ -0,0 +1,86 @@
+/**
+ *    Copyright (C) 2019-present MongoDB, Inc.
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the Server Side Public License, version 1,
+ *    as published by MongoDB, Inc.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    Server Side Public License for more details.
+ *
+ *    You should have received a copy of the Server Side Public License
+ *    along with this program. If not, see
+ *    <http://www.mongodb.com/licensing/server-side-public-license>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the Server Side Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include <benchmark/benchmark.h>
+
+#include "mongo/base/data_view.h"
+#include "mongo/bson/bson_validate.h"
+#include "mongo/bson/bsonobjbuilder.h"
+
+namespace mongo {
+namespace {
+
+/**
+ * Concatenates documents shaped like a typical collection's, totalling about `bytes`.
+ */
+std::string makeDocs(size_t bytes) {
+    std::string buf;
+    for (int i = 0; buf.size() < bytes; i++) {
+        BSONObjBuilder bob;
+        bob.append("_id", OID::gen());
+        bob.append("n", i);
+        bob.append("name", std::string(8 + i % 32, 'a' + i % 26));
+        bob.appendDate("created", Date_t::fromMillisSinceEpoch(1500000000000LL + i));
+        bob.append("score", i * 0.5);
+        bob.append("address",
+                   BSON("street"
+                        << "123 Main St"
+                        << "city"
+                        << "Springfield"
+                        << "zip" << 12345 + i % 100));
+        bob.append("tags",
+                   BSON_ARRAY("red"
+                              << "green" << i % 7));
+        bob.append("active", i % 2 == 0);
+        const BSONObj doc = bob.obj();
+        buf.append(doc.objdata(), doc.objsize());
+    }
+    return buf;
+}
+
+void BM_validateBSON(benchmark::State& state) {
+    const std::string buf = makeDocs(state.range(0));
+    for (auto _ : state) {
+        // One call per document, as a reader of a dump would.
+        for (size_t offset = 0; offset < buf.size();) {
+            const char* doc = buf.data() + offset;
+            benchmark::DoNotOptimize(
+                validateBSON(doc, buf.size() - offset, BSONVersion::kLatest).isOK());
+            offset += ConstDataView(doc).read<LittleEndian<int>>();
+        }
+    }
+    state.SetBytesProcessed(state.iterations() * buf.size());
+}
+
+BENCHMARK(BM_validateBSON)->Arg(64 * 1024)->Arg(16 * 1024 * 1024);
+
+}  // namespace
+}  // namespace mongo
@@ -356,4 +356,24 @@ TEST(BSONValidateBool, BoolValuesAreValidated) {
     }
 }
 
+TEST(BSONValidateFast, DeeplyNested) {
+    // (more levels than are validated without allocating)
+    BSONObj x = BSON("x" << 1);
+    for (int i = 0; i < 100; i++) {
+        x = BSON("a" << x << "b" << BSON_ARRAY(i));
+    }
+    ASSERT_OK(validateBSON(x.objdata(), x.objsize(), BSONVersion::kLatest));
+    ASSERT_NOT_OK(validateBSON(x.objdata(), x.objsize() - 1, BSONVersion::kLatest));
+}
+
+TEST(BSONValidateFast, FixedSizeValuesMustFit) {
+    BSONObjBuilder bob;
+    bob.append("_id", 1);
+    bob.append("d", 1.5);
+    const BSONObj x = bob.obj();
+    ASSERT_OK(validateBSON(x.objdata(), x.objsize(), BSONVersion::kLatest));
+    // Without the double's last bytes.
+    ASSERT_NOT_OK(validateBSON(x.objdata(), x.objsize() - 4, BSONVersion::kLatest));
+}
+
 }  // namespace
@@ -0,0 +1,344 @@
+/**
+ *    Copyright (C) 2019-present MongoDB, Inc.
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the Server Side Public License, version 1,
+ *    as published by MongoDB, Inc.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    Server Side Public License for more details.
+ *
+ *    You should have received a copy of the Server Side Public License
+ *    along with this program. If not, see
+ *    <http://www.mongodb.com/licensing/server-side-public-license>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the Server Side Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/bsonview/aggregation_stream.h"
+
+#include <boost/filesystem/operations.hpp>
+#include <cstring>
+#include <set>
+
+#include "mongo/bson/json.h"
+#include "mongo/db/client.h"
+#include "mongo/db/pipeline/document_source.h"
+#include "mongo/db/pipeline/expression_context.h"
+#include "mongo/db/query/datetime/date_time_support.h"
+#include "mongo/util/assert_util.h"
+#include "mongo/util/str.h"
+
+namespace mongo {
+
+namespace {
+
+// The stages which need nothing but the docs they're given.  The rest ($lookup, $out,
+// $indexStats, ...) need a server, which they'd reach through the ExpressionContext's
+// MongoProcessInterface, which here is a stub that aborts if it's called (some even call it while
+// being parsed).
+const std::set<StringData> kStandaloneStages{"$addFields",
+                                             "$bucket",
+                                             "$bucketAuto",
+                                             "$count",
+                                             "$facet",
+                                             "$group",
+                                             "$limit",
+                                             "$match",
+                                             "$project",
+                                             "$redact",
+                                             "$replaceRoot",
+                                             "$replaceWith",
+                                             "$sample",
+                                             "$set",
+                                             "$skip",
+                                             "$sort",
+                                             "$sortByCount",
+                                             "$unset",
+                                             "$unwind"};
+
+Status checkStandalone(const std::vector<BSONObj>& stages) {
+    for (auto&& stage : stages) {
+        const BSONElement spec = stage.firstElement();
+        if (!spec) {
+            continue;  // (for the parser to reject)
+        }
+        if (!kStandaloneStages.count(spec.fieldNameStringData())) {
+            return {ErrorCodes::NotImplemented,
+                    str::stream() << spec.fieldNameStringData()
+                                  << " isn't supported, only stages that need nothing but the "
+                                     "docs themselves"};
+        }
+
+        if (spec.fieldNameStringData() == "$facet" && spec.type() == Object) {
+            for (auto&& facet : spec.Obj()) {
+                if (facet.type() != Array) {
+                    continue;
+                }
+                std::vector<BSONObj> subStages;
+                for (auto&& subStage : facet.Obj()) {
+                    if (subStage.type() == Object) {
+                        subStages.push_back(subStage.Obj());
+                    }
+                }
+                Status s = checkStandalone(subStages);
+                if (!s.isOK()) {
+                    return s;
+                }
+            }
+        }
+    }
+    return Status::OK();
+}
+
+}  // namespace
+
+/**
+ * The front of the pipeline, which reads the docs added to the stream.
+ */
+class AggregationStream::Source final : public DocumentSource {
+public:
+    Source(AggregationStream* stream, const boost::intrusive_ptr<ExpressionContext>& expCtx)
+        : DocumentSource(expCtx), _stream(stream) {}
+
+    GetNextResult getNext() override {
+        pExpCtx->checkForInterrupt();
+
+        auto doc = _stream->_nextInput();
+        if (!doc) {
+            return GetNextResult::makeEOF();
+        }
+        return Document(*doc);
+    }
+
+    const char* getSourceName() const override {
+        return "$bsonview";
+    }
+
+    Value serialize(
+        boost::optional<ExplainOptions::Verbosity> explain = boost::none) const override {
+        return Value(Document{{getSourceName(), Document()}});
+    }
+
+    StageConstraints constraints(Pipeline::SplitState pipeState) const override {
+        StageConstraints constraints(StreamType::kStreaming,
+                                     PositionRequirement::kFirst,
+                                     HostTypeRequirement::kNone,
+                                     DiskUseRequirement::kNoDiskUse,
+                                     FacetRequirement::kNotAllowed,
+                                     TransactionRequirement::kAllowed,
+                                     LookupRequirement::kAllowed);
+        constraints.requiresInputDocSource = false;
+        return constraints;
+    }
+
+    boost::optional<DistributedPlanLogic> distributedPlanLogic() override {
+        return boost::none;
+    }
+
+private:
+    AggregationStream* const _stream;
+};
+
+StatusWith<std::unique_ptr<AggregationStream>> AggregationStream::make(
+    ServiceContext* service, const std::vector<BSONObj>& stages, std::string tempDir) {
+    Status s = checkStandalone(stages);
+    if (!s.isOK()) {
+        return s;
+    }
+
+    // Date expressions need one, and nothing else here sets it.
+    if (!TimeZoneDatabase::get(service)) {
+        TimeZoneDatabase::set(service, std::make_unique<TimeZoneDatabase>());
+    }
+
+    auto swArena = TempArena::make();
+    if (!swArena.isOK()) {
+        return swArena.getStatus();
+    }
+
+    auto client = service->makeClient("bsonview");
+    auto opCtx = client->makeOperationContext();
+    std::unique_ptr<AggregationStream> stream(
+        new AggregationStream(std::move(client), std::move(opCtx), std::move(tempDir)));
+    stream->_arena = std::move(swArena.getValue());
+
+    try {
+        boost::intrusive_ptr<ExpressionContext> expCtx(
+            new ExpressionContext(stream->_opCtx.get(), nullptr));
+        expCtx->allowDiskUse = true;
+        expCtx->tempDir = stream->_tempDir;
+
+        auto pipeline = Pipeline::parse(stages, expCtx);
+        if (!pipeline.isOK()) {
+            return pipeline.getStatus();
+        }
+        stream->_pipeline = std::move(pipeline.getValue());
+        stream->_pipeline->optimizePipeline();
+        stream->_pipeline->addInitialSource(new Source(stream.get(), expCtx));
+    } catch (const DBException& e) {
+        return e.toStatus();
+    }
+
+    stream->_thread = stdx::thread([s = stream.get()] { s->_run(); });
+    return std::move(stream);
+}
+
+StatusWith<std::vector<BSONObj>> AggregationStream::parseStages(StringData json) {
+    BSONObj wrapped;
+    try {
+        wrapped = fromjson(str::stream() << "{pipeline: " << json << "}");
+    } catch (const DBException& e) {
+        return e.toStatus();
+    }
+
+    BSONElement pipeline = wrapped.firstElement();
+    if (pipeline.type() == Object) {
+        return std::vector<BSONObj>{pipeline.Obj().getOwned()};
+    }
+    if (pipeline.type() != Array) {
+        return Status(ErrorCodes::TypeMismatch, "A pipeline is an array of stages");
+    }
+
+    std::vector<BSONObj> stages;
+    for (auto&& stage : pipeline.Obj()) {
+        if (stage.type() != Object) {
+            return Status(ErrorCodes::TypeMismatch, "Each stage of a pipeline is an object");
+        }
+        stages.push_back(stage.Obj().getOwned());
+    }
+    return stages;
+}
+
+AggregationStream::AggregationStream(ServiceContext::UniqueClient client,
+                                     ServiceContext::UniqueOperationContext opCtx,
+                                     std::string tempDir)
+    : _tempDir(std::move(tempDir)), _client(std::move(client)), _opCtx(std::move(opCtx)) {}
+
+AggregationStream::~AggregationStream() {
+    cancel();
+    _pipeline.reset();
+
+    // The Sorter removes its own files, and creates the directory if it spills at all.
+    boost::system::error_code ec;
+    if (!_tempDir.empty() && boost::filesystem::is_empty(_tempDir, ec)) {
+        boost::filesystem::remove(_tempDir, ec);
+    }
+}
+
+void AggregationStream::add(std::vector<BSONObj> docs) {
+    if (docs.empty()) {
+        return;
+    }
+    stdx::lock_guard<stdx::mutex> lk(_mutex);
+    invariant(!_finished);
+    _input.push_back(std::move(docs));
+    _inputReady.notify_one();
+}
+
+bool AggregationStream::wantsMore() const {
+    stdx::lock_guard<stdx::mutex> lk(_mutex);
+    return !_finished && !_done && _input.size() < kMaxPendingBatches;
+}
+
+void AggregationStream::finish() {
+    stdx::lock_guard<stdx::mutex> lk(_mutex);
+    _finished = true;
+    _inputReady.notify_one();
+}
+
+void AggregationStream::cancel() {
+    {
+        stdx::lock_guard<stdx::mutex> lk(_mutex);
+        _cancelled = true;
+        _input.clear();
+        _inputReady.notify_one();
+    }
+    {
+        // Stops blocking stages partway through their input, too.
+        stdx::lock_guard<Client> lk(*_client);
+        _opCtx->getServiceContext()->killOperation(lk, _opCtx.get());
+    }
+    if (_thread.joinable()) {
+        _thread.join();
+    }
+}
+
+size_t AggregationStream::numResults() const {
+    stdx::lock_guard<stdx::mutex> lk(_mutex);
+    return _results.size();
+}
+
+BSONObj AggregationStream::result(size_t i) const {
+    stdx::lock_guard<stdx::mutex> lk(_mutex);
+    invariant(i < _results.size());
+    return BSONObj(_arena->base() + _results[i]);
+}
+
+bool AggregationStream::isDone() const {
+    stdx::lock_guard<stdx::mutex> lk(_mutex);
+    return _done;
+}
+
+Status AggregationStream::getStatus() const {
+    stdx::lock_guard<stdx::mutex> lk(_mutex);
+    return _status;
+}
+
+void AggregationStream::_run() {
+    Status status = Status::OK();
+    uint64_t written = 0;
+    try {
+        while (auto doc = _pipeline->getNext()) {
+            // (readers only look at results once they're in _results)
+            BSONObj result = doc->toBson();
+            uassertStatusOK(_arena->ensureMapped(written + result.objsize()));
+            memcpy(_arena->base() + written, result.objdata(), result.objsize());
+
+            stdx::lock_guard<stdx::mutex> lk(_mutex);
+            if (_cancelled) {
+                break;
+            }
+            _results.append(written);
+            written += result.objsize();
+        }
+    } catch (const DBException& e) {
+        status = e.toStatus();
+    }
+
+    stdx::lock_guard<stdx::mutex> lk(_mutex);
+    _status = status;
+    _done = true;
+}
+
+boost::optional<BSONObj> AggregationStream::_nextInput() {
+    stdx::unique_lock<stdx::mutex> lk(_mutex);
+    _inputReady.wait(lk, [&] { return _cancelled || _finished || !_input.empty(); });
+    if (_cancelled || _input.empty()) {
+        return boost::none;
+    }
+
+    BSONObj doc = _input.front()[_inputPos++];
+    if (_inputPos == _input.front().size()) {
+        _input.pop_front();
+        _inputPos = 0;
+    }
+    _docsConsumed.fetchAndAdd(1);
+    return doc;
+}
+
+}  // namespace mongo
@@ -0,0 +1,167 @@
+/**
+ *    Copyright (C) 2019-present MongoDB, Inc.
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the Server Side Public License, version 1,
+ *    as published by MongoDB, Inc.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    Server Side Public License for more details.
+ *
+ *    You should have received a copy of the Server Side Public License
+ *    along with this program. If not, see
+ *    <http://www.mongodb.com/licensing/server-side-public-license>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the Server Side Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "mongo/base/status_with.h"
+#include "mongo/base/string_data.h"
+#include "mongo/bson/bsonobj.h"
+#include "mongo/bsonview/offset_index.h"
+#include "mongo/bsonview/temp_arena.h"
+#include "mongo/db/pipeline/pipeline.h"
+#include "mongo/db/service_context.h"
+#include "mongo/platform/atomic_word.h"
+#include "mongo/stdx/condition_variable.h"
+#include "mongo/stdx/mutex.h"
+#include "mongo/stdx/thread.h"
+
+namespace mongo {
+
+/**
+ * Runs an aggregation pipeline over docs handed to it, on a thread of its own, and keeps the
+ * results so they can be viewed like the docs of a file.
+ *
+ * As with BackgroundSearch, the docs are added a batch at a time by whoever knows where they are.
+ * The pipeline pulls them through a DocumentSource at its front, waiting when it has used them
+ * all, so streaming stages produce results as the file is read.  Blocking stages ($sort, $group)
+ * spill to tempDir (via the Sorter) rather than holding everything in memory, and the results are
+ * kept in a TempArena, for the same reason.
+ */
+class AggregationStream {
+    AggregationStream(const AggregationStream&) = delete;
+    AggregationStream& operator=(const AggregationStream&) = delete;
+
+public:
+    /**
+     * Batches waiting for the pipeline beyond which callers should stop adding more.
+     */
+    static constexpr size_t kMaxPendingBatches = 4;
+
+    /**
+     * Parses and optimizes the pipeline, and starts it running.  Fails if any stage is invalid,
+     * or needs a server (eg. $lookup, $out).
+     */
+    static StatusWith<std::unique_ptr<AggregationStream>> make(ServiceContext* service,
+                                                               const std::vector<BSONObj>& stages,
+                                                               std::string tempDir);
+
+    /**
+     * Parses a pipeline as typed in: a JSON array of stages, or a single stage.
+     */
+    static StatusWith<std::vector<BSONObj>> parseStages(StringData json);
+
+    ~AggregationStream();
+
+    /**
+     * Queues docs for the pipeline, in order.  They are copied into the pipeline as it reads
+     * them, so must stay valid until then (or until the stream is cancelled).
+     */
+    void add(std::vector<BSONObj> docs);
+
+    /**
+     * Whether the pipeline would run out of input without more soon.  False once it has stopped
+     * reading (eg. after a $limit).
+     */
+    bool wantsMore() const;
+
+    /**
+     * No more docs will be added.
+     */
+    void finish();
+
+    /**
+     * Abandons the pipeline, and waits for it to stop.
+     */
+    void cancel();
+
+    size_t numResults() const;
+
+    /**
+     * The i'th result, which must be < numResults().  It's in the stream's temporary file, so is
+     * only valid for as long as the stream is.
+     */
+    BSONObj result(size_t i) const;
+
+    /**
+     * Whether the pipeline has produced all its results, or failed.
+     */
+    bool isDone() const;
+
+    /**
+     * Why the pipeline failed, once it is done.
+     */
+    Status getStatus() const;
+
+    uint64_t docsConsumed() const {
+        return _docsConsumed.load();
+    }
+
+private:
+    class Source;
+
+    AggregationStream(ServiceContext::UniqueClient client,
+                      ServiceContext::UniqueOperationContext opCtx,
+                      std::string tempDir);
+
+    void _run();
+
+    // Waits for the next doc for the pipeline, or none once there are no more.
+    boost::optional<BSONObj> _nextInput();
+
+    const std::string _tempDir;
+    ServiceContext::UniqueClient _client;
+    ServiceContext::UniqueOperationContext _opCtx;
+    std::unique_ptr<Pipeline, PipelineDeleter> _pipeline;
+
+    AtomicWord<uint64_t> _docsConsumed{0};
+
+    // Guards everything below.
+    mutable stdx::mutex _mutex;
+    stdx::condition_variable _inputReady;
+    // Batches not yet read by the pipeline, the front one from _inputPos.
+    std::deque<std::vector<BSONObj>> _input;
+    size_t _inputPos = 0;
+    bool _finished = false;
+    bool _cancelled = false;
+    bool _done = false;
+    Status _status = Status::OK();
+    // Where each result is in _arena, which only the pipeline's thread writes to.
+    DocumentOffsetIndex _results;
+    std::unique_ptr<TempArena> _arena;
+
+    stdx::thread _thread;
+};
+
+}  // namespace mongo
@@ -0,0 +1,209 @@
+/**
+ *    Copyright (C) 2019-present MongoDB, Inc.
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the Server Side Public License, version 1,
+ *    as published by MongoDB, Inc.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    Server Side Public License for more details.
+ *
+ *    You should have received a copy of the Server Side Public License
+ *    along with this program. If not, see
+ *    <http://www.mongodb.com/licensing/server-side-public-license>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the Server Side Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include <boost/filesystem/operations.hpp>
+#include <memory>
+#include <vector>
+
+#include "mongo/bson/bsonobjbuilder.h"
+#include "mongo/bson/json.h"
+#include "mongo/bsonview/aggregation_stream.h"
+#include "mongo/db/query/query_knobs_gen.h"
+#include "mongo/db/service_context.h"
+#include "mongo/db/service_context_test_fixture.h"
+#include "mongo/stdx/thread.h"
+#include "mongo/unittest/temp_dir.h"
+#include "mongo/unittest/unittest.h"
+#include "mongo/util/scopeguard.h"
+
+namespace mongo {
+namespace {
+
+std::vector<BSONObj> makeDocs(int first, int n) {
+    std::vector<BSONObj> docs;
+    for (int i = first; i < first + n; i++) {
+        docs.push_back(BSON("_id" << i << "group" << i % 3));
+    }
+    return docs;
+}
+
+std::unique_ptr<AggregationStream> makeStream(ServiceContext* service, StringData pipeline) {
+    auto stages = AggregationStream::parseStages(pipeline);
+    ASSERT_OK(stages.getStatus());
+    auto stream = AggregationStream::make(service, stages.getValue(), "");
+    ASSERT_OK(stream.getStatus());
+    return std::move(stream.getValue());
+}
+
+void waitUntilDone(const AggregationStream& stream) {
+    while (!stream.isDone()) {
+        stdx::this_thread::yield();
+    }
+}
+
+TEST(AggregationStreamTest, ParsesAnArrayOrASingleStage) {
+    auto stages = AggregationStream::parseStages("[{$match: {a: 1}}, {$limit: 2}]");
+    ASSERT_OK(stages.getStatus());
+    ASSERT_EQ(stages.getValue().size(), 2U);
+    ASSERT_BSONOBJ_EQ(stages.getValue()[1], BSON("$limit" << 2));
+
+    stages = AggregationStream::parseStages("{$count: 'n'}");
+    ASSERT_OK(stages.getStatus());
+    ASSERT_EQ(stages.getValue().size(), 1U);
+
+    ASSERT_NOT_OK(AggregationStream::parseStages("[1, 2]").getStatus());
+    ASSERT_NOT_OK(AggregationStream::parseStages("{$match: ").getStatus());
+}
+
+TEST(AggregationStreamTest, InvalidStage) {
+    auto service = ServiceContext::make();
+    auto stream = AggregationStream::make(service.get(), {fromjson("{$nonsense: 1}")}, "");
+    ASSERT_NOT_OK(stream.getStatus());
+}
+
+TEST(AggregationStreamTest, StagesNeedingAServer) {
+    auto service = ServiceContext::make();
+    for (auto&& pipeline : {"{$indexStats: {}}",
+                            "{$collStats: {latencyStats: {}}}",
+                            "{$collStats: {count: {}}}",
+                            "{$out: 'out'}",
+                            "{$merge: {into: 'out'}}",
+                            "{$lookup: {from: 'o', localField: 'a', foreignField: 'b', as: 'c'}}",
+                            "[{$match: {}}, {$facet: {a: [{$graphLookup: {from: 'o'}}]}}]"}) {
+        auto stages = AggregationStream::parseStages(pipeline);
+        ASSERT_OK(stages.getStatus());
+        ASSERT_EQ(AggregationStream::make(service.get(), stages.getValue(), "").getStatus(),
+                  ErrorCodes::NotImplemented);
+    }
+}
+
+TEST(AggregationStreamTest, StreamsResultsAsDocsAreAdded) {
+    auto service = ServiceContext::make();
+    auto stream = makeStream(service.get(), "[{$match: {group: 0}}, {$project: {group: 0}}]");
+    stream->add(makeDocs(0, 30));
+    while (stream->numResults() < 10) {
+        stdx::this_thread::yield();
+    }
+    ASSERT(!stream->isDone());
+    ASSERT_BSONOBJ_EQ(stream->result(3), BSON("_id" << 9));
+
+    stream->add(makeDocs(30, 30));
+    stream->finish();
+    waitUntilDone(*stream);
+    ASSERT_OK(stream->getStatus());
+    ASSERT_EQ(stream->numResults(), 20U);
+    ASSERT_EQ(stream->docsConsumed(), 60U);
+}
+
+TEST(AggregationStreamTest, BlockingStagesWaitForFinish) {
+    auto service = ServiceContext::make();
+    auto stream = makeStream(
+        service.get(), "[{$group: {_id: '$group', n: {$sum: 1}}}, {$sort: {_id: -1}}]");
+    for (int first = 0; first < 3000; first += 100) {
+        stream->add(makeDocs(first, 100));
+    }
+    while (stream->docsConsumed() < 3000) {
+        stdx::this_thread::yield();
+    }
+    ASSERT_EQ(stream->numResults(), 0U);
+
+    stream->finish();
+    waitUntilDone(*stream);
+    ASSERT_OK(stream->getStatus());
+    ASSERT_EQ(stream->numResults(), 3U);
+    ASSERT_BSONOBJ_EQ(stream->result(0), BSON("_id" << 2 << "n" << 1000));
+}
+
+TEST(AggregationStreamTest, LimitStopsReadingBeforeFinish) {
+    auto service = ServiceContext::make();
+    auto stream = makeStream(service.get(), "{$limit: 5}");
+    stream->add(makeDocs(0, 10));
+    waitUntilDone(*stream);
+    ASSERT(!stream->wantsMore());
+    ASSERT_EQ(stream->numResults(), 5U);
+}
+
+TEST(AggregationStreamTest, RuntimeErrorsEndTheStream) {
+    auto service = ServiceContext::make();
+    auto stream = makeStream(service.get(), "{$project: {x: {$divide: [1, '$_id']}}}");
+    stream->add(makeDocs(1, 5));
+    stream->add(makeDocs(0, 5));
+    stream->finish();
+    waitUntilDone(*stream);
+    ASSERT_NOT_OK(stream->getStatus());
+    ASSERT_EQ(stream->numResults(), 5U);
+}
+
+TEST(AggregationStreamTest, Cancel) {
+    auto service = ServiceContext::make();
+    auto stream = makeStream(service.get(), "{$sort: {_id: -1}}");
+    stream->add(makeDocs(0, 1000));
+    stream->cancel();
+    ASSERT(stream->isDone());
+    ASSERT(!stream->wantsMore());
+}
+
+// Spilling needs the global ServiceContext, for the encryption hooks.
+class AggregationStreamSpillTest : public ServiceContextTest {};
+
+TEST_F(AggregationStreamSpillTest, SortSpillsToTempDir) {
+    const long long maxSortBytes = internalDocumentSourceSortMaxBlockingSortBytes.load();
+    internalDocumentSourceSortMaxBlockingSortBytes.store(64 * 1024);
+    ON_BLOCK_EXIT([&] { internalDocumentSourceSortMaxBlockingSortBytes.store(maxSortBytes); });
+
+    unittest::TempDir tempDir("aggregation_stream_test");
+    const std::string dir = tempDir.path() + "/bv";
+    {
+        auto stages = AggregationStream::parseStages("{$sort: {_id: -1}}");
+        ASSERT_OK(stages.getStatus());
+        auto swStream = AggregationStream::make(getServiceContext(), stages.getValue(), dir);
+        ASSERT_OK(swStream.getStatus());
+        auto& stream = swStream.getValue();
+        for (int first = 0; first < 20000; first += 1000) {
+            stream->add(makeDocs(first, 1000));
+        }
+        stream->finish();
+        waitUntilDone(*stream);
+        ASSERT_OK(stream->getStatus());
+        // (the Sorter only makes the directory when it spills)
+        ASSERT(boost::filesystem::exists(dir));
+
+        ASSERT_EQ(stream->numResults(), 20000U);
+        for (int i = 0; i < 20000; i++) {
+            const int id = 19999 - i;
+            ASSERT_BSONOBJ_EQ(stream->result(i), BSON("_id" << id << "group" << id % 3));
+        }
+    }
+    ASSERT(!boost::filesystem::exists(dir));
+}
+
+}  // namespace
+}  // namespace mongo
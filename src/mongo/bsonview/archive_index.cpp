@@ -0,0 +1,176 @@
+/**
+ *    Copyright (C) 2019-present MongoDB, Inc.
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the Server Side Public License, version 1,
+ *    as published by MongoDB, Inc.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    Server Side Public License for more details.
+ *
+ *    You should have received a copy of the Server Side Public License
+ *    along with this program. If not, see
+ *    <http://www.mongodb.com/licensing/server-side-public-license>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the Server Side Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/bsonview/archive_index.h"
+
+#include "mongo/base/data_type_endian.h"
+#include "mongo/base/data_view.h"
+#include "mongo/bson/bson_validate.h"
+#include "mongo/util/str.h"
+
+namespace mongo {
+
+namespace {
+
+constexpr int32_t kTerminator = -1;
+
+int32_t readInt32(const char* p) {
+    return ConstDataView(p).read<LittleEndian<int32_t>>();
+}
+
+}  // namespace
+
+bool ArchiveIndex::isArchive(const char* data, const char* end) {
+    return end - data >= 4 && ConstDataView(data).read<LittleEndian<uint32_t>>() == kMagic;
+}
+
+bool ArchiveIndex::hasNext(const char* end) const {
+    const char* p = _base + _offset;
+    if (end - p < 4) {
+        return false;
+    }
+    if (_state == State::kMagic) {
+        return true;
+    }
+    // Anything next() would reject as corrupt counts as whole.
+    const int32_t length = readInt32(p);
+    return length == kTerminator || length <= 0 || length > BSONObjMaxInternalSize ||
+        length <= end - p;
+}
+
+StatusWith<boost::optional<size_t>> ArchiveIndex::next() {
+    const char* p = _base + _offset;
+
+    if (_state == State::kMagic) {
+        if (!isArchive(p, p + 4)) {
+            return _corrupt("magic number");
+        }
+        _offset += 4;
+        _state = State::kPreludeHeader;
+        return {boost::none};
+    }
+
+    const int32_t length = readInt32(p);
+    if (length == kTerminator) {
+        _offset += 4;
+        switch (_state) {
+            case State::kPrelude:
+            case State::kSegment:
+                _state = State::kSegmentHeader;
+                return {boost::none};
+            default:
+                return _corrupt("terminator");
+        }
+    }
+
+    if (length < BSONObj::kMinBSONLength || length > BSONObjMaxInternalSize ||
+        p[length - 1] != EOO || !validateBSON(p, length, BSONVersion::kLatest).isOK()) {
+        return _corrupt("document");
+    }
+    BSONObj obj(p);
+    const uint64_t offset = _offset;
+    _offset += length;
+
+    switch (_state) {
+        case State::kMagic:
+            MONGO_UNREACHABLE;
+
+        case State::kPreludeHeader:
+            _header = obj;
+            _state = State::kPrelude;
+            return {boost::none};
+
+        case State::kPrelude: {
+            // Every collection is in the prelude, so empty ones are listed too.
+            if (obj["db"].type() != String || obj["collection"].type() != String) {
+                return _corrupt("collection metadata");
+            }
+            const size_t ns = _namespaceFor(obj["db"].valueStringData(),
+                                            obj["collection"].valueStringData());
+            _namespaces[ns].metadata = obj;
+            return {boost::none};
+        }
+
+        case State::kSegmentHeader:
+            if (obj["db"].type() != String || obj["collection"].type() != String) {
+                return _corrupt("namespace header");
+            }
+            _current =
+                _namespaceFor(obj["db"].valueStringData(), obj["collection"].valueStringData());
+            if (obj["EOF"].trueValue()) {
+                _namespaces[_current].complete = true;
+            }
+            _state = State::kSegment;
+            return {boost::none};
+
+        case State::kSegment:
+            _namespaces[_current].docs.append(offset);
+            return {_current};
+    }
+    MONGO_UNREACHABLE;
+}
+
+boost::optional<size_t> ArchiveIndex::findNamespace(StringData ns) const {
+    boost::optional<size_t> byCollection;
+    bool ambiguous = false;
+    auto it = _namespacesByName.find(ns);
+    if (it != _namespacesByName.end()) {
+        return it->second;
+    }
+    for (size_t i = 0; i < _namespaces.size(); i++) {
+        if (_namespaces[i].collection == ns) {
+            ambiguous = ambiguous || byCollection;
+            byCollection = i;
+        }
+    }
+    if (ambiguous) {
+        return boost::none;
+    }
+    return byCollection;
+}
+
+size_t ArchiveIndex::_namespaceFor(StringData db, StringData collection) {
+    auto inserted = _namespacesByName.emplace(str::stream() << db << "." << collection,
+                                              _namespaces.size());
+    if (inserted.second) {
+        _namespaces.emplace_back();
+        _namespaces.back().db = db.toString();
+        _namespaces.back().collection = collection.toString();
+    }
+    return inserted.first->second;
+}
+
+Status ArchiveIndex::_corrupt(StringData what) const {
+    return {ErrorCodes::InvalidBSON,
+            str::stream() << "Corrupt archive: invalid " << what << " at offset " << _offset};
+}
+
+}  // namespace mongo
@@ -0,0 +1,150 @@
+/**
+ *    Copyright (C) 2019-present MongoDB, Inc.
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the Server Side Public License, version 1,
+ *    as published by MongoDB, Inc.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    Server Side Public License for more details.
+ *
+ *    You should have received a copy of the Server Side Public License
+ *    along with this program. If not, see
+ *    <http://www.mongodb.com/licensing/server-side-public-license>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the Server Side Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#pragma once
+
+#include <boost/optional.hpp>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "mongo/base/status.h"
+#include "mongo/base/string_data.h"
+#include "mongo/bson/bsonobj.h"
+#include "mongo/bsonview/offset_index.h"
+#include "mongo/util/string_map.h"
+
+namespace mongo {
+
+/**
+ * Index of a mongodump archive (`mongodump --archive`), which holds several collections in one
+ * file.
+ *
+ * An archive starts with a magic number and a prelude: a header document, then a document of
+ * metadata for each collection, then a terminator (int32 -1).  The rest is a series of segments,
+ * each of a namespace header document, some of that namespace's documents, and a terminator.
+ * Since mongodump writes several collections at once, the segments of different namespaces are
+ * interleaved.  A namespace's last segment has "EOF" set in its header, and no documents.
+ *
+ * The archive is indexed in a single pass, an item (document or terminator) at a time, into a
+ * DocumentOffsetIndex per namespace.  Offsets are from the start of the archive.
+ */
+class ArchiveIndex {
+public:
+    static constexpr uint32_t kMagic = 0x8199e26d;
+
+    struct Namespace {
+        std::string db;
+        std::string collection;
+
+        // The namespace's document in the prelude (with its options and indexes), if it has one.
+        BSONObj metadata;
+
+        DocumentOffsetIndex docs;
+
+        // Whether the namespace's last segment has been seen.
+        bool complete = false;
+
+        std::string ns() const {
+            return db + "." + collection;
+        }
+    };
+
+    /**
+     * Whether `data` starts with the archive magic number.
+     */
+    static bool isArchive(const char* data, const char* end);
+
+    explicit ArchiveIndex(const char* base) : _base(base) {}
+
+    /**
+     * Whether there's a whole item at offset() (ie. before `end`) for next() to parse.
+     */
+    bool hasNext(const char* end) const;
+
+    /**
+     * Parses the item at offset(), which must be whole.  Returns the index of the namespace it
+     * added a document to, or boost::none if it wasn't a document.
+     */
+    StatusWith<boost::optional<size_t>> next();
+
+    /**
+     * How far through the archive has been parsed.
+     */
+    uint64_t offset() const {
+        return _offset;
+    }
+
+    /**
+     * The prelude's header (with the format and tool versions), once it has been parsed.
+     */
+    const BSONObj& header() const {
+        return _header;
+    }
+
+    size_t numNamespaces() const {
+        return _namespaces.size();
+    }
+
+    const Namespace& getNamespace(size_t i) const {
+        return _namespaces[i];
+    }
+
+    /**
+     * Returns the index of the namespace called `ns` ("db.collection"), or of the only one whose
+     * collection is called `ns`.
+     */
+    boost::optional<size_t> findNamespace(StringData ns) const;
+
+private:
+    enum class State {
+        kMagic,
+        kPreludeHeader,
+        kPrelude,
+        kSegmentHeader,
+        kSegment,
+    };
+
+    size_t _namespaceFor(StringData db, StringData collection);
+
+    Status _corrupt(StringData what) const;
+
+    const char* const _base;
+    uint64_t _offset = 0;
+    State _state = State::kMagic;
+
+    BSONObj _header;
+    std::vector<Namespace> _namespaces;
+    StringMap<size_t> _namespacesByName;
+
+    // Namespace of the segment being parsed.
+    size_t _current = 0;
+};
+
+}  // namespace mongo
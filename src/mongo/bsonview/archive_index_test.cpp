@@ -0,0 +1,210 @@
+/**
+ *    Copyright (C) 2019-present MongoDB, Inc.
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the Server Side Public License, version 1,
+ *    as published by MongoDB, Inc.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    Server Side Public License for more details.
+ *
+ *    You should have received a copy of the Server Side Public License
+ *    along with this program. If not, see
+ *    <http://www.mongodb.com/licensing/server-side-public-license>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the Server Side Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include <string>
+
+#include "mongo/base/data_type_endian.h"
+#include "mongo/base/data_view.h"
+#include "mongo/bson/bsonobjbuilder.h"
+#include "mongo/bsonview/archive_index.h"
+#include "mongo/unittest/unittest.h"
+
+namespace mongo {
+namespace {
+
+void appendInt32(std::string* out, uint32_t value) {
+    char buf[4];
+    DataView(buf).write<LittleEndian<uint32_t>>(value);
+    out->append(buf, 4);
+}
+
+void appendDoc(std::string* out, const BSONObj& obj) {
+    out->append(obj.objdata(), obj.objsize());
+}
+
+void appendSegment(std::string* out, StringData db, StringData coll, int first, int count) {
+    appendDoc(out, BSON("db" << db << "collection" << coll << "EOF" << false << "CRC" << 0LL));
+    for (int i = first; i < first + count; i++) {
+        appendDoc(out, BSON("_id" << i));
+    }
+    appendInt32(out, 0xFFFFFFFF);
+}
+
+void appendEOF(std::string* out, StringData db, StringData coll) {
+    appendDoc(out, BSON("db" << db << "collection" << coll << "EOF" << true << "CRC" << 0LL));
+    appendInt32(out, 0xFFFFFFFF);
+}
+
+/**
+ * An archive of test.a (5 docs), test.b (3 docs) and other.a (empty), with the segments of test.a
+ * and test.b interleaved.
+ */
+std::string makeArchive() {
+    std::string out;
+    appendInt32(&out, ArchiveIndex::kMagic);
+    appendDoc(&out, BSON("concurrent_collections" << 4 << "version"
+                                                  << "0.1"
+                                                  << "server_version"
+                                                  << "4.4.0"
+                                                  << "tool_version"
+                                                  << "100.0.0"));
+    for (auto ns : {std::make_pair("test", "a"), {"test", "b"}, {"other", "a"}}) {
+        appendDoc(&out,
+                  BSON("db" << ns.first << "collection" << ns.second << "metadata"
+                            << "{}"
+                            << "size" << 0 << "type"
+                            << "collection"));
+    }
+    appendInt32(&out, 0xFFFFFFFF);
+
+    appendSegment(&out, "test", "a", 0, 2);
+    appendSegment(&out, "test", "b", 100, 3);
+    appendSegment(&out, "test", "a", 2, 3);
+    appendEOF(&out, "test", "b");
+    appendEOF(&out, "test", "a");
+    appendEOF(&out, "other", "a");
+    return out;
+}
+
+void indexAll(ArchiveIndex* index, const std::string& archive) {
+    while (index->hasNext(archive.data() + archive.size())) {
+        ASSERT_OK(index->next().getStatus());
+    }
+}
+
+TEST(ArchiveIndexTest, DetectsArchive) {
+    const std::string archive = makeArchive();
+    ASSERT_TRUE(ArchiveIndex::isArchive(archive.data(), archive.data() + archive.size()));
+
+    const BSONObj obj = BSON("_id" << 1);
+    ASSERT_FALSE(ArchiveIndex::isArchive(obj.objdata(), obj.objdata() + obj.objsize()));
+}
+
+TEST(ArchiveIndexTest, IndexesEachNamespace) {
+    const std::string archive = makeArchive();
+    ArchiveIndex index(archive.data());
+    indexAll(&index, archive);
+    ASSERT_EQ(index.offset(), archive.size());
+    ASSERT_EQ(index.header()["tool_version"].str(), "100.0.0");
+
+    ASSERT_EQ(index.numNamespaces(), 3U);
+    const auto& a = index.getNamespace(0);
+    const auto& b = index.getNamespace(1);
+    const auto& empty = index.getNamespace(2);
+    ASSERT_EQ(a.ns(), "test.a");
+    ASSERT_EQ(b.ns(), "test.b");
+    ASSERT_EQ(empty.ns(), "other.a");
+    ASSERT_EQ(a.metadata["type"].str(), "collection");
+
+    ASSERT_EQ(a.docs.size(), 5U);
+    for (size_t i = 0; i < a.docs.size(); i++) {
+        ASSERT_EQ(BSONObj(archive.data() + a.docs[i])["_id"].numberInt(), int(i));
+    }
+    ASSERT_EQ(b.docs.size(), 3U);
+    ASSERT_EQ(BSONObj(archive.data() + b.docs[0])["_id"].numberInt(), 100);
+    ASSERT_EQ(empty.docs.size(), 0U);
+
+    ASSERT_TRUE(a.complete);
+    ASSERT_TRUE(b.complete);
+    ASSERT_TRUE(empty.complete);
+}
+
+TEST(ArchiveIndexTest, FindsNamespaces) {
+    const std::string archive = makeArchive();
+    ArchiveIndex index(archive.data());
+    indexAll(&index, archive);
+
+    ASSERT_EQ(*index.findNamespace("test.b"), 1U);
+    ASSERT_EQ(*index.findNamespace("b"), 1U);
+    ASSERT_EQ(*index.findNamespace("other.a"), 2U);
+    // Ambiguous.
+    ASSERT_FALSE(index.findNamespace("a"));
+    ASSERT_FALSE(index.findNamespace("test.c"));
+}
+
+TEST(ArchiveIndexTest, StopsBeforePartialItem) {
+    const std::string archive = makeArchive();
+    ArchiveIndex full(archive.data());
+    indexAll(&full, archive);
+
+    // Cut off part way through test.b's first document.
+    const size_t cut = full.getNamespace(1).docs[0] + 3;
+    ArchiveIndex partial(archive.data());
+    while (partial.hasNext(archive.data() + cut)) {
+        ASSERT_OK(partial.next().getStatus());
+    }
+    ASSERT_EQ(partial.offset(), full.getNamespace(1).docs[0]);
+    ASSERT_EQ(partial.getNamespace(0).docs.size(), 2U);
+    ASSERT_EQ(partial.getNamespace(1).docs.size(), 0U);
+
+    // And carries on when there's more.
+    indexAll(&partial, archive);
+    ASSERT_EQ(partial.getNamespace(1).docs.size(), 3U);
+}
+
+TEST(ArchiveIndexTest, RejectsCorruption) {
+    std::string archive = makeArchive();
+    ArchiveIndex full(archive.data());
+    indexAll(&full, archive);
+
+    // Make test.b's first document claim to be shorter than it is.
+    const size_t doc = full.getNamespace(1).docs[0];
+    archive[doc] = 7;
+
+    ArchiveIndex index(archive.data());
+    Status status = Status::OK();
+    while (status.isOK() && index.hasNext(archive.data() + archive.size())) {
+        status = index.next().getStatus();
+    }
+    ASSERT_NOT_OK(status);
+    ASSERT_EQ(index.offset(), doc);
+}
+
+TEST(ArchiveIndexTest, RejectsInvalidDocument) {
+    std::string archive = makeArchive();
+    ArchiveIndex full(archive.data());
+    indexAll(&full, archive);
+
+    // The length of test.b's first document is right, but its _id isn't a valid type.
+    const size_t doc = full.getNamespace(1).docs[0];
+    archive[doc + 4] = 0x42;
+
+    ArchiveIndex index(archive.data());
+    Status status = Status::OK();
+    while (status.isOK() && index.hasNext(archive.data() + archive.size())) {
+        status = index.next().getStatus();
+    }
+    ASSERT_NOT_OK(status);
+    ASSERT_EQ(index.offset(), doc);
+}
+
+}  // namespace
+}  // namespace mongo
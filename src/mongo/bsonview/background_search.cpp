@@ -0,0 +1,180 @@
+/**
+ *    Copyright (C) 2019-present MongoDB, Inc.
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the Server Side Public License, version 1,
+ *    as published by MongoDB, Inc.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    Server Side Public License for more details.
+ *
+ *    You should have received a copy of the Server Side Public License
+ *    along with this program. If not, see
+ *    <http://www.mongodb.com/licensing/server-side-public-license>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the Server Side Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/bsonview/background_search.h"
+
+#include <algorithm>
+
+#include "mongo/stdx/thread.h"
+#include "mongo/util/assert_util.h"
+#include "mongo/util/concurrency/thread_pool.h"
+
+namespace mongo {
+
+BackgroundSearch::BackgroundSearch(PredicateFactory makePredicate, Mode mode, size_t numThreads)
+    : _makePredicate(std::move(makePredicate)),
+      _mode(mode),
+      _numThreads(numThreads
+                      ? numThreads
+                      : std::max(1u, static_cast<unsigned>(stdx::thread::hardware_concurrency()))) {
+    ThreadPool::Options options;
+    options.poolName = "bsonview search";
+    options.threadNamePrefix = "bsonview-search-";
+    options.minThreads = 0;
+    options.maxThreads = _numThreads;
+    _pool = std::make_unique<ThreadPool>(options);
+    _pool->startup();
+}
+
+BackgroundSearch::~BackgroundSearch() {
+    cancel();
+}
+
+void BackgroundSearch::add(uint64_t first, std::vector<BSONObj> docs) {
+    uint64_t seq;
+    {
+        stdx::lock_guard<stdx::mutex> lk(_mutex);
+        invariant(!_finished);
+        seq = _firstSeq + _batches.size();
+        Batch batch;
+        batch.first = first;
+        batch.size = docs.size();
+        _batches.push_back(batch);
+    }
+
+    auto shared = std::make_shared<std::vector<BSONObj>>(std::move(docs));
+    _pool->schedule([this, seq, first, shared](Status status) {
+        _check(seq, first, status.isOK() ? *shared : std::vector<BSONObj>());
+    });
+}
+
+bool BackgroundSearch::wantsMore() const {
+    stdx::lock_guard<stdx::mutex> lk(_mutex);
+    return !_firstMatch && !_finished && _batches.size() < 2 * _numThreads;
+}
+
+void BackgroundSearch::finish() {
+    stdx::lock_guard<stdx::mutex> lk(_mutex);
+    _finished = true;
+}
+
+void BackgroundSearch::cancel() {
+    if (_pool) {
+        _cancelled.store(true);
+        _pool->shutdown();
+        _pool->join();
+        _pool.reset();
+    }
+}
+
+boost::optional<uint64_t> BackgroundSearch::firstMatch() const {
+    stdx::lock_guard<stdx::mutex> lk(_mutex);
+    return _firstMatch;
+}
+
+std::vector<uint64_t> BackgroundSearch::takeMatches() {
+    stdx::lock_guard<stdx::mutex> lk(_mutex);
+    std::vector<uint64_t> matches;
+    matches.swap(_matches);
+    return matches;
+}
+
+uint64_t BackgroundSearch::docsResolved() const {
+    stdx::lock_guard<stdx::mutex> lk(_mutex);
+    return _docsResolved;
+}
+
+bool BackgroundSearch::isDone() const {
+    stdx::lock_guard<stdx::mutex> lk(_mutex);
+    return _firstMatch || (_finished && _batches.empty());
+}
+
+void BackgroundSearch::_check(uint64_t seq, uint64_t first, const std::vector<BSONObj>& docs) {
+    Predicate matches;
+    {
+        stdx::lock_guard<stdx::mutex> lk(_mutex);
+        if (!_idlePredicates.empty()) {
+            matches = std::move(_idlePredicates.back());
+            _idlePredicates.pop_back();
+        }
+    }
+    if (!matches && !docs.empty()) {
+        matches = _makePredicate();
+    }
+
+    std::vector<uint64_t> found;
+    for (size_t i = 0; i < docs.size(); i++) {
+        if (_cancelled.load() || seq > _stopAfterSeq.load()) {
+            break;
+        }
+        bool matched = false;
+        try {
+            matched = matches(docs[i]);
+        } catch (const DBException&) {
+        }
+        _docsChecked.fetchAndAdd(1);
+        if (matched) {
+            found.push_back(first + i);
+            if (_mode == Mode::kFirst) {
+                break;
+            }
+        }
+    }
+
+    stdx::lock_guard<stdx::mutex> lk(_mutex);
+    if (matches) {
+        _idlePredicates.push_back(std::move(matches));
+    }
+    if (_mode == Mode::kFirst && !found.empty() && seq < _stopAfterSeq.load()) {
+        _stopAfterSeq.store(seq);
+    }
+    if (seq >= _firstSeq && seq - _firstSeq < _batches.size()) {
+        Batch& batch = _batches[seq - _firstSeq];
+        batch.checked = true;
+        batch.matches = std::move(found);
+    }
+    _resolve(lk);
+}
+
+void BackgroundSearch::_resolve(WithLock) {
+    while (!_firstMatch && !_batches.empty() && _batches.front().checked) {
+        const Batch& batch = _batches.front();
+        if (_mode == Mode::kFirst && !batch.matches.empty()) {
+            _firstMatch = batch.matches.front();
+        }
+        _matches.insert(_matches.end(), batch.matches.begin(), batch.matches.end());
+        _docsResolved += batch.size;
+        _batches.pop_front();
+        _firstSeq++;
+    }
+}
+
+}  // namespace mongo
@@ -0,0 +1,182 @@
+/**
+ *    Copyright (C) 2019-present MongoDB, Inc.
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the Server Side Public License, version 1,
+ *    as published by MongoDB, Inc.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    Server Side Public License for more details.
+ *
+ *    You should have received a copy of the Server Side Public License
+ *    along with this program. If not, see
+ *    <http://www.mongodb.com/licensing/server-side-public-license>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the Server Side Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#pragma once
+
+#include <boost/optional.hpp>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "mongo/bson/bsonobj.h"
+#include "mongo/platform/atomic_word.h"
+#include "mongo/stdx/mutex.h"
+#include "mongo/util/concurrency/with_lock.h"
+
+namespace mongo {
+
+class ThreadPool;
+
+/**
+ * Checks docs against a predicate on worker threads, to find the first that matches, or all of
+ * them.
+ *
+ * The docs are added a batch at a time, by whoever knows where they are (so they can be found as
+ * the file is indexed), and the batches needn't follow each other.  Batches are checked in
+ * parallel, and matches are reported in the order their batches were added, as soon as every
+ * batch added before theirs has been checked.  When only the first match is wanted, "first" means
+ * in that order, and batches added after a match are skipped.
+ */
+class BackgroundSearch {
+    BackgroundSearch(const BackgroundSearch&) = delete;
+    BackgroundSearch& operator=(const BackgroundSearch&) = delete;
+
+public:
+    /**
+     * A doc that makes it throw doesn't match.
+     */
+    using Predicate = std::function<bool(const BSONObj&)>;
+
+    /**
+     * Makes a predicate for a worker to use.  Each predicate is only used by one thread at a time,
+     * so needn't be thread-safe (eg. it can have its own copy of a MatchExpression).
+     */
+    using PredicateFactory = std::function<Predicate()>;
+
+    enum class Mode {
+        kFirst,
+        kAll,
+    };
+
+    /**
+     * Docs per batch that callers should aim for: enough that handing them out is cheap, few
+     * enough that a match is noticed promptly.
+     */
+    static constexpr size_t kBatchSize = 1024;
+
+    /**
+     * A numThreads of 0 means one thread per available core.
+     */
+    explicit BackgroundSearch(PredicateFactory makePredicate,
+                              Mode mode = Mode::kFirst,
+                              size_t numThreads = 0);
+    ~BackgroundSearch();
+
+    /**
+     * Queues docs numbered [first, first + docs.size()) to be checked.  Batches are searched in
+     * the order they're added, which needn't be the order of their numbers (eg. to wrap around to
+     * the start of the file).  The docs must stay valid until they have been checked (or the
+     * search is cancelled).
+     */
+    void add(uint64_t first, std::vector<BSONObj> docs);
+
+    /**
+     * Whether the workers would run out of batches without more soon.  Callers should add batches
+     * until this is false, rather than reading far ahead of the search.
+     */
+    bool wantsMore() const;
+
+    /**
+     * No more docs will be added.
+     */
+    void finish();
+
+    /**
+     * Abandons the search, and waits for the workers to stop.
+     */
+    void cancel();
+
+    /**
+     * The first matching doc, once it is known to be the first.
+     */
+    boost::optional<uint64_t> firstMatch() const;
+
+    /**
+     * The matching docs found since the last call, in the order their batches were added, not
+     * including any that might yet be preceded by others.  With Mode::kFirst, this is at most the first match.
+     */
+    std::vector<uint64_t> takeMatches();
+
+    /**
+     * Whether the search is over, either because the first match is known (with Mode::kFirst),
+     * or because every doc has been checked (after finish()).
+     */
+    bool isDone() const;
+
+    uint64_t docsChecked() const {
+        return _docsChecked.load();
+    }
+
+    /**
+     * How many of the docs added have been checked along with every doc added before them, so
+     * their matches have all been reported.
+     */
+    uint64_t docsResolved() const;
+
+private:
+    struct Batch {
+        uint64_t first;
+        size_t size;
+        bool checked = false;
+        std::vector<uint64_t> matches;
+    };
+
+    void _check(uint64_t seq, uint64_t first, const std::vector<BSONObj>& docs);
+
+    // Pops the checked batches at the front of _batches, stopping at the first match if that's all
+    // that's wanted.
+    void _resolve(WithLock);
+
+    const PredicateFactory _makePredicate;
+    const Mode _mode;
+    const size_t _numThreads;
+    std::unique_ptr<ThreadPool> _pool;
+
+    AtomicWord<bool> _cancelled{false};
+    // Batches after the earliest one known to contain a match needn't be checked (for kFirst).
+    AtomicWord<uint64_t> _stopAfterSeq{UINT64_MAX};
+    AtomicWord<uint64_t> _docsChecked{0};
+
+    // Guards everything below.
+    mutable stdx::mutex _mutex;
+    // Predicates not in use by a worker.
+    std::vector<Predicate> _idlePredicates;
+    // Batches that are still being checked, or that follow one that is.  The front one is
+    // numbered _firstSeq.
+    std::deque<Batch> _batches;
+    uint64_t _firstSeq = 0;
+    uint64_t _docsResolved = 0;
+    bool _finished = false;
+    boost::optional<uint64_t> _firstMatch;
+    std::vector<uint64_t> _matches;
+};
+
+}  // namespace mongo
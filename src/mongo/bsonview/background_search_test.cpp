@@ -0,0 +1,210 @@
+/**
+ *    Copyright (C) 2019-present MongoDB, Inc.
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the Server Side Public License, version 1,
+ *    as published by MongoDB, Inc.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    Server Side Public License for more details.
+ *
+ *    You should have received a copy of the Server Side Public License
+ *    along with this program. If not, see
+ *    <http://www.mongodb.com/licensing/server-side-public-license>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the Server Side Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include <algorithm>
+#include <memory>
+#include <set>
+#include <vector>
+
+#include "mongo/bson/bsonobjbuilder.h"
+#include "mongo/bsonview/background_search.h"
+#include "mongo/platform/atomic_word.h"
+#include "mongo/stdx/thread.h"
+#include "mongo/unittest/unittest.h"
+#include "mongo/util/assert_util.h"
+
+namespace mongo {
+namespace {
+
+std::vector<BSONObj> makeDocs(int first, int n) {
+    std::vector<BSONObj> docs;
+    for (int i = first; i < first + n; i++) {
+        docs.push_back(BSON("_id" << i));
+    }
+    return docs;
+}
+
+void waitUntilDone(const BackgroundSearch& search) {
+    while (!search.isDone()) {
+        stdx::this_thread::yield();
+    }
+}
+
+BackgroundSearch::PredicateFactory idIs(std::set<int> ids) {
+    return [ids] {
+        return [ids](const BSONObj& doc) { return ids.count(doc["_id"].numberInt()) > 0; };
+    };
+}
+
+TEST(BackgroundSearchTest, FindsFirstMatchAcrossBatches) {
+    // Later matches may well be found first, but mustn't be reported.
+    BackgroundSearch search(idIs({2500, 3000, 9000}), BackgroundSearch::Mode::kFirst, 4);
+    for (int first = 0; first < 10000; first += 100) {
+        search.add(first, makeDocs(first, 100));
+    }
+    search.finish();
+    waitUntilDone(search);
+    ASSERT(search.firstMatch());
+    ASSERT_EQ(*search.firstMatch(), 2500U);
+    ASSERT_GTE(search.docsChecked(), 2501U);
+}
+
+TEST(BackgroundSearchTest, NoMatch) {
+    BackgroundSearch search(idIs({}), BackgroundSearch::Mode::kFirst, 2);
+    search.add(10, makeDocs(10, 50));
+    search.add(60, makeDocs(60, 50));
+    ASSERT(!search.isDone());
+    search.finish();
+    waitUntilDone(search);
+    ASSERT(!search.firstMatch());
+    ASSERT_EQ(search.docsChecked(), 100U);
+}
+
+TEST(BackgroundSearchTest, NotDoneUntilFinished) {
+    BackgroundSearch search(idIs({}), BackgroundSearch::Mode::kFirst, 1);
+    search.add(0, makeDocs(0, 10));
+    while (search.docsChecked() < 10) {
+        stdx::this_thread::yield();
+    }
+    ASSERT(!search.isDone());
+    ASSERT(search.wantsMore());
+    search.finish();
+    waitUntilDone(search);
+    ASSERT(!search.wantsMore());
+}
+
+TEST(BackgroundSearchTest, MatchEndsSearchBeforeFinish) {
+    BackgroundSearch search(idIs({5}), BackgroundSearch::Mode::kFirst, 2);
+    search.add(0, makeDocs(0, 10));
+    waitUntilDone(search);
+    ASSERT_EQ(*search.firstMatch(), 5U);
+    ASSERT(!search.wantsMore());
+}
+
+TEST(BackgroundSearchTest, ExceptionsDontMatch) {
+    BackgroundSearch search(
+        [] {
+            return [](const BSONObj& doc) {
+                if (doc["_id"].numberInt() < 3) {
+                    uasserted(ErrorCodes::BadValue, "can't match");
+                }
+                return true;
+            };
+        },
+        BackgroundSearch::Mode::kFirst,
+        1);
+    search.add(0, makeDocs(0, 10));
+    waitUntilDone(search);
+    ASSERT_EQ(*search.firstMatch(), 3U);
+}
+
+TEST(BackgroundSearchTest, Cancel) {
+    BackgroundSearch search(
+        [] {
+            return [](const BSONObj& doc) {
+                stdx::this_thread::sleep_for(Milliseconds(1).toSystemDuration());
+                return false;
+            };
+        },
+        BackgroundSearch::Mode::kFirst,
+        2);
+    for (int first = 0; first < 100000; first += 1000) {
+        search.add(first, makeDocs(first, 1000));
+    }
+    search.cancel();
+    ASSERT_LT(search.docsChecked(), 100000U);
+    ASSERT(!search.firstMatch());
+}
+
+TEST(BackgroundSearchTest, FindsAllMatchesInOrder) {
+    std::set<int> ids;
+    for (int i = 0; i < 10000; i += 7) {
+        ids.insert(i);
+    }
+    BackgroundSearch search(idIs(ids), BackgroundSearch::Mode::kAll, 4);
+    std::vector<uint64_t> found;
+    for (int first = 0; first < 10000; first += 100) {
+        search.add(first, makeDocs(first, 100));
+        auto matches = search.takeMatches();
+        found.insert(found.end(), matches.begin(), matches.end());
+    }
+    search.finish();
+    waitUntilDone(search);
+    auto matches = search.takeMatches();
+    found.insert(found.end(), matches.begin(), matches.end());
+
+    ASSERT(!search.firstMatch());
+    ASSERT_EQ(search.docsChecked(), 10000U);
+    ASSERT_EQ(found.size(), ids.size());
+    ASSERT(std::equal(found.begin(), found.end(), ids.begin()));
+}
+
+TEST(BackgroundSearchTest, MatchesAreReportedInTheOrderBatchesWereAdded) {
+    // Searching from the middle, then wrapping around to the start.
+    BackgroundSearch search(idIs({10, 150, 160}), BackgroundSearch::Mode::kAll, 4);
+    search.add(100, makeDocs(100, 100));
+    search.add(0, makeDocs(0, 100));
+    search.finish();
+    waitUntilDone(search);
+    ASSERT_EQ(search.docsResolved(), 200U);
+    auto matches = search.takeMatches();
+    ASSERT_EQ(matches.size(), 3U);
+    ASSERT_EQ(matches[0], 150U);
+    ASSERT_EQ(matches[1], 160U);
+    ASSERT_EQ(matches[2], 10U);
+}
+
+TEST(BackgroundSearchTest, EachPredicateIsUsedByOneThreadAtATime) {
+    AtomicWord<int> made{0};
+    BackgroundSearch search(
+        [&made] {
+            made.fetchAndAdd(1);
+            auto inUse = std::make_shared<AtomicWord<bool>>(false);
+            return [inUse](const BSONObj& doc) {
+                ASSERT(!inUse->swap(true));
+                stdx::this_thread::yield();
+                inUse->store(false);
+                return false;
+            };
+        },
+        BackgroundSearch::Mode::kAll,
+        4);
+    for (int first = 0; first < 20000; first += 100) {
+        search.add(first, makeDocs(first, 100));
+    }
+    search.finish();
+    waitUntilDone(search);
+    ASSERT_EQ(search.docsChecked(), 20000U);
+    ASSERT_LTE(made.load(), 4);
+}
+
+}  // namespace
+}  // namespace mongo
@@ -0,0 +1,237 @@
+/**
+ *    Copyright (C) 2019-present MongoDB, Inc.
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the Server Side Public License, version 1,
+ *    as published by MongoDB, Inc.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    Server Side Public License for more details.
+ *
+ *    You should have received a copy of the Server Side Public License
+ *    along with this program. If not, see
+ *    <http://www.mongodb.com/licensing/server-side-public-license>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the Server Side Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/bsonview/byte_search.h"
+
+#include <cstring>
+#include <vector>
+
+#include "mongo/db/fts/unicode/byte_vector.h"
+#include "mongo/util/str.h"
+
+namespace mongo {
+
+#ifdef MONGO_HAVE_FAST_BYTE_VECTOR
+using unicode::ByteVector;
+#endif
+
+namespace {
+
+// How a non-string value of a type is rendered: some fixed words, and other parts (eg. digits)
+// made up of the characters in the alphabet.
+struct TypeRendering {
+    BSONType type;
+    std::vector<StringData> words;
+    StringData alphabet;
+};
+
+const TypeRendering kTypeRenderings[] = {
+    {NumberDouble, {"NaN", "-Infinity"}, "0123456789.+-e"},
+    {NumberInt, {"NumberInt"}, "0123456789-"},
+    {NumberLong, {"NumberLong", "$numberLong"}, "0123456789-"},
+    {NumberDecimal, {"NumberDecimal", "$numberDecimal", "NaN", "-Infinity"}, "0123456789.+-E"},
+    {Bool, {"true", "false"}, ""},
+    {jstNULL, {"null"}, ""},
+    {Undefined, {"undefined", "$undefined", "true"}, ""},
+    {jstOID, {"ObjectId", "$oid"}, "0123456789abcdef"},
+    {Date, {"Date", "$date", "$numberLong"}, "0123456789-+:.TZ"},
+    {bsonTimestamp, {"Timestamp", "$timestamp", "t", "i"}, "0123456789"},
+    {BinData,
+     {"$binary", "$type"},
+     "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/="},
+    {MinKey, {"$minKey", "1"}, ""},
+    {MaxKey, {"$maxKey", "1"}, ""},
+    // Gaps in arrays.
+    {Array, {"undefined"}, ""},
+};
+
+// Characters that separate the tokens of the JSON (besides whitespace and control characters).
+const StringData kPunctuation = "\"\\{}[](),:";
+
+// Characters that can follow the backslash of an escape sequence.
+const StringData kEscapeTail = "bfnrtu0123456789abcdef";
+
+bool isEscaped(unsigned char c) {
+    return c < 0x20 || c == '"' || c == '\\';
+}
+
+// Whether str::escape() would change s.
+bool needsEscaping(StringData s) {
+    const char* p = s.rawData();
+    const char* const end = p + s.size();
+#ifdef MONGO_HAVE_FAST_BYTE_VECTOR
+    for (; end - p >= ByteVector::size; p += ByteVector::size) {
+        const auto bytes = ByteVector::load(p);
+        // compareLT() may be signed, so ignore bytes with the high bit set.
+        const auto controls = bytes.compareLT(0x20).maskAny() & ~bytes.maskHigh();
+        if (controls || (bytes.compareEQ('"') | bytes.compareEQ('\\')).maskAny()) {
+            return true;
+        }
+    }
+#endif
+    for (; p < end; p++) {
+        if (isEscaped(*p)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+}  // namespace
+
+const char* SubstringSearcher::find(const char* p, const char* end) const {
+    const size_t n = _needle.size();
+    if (n == 0) {
+        return p;
+    }
+    if (static_cast<size_t>(end - p) < n) {
+        return nullptr;
+    }
+
+    const char first = _needle.front();
+#ifdef MONGO_HAVE_FAST_BYTE_VECTOR
+    const char last = _needle.back();
+    for (; static_cast<size_t>(end - p) >= n - 1 + ByteVector::size; p += ByteVector::size) {
+        auto candidates = (ByteVector::load(p).compareEQ(first) &
+                           ByteVector::load(p + n - 1).compareEQ(last))
+                              .maskAny();
+        while (candidates) {
+            const char* candidate = p + ByteVector::countInitialZeros(candidates);
+            if (memcmp(candidate + 1, _needle.data() + 1, n - 1) == 0) {
+                return candidate;
+            }
+            candidates &= candidates - 1;
+        }
+    }
+#endif
+    for (const char* lastStart = end - n; p <= lastStart; p++) {
+        p = static_cast<const char*>(memchr(p, first, lastStart - p + 1));
+        if (!p) {
+            return nullptr;
+        }
+        if (memcmp(p, _needle.data(), n) == 0) {
+            return p;
+        }
+    }
+    return nullptr;
+}
+
+boost::optional<JSONTextSearch> JSONTextSearch::make(StringData text) {
+    if (text.empty()) {
+        return boost::none;
+    }
+    for (char c : text) {
+        if (static_cast<unsigned char>(c) <= ' ' || kPunctuation.find(c) != std::string::npos) {
+            return boost::none;
+        }
+    }
+    return JSONTextSearch(text);
+}
+
+JSONTextSearch::JSONTextSearch(StringData text)
+    : _searcher(text.toString()),
+      _mayStartInEscape(kEscapeTail.find(text[0]) != std::string::npos) {
+    // Types not listed are rare enough to just render.
+    _mayBeInType.fill(true);
+    for (const auto& rendering : kTypeRenderings) {
+        bool mayBeIn = false;
+        for (auto word : rendering.words) {
+            mayBeIn |= word.find(text) != std::string::npos;
+        }
+        if (!rendering.alphabet.empty()) {
+            bool inAlphabet = true;
+            for (char c : text) {
+                inAlphabet &= rendering.alphabet.find(c) != std::string::npos;
+            }
+            mayBeIn |= inAlphabet;
+        }
+        _mayBeInType[static_cast<uint8_t>(rendering.type)] = mayBeIn;
+    }
+}
+
+JSONTextSearch::Result JSONTextSearch::search(const BSONObj& doc) const {
+    return _searchObj(doc, false);
+}
+
+JSONTextSearch::Result JSONTextSearch::_searchObj(const BSONObj& obj, bool isArray) const {
+    bool maybe = false;
+    for (auto&& elem : obj) {
+        Result result = Result::kNoMatch;
+        if (!isArray) {
+            result = _searchString(elem.fieldNameStringData());
+        } else if (_mayBeInType[static_cast<uint8_t>(Array)]) {
+            // (only if the array has gaps, which it's simplest to leave to rendering)
+            maybe = true;
+        }
+
+        if (result == Result::kNoMatch) {
+            switch (elem.type()) {
+                case String:
+                case Symbol:
+                case Code:
+                    result = _searchString(StringData(elem.valuestr(), elem.valuestrsize() - 1));
+                    break;
+                case Object:
+                    result = _searchObj(elem.embeddedObject(), false);
+                    break;
+                case Array:
+                    result = _searchObj(elem.embeddedObject(), true);
+                    break;
+                default:
+                    if (_mayBeInType[static_cast<uint8_t>(elem.type())]) {
+                        result = Result::kMaybe;
+                    }
+                    break;
+            }
+        }
+
+        if (result == Result::kMatch) {
+            return result;
+        }
+        maybe |= result == Result::kMaybe;
+    }
+    return maybe ? Result::kMaybe : Result::kNoMatch;
+}
+
+JSONTextSearch::Result JSONTextSearch::_searchString(StringData s) const {
+    // The text has nothing that needs escaping, so if it's in s, it's in the escaped s too.
+    if (_searcher.contains(s)) {
+        return Result::kMatch;
+    }
+    // But the escaped s may also have it starting within an escape sequence (eg. "nfoo" in
+    // "\nfoo").
+    if (_mayStartInEscape && needsEscaping(s) && _searcher.contains(str::escape(s))) {
+        return Result::kMatch;
+    }
+    return Result::kNoMatch;
+}
+
+}  // namespace mongo
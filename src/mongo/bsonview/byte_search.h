@@ -0,0 +1,111 @@
+/**
+ *    Copyright (C) 2019-present MongoDB, Inc.
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the Server Side Public License, version 1,
+ *    as published by MongoDB, Inc.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    Server Side Public License for more details.
+ *
+ *    You should have received a copy of the Server Side Public License
+ *    along with this program. If not, see
+ *    <http://www.mongodb.com/licensing/server-side-public-license>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the Server Side Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#pragma once
+
+#include <array>
+#include <boost/optional.hpp>
+#include <string>
+
+#include "mongo/base/string_data.h"
+#include "mongo/bson/bsonobj.h"
+
+namespace mongo {
+
+/**
+ * Finds a fixed string in bytes, a vector at a time where the platform allows.  Candidates are
+ * positions where both the first and last bytes of the string match, which are then checked in
+ * full.
+ */
+class SubstringSearcher {
+public:
+    explicit SubstringSearcher(std::string needle) : _needle(std::move(needle)) {}
+
+    /**
+     * The first occurrence of the needle in [begin, end), or nullptr.
+     */
+    const char* find(const char* begin, const char* end) const;
+
+    bool contains(StringData haystack) const {
+        return find(haystack.rawData(), haystack.rawData() + haystack.size());
+    }
+
+    const std::string& needle() const {
+        return _needle;
+    }
+
+private:
+    const std::string _needle;
+};
+
+/**
+ * Looks for text in what BSONObj::jsonString() would produce for a doc (in either format, pretty
+ * or not), without producing it.
+ *
+ * Only works for text that can't span more than one token of the JSON, ie. that has no quotes,
+ * backslashes, whitespace, control characters or JSON (or TenGen) punctuation.  Such text can only
+ * be found within a key, a string, or the rendering of a single non-string value.  Keys and
+ * strings are searched in place (escaping them first only if they need it, and the text could
+ * start within an escape sequence).  Other values can only be found by rendering them, but the
+ * text can often be ruled out from its characters (eg. "error" is never part of a number), in
+ * which case they're skipped.
+ */
+class JSONTextSearch {
+public:
+    enum class Result {
+        kNoMatch,
+        kMatch,
+        // Some value might render as the text, so the doc has to be rendered to be sure.
+        kMaybe,
+    };
+
+    /**
+     * Returns boost::none if `text` is empty or could span tokens.
+     */
+    static boost::optional<JSONTextSearch> make(StringData text);
+
+    Result search(const BSONObj& doc) const;
+
+private:
+    explicit JSONTextSearch(StringData text);
+
+    Result _searchObj(const BSONObj& obj, bool isArray) const;
+    Result _searchString(StringData s) const;
+
+    SubstringSearcher _searcher;
+
+    // Whether the text could start within the escape sequence for a character.
+    bool _mayStartInEscape;
+
+    // Whether the text could be part of how a value of each type (as a uint8_t) is rendered.
+    // The entry for Array is whether it could be part of a gap in the array.
+    std::array<bool, 256> _mayBeInType;
+};
+
+}  // namespace mongo
@@ -0,0 +1,231 @@
+/**
+ *    Copyright (C) 2019-present MongoDB, Inc.
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the Server Side Public License, version 1,
+ *    as published by MongoDB, Inc.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    Server Side Public License for more details.
+ *
+ *    You should have received a copy of the Server Side Public License
+ *    along with this program. If not, see
+ *    <http://www.mongodb.com/licensing/server-side-public-license>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the Server Side Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include <string>
+#include <vector>
+
+#include "mongo/bson/bsonobjbuilder.h"
+#include "mongo/bsonview/byte_search.h"
+#include "mongo/platform/random.h"
+#include "mongo/unittest/unittest.h"
+
+namespace mongo {
+namespace {
+
+const char* findSlowly(const std::string& haystack, const std::string& needle) {
+    auto pos = haystack.find(needle);
+    return pos == std::string::npos ? nullptr : haystack.data() + pos;
+}
+
+TEST(SubstringSearcherTest, MatchesStringFind) {
+    PseudoRandom random(1);
+    for (int i = 0; i < 2000; i++) {
+        // A small alphabet, so that there are plenty of near misses.
+        std::string haystack;
+        const int haystackLength = random.nextInt32(100);
+        for (int j = 0; j < haystackLength; j++) {
+            haystack += "abc"[random.nextInt32(3)];
+        }
+        std::string needle;
+        const int needleLength = 1 + random.nextInt32(6);
+        for (int j = 0; j < needleLength; j++) {
+            needle += "abc"[random.nextInt32(3)];
+        }
+
+        SubstringSearcher searcher(needle);
+        ASSERT_EQ(static_cast<const void*>(
+                      searcher.find(haystack.data(), haystack.data() + haystack.size())),
+                  static_cast<const void*>(findSlowly(haystack, needle)))
+            << "needle " << needle << " haystack " << haystack;
+    }
+}
+
+TEST(SubstringSearcherTest, EdgeCases) {
+    SubstringSearcher empty("");
+    std::string s = "abc";
+    ASSERT_EQ(empty.find(s.data(), s.data() + 3), s.data());
+
+    SubstringSearcher longer("abcd");
+    ASSERT_FALSE(longer.contains(s));
+
+    // Bytes with the high bit set are nothing special.
+    std::string utf8 = std::string(40, 'x') + "caf\xc3\xa9";
+    ASSERT_TRUE(SubstringSearcher("\xc3\xa9").contains(utf8));
+    ASSERT_FALSE(SubstringSearcher("\xc3\xa8").contains(utf8));
+}
+
+TEST(JSONTextSearchTest, OnlyTextWithinATokenCanBeSearched) {
+    ASSERT_FALSE(JSONTextSearch::make(""));
+    ASSERT_FALSE(JSONTextSearch::make("a b"));
+    ASSERT_FALSE(JSONTextSearch::make("\"a\""));
+    ASSERT_FALSE(JSONTextSearch::make("a:"));
+    ASSERT_FALSE(JSONTextSearch::make("a\\n"));
+    ASSERT_TRUE(JSONTextSearch::make("connection-accepted"));
+    ASSERT_TRUE(JSONTextSearch::make("caf\xc3\xa9"));
+}
+
+TEST(JSONTextSearchTest, SearchesKeysAndStrings) {
+    auto search = *JSONTextSearch::make("needle");
+    using Result = JSONTextSearch::Result;
+
+    ASSERT(search.search(BSON("a"
+                              << "haystack with a needle in it"))
+               == Result::kMatch);
+    ASSERT(search.search(BSON("needles" << 1)) == Result::kMatch);
+    ASSERT(search.search(BSON("a" << BSON("b" << BSON_ARRAY("x"
+                                                             << "needle"))))
+               == Result::kMatch);
+    ASSERT(search.search(BSON("a"
+                              << "haystack"
+                              << "n" << 1 << "t" << true << "d" << 1.5))
+               == Result::kNoMatch);
+
+    // Array indexes aren't rendered.
+    auto zero = *JSONTextSearch::make("0");
+    ASSERT(zero.search(BSON("a" << BSON_ARRAY("x"))) == Result::kNoMatch);
+}
+
+TEST(JSONTextSearchTest, OtherValuesMayMatch) {
+    using Result = JSONTextSearch::Result;
+    ASSERT(JSONTextSearch::make("123")->search(BSON("a" << 5)) == Result::kMaybe);
+    ASSERT(JSONTextSearch::make("tru")->search(BSON("a" << false)) == Result::kMaybe);
+    ASSERT(JSONTextSearch::make("oid")->search(BSON("a" << OID())) == Result::kMaybe);
+    ASSERT(JSONTextSearch::make("oid")->search(BSON("a" << 5)) == Result::kNoMatch);
+}
+
+TEST(JSONTextSearchTest, TextStartingInAnEscape) {
+    using Result = JSONTextSearch::Result;
+    ASSERT(JSONTextSearch::make("nfoo")->search(BSON("a"
+                                                     << "\nfoo"))
+               == Result::kMatch);
+    ASSERT(JSONTextSearch::make("u0001")->search(BSON("a"
+                                                      << "\x01"))
+               == Result::kMatch);
+    ASSERT(JSONTextSearch::make("xfoo")->search(BSON("a"
+                                                     << "\nfoo"))
+               == Result::kNoMatch);
+}
+
+// Whatever the doc and text, the search must agree with rendering the doc.
+TEST(JSONTextSearchTest, AgreesWithRendering) {
+    PseudoRandom random(2);
+    const char* words[] = {"a", "b", "1", "0", "-", "e", "n", "t", "true", "null", "NaN", "$oid"};
+    auto randomString = [&] {
+        std::string s;
+        const int n = random.nextInt32(4);
+        for (int i = 0; i < n; i++) {
+            s += random.nextInt32(8) ? words[random.nextInt32(12)] : "\n";
+        }
+        return s;
+    };
+
+    std::vector<BSONObj> docs;
+    for (int i = 0; i < 300; i++) {
+        BSONObjBuilder bob;
+        const int n = random.nextInt32(5);
+        for (int j = 0; j < n; j++) {
+            const std::string key = randomString();
+            switch (random.nextInt32(9)) {
+                case 0:
+                    bob.append(key, randomString());
+                    break;
+                case 1:
+                    bob.append(key, random.nextInt32(2000) - 1000);
+                    break;
+                case 2:
+                    bob.append(key, random.nextInt64());
+                    break;
+                case 3:
+                    bob.append(key, random.nextCanonicalDouble() * 1e6);
+                    break;
+                case 4:
+                    bob.append(key, random.nextInt32(2) == 0);
+                    break;
+                case 5:
+                    bob.appendNull(key);
+                    break;
+                case 6:
+                    bob.append(key, OID::gen());
+                    break;
+                case 7:
+                    bob.append(key,
+                               BSON_ARRAY(randomString() << 1 << BSON("x" << randomString())));
+                    break;
+                case 8:
+                    bob.appendDate(key, Date_t::fromMillisSinceEpoch(random.nextInt64(1LL << 42)));
+                    break;
+            }
+        }
+        docs.push_back(bob.obj());
+    }
+
+    const char* texts[] = {"a", "1", "10", "e", "n", "nan", "ru", "$", "$o", "oid", "ObjectId",
+                           "Number", "-", "b1", "ta", "u000a", "ntrue", "T", "Z", "ll"};
+    int results[3] = {0, 0, 0};
+    for (const char* text : texts) {
+        auto search = *JSONTextSearch::make(text);
+        for (const auto& doc : docs) {
+            bool rendered = false;
+            for (auto format : {Strict, TenGen}) {
+                for (int pretty : {0, 1}) {
+                    rendered |= doc.jsonString(format, pretty).find(text) != std::string::npos;
+                }
+            }
+            bool renderedEveryWay = true;
+            for (auto format : {Strict, TenGen}) {
+                for (int pretty : {0, 1}) {
+                    renderedEveryWay &=
+                        doc.jsonString(format, pretty).find(text) != std::string::npos;
+                }
+            }
+            const auto result = search.search(doc);
+            results[static_cast<int>(result)]++;
+            switch (result) {
+                case JSONTextSearch::Result::kMatch:
+                    ASSERT_TRUE(renderedEveryWay) << text << " " << doc.jsonString();
+                    break;
+                case JSONTextSearch::Result::kNoMatch:
+                    ASSERT_FALSE(rendered) << text << " " << doc.jsonString();
+                    break;
+                case JSONTextSearch::Result::kMaybe:
+                    break;
+            }
+        }
+    }
+
+    // All three outcomes should have been tested.
+    for (int count : results) {
+        ASSERT_GT(count, 0);
+    }
+}
+
+}  // namespace
+}  // namespace mongo
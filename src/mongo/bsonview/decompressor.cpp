@@ -0,0 +1,854 @@
+/**
+ *    Copyright (C) 2019-present MongoDB, Inc.
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the Server Side Public License, version 1,
+ *    as published by MongoDB, Inc.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    Server Side Public License for more details.
+ *
+ *    You should have received a copy of the Server Side Public License
+ *    along with this program. If not, see
+ *    <http://www.mongodb.com/licensing/server-side-public-license>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the Server Side Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/bsonview/decompressor.h"
+
+#include <algorithm>
+#include <cstring>
+#include <deque>
+#include <snappy.h>
+#include <vector>
+#include <zlib.h>
+#include <zstd.h>
+
+#include <boost/optional.hpp>
+
+#include "mongo/base/data_type_endian.h"
+#include "mongo/base/data_view.h"
+#include "mongo/bsonview/document_boundary.h"
+#include "mongo/stdx/condition_variable.h"
+#include "mongo/stdx/mutex.h"
+#include "mongo/stdx/thread.h"
+#include "mongo/util/assert_util.h"
+#include "mongo/util/concurrency/thread_pool.h"
+#include "mongo/util/str.h"
+
+namespace mongo {
+
+namespace {
+
+// Most that's decompressed by one read(), so the reader thread can notice when it should stop.
+constexpr size_t kMaxReadSize = 4 * 1024 * 1024;
+
+// zlib counts in uInt.
+constexpr size_t kMaxZlibChunk = 1 << 30;
+
+// Frames are decompressed this many per thread ahead of what has been read...
+constexpr size_t kFramesInFlightPerThread = 4;
+
+// ...up to this many bytes of them.
+constexpr uint64_t kMaxBytesInFlight = 256 * 1024 * 1024;
+
+// Larger frames than this are taken to be corrupt, rather than allocated.
+constexpr uint64_t kMaxFrameSize = 1 << 30;
+
+constexpr uint32_t kZstdMagic = 0xFD2FB528;
+constexpr uint32_t kZstdSkippableFrameMagic = 0x184D2A5E;
+constexpr uint32_t kZstdSeekTableMagic = 0x8F92EAB1;
+constexpr size_t kZstdSeekTableFooterSize = 9;
+
+constexpr char kGzipMagic[] = "\x1f\x8b\x08";
+constexpr size_t kGzipWindowSize = 32 * 1024;
+constexpr char kSnappyStreamIdentifier[] = "\xff\x06\x00\x00sNaPpY";
+
+uint32_t readLE32(const char* p) {
+    return ConstDataView(p).read<LittleEndian<uint32_t>>();
+}
+
+uint16_t readLE16(const char* p) {
+    return ConstDataView(p).read<LittleEndian<uint16_t>>();
+}
+
+bool startsWith(const char* data, const char* end, const char* prefix, size_t len) {
+    return size_t(end - data) >= len && memcmp(data, prefix, len) == 0;
+}
+
+Status decompressionError(CompressionFormat format, StringData reason) {
+    return {ErrorCodes::FileStreamFailed,
+            str::stream() << "Unable to decompress " << compressionFormatName(format)
+                          << " input: " << reason};
+}
+
+/**
+ * Where in the compressed input a source can start again.
+ */
+struct CompressedCheckpoint : public StreamStorage::Source::Checkpoint {
+    explicit CompressedCheckpoint(uint64_t pos) : pos(pos) {}
+
+    uint64_t pos;
+
+    // gzip can also start again between the deflate blocks of a member, as zran.c (in zlib's
+    // examples) does: given how many bits of the byte before `pos` are left to be read, and the
+    // 32KiB of output before, which what follows may refer back to.  That's kept compressed.
+    bool midMember = false;
+    int bits = 0;
+    std::string window;
+    size_t windowSize = 0;
+};
+
+/**
+ * Base for the sources, which decompress from a mapping of the whole compressed file.
+ */
+class CompressedSource : public StreamStorage::Source {
+public:
+    explicit CompressedSource(std::shared_ptr<BSONStorage> compressed)
+        : _compressed(std::move(compressed)),
+          _begin(_compressed->base()),
+          _end(_compressed->end()) {}
+
+    /**
+     * A restart, from `pos`.  Leaves dropping the compressed input to the original.
+     */
+    CompressedSource(std::shared_ptr<BSONStorage> compressed, uint64_t pos)
+        : CompressedSource(std::move(compressed)) {
+        _pos = pos;
+        _restarted = true;
+    }
+
+    bool atEnd() const override {
+        return _atEnd;
+    }
+
+protected:
+    uint64_t _remaining() const {
+        return _end - (_begin + _pos);
+    }
+
+    /**
+     * Notes that the compressed input up to `to` is no longer needed.
+     */
+    void _consumed(uint64_t to) {
+        if (!_restarted) {
+            _compressed->scanned(_scannedTo, to);
+            _scannedTo = to;
+        }
+    }
+
+    const std::shared_ptr<BSONStorage> _compressed;
+    const char* const _begin;
+    const char* const _end;
+
+    // How far through the compressed input we are.
+    uint64_t _pos = 0;
+    bool _atEnd = false;
+
+private:
+    bool _restarted = false;
+    uint64_t _scannedTo = 0;
+};
+
+/**
+ * gzip, including files of several concatenated members.
+ */
+class GzipSource : public CompressedSource {
+public:
+    using CompressedSource::CompressedSource;
+
+    GzipSource(std::shared_ptr<BSONStorage> compressed, const CompressedCheckpoint& checkpoint)
+        : CompressedSource(std::move(compressed), checkpoint.pos), _checkpoint(checkpoint) {}
+
+    ~GzipSource() {
+        if (_initialized) {
+            inflateEnd(&_stream);
+        }
+    }
+
+    StatusWith<size_t> read(char* buf, size_t len) override {
+        if (!_initialized) {
+            auto status = _init();
+            if (!status.isOK()) {
+                return status;
+            }
+        }
+
+        const char* in = _begin + _pos;
+        _stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(in));
+        _stream.avail_in = std::min<uint64_t>(_remaining(), kMaxZlibChunk);
+        _stream.next_out = reinterpret_cast<Bytef*>(buf);
+        _stream.avail_out = std::min({len, kMaxReadSize, kMaxZlibChunk});
+
+        // Stopping at the end of each block gives somewhere to checkpoint.
+        const int ret = inflate(&_stream, Z_BLOCK);
+        const size_t consumed = reinterpret_cast<const char*>(_stream.next_in) - in;
+        const size_t produced = reinterpret_cast<char*>(_stream.next_out) - buf;
+        _pos += consumed;
+        _consumed(_pos);
+        _atMemberStart = false;
+        _atBlockEnd = ret == Z_OK && (_stream.data_type & 128) && !(_stream.data_type & 64);
+
+        if (ret == Z_STREAM_END && _raw) {
+            // Restarted part way through a member, so its trailer is still to be skipped.
+            constexpr size_t kTrailerSize = 8;
+            if (_remaining() < kTrailerSize) {
+                return decompressionError(CompressionFormat::kGzip, "input is truncated");
+            }
+            _pos += kTrailerSize;
+        }
+        if (ret == Z_STREAM_END) {
+            // Another member may follow.  Anything else (eg. padding) is ignored.
+            if (startsWith(_begin + _pos, _end, kGzipMagic, sizeof(kGzipMagic) - 1)) {
+                inflateReset2(&_stream, 16 + MAX_WBITS);
+                _raw = false;
+                _atMemberStart = true;
+            } else {
+                _atEnd = true;
+            }
+        } else if (ret == Z_BUF_ERROR && _remaining() == 0) {
+            if (produced == 0) {
+                return decompressionError(CompressionFormat::kGzip, "input is truncated");
+            }
+        } else if (ret != Z_OK) {
+            return decompressionError(CompressionFormat::kGzip,
+                                      _stream.msg ? _stream.msg : "input is corrupt");
+        }
+        return produced;
+    }
+
+    std::unique_ptr<Checkpoint> checkpoint() override {
+        if (_atEnd || !(_atMemberStart || _atBlockEnd)) {
+            return nullptr;
+        }
+        auto checkpoint = std::make_unique<CompressedCheckpoint>(_pos);
+        if (_atMemberStart) {
+            return std::move(checkpoint);
+        }
+
+        checkpoint->midMember = true;
+        checkpoint->bits = _stream.data_type & 7;
+        std::string window(kGzipWindowSize, '\0');
+        uInt windowSize = window.size();
+        if (inflateGetDictionary(&_stream, reinterpret_cast<Bytef*>(&window[0]), &windowSize) !=
+            Z_OK) {
+            return nullptr;
+        }
+        uLongf compressedSize = compressBound(windowSize);
+        checkpoint->window.resize(compressedSize);
+        if (compress(reinterpret_cast<Bytef*>(&checkpoint->window[0]),
+                     &compressedSize,
+                     reinterpret_cast<const Bytef*>(window.data()),
+                     windowSize) != Z_OK) {
+            return nullptr;
+        }
+        checkpoint->window.resize(compressedSize);
+        checkpoint->windowSize = windowSize;
+        return std::move(checkpoint);
+    }
+
+    std::unique_ptr<Source> restart(const Checkpoint& checkpoint) const override {
+        return std::make_unique<GzipSource>(_compressed,
+                                            static_cast<const CompressedCheckpoint&>(checkpoint));
+    }
+
+private:
+    Status _init() {
+        _raw = _checkpoint && _checkpoint->midMember;
+        if (inflateInit2(&_stream, _raw ? -MAX_WBITS : 16 + MAX_WBITS) != Z_OK) {
+            return decompressionError(CompressionFormat::kGzip, "out of memory");
+        }
+        _initialized = true;
+        if (!_raw) {
+            return Status::OK();
+        }
+
+        if (_checkpoint->bits) {
+            const uint8_t last = _begin[_pos - 1];
+            inflatePrime(&_stream, _checkpoint->bits, last >> (8 - _checkpoint->bits));
+        }
+        std::string window(_checkpoint->windowSize, '\0');
+        uLongf windowSize = window.size();
+        if (uncompress(reinterpret_cast<Bytef*>(&window[0]),
+                       &windowSize,
+                       reinterpret_cast<const Bytef*>(_checkpoint->window.data()),
+                       _checkpoint->window.size()) != Z_OK ||
+            inflateSetDictionary(
+                &_stream, reinterpret_cast<const Bytef*>(window.data()), windowSize) != Z_OK) {
+            return decompressionError(CompressionFormat::kGzip, "checkpoint is corrupt");
+        }
+        return Status::OK();
+    }
+
+    // Where a restarted source started.
+    boost::optional<CompressedCheckpoint> _checkpoint;
+
+    z_stream _stream{};
+    bool _initialized = false;
+    // Inflating a deflate stream without its gzip header, having restarted part way through it.
+    bool _raw = false;
+    bool _atMemberStart = true;
+    bool _atBlockEnd = false;
+};
+
+/**
+ * zstd, including files of several frames.
+ */
+class ZstdSource : public CompressedSource {
+public:
+    explicit ZstdSource(std::shared_ptr<BSONStorage> compressed)
+        : CompressedSource(std::move(compressed)), _stream(ZSTD_createDStream()) {}
+
+    /**
+     * A restart, at the start of a frame.
+     */
+    ZstdSource(std::shared_ptr<BSONStorage> compressed, uint64_t pos)
+        : CompressedSource(std::move(compressed), pos), _stream(ZSTD_createDStream()) {}
+
+    ~ZstdSource() {
+        ZSTD_freeDStream(_stream);
+    }
+
+    StatusWith<size_t> read(char* buf, size_t len) override {
+        if (!_stream) {
+            return decompressionError(CompressionFormat::kZstd, "out of memory");
+        }
+
+        ZSTD_inBuffer in{_begin, size_t(_end - _begin), _pos};
+        ZSTD_outBuffer out{buf, std::min(len, kMaxReadSize), 0};
+        const size_t ret = ZSTD_decompressStream(_stream, &out, &in);
+        if (ZSTD_isError(ret)) {
+            return decompressionError(CompressionFormat::kZstd, ZSTD_getErrorName(ret));
+        }
+        _pos = in.pos;
+        _consumed(_pos);
+
+        if (_remaining() == 0) {
+            if (ret == 0) {
+                _atEnd = true;
+            } else if (out.pos == 0) {
+                return decompressionError(CompressionFormat::kZstd, "input is truncated");
+            }
+        }
+        return out.pos;
+    }
+
+private:
+    ZSTD_DStream* const _stream;
+};
+
+/**
+ * Snappy's framing format (as written by `snzip -t framing2`, python-snappy, etc).  Raw snappy
+ * has no magic number, so isn't recognised.
+ */
+class SnappySource : public CompressedSource {
+public:
+    using CompressedSource::CompressedSource;
+
+    StatusWith<size_t> read(char* buf, size_t len) override {
+        len = std::min(len, kMaxReadSize);
+        size_t produced = 0;
+        while (produced < len) {
+            if (_pendingPos == _pending.size()) {
+                // Stopping between chunks gives somewhere to checkpoint.
+                if (produced) {
+                    break;
+                }
+                if (_remaining() == 0) {
+                    _atEnd = true;
+                    break;
+                }
+                auto status = _nextChunk();
+                if (!status.isOK()) {
+                    return status;
+                }
+                continue;
+            }
+
+            const size_t n = std::min(len - produced, _pending.size() - _pendingPos);
+            memcpy(buf + produced, _pending.data() + _pendingPos, n);
+            produced += n;
+            _pendingPos += n;
+        }
+        _consumed(_pos);
+        return produced;
+    }
+
+    std::unique_ptr<Checkpoint> checkpoint() override {
+        if (_pendingPos != _pending.size()) {
+            return nullptr;
+        }
+        return std::make_unique<CompressedCheckpoint>(_pos);
+    }
+
+    std::unique_ptr<Source> restart(const Checkpoint& checkpoint) const override {
+        return std::make_unique<SnappySource>(
+            _compressed, static_cast<const CompressedCheckpoint&>(checkpoint).pos);
+    }
+
+private:
+    static constexpr size_t kChunkHeaderSize = 4;
+    static constexpr size_t kChecksumSize = 4;
+    static constexpr size_t kMaxChunkData = 65536;
+
+    /**
+     * Decodes the next chunk into _pending.
+     */
+    Status _nextChunk() {
+        if (_remaining() < kChunkHeaderSize) {
+            return decompressionError(CompressionFormat::kSnappy, "input is truncated");
+        }
+        const char* header = _begin + _pos;
+        const uint8_t type = header[0];
+        const size_t length = readLE32(header) >> 8;
+        if (_remaining() - kChunkHeaderSize < length) {
+            return decompressionError(CompressionFormat::kSnappy, "input is truncated");
+        }
+        const char* data = header + kChunkHeaderSize;
+        _pos += kChunkHeaderSize + length;
+
+        _pending.clear();
+        _pendingPos = 0;
+
+        // The checksums are not verified: BSON has enough structure of its own that corruption is
+        // seen soon enough.
+        if (type == 0x00 || type == 0x01) {
+            if (length < kChecksumSize) {
+                return decompressionError(CompressionFormat::kSnappy, "chunk is too short");
+            }
+            data += kChecksumSize;
+            const size_t dataLength = length - kChecksumSize;
+
+            if (type == 0x01) {
+                _pending.assign(data, dataLength);
+                return Status::OK();
+            }
+
+            size_t uncompressedLength;
+            if (!snappy::GetUncompressedLength(data, dataLength, &uncompressedLength) ||
+                uncompressedLength > kMaxChunkData) {
+                return decompressionError(CompressionFormat::kSnappy, "chunk is corrupt");
+            }
+            _pending.resize(uncompressedLength);
+            if (!snappy::RawUncompress(data, dataLength, &_pending[0])) {
+                return decompressionError(CompressionFormat::kSnappy, "chunk is corrupt");
+            }
+            return Status::OK();
+        }
+
+        if (type == 0xff) {
+            if (!startsWith(header,
+                            _end,
+                            kSnappyStreamIdentifier,
+                            sizeof(kSnappyStreamIdentifier) - 1)) {
+                return decompressionError(CompressionFormat::kSnappy,
+                                          "stream identifier is invalid");
+            }
+            return Status::OK();
+        }
+
+        if (type >= 0x80) {
+            // Padding, and skippable chunks.
+            return Status::OK();
+        }
+
+        return decompressionError(CompressionFormat::kSnappy,
+                                  str::stream() << "unknown chunk type " << int(type));
+    }
+
+    std::string _pending;
+    size_t _pendingPos = 0;
+};
+
+/**
+ * A frame which can be decompressed on its own.
+ */
+struct Frame {
+    uint64_t offset;
+    uint64_t compressedSize;
+    uint64_t decompressedSize;
+};
+
+/**
+ * Decompresses frames on a pool of threads, a window of them at a time, and hands them out in
+ * order.
+ */
+class FrameSource : public CompressedSource {
+public:
+    /**
+     * Decompresses `in` into exactly `outLen` bytes at `out`.  Called from the pool's threads.
+     */
+    using DecompressFn = Status (*)(const char* in, size_t inLen, char* out, size_t outLen);
+
+    FrameSource(std::shared_ptr<BSONStorage> compressed, DecompressFn decompress)
+        : CompressedSource(std::move(compressed)),
+          _decompress(decompress),
+          _numThreads(std::max(1u, static_cast<unsigned>(stdx::thread::hardware_concurrency()))) {
+        ThreadPool::Options options;
+        options.poolName = "bsonview decompressor";
+        options.threadNamePrefix = "bsonview-decompressor-";
+        options.minThreads = 0;
+        options.maxThreads = _numThreads;
+        _pool = std::make_unique<ThreadPool>(options);
+        _pool->startup();
+    }
+
+    ~FrameSource() {
+        _pool->shutdown();
+        _pool->join();
+    }
+
+    StatusWith<size_t> read(char* buf, size_t len) override {
+        auto status = _fill();
+        if (!status.isOK()) {
+            return status;
+        }
+        if (_inFlight.empty()) {
+            _atEnd = true;
+            return 0;
+        }
+
+        auto slot = _inFlight.front();
+        {
+            stdx::unique_lock<stdx::mutex> lk(_mutex);
+            if (!_done.wait_for(lk, Milliseconds(100).toSystemDuration(), [&] {
+                    return slot->done;
+                })) {
+                return 0;
+            }
+        }
+        if (!slot->status.isOK()) {
+            return slot->status;
+        }
+
+        const size_t n = std::min(len, slot->data.size() - _copied);
+        memcpy(buf, slot->data.data() + _copied, n);
+        _copied += n;
+        if (_copied == slot->data.size()) {
+            _inFlight.pop_front();
+            _bytesInFlight -= slot->data.size();
+            _copied = 0;
+            _nextFrameOffset = slot->frame.offset + slot->frame.compressedSize;
+            _consumed(_nextFrameOffset);
+        }
+        return n;
+    }
+
+    /**
+     * Between frames.  (Restarted sources read the frames that follow sequentially.)
+     */
+    std::unique_ptr<Checkpoint> checkpoint() override {
+        if (_copied) {
+            return nullptr;
+        }
+        return std::make_unique<CompressedCheckpoint>(_nextFrameOffset);
+    }
+
+protected:
+    /**
+     * Returns the next frame, or none after the last.  Only called from the reader thread.
+     */
+    virtual StatusWith<boost::optional<Frame>> _nextFrame() = 0;
+
+private:
+    struct Slot {
+        Frame frame;
+        std::string data;
+        Status status = Status::OK();
+        bool done = false;
+    };
+
+    /**
+     * Starts decompressing frames until the window is full.
+     */
+    Status _fill() {
+        while (!_noMoreFrames && _inFlight.size() < kFramesInFlightPerThread * _numThreads &&
+               _bytesInFlight < kMaxBytesInFlight) {
+            auto swFrame = _nextFrame();
+            if (!swFrame.isOK()) {
+                return swFrame.getStatus();
+            }
+            if (!swFrame.getValue()) {
+                _noMoreFrames = true;
+                break;
+            }
+
+            auto slot = std::make_shared<Slot>();
+            slot->frame = *swFrame.getValue();
+            slot->data.resize(slot->frame.decompressedSize);
+            _inFlight.push_back(slot);
+            _bytesInFlight += slot->frame.decompressedSize;
+
+            const char* in = _begin + slot->frame.offset;
+            _pool->schedule([this, slot, in](Status status) {
+                if (status.isOK()) {
+                    status = _decompress(
+                        in, slot->frame.compressedSize, &slot->data[0], slot->data.size());
+                }
+                stdx::lock_guard<stdx::mutex> lk(_mutex);
+                slot->status = status;
+                slot->done = true;
+                _done.notify_all();
+            });
+        }
+        return Status::OK();
+    }
+
+    const DecompressFn _decompress;
+    const size_t _numThreads;
+
+    std::deque<std::shared_ptr<Slot>> _inFlight;
+    uint64_t _bytesInFlight = 0;
+    bool _noMoreFrames = false;
+
+    // How much of the front slot has been read.
+    size_t _copied = 0;
+    // Where the front slot's frame starts: frames follow one another.
+    uint64_t _nextFrameOffset = 0;
+
+    stdx::mutex _mutex;
+    stdx::condition_variable _done;
+    std::unique_ptr<ThreadPool> _pool;
+};
+
+/**
+ * zstd's seekable format: independent frames, followed by a skippable frame with a table of
+ * their sizes.
+ */
+class ZstdSeekableSource : public FrameSource {
+public:
+    ZstdSeekableSource(std::shared_ptr<BSONStorage> compressed, std::vector<Frame> frames)
+        : FrameSource(std::move(compressed), &_decompressFrame), _frames(std::move(frames)) {}
+
+    /**
+     * Reads the seek table from the end of the file.  Returns none if there isn't one, or it
+     * doesn't describe the file.
+     */
+    static boost::optional<std::vector<Frame>> readSeekTable(const char* begin, const char* end) {
+        const size_t fileSize = end - begin;
+        if (fileSize < kZstdSeekTableFooterSize) {
+            return boost::none;
+        }
+        const char* footer = end - kZstdSeekTableFooterSize;
+        if (readLE32(footer + 5) != kZstdSeekTableMagic) {
+            return boost::none;
+        }
+        const uint64_t numFrames = readLE32(footer);
+        const uint8_t descriptor = footer[4];
+        const size_t entrySize = (descriptor & 0x80) ? 12 : 8;
+
+        // The table is the payload of a skippable frame, whose header is 8 bytes.
+        const uint64_t tableSize = numFrames * entrySize + kZstdSeekTableFooterSize;
+        if (tableSize + 8 > fileSize) {
+            return boost::none;
+        }
+        const char* frameHeader = end - tableSize - 8;
+        if (readLE32(frameHeader) != kZstdSkippableFrameMagic ||
+            readLE32(frameHeader + 4) != tableSize) {
+            return boost::none;
+        }
+
+        std::vector<Frame> frames;
+        frames.reserve(numFrames);
+        uint64_t offset = 0;
+        for (const char* entry = frameHeader + 8; entry < footer; entry += entrySize) {
+            Frame frame{offset, readLE32(entry), readLE32(entry + 4)};
+            if (frame.decompressedSize > kMaxFrameSize) {
+                return boost::none;
+            }
+            offset += frame.compressedSize;
+            frames.push_back(frame);
+        }
+        if (offset != uint64_t(frameHeader - begin)) {
+            return boost::none;
+        }
+        return {std::move(frames)};
+    }
+
+    std::unique_ptr<Source> restart(const Checkpoint& checkpoint) const override {
+        return std::make_unique<ZstdSource>(
+            _compressed, static_cast<const CompressedCheckpoint&>(checkpoint).pos);
+    }
+
+private:
+    StatusWith<boost::optional<Frame>> _nextFrame() override {
+        if (_next == _frames.size()) {
+            return {boost::none};
+        }
+        return {_frames[_next++]};
+    }
+
+    static Status _decompressFrame(const char* in, size_t inLen, char* out, size_t outLen) {
+        const size_t ret = ZSTD_decompress(out, outLen, in, inLen);
+        if (ZSTD_isError(ret)) {
+            return decompressionError(CompressionFormat::kZstd, ZSTD_getErrorName(ret));
+        }
+        if (ret != outLen) {
+            return decompressionError(CompressionFormat::kZstd,
+                                      "frame size doesn't match the seek table");
+        }
+        return Status::OK();
+    }
+
+    const std::vector<Frame> _frames;
+    size_t _next = 0;
+};
+
+/**
+ * BGZF (as written by bgzip): gzip members of at most 64KiB, each with its compressed size in
+ * an extra field.
+ */
+class BgzfSource : public FrameSource {
+public:
+    explicit BgzfSource(std::shared_ptr<BSONStorage> compressed)
+        : FrameSource(std::move(compressed), &_decompressFrame) {}
+
+    /**
+     * Returns the length of the BGZF member at `p`, or 0 if there isn't one.
+     */
+    static size_t memberLength(const char* p, const char* end) {
+        // ID1 ID2 CM FLG MTIME(4) XFL OS XLEN(2), then a subfield SI1 SI2 SLEN(2) BSIZE(2).
+        constexpr size_t kHeaderSize = 18;
+        constexpr uint8_t kFlagExtra = 0x04;
+        if (size_t(end - p) < kHeaderSize || !startsWith(p, end, kGzipMagic, 3) ||
+            !(p[3] & kFlagExtra)) {
+            return 0;
+        }
+
+        // The BC subfield needn't be the only one, or the first.
+        const char* field = p + 12;
+        const char* fieldsEnd = field + readLE16(p + 10);
+        if (fieldsEnd > end) {
+            return 0;
+        }
+        while (field + 4 <= fieldsEnd) {
+            const size_t fieldLength = readLE16(field + 2);
+            if (field[0] == 'B' && field[1] == 'C' && fieldLength == 2 &&
+                field + 6 <= fieldsEnd) {
+                const size_t length = readLE16(field + 4) + 1;
+                return length <= size_t(end - p) ? length : 0;
+            }
+            field += 4 + fieldLength;
+        }
+        return 0;
+    }
+
+    std::unique_ptr<Source> restart(const Checkpoint& checkpoint) const override {
+        return std::make_unique<GzipSource>(_compressed,
+                                            static_cast<const CompressedCheckpoint&>(checkpoint));
+    }
+
+private:
+    static constexpr uint64_t kMaxBlockSize = 65536;
+
+    StatusWith<boost::optional<Frame>> _nextFrame() override {
+        if (_remaining() == 0) {
+            return {boost::none};
+        }
+        const size_t length = memberLength(_begin + _pos, _end);
+        if (length < 8) {
+            return decompressionError(CompressionFormat::kGzip,
+                                      str::stream() << "BGZF block at offset " << _pos
+                                                    << " is corrupt");
+        }
+        Frame frame{_pos, length, readLE32(_begin + _pos + length - 4)};
+        if (frame.decompressedSize > kMaxBlockSize) {
+            return decompressionError(CompressionFormat::kGzip,
+                                      str::stream() << "BGZF block at offset " << _pos
+                                                    << " is corrupt");
+        }
+        _pos += length;
+        return {frame};
+    }
+
+    static Status _decompressFrame(const char* in, size_t inLen, char* out, size_t outLen) {
+        z_stream stream{};
+        if (inflateInit2(&stream, 16 + MAX_WBITS) != Z_OK) {
+            return decompressionError(CompressionFormat::kGzip, "out of memory");
+        }
+        stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(in));
+        stream.avail_in = inLen;
+        stream.next_out = reinterpret_cast<Bytef*>(out);
+        stream.avail_out = outLen;
+        const int ret = inflate(&stream, Z_FINISH);
+        const size_t produced = stream.total_out;
+        inflateEnd(&stream);
+        if (ret != Z_STREAM_END || produced != outLen) {
+            return decompressionError(CompressionFormat::kGzip, "BGZF block is corrupt");
+        }
+        return Status::OK();
+    }
+};
+
+}  // namespace
+
+StringData compressionFormatName(CompressionFormat format) {
+    switch (format) {
+        case CompressionFormat::kNone:
+            return "uncompressed"_sd;
+        case CompressionFormat::kGzip:
+            return "gzip"_sd;
+        case CompressionFormat::kZstd:
+            return "zstd"_sd;
+        case CompressionFormat::kSnappy:
+            return "snappy"_sd;
+    }
+    MONGO_UNREACHABLE;
+}
+
+CompressionFormat detectCompression(const char* data, const char* end) {
+    if (isPlausibleDocumentStart(data, end)) {
+        return CompressionFormat::kNone;
+    }
+    if (startsWith(data, end, kGzipMagic, sizeof(kGzipMagic) - 1)) {
+        return CompressionFormat::kGzip;
+    }
+    if (end - data >= 4 && readLE32(data) == kZstdMagic) {
+        return CompressionFormat::kZstd;
+    }
+    if (startsWith(data, end, kSnappyStreamIdentifier, sizeof(kSnappyStreamIdentifier) - 1)) {
+        return CompressionFormat::kSnappy;
+    }
+    return CompressionFormat::kNone;
+}
+
+std::unique_ptr<StreamStorage::Source> makeDecompressor(CompressionFormat format,
+                                                        std::unique_ptr<BSONStorage> compressed) {
+    const char* begin = compressed->base();
+    const char* end = compressed->end();
+    switch (format) {
+        case CompressionFormat::kGzip:
+            if (BgzfSource::memberLength(begin, end)) {
+                return std::make_unique<BgzfSource>(std::move(compressed));
+            }
+            return std::make_unique<GzipSource>(std::move(compressed));
+        case CompressionFormat::kZstd:
+            if (auto frames = ZstdSeekableSource::readSeekTable(begin, end)) {
+                return std::make_unique<ZstdSeekableSource>(std::move(compressed),
+                                                            std::move(*frames));
+            }
+            return std::make_unique<ZstdSource>(std::move(compressed));
+        case CompressionFormat::kSnappy:
+            return std::make_unique<SnappySource>(std::move(compressed));
+        case CompressionFormat::kNone:
+            break;
+    }
+    MONGO_UNREACHABLE;
+}
+
+}  // namespace mongo
@@ -0,0 +1,70 @@
+/**
+ *    Copyright (C) 2019-present MongoDB, Inc.
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the Server Side Public License, version 1,
+ *    as published by MongoDB, Inc.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    Server Side Public License for more details.
+ *
+ *    You should have received a copy of the Server Side Public License
+ *    along with this program. If not, see
+ *    <http://www.mongodb.com/licensing/server-side-public-license>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the Server Side Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#pragma once
+
+#include <memory>
+
+#include "mongo/base/string_data.h"
+#include "mongo/bsonview/storage.h"
+#include "mongo/bsonview/stream_storage.h"
+
+namespace mongo {
+
+enum class CompressionFormat {
+    kNone,
+    kGzip,
+    kZstd,
+    kSnappy,
+};
+
+StringData compressionFormatName(CompressionFormat format);
+
+/**
+ * Recognises gzip, zstd and framed snappy data by their magic bytes.  Anything that could also
+ * be the start of a BSON document is taken to be BSON.
+ */
+CompressionFormat detectCompression(const char* data, const char* end);
+
+/**
+ * Returns a source which decompresses the contents of `compressed` (which must not change), in
+ * `format`.
+ *
+ * Files that are made of independently compressed frames and say where they are (zstd's
+ * seekable format, which has a table of them at the end, or BGZF, whose gzip members each have
+ * their size in a "BC" extra field) are decompressed a number of frames at a time, in parallel.
+ * Anything else is decompressed sequentially.
+ *
+ * All but plain (unseekable) zstd can be restarted from checkpoints: the start of any frame, and
+ * for gzip, also between any two deflate blocks (with the 32KiB of output before).
+ */
+std::unique_ptr<StreamStorage::Source> makeDecompressor(CompressionFormat format,
+                                                        std::unique_ptr<BSONStorage> compressed);
+
+}  // namespace mongo
@@ -0,0 +1,343 @@
+/**
+ *    Copyright (C) 2019-present MongoDB, Inc.
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the Server Side Public License, version 1,
+ *    as published by MongoDB, Inc.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    Server Side Public License for more details.
+ *
+ *    You should have received a copy of the Server Side Public License
+ *    along with this program. If not, see
+ *    <http://www.mongodb.com/licensing/server-side-public-license>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the Server Side Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include <cstring>
+#include <snappy.h>
+#include <string>
+#include <sys/mman.h>
+#include <vector>
+#include <zlib.h>
+#include <zstd.h>
+
+#include <boost/optional.hpp>
+
+#include "mongo/base/data_type_endian.h"
+#include "mongo/base/data_view.h"
+#include "mongo/bson/bsonobjbuilder.h"
+#include "mongo/bsonview/decompressor.h"
+#include "mongo/unittest/unittest.h"
+
+namespace mongo {
+namespace {
+
+class StringStorage : public BSONStorage {
+public:
+    explicit StringStorage(std::string data) : _data(std::move(data)) {}
+
+    const char* base() const override {
+        return _data.data();
+    }
+
+    uint64_t size() const override {
+        return _data.size();
+    }
+
+private:
+    const std::string _data;
+};
+
+template <typename T>
+void appendLE(std::string* out, T value) {
+    char buf[sizeof(T)];
+    DataView(buf).write<LittleEndian<T>>(value);
+    out->append(buf, sizeof(T));
+}
+
+/**
+ * Some BSON documents, big enough to need several frames and several reads.
+ */
+std::string makeDocuments(int count = 20000) {
+    std::string out;
+    for (int i = 0; i < count; i++) {
+        BSONObj obj = BSON("_id" << i << "name"
+                                 << "document"
+                                 << "values" << BSON_ARRAY(i << i * 2 << i * 3));
+        out.append(obj.objdata(), obj.objsize());
+    }
+    return out;
+}
+
+std::string gzip(const std::string& data) {
+    z_stream stream{};
+    ASSERT_EQ(deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 16 + MAX_WBITS, 8,
+                           Z_DEFAULT_STRATEGY),
+              Z_OK);
+    std::string out(deflateBound(&stream, data.size()), '\0');
+    stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+    stream.avail_in = data.size();
+    stream.next_out = reinterpret_cast<Bytef*>(&out[0]);
+    stream.avail_out = out.size();
+    ASSERT_EQ(deflate(&stream, Z_FINISH), Z_STREAM_END);
+    out.resize(stream.total_out);
+    deflateEnd(&stream);
+    return out;
+}
+
+std::string bgzf(const std::string& data) {
+    constexpr size_t kBlockSize = 60000;
+    std::string out;
+    for (size_t pos = 0; pos < data.size(); pos += kBlockSize) {
+        const size_t len = std::min(kBlockSize, data.size() - pos);
+
+        z_stream stream{};
+        ASSERT_EQ(
+            deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -MAX_WBITS, 8,
+                         Z_DEFAULT_STRATEGY),
+            Z_OK);
+        std::string deflated(deflateBound(&stream, len), '\0');
+        stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.data() + pos));
+        stream.avail_in = len;
+        stream.next_out = reinterpret_cast<Bytef*>(&deflated[0]);
+        stream.avail_out = deflated.size();
+        ASSERT_EQ(deflate(&stream, Z_FINISH), Z_STREAM_END);
+        deflated.resize(stream.total_out);
+        deflateEnd(&stream);
+
+        const size_t memberSize = 18 + deflated.size() + 8;
+        appendLE<uint32_t>(&out, 0x04088b1f);  // ID1 ID2 CM FLG
+        appendLE<uint32_t>(&out, 0);           // MTIME
+        appendLE<uint8_t>(&out, 0);            // XFL
+        appendLE<uint8_t>(&out, 0xff);         // OS
+        appendLE<uint16_t>(&out, 6);           // XLEN
+        out.append("BC");
+        appendLE<uint16_t>(&out, 2);
+        appendLE<uint16_t>(&out, memberSize - 1);
+        out.append(deflated);
+        appendLE<uint32_t>(&out, crc32(0, reinterpret_cast<const Bytef*>(data.data() + pos), len));
+        appendLE<uint32_t>(&out, len);
+    }
+    return out;
+}
+
+std::string zstd(const std::string& data) {
+    std::string out(ZSTD_compressBound(data.size()), '\0');
+    const size_t n = ZSTD_compress(&out[0], out.size(), data.data(), data.size(), 1);
+    ASSERT_FALSE(ZSTD_isError(n));
+    out.resize(n);
+    return out;
+}
+
+std::string zstdSeekable(const std::string& data) {
+    constexpr size_t kFrameSize = 100000;
+    std::string out;
+    std::vector<std::pair<uint32_t, uint32_t>> entries;
+    for (size_t pos = 0; pos < data.size(); pos += kFrameSize) {
+        const std::string frame = zstd(data.substr(pos, kFrameSize));
+        out.append(frame);
+        entries.emplace_back(frame.size(), std::min(kFrameSize, data.size() - pos));
+    }
+
+    // The seek table, in a skippable frame.
+    appendLE<uint32_t>(&out, 0x184D2A5E);
+    appendLE<uint32_t>(&out, entries.size() * 8 + 9);
+    for (auto&& entry : entries) {
+        appendLE<uint32_t>(&out, entry.first);
+        appendLE<uint32_t>(&out, entry.second);
+    }
+    appendLE<uint32_t>(&out, entries.size());
+    appendLE<uint8_t>(&out, 0);
+    appendLE<uint32_t>(&out, 0x8F92EAB1);
+    return out;
+}
+
+std::string snappyFramed(const std::string& data) {
+    constexpr size_t kChunkSize = 65536;
+    std::string out("\xff\x06\x00\x00sNaPpY", 10);
+    for (size_t pos = 0; pos < data.size(); pos += kChunkSize) {
+        std::string compressed;
+        snappy::Compress(data.data() + pos, std::min(kChunkSize, data.size() - pos), &compressed);
+
+        // Checksums aren't checked, so needn't be right.
+        appendLE<uint32_t>(&out, (compressed.size() + 4) << 8);
+        appendLE<uint32_t>(&out, 0);
+        out.append(compressed);
+    }
+    return out;
+}
+
+std::string decompress(const std::string& compressed, CompressionFormat expected) {
+    const CompressionFormat format =
+        detectCompression(compressed.data(), compressed.data() + compressed.size());
+    ASSERT(format == expected);
+
+    auto swStream = StreamStorage::open(
+        makeDecompressor(format, std::make_unique<StringStorage>(compressed)));
+    ASSERT_OK(swStream.getStatus());
+    auto& stream = swStream.getValue();
+    while (!stream->isComplete()) {
+        stream->waitFor(stream->size() + 1);
+    }
+    ASSERT_OK(stream->refresh().getStatus());
+    return std::string(stream->base(), stream->size());
+}
+
+bool isResident(const char* p) {
+    unsigned char vec;
+    const uint64_t page = RefillableArena::pageSize();
+    void* start = reinterpret_cast<void*>(reinterpret_cast<uintptr_t>(p) & ~(page - 1));
+    ASSERT_EQ(mincore(start, page, &vec), 0);
+    return vec & 1;
+}
+
+/**
+ * Decompresses with a budget of a segment, so that what's been read is dropped, then reads it all
+ * again, backwards, so each block is decompressed again from the nearest checkpoint before it.
+ * Returns none if userfaultfd isn't allowed (eg. in a container), so there's nothing to test.
+ */
+boost::optional<std::string> decompressAndRefill(const std::string& compressed) {
+    const CompressionFormat format =
+        detectCompression(compressed.data(), compressed.data() + compressed.size());
+    auto swStream =
+        StreamStorage::open(makeDecompressor(format, std::make_unique<StringStorage>(compressed)),
+                            BSONStorage::kSegmentSize);
+    ASSERT_OK(swStream.getStatus());
+    auto& stream = swStream.getValue();
+    if (!stream->isRefillable()) {
+        return boost::none;
+    }
+    while (!stream->isComplete()) {
+        stream->waitFor(stream->size() + 1);
+    }
+    ASSERT_GT(stream->size(), 2 * BSONStorage::kSegmentSize);
+
+    stream->scanned(0, stream->size());
+    ASSERT_FALSE(isResident(stream->base()));
+    ASSERT_FALSE(isResident(stream->base() + BSONStorage::kSegmentSize));
+
+    std::string out(stream->size(), '\0');
+    for (uint64_t end = stream->size(); end > 0;) {
+        const uint64_t begin = end - std::min(end, RefillableArena::kRefillSize);
+        memcpy(&out[begin], stream->base() + begin, end - begin);
+        end = begin;
+    }
+    ASSERT_OK(stream->refresh().getStatus());
+    return {std::move(out)};
+}
+
+TEST(DecompressorTest, DetectsUncompressedBSON) {
+    const std::string data = makeDocuments();
+    ASSERT(detectCompression(data.data(), data.data() + data.size()) == CompressionFormat::kNone);
+}
+
+TEST(DecompressorTest, Gzip) {
+    const std::string data = makeDocuments();
+    ASSERT_EQ(decompress(gzip(data), CompressionFormat::kGzip), data);
+}
+
+TEST(DecompressorTest, GzipConcatenatedMembers) {
+    const std::string data = makeDocuments();
+    const std::string half = data.substr(0, data.size() / 2);
+    const std::string rest = data.substr(data.size() / 2);
+    ASSERT_EQ(decompress(gzip(half) + gzip(rest), CompressionFormat::kGzip), data);
+}
+
+TEST(DecompressorTest, Bgzf) {
+    const std::string data = makeDocuments();
+    ASSERT_EQ(decompress(bgzf(data), CompressionFormat::kGzip), data);
+}
+
+TEST(DecompressorTest, Zstd) {
+    const std::string data = makeDocuments();
+    ASSERT_EQ(decompress(zstd(data), CompressionFormat::kZstd), data);
+}
+
+TEST(DecompressorTest, ZstdSeekable) {
+    const std::string data = makeDocuments();
+    ASSERT_EQ(decompress(zstdSeekable(data), CompressionFormat::kZstd), data);
+}
+
+TEST(DecompressorTest, Snappy) {
+    const std::string data = makeDocuments();
+    ASSERT_EQ(decompress(snappyFramed(data), CompressionFormat::kSnappy), data);
+}
+
+// Enough to be dropped, with several checkpoints.
+constexpr int kManyDocuments = 600000;
+
+TEST(DecompressorTest, GzipRefillsFromCheckpoints) {
+    const std::string data = makeDocuments(kManyDocuments);
+    const std::string half = data.substr(0, data.size() / 2);
+    const std::string rest = data.substr(data.size() / 2);
+    auto refilled = decompressAndRefill(gzip(half) + gzip(rest));
+    if (refilled) {
+        ASSERT(*refilled == data);
+    }
+}
+
+TEST(DecompressorTest, BgzfRefillsFromCheckpoints) {
+    const std::string data = makeDocuments(kManyDocuments);
+    auto refilled = decompressAndRefill(bgzf(data));
+    if (refilled) {
+        ASSERT(*refilled == data);
+    }
+}
+
+TEST(DecompressorTest, ZstdSeekableRefillsFromCheckpoints) {
+    const std::string data = makeDocuments(kManyDocuments);
+    auto refilled = decompressAndRefill(zstdSeekable(data));
+    if (refilled) {
+        ASSERT(*refilled == data);
+    }
+}
+
+TEST(DecompressorTest, SnappyRefillsFromCheckpoints) {
+    const std::string data = makeDocuments(kManyDocuments);
+    auto refilled = decompressAndRefill(snappyFramed(data));
+    if (refilled) {
+        ASSERT(*refilled == data);
+    }
+}
+
+TEST(DecompressorTest, ZstdIsKeptInAFile) {
+    // A zstd frame can't be started part way through.
+    auto swStream = StreamStorage::open(
+        makeDecompressor(CompressionFormat::kZstd,
+                         std::make_unique<StringStorage>(zstd(makeDocuments()))),
+        BSONStorage::kSegmentSize);
+    ASSERT_OK(swStream.getStatus());
+    ASSERT_FALSE(swStream.getValue()->isRefillable());
+}
+
+TEST(DecompressorTest, TruncatedInputIsAnError) {
+    const std::string compressed = gzip(makeDocuments());
+    auto swStream = StreamStorage::open(makeDecompressor(
+        CompressionFormat::kGzip,
+        std::make_unique<StringStorage>(compressed.substr(0, compressed.size() / 2))));
+    ASSERT_OK(swStream.getStatus());
+    auto& stream = swStream.getValue();
+    while (!stream->isComplete()) {
+        stream->waitFor(stream->size() + 1);
+    }
+    ASSERT_NOT_OK(stream->refresh().getStatus());
+}
+
+}  // namespace
+}  // namespace mongo
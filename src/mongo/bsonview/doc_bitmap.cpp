@@ -0,0 +1,286 @@
+/**
+ *    Copyright (C) 2019-present MongoDB, Inc.
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the Server Side Public License, version 1,
+ *    as published by MongoDB, Inc.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    Server Side Public License for more details.
+ *
+ *    You should have received a copy of the Server Side Public License
+ *    along with this program. If not, see
+ *    <http://www.mongodb.com/licensing/server-side-public-license>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the Server Side Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/bsonview/doc_bitmap.h"
+
+#include <algorithm>
+#include <bitset>
+
+#include "mongo/platform/bits.h"
+#include "mongo/util/assert_util.h"
+
+namespace mongo {
+
+namespace {
+
+uint32_t popcount(uint64_t word) {
+    return std::bitset<64>(word).count();
+}
+
+uint64_t highOf(uint64_t doc) {
+    return doc >> 16;
+}
+
+uint16_t lowOf(uint64_t doc) {
+    return doc & 0xffff;
+}
+
+}  // namespace
+
+bool DocBitmap::Container::contains(uint16_t low) const {
+    if (bits.empty()) {
+        return std::binary_search(array.begin(), array.end(), low);
+    }
+    return bits[low / 64] & (1ULL << (low % 64));
+}
+
+bool DocBitmap::Container::add(uint16_t low) {
+    if (bits.empty()) {
+        // Docs are usually added in order.
+        auto it = array.empty() || array.back() < low
+            ? array.end()
+            : std::lower_bound(array.begin(), array.end(), low);
+        if (it != array.end() && *it == low) {
+            return false;
+        }
+        if (array.size() < kMaxArraySize) {
+            array.insert(it, low);
+            cardinality++;
+            return true;
+        }
+
+        bits.assign(kBitmapWords, 0);
+        for (auto member : array) {
+            bits[member / 64] |= 1ULL << (member % 64);
+        }
+        array.clear();
+        array.shrink_to_fit();
+    }
+
+    uint64_t& word = bits[low / 64];
+    const uint64_t bit = 1ULL << (low % 64);
+    if (word & bit) {
+        return false;
+    }
+    word |= bit;
+    cardinality++;
+    return true;
+}
+
+uint32_t DocBitmap::Container::rank(uint16_t low) const {
+    if (bits.empty()) {
+        return std::lower_bound(array.begin(), array.end(), low) - array.begin();
+    }
+    uint32_t count = 0;
+    for (size_t w = 0; w < low / 64u; w++) {
+        count += popcount(bits[w]);
+    }
+    return count + popcount(bits[low / 64] & ((1ULL << (low % 64)) - 1));
+}
+
+uint16_t DocBitmap::Container::select(uint32_t i) const {
+    if (bits.empty()) {
+        return array[i];
+    }
+    for (size_t w = 0; w < kBitmapWords; w++) {
+        const uint32_t count = popcount(bits[w]);
+        if (i < count) {
+            uint64_t word = bits[w];
+            for (; i > 0; i--) {
+                word &= word - 1;
+            }
+            return w * 64 + countTrailingZeros64(word);
+        }
+        i -= count;
+    }
+    MONGO_UNREACHABLE;
+}
+
+boost::optional<uint16_t> DocBitmap::Container::next(uint16_t low) const {
+    if (bits.empty()) {
+        auto it = std::upper_bound(array.begin(), array.end(), low);
+        if (it == array.end()) {
+            return boost::none;
+        }
+        return *it;
+    }
+    if (low == 0xffff) {
+        return boost::none;
+    }
+    const uint32_t from = low + 1;
+    size_t w = from / 64;
+    uint64_t word = bits[w] & ~((1ULL << (from % 64)) - 1);
+    while (!word) {
+        if (++w == kBitmapWords) {
+            return boost::none;
+        }
+        word = bits[w];
+    }
+    return w * 64 + countTrailingZeros64(word);
+}
+
+boost::optional<uint16_t> DocBitmap::Container::prev(uint16_t low) const {
+    if (bits.empty()) {
+        auto it = std::lower_bound(array.begin(), array.end(), low);
+        if (it == array.begin()) {
+            return boost::none;
+        }
+        return *--it;
+    }
+    size_t w = low / 64;
+    uint64_t word = bits[w] & ((1ULL << (low % 64)) - 1);
+    while (!word) {
+        if (w-- == 0) {
+            return boost::none;
+        }
+        word = bits[w];
+    }
+    return w * 64 + 63 - countLeadingZeros64(word);
+}
+
+uint16_t DocBitmap::Container::min() const {
+    if (bits.empty()) {
+        return array.front();
+    }
+    return contains(0) ? 0 : *next(0);
+}
+
+uint16_t DocBitmap::Container::max() const {
+    if (bits.empty()) {
+        return array.back();
+    }
+    return contains(0xffff) ? 0xffff : *prev(0xffff);
+}
+
+std::vector<DocBitmap::Container>::const_iterator DocBitmap::_find(uint64_t high) const {
+    // Fast path for docs being added (and looked up) in order.
+    if (!_containers.empty() && _containers.back().high <= high) {
+        return _containers.back().high == high ? _containers.end() - 1 : _containers.end();
+    }
+    return std::lower_bound(
+        _containers.begin(), _containers.end(), high, [](const Container& c, uint64_t high) {
+            return c.high < high;
+        });
+}
+
+void DocBitmap::add(uint64_t doc) {
+    auto it = _containers.begin() + (_find(highOf(doc)) - _containers.cbegin());
+    if (it == _containers.end() || it->high != highOf(doc)) {
+        it = _containers.emplace(it, highOf(doc));
+    }
+    if (it->add(lowOf(doc))) {
+        _size++;
+        _ranksValid = false;
+    }
+}
+
+bool DocBitmap::contains(uint64_t doc) const {
+    auto it = _find(highOf(doc));
+    return it != _containers.end() && it->high == highOf(doc) && it->contains(lowOf(doc));
+}
+
+void DocBitmap::_computeRanks() const {
+    if (_ranksValid) {
+        return;
+    }
+    _ranks.resize(_containers.size());
+    uint64_t count = 0;
+    for (size_t i = 0; i < _containers.size(); i++) {
+        _ranks[i] = count;
+        count += _containers[i].cardinality;
+    }
+    _ranksValid = true;
+}
+
+uint64_t DocBitmap::rank(uint64_t doc) const {
+    auto it = _find(highOf(doc));
+    if (it == _containers.end()) {
+        return _size;
+    }
+    _computeRanks();
+    const uint64_t before = _ranks[it - _containers.begin()];
+    return it->high == highOf(doc) ? before + it->rank(lowOf(doc)) : before;
+}
+
+uint64_t DocBitmap::select(uint64_t i) const {
+    invariant(i < _size);
+    _computeRanks();
+    const size_t c = std::upper_bound(_ranks.begin(), _ranks.end(), i) - _ranks.begin() - 1;
+    const Container& container = _containers[c];
+    return (container.high << 16) | container.select(i - _ranks[c]);
+}
+
+boost::optional<uint64_t> DocBitmap::next(uint64_t doc) const {
+    auto it = _find(highOf(doc));
+    if (it != _containers.end() && it->high == highOf(doc)) {
+        if (auto low = it->next(lowOf(doc))) {
+            return (it->high << 16) | *low;
+        }
+        ++it;
+    }
+    if (it == _containers.end()) {
+        return boost::none;
+    }
+    return (it->high << 16) | it->min();
+}
+
+boost::optional<uint64_t> DocBitmap::prev(uint64_t doc) const {
+    auto it = _find(highOf(doc));
+    if (it != _containers.end() && it->high == highOf(doc)) {
+        if (auto low = it->prev(lowOf(doc))) {
+            return (it->high << 16) | *low;
+        }
+    }
+    if (it == _containers.begin()) {
+        return boost::none;
+    }
+    --it;
+    return (it->high << 16) | it->max();
+}
+
+void DocBitmap::clear() {
+    _containers.clear();
+    _ranks.clear();
+    _size = 0;
+    _ranksValid = true;
+}
+
+size_t DocBitmap::bytesUsed() const {
+    size_t bytes = sizeof(*this) + _containers.capacity() * sizeof(Container) +
+        _ranks.capacity() * sizeof(uint64_t);
+    for (const auto& container : _containers) {
+        bytes += container.array.capacity() * sizeof(uint16_t) +
+            container.bits.capacity() * sizeof(uint64_t);
+    }
+    return bytes;
+}
+
+}  // namespace mongo
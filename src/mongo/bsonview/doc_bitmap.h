@@ -0,0 +1,123 @@
+/**
+ *    Copyright (C) 2019-present MongoDB, Inc.
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the Server Side Public License, version 1,
+ *    as published by MongoDB, Inc.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    Server Side Public License for more details.
+ *
+ *    You should have received a copy of the Server Side Public License
+ *    along with this program. If not, see
+ *    <http://www.mongodb.com/licensing/server-side-public-license>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the Server Side Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#pragma once
+
+#include <boost/optional.hpp>
+#include <cstdint>
+#include <vector>
+
+namespace mongo {
+
+/**
+ * A set of doc numbers, compressed in the manner of Roaring bitmaps: docs are grouped by their
+ * high bits into containers of 64Ki docs, each of which is a sorted array of the low bits while
+ * it has few members, and a bitmap once it has many.  So both sparse and dense sets are compact,
+ * and finding the i'th member (or how many come before a doc) only needs counting within one
+ * container.
+ */
+class DocBitmap {
+public:
+    void add(uint64_t doc);
+
+    bool contains(uint64_t doc) const;
+
+    uint64_t size() const {
+        return _size;
+    }
+
+    bool empty() const {
+        return _size == 0;
+    }
+
+    /**
+     * How many members are less than `doc` (which is also the index of `doc`, if it's a member).
+     */
+    uint64_t rank(uint64_t doc) const;
+
+    /**
+     * The member with `i` members before it.  `i` must be less than size().
+     */
+    uint64_t select(uint64_t i) const;
+
+    /**
+     * The first member after `doc`.
+     */
+    boost::optional<uint64_t> next(uint64_t doc) const;
+
+    /**
+     * The last member before `doc`.
+     */
+    boost::optional<uint64_t> prev(uint64_t doc) const;
+
+    void clear();
+
+    size_t bytesUsed() const;
+
+private:
+    // A container switches from an array to a bitmap once the bitmap would be smaller.
+    static constexpr size_t kMaxArraySize = 4096;
+    static constexpr size_t kBitmapWords = 65536 / 64;
+
+    struct Container {
+        explicit Container(uint64_t high) : high(high) {}
+
+        bool contains(uint16_t low) const;
+        // Returns whether low was added (rather than already being there).
+        bool add(uint16_t low);
+        uint32_t rank(uint16_t low) const;
+        uint16_t select(uint32_t i) const;
+        boost::optional<uint16_t> next(uint16_t low) const;
+        boost::optional<uint16_t> prev(uint16_t low) const;
+        uint16_t min() const;
+        uint16_t max() const;
+
+        uint64_t high;
+        uint32_t cardinality = 0;
+        // Either array is used (sorted), or bits is (with kBitmapWords words).
+        std::vector<uint16_t> array;
+        std::vector<uint64_t> bits;
+    };
+
+    // The container for `high`, or where it would go.
+    std::vector<Container>::const_iterator _find(uint64_t high) const;
+
+    void _computeRanks() const;
+
+    // In order of high.
+    std::vector<Container> _containers;
+    uint64_t _size = 0;
+
+    // _ranks[i] is the number of members in the containers before i.  Only brought up to date
+    // when it's needed, since members are usually added in bulk between lookups.
+    mutable std::vector<uint64_t> _ranks;
+    mutable bool _ranksValid = true;
+};
+
+}  // namespace mongo
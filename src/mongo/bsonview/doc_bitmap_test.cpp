@@ -0,0 +1,131 @@
+/**
+ *    Copyright (C) 2019-present MongoDB, Inc.
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the Server Side Public License, version 1,
+ *    as published by MongoDB, Inc.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    Server Side Public License for more details.
+ *
+ *    You should have received a copy of the Server Side Public License
+ *    along with this program. If not, see
+ *    <http://www.mongodb.com/licensing/server-side-public-license>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the Server Side Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/bsonview/doc_bitmap.h"
+
+#include <iterator>
+#include <set>
+
+#include "mongo/platform/random.h"
+#include "mongo/unittest/unittest.h"
+
+namespace mongo {
+namespace {
+
+TEST(DocBitmapTest, Empty) {
+    DocBitmap bitmap;
+    ASSERT(bitmap.empty());
+    ASSERT_FALSE(bitmap.contains(0));
+    ASSERT_EQ(bitmap.rank(100), 0U);
+    ASSERT_FALSE(bitmap.next(0));
+    ASSERT_FALSE(bitmap.prev(100));
+}
+
+TEST(DocBitmapTest, AddOutOfOrderAndTwice) {
+    DocBitmap bitmap;
+    for (uint64_t doc : {70000ULL, 5ULL, 1ULL << 40, 5ULL, 3ULL}) {
+        bitmap.add(doc);
+    }
+    ASSERT_EQ(bitmap.size(), 4U);
+    ASSERT(bitmap.contains(3));
+    ASSERT(bitmap.contains(1ULL << 40));
+    ASSERT_FALSE(bitmap.contains(4));
+
+    ASSERT_EQ(bitmap.select(0), 3U);
+    ASSERT_EQ(bitmap.select(2), 70000U);
+    ASSERT_EQ(bitmap.select(3), 1ULL << 40);
+    ASSERT_EQ(bitmap.rank(70000), 2U);
+    ASSERT_EQ(bitmap.rank(1ULL << 41), 4U);
+    ASSERT_EQ(*bitmap.next(5), 70000U);
+    ASSERT_EQ(*bitmap.prev(70000), 5U);
+    ASSERT_FALSE(bitmap.next(1ULL << 40));
+    ASSERT_FALSE(bitmap.prev(3));
+
+    bitmap.clear();
+    ASSERT(bitmap.empty());
+    ASSERT_FALSE(bitmap.contains(3));
+}
+
+TEST(DocBitmapTest, DenseContainersStaySmall) {
+    DocBitmap bitmap;
+    for (uint64_t doc = 0; doc < 10 * 65536; doc++) {
+        bitmap.add(doc);
+    }
+    // Ten 8KiB bitmaps, rather than 128KiB arrays.
+    ASSERT_LT(bitmap.bytesUsed(), 100 * 1024U);
+    ASSERT_EQ(bitmap.rank(300000), 300000U);
+    ASSERT_EQ(bitmap.select(654321), 654321U);
+    ASSERT_EQ(*bitmap.next(65535), 65536U);
+    ASSERT_EQ(*bitmap.prev(65536), 65535U);
+}
+
+// Checks everything against a std::set, at densities which use both kinds of container.
+TEST(DocBitmapTest, MatchesSet) {
+    PseudoRandom random(1);
+    for (int oneIn : {1000, 20, 3}) {
+        DocBitmap bitmap;
+        std::set<uint64_t> set;
+        for (int i = 0; i < 300000 / oneIn; i++) {
+            const uint64_t doc = random.nextInt32(300000);
+            bitmap.add(doc);
+            set.insert(doc);
+        }
+        ASSERT_EQ(bitmap.size(), set.size());
+
+        uint64_t i = 0;
+        for (auto doc : set) {
+            ASSERT_EQ(bitmap.select(i), doc);
+            ASSERT_EQ(bitmap.rank(doc), i);
+            i++;
+        }
+
+        for (int probe = 0; probe < 10000; probe++) {
+            const uint64_t doc = random.nextInt32(300100);
+            ASSERT_EQ(bitmap.contains(doc), set.count(doc) == 1);
+            auto after = set.upper_bound(doc);
+            auto next = bitmap.next(doc);
+            ASSERT_EQ(bool(next), after != set.end());
+            if (next) {
+                ASSERT_EQ(*next, *after);
+            }
+            auto atOrAfter = set.lower_bound(doc);
+            auto prev = bitmap.prev(doc);
+            ASSERT_EQ(bool(prev), atOrAfter != set.begin());
+            if (prev) {
+                ASSERT_EQ(*prev, *std::prev(atOrAfter));
+            }
+            ASSERT_EQ(bitmap.rank(doc), uint64_t(std::distance(set.begin(), atOrAfter)));
+        }
+    }
+}
+
+}  // namespace
+}  // namespace mongo
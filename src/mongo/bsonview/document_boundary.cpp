@@ -0,0 +1,103 @@
+/**
+ *    Copyright (C) 2019-present MongoDB, Inc.
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the Server Side Public License, version 1,
+ *    as published by MongoDB, Inc.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    Server Side Public License for more details.
+ *
+ *    You should have received a copy of the Server Side Public License
+ *    along with this program. If not, see
+ *    <http://www.mongodb.com/licensing/server-side-public-license>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the Server Side Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/bsonview/document_boundary.h"
+
+#include "mongo/base/data_view.h"
+#include "mongo/base/status.h"
+#include "mongo/bson/bson_validate.h"
+#include "mongo/bson/bsonobj.h"
+#include "mongo/bson/bsontypes.h"
+#include "mongo/bson/util/builder.h"
+
+namespace mongo {
+
+size_t plausibleDocumentLength(const char* p, const char* end) {
+    if (end - p < BSONObj::kMinBSONLength) {
+        return 0;
+    }
+
+    const int len = ConstDataView(p).read<LittleEndian<int>>();
+    if (len < BSONObj::kMinBSONLength || len > BSONObjMaxInternalSize || len > end - p) {
+        return 0;
+    }
+    if (p[len - 1] != EOO) {
+        return 0;
+    }
+
+    const int firstType = static_cast<signed char>(p[4]);
+    if (firstType == EOO) {
+        // Only the empty document may start with EOO.
+        return len == BSONObj::kMinBSONLength ? len : 0;
+    }
+    if (len == BSONObj::kMinBSONLength || !isValidBSONType(firstType)) {
+        return 0;
+    }
+
+    return len;
+}
+
+size_t validDocumentLength(const char* p, const char* end) {
+    const size_t len = plausibleDocumentLength(p, end);
+    if (len == 0 || !validateBSON(p, len, BSONVersion::kLatest).isOK()) {
+        return 0;
+    }
+    return len;
+}
+
+const char* findNextDocumentStart(const char* from,
+                                  const char* limit,
+                                  const char* end,
+                                  int confirmations) {
+    for (const char* p = from; p < limit; p++) {
+        size_t len = validDocumentLength(p, end);
+        if (len == 0) {
+            continue;
+        }
+
+        const char* next = p + len;
+        int confirmed = 0;
+        while (confirmed < confirmations && next < end) {
+            size_t nextLen = plausibleDocumentLength(next, end);
+            if (nextLen == 0) {
+                break;
+            }
+            next += nextLen;
+            confirmed++;
+        }
+        if (confirmed == confirmations || next == end) {
+            return p;
+        }
+    }
+    return nullptr;
+}
+
+}  // namespace mongo
@@ -0,0 +1,79 @@
+/**
+ *    Copyright (C) 2019-present MongoDB, Inc.
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the Server Side Public License, version 1,
+ *    as published by MongoDB, Inc.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    Server Side Public License for more details.
+ *
+ *    You should have received a copy of the Server Side Public License
+ *    along with this program. If not, see
+ *    <http://www.mongodb.com/licensing/server-side-public-license>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the Server Side Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#pragma once
+
+#include <cstddef>
+
+namespace mongo {
+
+/**
+ * Heuristics for locating BSON document boundaries in a stream of concatenated documents (eg.
+ * mongodump output), when starting from an arbitrary byte position.
+ *
+ * A position is a plausible document start if the int32 length found there is sane, the
+ * document it describes fits before the end of the data, its last byte is EOO, and the type of
+ * its first element is a valid BSON type.  None of this guarantees that the position really is
+ * the start of a document, which is why findNextDocumentStart() also requires a number of
+ * subsequent documents to chain on correctly.
+ */
+
+/**
+ * Returns the length of the plausible document starting at p, or 0 if p does not look like the
+ * start of a document that lies entirely within [p, end).
+ */
+size_t plausibleDocumentLength(const char* p, const char* end);
+
+/**
+ * Returns true if p looks like the start of a document that lies entirely within [p, end).
+ */
+inline bool isPlausibleDocumentStart(const char* p, const char* end) {
+    return plausibleDocumentLength(p, end) != 0;
+}
+
+/**
+ * Returns the length of the document starting at p, or 0 if it is not plausible (see above) or
+ * fails validateBSON(), ie. if it's not safe to read.
+ */
+size_t validDocumentLength(const char* p, const char* end);
+
+/**
+ * Scans forwards from `from` for the first position that is a plausible document start, holds a
+ * valid BSON document, and is followed by at least `confirmations` more plausible documents (or
+ * by the end of the data).
+ *
+ * Only candidate positions before `limit` are considered (documents may still extend up to
+ * `end`).  Returns nullptr if no such position is found.
+ */
+const char* findNextDocumentStart(const char* from,
+                                  const char* limit,
+                                  const char* end,
+                                  int confirmations = 2);
+
+}  // namespace mongo
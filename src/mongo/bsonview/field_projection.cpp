@@ -0,0 +1,235 @@
+/**
+ *    Copyright (C) 2019-present MongoDB, Inc.
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the Server Side Public License, version 1,
+ *    as published by MongoDB, Inc.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    Server Side Public License for more details.
+ *
+ *    You should have received a copy of the Server Side Public License
+ *    along with this program. If not, see
+ *    <http://www.mongodb.com/licensing/server-side-public-license>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the Server Side Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/bsonview/field_projection.h"
+
+#include <algorithm>
+
+#include "mongo/util/str.h"
+
+namespace mongo {
+
+namespace {
+
+std::string trim(const std::string& s) {
+    const size_t begin = s.find_first_not_of(" \t");
+    if (begin == std::string::npos) {
+        return "";
+    }
+    return s.substr(begin, s.find_last_not_of(" \t") + 1 - begin);
+}
+
+constexpr StringData kColumnSeparator = " | "_sd;
+
+}  // namespace
+
+StatusWith<FieldProjection> FieldProjection::parse(StringData spec) {
+    std::vector<std::string> paths;
+    str::splitStringDelim(spec.toString(), &paths, ',');
+
+    FieldProjection projection;
+    for (auto&& path : paths) {
+        Status s = projection._addPath(trim(path));
+        if (!s.isOK()) {
+            return s;
+        }
+    }
+
+    if (projection._paths.empty()) {
+        return Status(ErrorCodes::BadValue, "No field paths");
+    }
+    return projection;
+}
+
+FieldProjection FieldProjection::inferColumns(const std::vector<BSONObj>& sample,
+                                              size_t maxColumns) {
+    FieldProjection projection;
+    for (auto&& doc : sample) {
+        for (auto&& elem : doc) {
+            if (projection._paths.size() == maxColumns) {
+                return projection;
+            }
+            // (a field whose name has a dot in it can't be told apart from a path)
+            const std::string name = elem.fieldName();
+            if (name.find('.') == std::string::npos) {
+                projection._addPath(name).ignore();
+            }
+        }
+    }
+    return projection;
+}
+
+Status FieldProjection::_addPath(const std::string& path) {
+    if (path.empty()) {
+        return Status(ErrorCodes::BadValue, "Empty field path");
+    }
+    if (std::find(_paths.begin(), _paths.end(), path) != _paths.end()) {
+        return Status::OK();
+    }
+
+    std::vector<std::string> parts;
+    str::splitStringDelim(path, &parts, '.');
+    if (std::find(parts.begin(), parts.end(), "") != parts.end()) {
+        return Status(ErrorCodes::BadValue, "Invalid field path " + path);
+    }
+
+    std::vector<Node>* nodes = &_root;
+    Node* node = nullptr;
+    for (auto&& part : parts) {
+        auto it = std::find_if(
+            nodes->begin(), nodes->end(), [&](const Node& n) { return n.name == part; });
+        if (it == nodes->end()) {
+            nodes->push_back(Node{part});
+            it = nodes->end() - 1;
+        }
+        node = &*it;
+        nodes = &node->children;
+    }
+    node->path = _paths.size();
+    _paths.push_back(path);
+    _widths.push_back(0);
+    return Status::OK();
+}
+
+std::vector<BSONElement> FieldProjection::extract(const BSONObj& doc) const {
+    std::vector<BSONElement> elems(_paths.size());
+    _extract(doc, _root, &elems);
+    return elems;
+}
+
+void FieldProjection::_extract(const BSONObj& obj,
+                               const std::vector<Node>& nodes,
+                               std::vector<BSONElement>* elems) {
+    // (only the first of a repeated field name counts, so each node is used at most once)
+    std::vector<bool> used(nodes.size());
+    size_t remaining = nodes.size();
+    for (auto&& elem : obj) {
+        const StringData name = elem.fieldNameStringData();
+        for (size_t i = 0; i < nodes.size(); i++) {
+            const Node& node = nodes[i];
+            if (used[i] || node.name != name) {
+                continue;
+            }
+            if (node.path >= 0) {
+                (*elems)[node.path] = elem;
+            }
+            if (!node.children.empty() && elem.isABSONObj()) {
+                _extract(elem.Obj(), node.children, elems);
+            }
+            used[i] = true;
+            remaining--;
+            break;
+        }
+        if (remaining == 0) {
+            break;
+        }
+    }
+}
+
+std::string FieldProjection::_renderValue(const BSONElement& elem, JsonStringFormat format) {
+    return elem.eoo() ? "" : elem.jsonString(format, false);
+}
+
+bool FieldProjection::fitColumns(const BSONObj& doc, JsonStringFormat format) {
+    const auto elems = extract(doc);
+    bool wider = false;
+    for (size_t i = 0; i < elems.size(); i++) {
+        const size_t width = std::min(_renderValue(elems[i], format).size(), kMaxColumnWidth);
+        if (width > _widths[i]) {
+            _widths[i] = width;
+            wider = true;
+        }
+    }
+    return wider;
+}
+
+std::string FieldProjection::render(const BSONObj& doc, JsonStringFormat format) const {
+    const auto elems = extract(doc);
+    std::string line;
+    for (size_t i = 0; i < elems.size(); i++) {
+        const std::string value = _renderValue(elems[i], format);
+        line += _paths[i];
+        line += ": ";
+        line += value;
+        if (i + 1 < elems.size()) {
+            line.append(_widths[i] > value.size() ? _widths[i] - value.size() : 0, ' ');
+            line += "  ";
+        }
+    }
+    return line;
+}
+
+std::string FieldProjection::renderHeader() const {
+    return _renderTableLine(_paths);
+}
+
+std::string FieldProjection::renderRow(const BSONObj& doc, JsonStringFormat format) const {
+    const auto elems = extract(doc);
+    std::vector<std::string> cells;
+    cells.reserve(elems.size());
+    for (auto&& elem : elems) {
+        cells.push_back(_renderValue(elem, format));
+    }
+    return _renderTableLine(cells);
+}
+
+std::string FieldProjection::_renderTableLine(const std::vector<std::string>& cells) const {
+    std::string line;
+    for (size_t i = 0; i < cells.size(); i++) {
+        const size_t width = _tableColumnWidth(i);
+        if (cells[i].size() > width) {
+            // (marking where it was cut)
+            line.append(cells[i], 0, width - 1);
+            line += '~';
+        } else {
+            line += cells[i];
+            if (i + 1 < cells.size()) {
+                line.append(width - cells[i].size(), ' ');
+            }
+        }
+        if (i + 1 < cells.size()) {
+            line.append(kColumnSeparator.rawData(), kColumnSeparator.size());
+        }
+    }
+    return line;
+}
+
+std::vector<size_t> FieldProjection::columnStarts() const {
+    std::vector<size_t> starts;
+    size_t start = 0;
+    for (size_t i = 0; i < _paths.size(); i++) {
+        starts.push_back(start);
+        start += _tableColumnWidth(i) + kColumnSeparator.size();
+    }
+    return starts;
+}
+
+}  // namespace mongo
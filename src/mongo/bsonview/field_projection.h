@@ -0,0 +1,139 @@
+/**
+ *    Copyright (C) 2019-present MongoDB, Inc.
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the Server Side Public License, version 1,
+ *    as published by MongoDB, Inc.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    Server Side Public License for more details.
+ *
+ *    You should have received a copy of the Server Side Public License
+ *    along with this program. If not, see
+ *    <http://www.mongodb.com/licensing/server-side-public-license>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the Server Side Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "mongo/base/status_with.h"
+#include "mongo/base/string_data.h"
+#include "mongo/bson/bsonobj.h"
+#include "mongo/bson/json.h"
+
+namespace mongo {
+
+/**
+ * Picks a few fields out of docs by their dotted paths (eg. "ts,op,o._id"), and renders them as
+ * one line of aligned columns, either labelled with their paths, or as the rows of a table.
+ *
+ * The paths are merged into a tree, so each doc (and each subdoc on a path) is walked once, and
+ * only as far as its last wanted field.  Other subdocs are stepped over by their length, without
+ * looking inside them.  Array elements are picked by number (eg. "a.0.b"), rather than
+ * searching every element like a query would.
+ */
+class FieldProjection {
+public:
+    /**
+     * Columns are widened to fit the values seen by fitColumns(), but no further than this.
+     */
+    static constexpr size_t kMaxColumnWidth = 40;
+
+    static constexpr size_t kMaxInferredColumns = 64;
+
+    /**
+     * Parses a comma separated list of paths.
+     */
+    static StatusWith<FieldProjection> parse(StringData spec);
+
+    /**
+     * The top-level fields of the sample docs, in the order they're first seen, for showing a
+     * collection whose docs mostly have the same fields as a table.
+     */
+    static FieldProjection inferColumns(const std::vector<BSONObj>& sample,
+                                        size_t maxColumns = kMaxInferredColumns);
+
+    const std::vector<std::string>& paths() const {
+        return _paths;
+    }
+
+    /**
+     * The element at each path, in the order of paths(), or EOO where the doc doesn't have one.
+     * Where a field name is repeated, the first is used.
+     */
+    std::vector<BSONElement> extract(const BSONObj& doc) const;
+
+    /**
+     * Widens the columns to fit this doc's values.  Returns whether any got wider.
+     */
+    bool fitColumns(const BSONObj& doc, JsonStringFormat format);
+
+    /**
+     * Each path and its value, on one line, with values padded to the width of their column.
+     */
+    std::string render(const BSONObj& doc, JsonStringFormat format) const;
+
+    /**
+     * The paths, as the header of a table whose rows are renderRow().
+     */
+    std::string renderHeader() const;
+
+    /**
+     * Just the values, each padded (or cut short) to the width of its column, which is at least
+     * as wide as its path.
+     */
+    std::string renderRow(const BSONObj& doc, JsonStringFormat format) const;
+
+    /**
+     * Where each column of the table starts.
+     */
+    std::vector<size_t> columnStarts() const;
+
+private:
+    // The paths as a tree of their parts.  A node is the end of the path numbered `path`, if
+    // that's not -1, and leads to the paths below it in `children`.
+    struct Node {
+        std::string name;
+        int path = -1;
+        std::vector<Node> children;
+    };
+
+    FieldProjection() = default;
+
+    Status _addPath(const std::string& path);
+
+    size_t _tableColumnWidth(size_t i) const {
+        return std::max(_widths[i], _paths[i].size());
+    }
+
+    std::string _renderTableLine(const std::vector<std::string>& cells) const;
+
+    static void _extract(const BSONObj& obj,
+                         const std::vector<Node>& nodes,
+                         std::vector<BSONElement>* elems);
+
+    static std::string _renderValue(const BSONElement& elem, JsonStringFormat format);
+
+    std::vector<std::string> _paths;
+    std::vector<Node> _root;
+    std::vector<size_t> _widths;
+};
+
+}  // namespace mongo
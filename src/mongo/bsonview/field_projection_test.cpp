@@ -0,0 +1,156 @@
+/**
+ *    Copyright (C) 2019-present MongoDB, Inc.
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the Server Side Public License, version 1,
+ *    as published by MongoDB, Inc.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    Server Side Public License for more details.
+ *
+ *    You should have received a copy of the Server Side Public License
+ *    along with this program. If not, see
+ *    <http://www.mongodb.com/licensing/server-side-public-license>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the Server Side Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/bson/bsonobjbuilder.h"
+#include "mongo/bsonview/field_projection.h"
+#include "mongo/unittest/unittest.h"
+
+namespace mongo {
+
+namespace {
+
+FieldProjection parse(StringData spec) {
+    auto swProjection = FieldProjection::parse(spec);
+    ASSERT_OK(swProjection.getStatus());
+    return swProjection.getValue();
+}
+
+TEST(FieldProjectionTest, Parse) {
+    ASSERT_EQ(parse("ts").paths().size(), 1U);
+    auto projection = parse(" ts, op ,o._id,op");
+    ASSERT_EQ(projection.paths().size(), 3U);
+    ASSERT_EQ(projection.paths()[1], "op");
+    ASSERT_EQ(projection.paths()[2], "o._id");
+
+    ASSERT_NOT_OK(FieldProjection::parse("").getStatus());
+    ASSERT_NOT_OK(FieldProjection::parse("ts,,op").getStatus());
+    ASSERT_NOT_OK(FieldProjection::parse("o..x").getStatus());
+    ASSERT_NOT_OK(FieldProjection::parse("o.").getStatus());
+}
+
+TEST(FieldProjectionTest, ExtractsNestedPathsInOrder) {
+    auto projection = parse("o._id,ts,o,missing,o.missing,ts.x");
+    const BSONObj doc = BSON("ts" << 5 << "op"
+                                  << "i"
+                                  << "o" << BSON("x" << 1 << "_id" << 7));
+    auto elems = projection.extract(doc);
+    ASSERT_EQ(elems.size(), 6U);
+    ASSERT_EQ(elems[0].numberInt(), 7);
+    ASSERT_EQ(elems[1].numberInt(), 5);
+    ASSERT_BSONOBJ_EQ(elems[2].Obj(), BSON("x" << 1 << "_id" << 7));
+    ASSERT(elems[3].eoo());
+    ASSERT(elems[4].eoo());
+    ASSERT(elems[5].eoo());
+}
+
+TEST(FieldProjectionTest, ArrayElementsByNumber) {
+    auto projection = parse("a.1.b,a.b");
+    const BSONObj doc = BSON("a" << BSON_ARRAY(BSON("b" << 1) << BSON("b" << 2)));
+    auto elems = projection.extract(doc);
+    ASSERT_EQ(elems[0].numberInt(), 2);
+    ASSERT(elems[1].eoo());
+}
+
+TEST(FieldProjectionTest, FirstOfRepeatedFields) {
+    BSONObjBuilder b;
+    b.append("a", 1);
+    b.append("a", 2);
+    const BSONObj doc = b.obj();
+    auto elems = parse("a").extract(doc);
+    ASSERT_EQ(elems[0].numberInt(), 1);
+}
+
+TEST(FieldProjectionTest, SkippedSubdocsAreNotRead) {
+    // The subdoc's contents are garbage, but only its length should be looked at.
+    BSONObjBuilder b;
+    b.append("skipped", BSON("x" << "some string"));
+    b.append("wanted", 3);
+    BSONObj doc = b.obj();
+    char* contents = const_cast<char*>(doc["skipped"].Obj().objdata()) + 4;
+    memset(contents, 0xff, doc["skipped"].Obj().objsize() - 5);
+    ASSERT_EQ(parse("wanted").extract(doc)[0].numberInt(), 3);
+}
+
+TEST(FieldProjectionTest, RendersAlignedColumns) {
+    auto projection = parse("op,ns,n");
+    const BSONObj a = BSON("op"
+                           << "query"
+                           << "ns"
+                           << "test.c"
+                           << "n" << 1);
+    const BSONObj b = BSON("op"
+                           << "i"
+                           << "n" << 10);
+    projection.fitColumns(a, Strict);
+    projection.fitColumns(b, Strict);
+    ASSERT_EQ(projection.render(a, Strict), "op: \"query\"  ns: \"test.c\"  n: 1");
+    ASSERT_EQ(projection.render(b, Strict), "op: \"i\"      ns:           n: 10");
+}
+
+TEST(FieldProjectionTest, InfersColumnsFromTopLevelFields) {
+    auto projection = FieldProjection::inferColumns(
+        {BSON("_id" << 1 << "a" << BSON("x" << 1)), BSON("_id" << 2 << "b" << 1 << "a.b" << 1)});
+    ASSERT_EQ(projection.paths().size(), 3U);
+    ASSERT_EQ(projection.paths()[0], "_id");
+    ASSERT_EQ(projection.paths()[1], "a");
+    ASSERT_EQ(projection.paths()[2], "b");
+
+    ASSERT_EQ(FieldProjection::inferColumns({BSON("a" << 1 << "b" << 2 << "c" << 3)}, 2)
+                  .paths()
+                  .size(),
+              2U);
+}
+
+TEST(FieldProjectionTest, RendersTableRows) {
+    auto projection = parse("_id,name,n");
+    const BSONObj a = BSON("_id" << 1 << "name"
+                                 << "a long name that won't fit in the column at all, at all"
+                                 << "n" << 1);
+    const BSONObj b = BSON("_id" << 22 << "n" << 100);
+    ASSERT(projection.fitColumns(a, Strict));
+    ASSERT(!projection.fitColumns(a, Strict));
+    ASSERT(projection.fitColumns(b, Strict));
+
+    ASSERT_EQ(projection.renderHeader(), "_id | name" + std::string(36, ' ') + " | n");
+    ASSERT_EQ(projection.renderRow(b, Strict), "22  | " + std::string(40, ' ') + " | 100");
+    const std::string row = projection.renderRow(a, Strict);
+    ASSERT_EQ(row.substr(0, 6), "1   | ");
+    ASSERT_EQ(row.substr(45), "~ | 1");
+
+    const auto starts = projection.columnStarts();
+    ASSERT_EQ(starts.size(), 3U);
+    ASSERT_EQ(starts[0], 0U);
+    ASSERT_EQ(starts[1], 6U);
+    ASSERT_EQ(starts[2], 49U);
+}
+
+}  // namespace
+}  // namespace mongo
@@ -0,0 +1,410 @@
+/**
+ *    Copyright (C) 2019-present MongoDB, Inc.
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the Server Side Public License, version 1,
+ *    as published by MongoDB, Inc.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    Server Side Public License for more details.
+ *
+ *    You should have received a copy of the Server Side Public License
+ *    along with this program. If not, see
+ *    <http://www.mongodb.com/licensing/server-side-public-license>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the Server Side Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/bsonview/field_stats.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <sstream>
+#include <third_party/murmurhash3/MurmurHash3.h>
+
+#include "mongo/bson/bsonelement.h"
+#include "mongo/platform/bits.h"
+#include "mongo/stdx/thread.h"
+#include "mongo/util/assert_util.h"
+#include "mongo/util/concurrency/thread_pool.h"
+
+namespace mongo {
+
+namespace {
+
+uint64_t hashValue(const BSONElement& elem) {
+    // (the type counts too, so that eg. 1 and "1" are different values)
+    uint64_t hash[2];
+    const char type = elem.type();
+    MurmurHash3_x64_128(elem.value(), elem.valuesize(), static_cast<uint8_t>(type), hash);
+    return hash[0];
+}
+
+// Most frequent first, then (for ties, so the order doesn't depend on how they were added) by value.
+bool moreFrequent(const TopValues::Entry& a, const TopValues::Entry& b) {
+    return a.count != b.count ? a.count > b.count : a.value < b.value;
+}
+
+// Which of PathStats::sizeBuckets a size goes in.
+int sizeBucket(uint64_t size) {
+    return size ? 64 - countLeadingZeros64(size) : 0;
+}
+
+}  // namespace
+
+void HyperLogLog::add(uint64_t hash) {
+    const size_t i = hash >> (64 - kPrecision);
+    const uint64_t rest = hash << kPrecision;
+    // (where the first 1 bit is in the rest, from 1)
+    const uint8_t rank = rest ? countLeadingZeros64(rest) + 1 : 64 - kPrecision + 1;
+    _registers[i] = std::max(_registers[i], rank);
+}
+
+void HyperLogLog::merge(const HyperLogLog& other) {
+    for (size_t i = 0; i < _registers.size(); i++) {
+        _registers[i] = std::max(_registers[i], other._registers[i]);
+    }
+}
+
+uint64_t HyperLogLog::estimate() const {
+    const double m = _registers.size();
+    double sum = 0;
+    size_t zeros = 0;
+    for (uint8_t r : _registers) {
+        sum += std::ldexp(1.0, -r);
+        zeros += r == 0;
+    }
+    const double alpha = 0.7213 / (1 + 1.079 / m);
+    const double estimate = alpha * m * m / sum;
+    if (estimate <= 2.5 * m && zeros) {
+        // Few values, so count how many registers they've touched instead.
+        return std::llround(m * std::log(m / zeros));
+    }
+    return std::llround(estimate);
+}
+
+void TopValues::add(StringData value) {
+    for (auto&& entry : _entries) {
+        if (entry.value == value) {
+            entry.count++;
+            return;
+        }
+    }
+    if (_entries.size() < kCapacity) {
+        _entries.push_back({value.toString(), 1, 0});
+        return;
+    }
+    // The new value takes over the least frequent counter, which is as many times as it could
+    // have been added before without being counted.
+    auto least = std::min_element(_entries.begin(), _entries.end(), [](auto&& a, auto&& b) {
+        return a.count < b.count;
+    });
+    least->value = value.toString();
+    least->error = least->count;
+    least->count++;
+}
+
+void TopValues::merge(const TopValues& other) {
+    for (auto&& theirs : other._entries) {
+        auto ours = std::find_if(_entries.begin(), _entries.end(), [&](auto&& entry) {
+            return entry.value == theirs.value;
+        });
+        if (ours != _entries.end()) {
+            ours->count += theirs.count;
+            ours->error += theirs.error;
+        } else {
+            _entries.push_back(theirs);
+        }
+    }
+    std::sort(_entries.begin(), _entries.end(), moreFrequent);
+    if (_entries.size() > kCapacity) {
+        _entries.resize(kCapacity);
+    }
+}
+
+std::vector<TopValues::Entry> TopValues::top(size_t k) const {
+    std::vector<Entry> top = _entries;
+    std::sort(top.begin(), top.end(), moreFrequent);
+    if (top.size() > k) {
+        top.resize(k);
+    }
+    return top;
+}
+
+void PathStats::merge(const PathStats& other) {
+    count += other.count;
+    docs += other.docs;
+    for (auto&& type : other.types) {
+        types[type.first] += type.second;
+    }
+    minSize = std::min(minSize, other.minSize);
+    maxSize = std::max(maxSize, other.maxSize);
+    totalSize += other.totalSize;
+    for (size_t i = 0; i < sizeBuckets.size(); i++) {
+        sizeBuckets[i] += other.sizeBuckets[i];
+    }
+    distinct.merge(other.distinct);
+    top.merge(other.top);
+}
+
+void FieldStats::add(const BSONObj& doc) {
+    _numDocs++;
+    std::string path;
+    _addObject(doc, &path, 0);
+}
+
+void FieldStats::_addObject(const BSONObj& obj, std::string* path, int depth) {
+    const size_t prefixLength = path->size();
+    for (auto&& elem : obj) {
+        if (prefixLength) {
+            *path += '.';
+        }
+        path->append(elem.fieldName(), elem.fieldNameSize() - 1);
+        _addElement(elem, path, depth);
+        path->resize(prefixLength);
+    }
+}
+
+void FieldStats::_addElement(const BSONElement& elem, std::string* path, int depth) {
+    auto it = _paths.find(*path);
+    if (it == _paths.end()) {
+        if (_paths.size() >= kMaxPaths) {
+            _droppedPaths++;
+            return;
+        }
+        it = _paths.emplace(*path, PathStats()).first;
+    }
+    PathStats& stats = it->second;
+
+    stats.count++;
+    if (stats.lastDoc != _numDocs) {
+        stats.lastDoc = _numDocs;
+        stats.docs++;
+    }
+    stats.types[elem.type()]++;
+    const uint64_t size = elem.valuesize();
+    stats.minSize = std::min(stats.minSize, size);
+    stats.maxSize = std::max(stats.maxSize, size);
+    stats.totalSize += size;
+    stats.sizeBuckets[sizeBucket(size)]++;
+    stats.distinct.add(hashValue(elem));
+
+    if (elem.type() == Object || elem.type() == Array) {
+        if (depth < kMaxDepth) {
+            if (elem.type() == Array) {
+                // (every element of an array has the same path)
+                const size_t prefixLength = path->size();
+                *path += ".[]";
+                for (auto&& item : elem.Obj()) {
+                    _addElement(item, path, depth + 1);
+                }
+                path->resize(prefixLength);
+            } else {
+                _addObject(elem.Obj(), path, depth + 1);
+            }
+        }
+    } else if (size <= kMaxTopValueSize) {
+        // (type, empty field name, value)
+        std::string value(1, elem.type());
+        value += '\0';
+        value.append(elem.value(), size);
+        stats.top.add(value);
+    }
+}
+
+void FieldStats::merge(const FieldStats& other) {
+    _numDocs += other._numDocs;
+    _droppedPaths += other._droppedPaths;
+    for (auto&& path : other._paths) {
+        auto it = _paths.find(path.first);
+        if (it != _paths.end()) {
+            it->second.merge(path.second);
+        } else if (_paths.size() < kMaxPaths) {
+            _paths.emplace(path.first, path.second);
+        } else {
+            _droppedPaths += path.second.count;
+        }
+    }
+}
+
+std::string FieldStats::report() const {
+    std::vector<const std::pair<const std::string, PathStats>*> paths;
+    for (auto&& path : _paths) {
+        paths.push_back(&path);
+    }
+    std::sort(paths.begin(), paths.end(), [](auto&& a, auto&& b) { return a->first < b->first; });
+
+    std::ostringstream out;
+    out << _numDocs << " docs, " << paths.size() << " paths";
+    if (_droppedPaths) {
+        out << " (and " << _droppedPaths << " occurrences of others, not profiled)";
+    }
+    out << "\n";
+
+    out << std::fixed << std::setprecision(1);
+    for (auto&& path : paths) {
+        const PathStats& stats = path->second;
+        out << "\n" << path->first << "\n";
+
+        out << "  in " << stats.docs << " docs (" << _numDocs - stats.docs << " missing)";
+        if (stats.count != stats.docs) {
+            out << ", " << stats.count << " times";
+        }
+        out << ", ~" << std::min(stats.distinct.estimate(), stats.count) << " distinct\n";
+
+        out << "  types:";
+        for (auto&& type : stats.types) {
+            out << " " << typeName(type.first) << " " << type.second;
+        }
+        out << "\n";
+
+        out << "  sizes: " << stats.minSize << "-" << stats.maxSize << " bytes, mean "
+            << double(stats.totalSize) / stats.count << ";";
+        for (size_t i = 0; i < stats.sizeBuckets.size(); i++) {
+            if (stats.sizeBuckets[i]) {
+                const uint64_t low = i ? 1ULL << (i - 1) : 0;
+                const uint64_t high = i ? (1ULL << i) - 1 : 0;
+                out << " " << low;
+                if (high != low) {
+                    out << "-" << high;
+                }
+                out << ": " << stats.sizeBuckets[i];
+            }
+        }
+        out << "\n";
+
+        // (values that may only occur once aren't interesting, eg. for _id)
+        const auto top = stats.top.top(5);
+        auto recurring = [](const TopValues::Entry& entry) { return entry.count - entry.error > 1; };
+        if (std::any_of(top.begin(), top.end(), recurring)) {
+            out << "  top:";
+            for (auto&& entry : top) {
+                if (recurring(entry)) {
+                    out << " " << BSONElement(entry.value.data()).jsonString(Strict, false) << " ("
+                        << entry.count << ")";
+                }
+            }
+            out << "\n";
+        }
+    }
+    return out.str();
+}
+
+BackgroundFieldStats::BackgroundFieldStats(size_t numThreads)
+    : _numThreads(numThreads
+                      ? numThreads
+                      : std::max(1u, static_cast<unsigned>(stdx::thread::hardware_concurrency()))) {
+    ThreadPool::Options options;
+    options.poolName = "bsonview stats";
+    options.threadNamePrefix = "bsonview-stats-";
+    options.minThreads = 0;
+    options.maxThreads = _numThreads;
+    _pool = std::make_unique<ThreadPool>(options);
+    _pool->startup();
+}
+
+BackgroundFieldStats::~BackgroundFieldStats() {
+    cancel();
+}
+
+void BackgroundFieldStats::add(std::vector<BSONObj> docs) {
+    {
+        stdx::lock_guard<stdx::mutex> lk(_mutex);
+        invariant(!_finished);
+        _pendingBatches++;
+    }
+
+    auto shared = std::make_shared<std::vector<BSONObj>>(std::move(docs));
+    _pool->schedule([this, shared](Status status) {
+        _profile(status.isOK() ? *shared : std::vector<BSONObj>());
+    });
+}
+
+bool BackgroundFieldStats::wantsMore() const {
+    stdx::lock_guard<stdx::mutex> lk(_mutex);
+    return !_finished && _pendingBatches < 2 * _numThreads;
+}
+
+void BackgroundFieldStats::waitUntilWantsMore() const {
+    stdx::unique_lock<stdx::mutex> lk(_mutex);
+    _batchDone.wait(lk, [&] { return _finished || _pendingBatches < 2 * _numThreads; });
+}
+
+void BackgroundFieldStats::finish() {
+    stdx::lock_guard<stdx::mutex> lk(_mutex);
+    _finished = true;
+}
+
+void BackgroundFieldStats::waitUntilDone() const {
+    stdx::unique_lock<stdx::mutex> lk(_mutex);
+    invariant(_finished);
+    _batchDone.wait(lk, [&] { return _pendingBatches == 0; });
+}
+
+void BackgroundFieldStats::cancel() {
+    if (_pool) {
+        _cancelled.store(true);
+        _pool->shutdown();
+        _pool->join();
+        _pool.reset();
+    }
+}
+
+bool BackgroundFieldStats::isDone() const {
+    stdx::lock_guard<stdx::mutex> lk(_mutex);
+    return _finished && _pendingBatches == 0;
+}
+
+FieldStats BackgroundFieldStats::result() const {
+    stdx::lock_guard<stdx::mutex> lk(_mutex);
+    invariant(_finished && _pendingBatches == 0);
+    FieldStats result;
+    for (auto&& stats : _idleStats) {
+        result.merge(*stats);
+    }
+    return result;
+}
+
+void BackgroundFieldStats::_profile(const std::vector<BSONObj>& docs) {
+    std::unique_ptr<FieldStats> stats;
+    {
+        stdx::lock_guard<stdx::mutex> lk(_mutex);
+        if (!_idleStats.empty()) {
+            stats = std::move(_idleStats.back());
+            _idleStats.pop_back();
+        }
+    }
+    if (!stats) {
+        stats = std::make_unique<FieldStats>();
+    }
+
+    for (auto&& doc : docs) {
+        if (_cancelled.load()) {
+            break;
+        }
+        stats->add(doc);
+        _docsProfiled.fetchAndAdd(1);
+    }
+
+    stdx::lock_guard<stdx::mutex> lk(_mutex);
+    _idleStats.push_back(std::move(stats));
+    _pendingBatches--;
+    _batchDone.notify_all();
+}
+
+}  // namespace mongo
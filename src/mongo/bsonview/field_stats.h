@@ -0,0 +1,253 @@
+/**
+ *    Copyright (C) 2019-present MongoDB, Inc.
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the Server Side Public License, version 1,
+ *    as published by MongoDB, Inc.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    Server Side Public License for more details.
+ *
+ *    You should have received a copy of the Server Side Public License
+ *    along with this program. If not, see
+ *    <http://www.mongodb.com/licensing/server-side-public-license>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the Server Side Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "mongo/base/string_data.h"
+#include "mongo/bson/bsonobj.h"
+#include "mongo/platform/atomic_word.h"
+#include "mongo/stdx/condition_variable.h"
+#include "mongo/stdx/mutex.h"
+
+namespace mongo {
+
+class ThreadPool;
+
+/**
+ * Estimates how many distinct values have been added (HyperLogLog, with linear counting while
+ * there are few), to within a few percent, in 2^kPrecision bytes.  Estimates can be merged.
+ */
+class HyperLogLog {
+public:
+    static constexpr int kPrecision = 11;
+
+    /**
+     * `hash` must be a good 64 bit hash of the value.
+     */
+    void add(uint64_t hash);
+
+    void merge(const HyperLogLog& other);
+
+    uint64_t estimate() const;
+
+private:
+    std::array<uint8_t, 1 << kPrecision> _registers{};
+};
+
+/**
+ * The values added most often, approximately, using a fixed number of counters (Space-Saving).
+ * Any value that's more than 1/kCapacity of those added is sure to be among them, and each count
+ * is at most `error` too high.  Merging is approximate too: values that fell out of one side's
+ * counters are undercounted.
+ */
+class TopValues {
+public:
+    static constexpr size_t kCapacity = 32;
+
+    struct Entry {
+        std::string value;
+        uint64_t count;
+        uint64_t error;
+    };
+
+    void add(StringData value);
+
+    void merge(const TopValues& other);
+
+    /**
+     * The k most frequent, most frequent first.
+     */
+    std::vector<Entry> top(size_t k) const;
+
+private:
+    std::vector<Entry> _entries;
+};
+
+/**
+ * What the values at one (dotted) path are like.
+ */
+struct PathStats {
+    // Times the path occurs, which is more than the number of docs it's in if it's in an array.
+    uint64_t count = 0;
+    uint64_t docs = 0;
+    std::map<BSONType, uint64_t> types;
+    // Of the values (as in BSONElement::valuesize()).  Bucket i has sizes in [2^(i-1), 2^i).
+    uint64_t minSize = UINT64_MAX;
+    uint64_t maxSize = 0;
+    uint64_t totalSize = 0;
+    std::array<uint64_t, 33> sizeBuckets{};
+    HyperLogLog distinct;
+    // Only of values up to kMaxTopValueSize (and not docs or arrays), as type, empty field name
+    // and value, so they can be read as a BSONElement.
+    TopValues top;
+
+    // The last doc counted in `docs` (numbered from 1), so each doc is only counted once.
+    uint64_t lastDoc = 0;
+
+    void merge(const PathStats& other);
+};
+
+/**
+ * A profile of the fields in a set of docs: which paths occur, how often, with what types, sizes
+ * and values.  Elements of arrays have the array's path followed by ".[]".
+ *
+ * Profiles of different docs can be merged, so they can be built in parallel (see
+ * BackgroundFieldStats).
+ */
+class FieldStats {
+public:
+    static constexpr size_t kMaxTopValueSize = 128;
+
+    /**
+     * Beyond these, new paths aren't profiled (eg. if field names are ids, rather than a schema).
+     */
+    static constexpr size_t kMaxPaths = 10000;
+    static constexpr int kMaxDepth = 32;
+
+    void add(const BSONObj& doc);
+
+    void merge(const FieldStats& other);
+
+    uint64_t numDocs() const {
+        return _numDocs;
+    }
+
+    const std::unordered_map<std::string, PathStats>& paths() const {
+        return _paths;
+    }
+
+    /**
+     * Occurrences of paths that were dropped because there were too many.
+     */
+    uint64_t droppedPaths() const {
+        return _droppedPaths;
+    }
+
+    /**
+     * The profile as text, path by path.
+     */
+    std::string report() const;
+
+private:
+    void _addObject(const BSONObj& obj, std::string* path, int depth);
+    void _addElement(const BSONElement& elem, std::string* path, int depth);
+
+    std::unordered_map<std::string, PathStats> _paths;
+    uint64_t _numDocs = 0;
+    uint64_t _droppedPaths = 0;
+};
+
+/**
+ * Profiles docs on worker threads, each with a FieldStats of its own, and merges them once the
+ * docs have all been profiled.
+ *
+ * The docs are added a batch at a time, as with BackgroundSearch, and in any order.
+ */
+class BackgroundFieldStats {
+    BackgroundFieldStats(const BackgroundFieldStats&) = delete;
+    BackgroundFieldStats& operator=(const BackgroundFieldStats&) = delete;
+
+public:
+    /**
+     * A numThreads of 0 means one thread per available core.
+     */
+    explicit BackgroundFieldStats(size_t numThreads = 0);
+    ~BackgroundFieldStats();
+
+    /**
+     * The docs must stay valid until they have been profiled (or it's cancelled).
+     */
+    void add(std::vector<BSONObj> docs);
+
+    /**
+     * Whether the workers would run out of batches without more soon.
+     */
+    bool wantsMore() const;
+
+    /**
+     * Waits until wantsMore().
+     */
+    void waitUntilWantsMore() const;
+
+    /**
+     * No more docs will be added.
+     */
+    void finish();
+
+    /**
+     * Waits until isDone(), which must be after finish().
+     */
+    void waitUntilDone() const;
+
+    /**
+     * Abandons the profile, and waits for the workers to stop.
+     */
+    void cancel();
+
+    /**
+     * Whether every doc has been profiled (after finish()).
+     */
+    bool isDone() const;
+
+    uint64_t docsProfiled() const {
+        return _docsProfiled.load();
+    }
+
+    /**
+     * The profile of all the docs, once isDone().
+     */
+    FieldStats result() const;
+
+private:
+    void _profile(const std::vector<BSONObj>& docs);
+
+    const size_t _numThreads;
+    std::unique_ptr<ThreadPool> _pool;
+
+    AtomicWord<bool> _cancelled{false};
+    AtomicWord<uint64_t> _docsProfiled{0};
+
+    // Guards everything below.
+    mutable stdx::mutex _mutex;
+    mutable stdx::condition_variable _batchDone;
+    // Profiles not in use by a worker.
+    std::vector<std::unique_ptr<FieldStats>> _idleStats;
+    size_t _pendingBatches = 0;
+    bool _finished = false;
+};
+
+}  // namespace mongo
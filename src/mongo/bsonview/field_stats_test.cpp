@@ -0,0 +1,200 @@
+/**
+ *    Copyright (C) 2019-present MongoDB, Inc.
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the Server Side Public License, version 1,
+ *    as published by MongoDB, Inc.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    Server Side Public License for more details.
+ *
+ *    You should have received a copy of the Server Side Public License
+ *    along with this program. If not, see
+ *    <http://www.mongodb.com/licensing/server-side-public-license>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the Server Side Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include <cmath>
+#include <string>
+
+#include "mongo/bson/bsonobjbuilder.h"
+#include "mongo/bsonview/field_stats.h"
+#include "mongo/stdx/thread.h"
+#include "mongo/unittest/unittest.h"
+
+namespace mongo {
+namespace {
+
+// A good enough hash of i (splitmix64).
+uint64_t hash(uint64_t i) {
+    uint64_t z = (i + 1) * 0x9E3779B97F4A7C15ULL;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+TEST(HyperLogLogTest, EstimatesDistinctValues) {
+    for (uint64_t n : {0ULL, 10ULL, 1000ULL, 100000ULL}) {
+        HyperLogLog hll;
+        for (uint64_t i = 0; i < n; i++) {
+            hll.add(hash(i));
+            hll.add(hash(i));
+        }
+        const double error = std::abs(double(hll.estimate()) - n);
+        ASSERT_LTE(error, 0.05 * n + 1) << n << " estimated as " << hll.estimate();
+    }
+}
+
+TEST(HyperLogLogTest, Merge) {
+    HyperLogLog a, b;
+    for (uint64_t i = 0; i < 20000; i++) {
+        (i % 2 ? a : b).add(hash(i));
+    }
+    a.merge(b);
+    ASSERT_LTE(std::abs(double(a.estimate()) - 20000), 1000.0) << a.estimate();
+}
+
+TEST(TopValuesTest, FindsFrequentValuesAmongMany) {
+    TopValues top;
+    for (int i = 0; i < 10000; i++) {
+        top.add(i % 4 == 0 ? "common" : i % 10 == 1 ? "less common" : std::to_string(i));
+    }
+    auto values = top.top(2);
+    ASSERT_EQ(values.size(), 2U);
+    ASSERT_EQ(values[0].value, "common");
+    ASSERT_GTE(values[0].count, 2500U);
+    ASSERT_LTE(values[0].count - values[0].error, 2500U);
+    ASSERT_EQ(values[1].value, "less common");
+}
+
+TEST(TopValuesTest, Merge) {
+    TopValues a, b;
+    for (int i = 0; i < 10; i++) {
+        a.add("x");
+        b.add("x");
+        b.add("y");
+    }
+    a.merge(b);
+    auto values = a.top(10);
+    ASSERT_EQ(values.size(), 2U);
+    ASSERT_EQ(values[0].value, "x");
+    ASSERT_EQ(values[0].count, 20U);
+    ASSERT_EQ(values[1].count, 10U);
+}
+
+TEST(FieldStatsTest, ProfilesPaths) {
+    FieldStats stats;
+    stats.add(BSON("_id" << 1 << "a" << BSON("b"
+                                             << "x")
+                         << "c" << BSON_ARRAY(1 << 2 << 3)));
+    stats.add(BSON("_id" << 2 << "a" << BSONNULL));
+    stats.add(BSON("_id" << 3 << "a" << BSON("b" << 5)));
+
+    ASSERT_EQ(stats.numDocs(), 3U);
+    const auto& paths = stats.paths();
+    ASSERT_EQ(paths.size(), 5U);
+
+    const PathStats& id = paths.at("_id");
+    ASSERT_EQ(id.docs, 3U);
+    ASSERT_EQ(id.types.at(NumberInt), 3U);
+    ASSERT_EQ(id.distinct.estimate(), 3U);
+    ASSERT_EQ(id.minSize, 4U);
+    ASSERT_EQ(id.sizeBuckets[3], 3U);
+
+    const PathStats& a = paths.at("a");
+    ASSERT_EQ(a.types.at(Object), 2U);
+    ASSERT_EQ(a.types.at(jstNULL), 1U);
+
+    const PathStats& b = paths.at("a.b");
+    ASSERT_EQ(b.docs, 2U);
+    ASSERT_EQ(b.types.size(), 2U);
+
+    ASSERT_EQ(paths.at("c").docs, 1U);
+    const PathStats& items = paths.at("c.[]");
+    ASSERT_EQ(items.docs, 1U);
+    ASSERT_EQ(items.count, 3U);
+}
+
+TEST(FieldStatsTest, TopValuesKeepTheirType) {
+    FieldStats stats;
+    for (int i = 0; i < 5; i++) {
+        stats.add(BSON("v" << 1));
+        stats.add(BSON("v"
+                       << "1"));
+        stats.add(BSON("v" << 1));
+    }
+    auto top = stats.paths().at("v").top.top(2);
+    ASSERT_EQ(top.size(), 2U);
+    ASSERT_EQ(BSONElement(top[0].value.data()).type(), NumberInt);
+    ASSERT_EQ(top[0].count, 10U);
+    ASSERT_EQ(BSONElement(top[1].value.data()).String(), "1");
+    ASSERT_EQ(stats.paths().at("v").distinct.estimate(), 2U);
+
+    const std::string report = stats.report();
+    ASSERT(report.find("top: 1 (10) \"1\" (5)") != std::string::npos) << report;
+}
+
+TEST(FieldStatsTest, MergingIsLikeAddingToOne) {
+    FieldStats all, even, odd;
+    for (int i = 0; i < 100; i++) {
+        // (few enough values that the top ones are exact)
+        BSONObj doc = BSON("x" << i % 20 << (i % 2 ? "odd" : "even") << i % 10);
+        all.add(doc);
+        (i % 2 ? odd : even).add(doc);
+    }
+    even.merge(odd);
+    ASSERT_EQ(even.numDocs(), 100U);
+    ASSERT_EQ(even.report(), all.report());
+}
+
+TEST(FieldStatsTest, TooManyPaths) {
+    FieldStats stats;
+    BSONObjBuilder b;
+    for (size_t i = 0; i < FieldStats::kMaxPaths + 10; i++) {
+        b.append(std::to_string(i), 1);
+    }
+    stats.add(b.obj());
+    ASSERT_EQ(stats.paths().size(), FieldStats::kMaxPaths);
+    ASSERT_EQ(stats.droppedPaths(), 10U);
+}
+
+TEST(BackgroundFieldStatsTest, ProfilesEveryDoc) {
+    BackgroundFieldStats stats(4);
+    for (int first = 0; first < 10000; first += 100) {
+        stats.waitUntilWantsMore();
+        std::vector<BSONObj> batch;
+        for (int i = first; i < first + 100; i++) {
+            batch.push_back(BSON("_id" << i << "group" << i % 7));
+        }
+        stats.add(std::move(batch));
+    }
+    stats.finish();
+    while (!stats.isDone()) {
+        stdx::this_thread::yield();
+    }
+    ASSERT_EQ(stats.docsProfiled(), 10000U);
+
+    FieldStats result = stats.result();
+    ASSERT_EQ(result.numDocs(), 10000U);
+    ASSERT_EQ(result.paths().at("group").docs, 10000U);
+    ASSERT_EQ(result.paths().at("group").distinct.estimate(), 7U);
+    ASSERT_EQ(result.paths().at("group").top.top(10).size(), 7U);
+}
+
+}  // namespace
+}  // namespace mongo
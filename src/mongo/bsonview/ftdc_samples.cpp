@@ -0,0 +1,258 @@
+/**
+ *    Copyright (C) 2019-present MongoDB, Inc.
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the Server Side Public License, version 1,
+ *    as published by MongoDB, Inc.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    Server Side Public License for more details.
+ *
+ *    You should have received a copy of the Server Side Public License
+ *    along with this program. If not, see
+ *    <http://www.mongodb.com/licensing/server-side-public-license>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the Server Side Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/bsonview/ftdc_samples.h"
+
+#include <algorithm>
+#include <dirent.h>
+#include <zlib.h>
+
+#include "mongo/base/data_type_endian.h"
+#include "mongo/base/data_view.h"
+#include "mongo/db/ftdc/constants.h"
+#include "mongo/db/ftdc/util.h"
+#include "mongo/util/errno_util.h"
+#include "mongo/util/scopeguard.h"
+#include "mongo/util/str.h"
+
+namespace mongo {
+
+namespace {
+
+// The same limit as FTDCDecompressor.
+constexpr uint32_t kMaxUncompressedChunkSize = 10000000;
+
+Status corruptChunk(StringData reason) {
+    return {ErrorCodes::InvalidBSON, str::stream() << "Corrupt FTDC metrics chunk: " << reason};
+}
+
+/**
+ * Returns the number of samples in a compressed metrics chunk.
+ *
+ * A chunk is the length of the uncompressed data, then the zlib compressed reference document,
+ * count of metrics, count of samples (not including the reference document), and the deltas.
+ * Only as far as the count of samples is inflated.
+ */
+StatusWith<size_t> countSamples(const char* data, size_t length) {
+    if (length < 4) {
+        return corruptChunk("too short");
+    }
+    const uint32_t uncompressedLength = ConstDataView(data).read<LittleEndian<uint32_t>>();
+    if (uncompressedLength > kMaxUncompressedChunkSize) {
+        return corruptChunk("too long");
+    }
+
+    z_stream stream{};
+    stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data + 4));
+    stream.avail_in = length - 4;
+    if (inflateInit(&stream) != Z_OK) {
+        return corruptChunk("unable to inflate");
+    }
+    ON_BLOCK_EXIT([&] { inflateEnd(&stream); });
+
+    // First just the reference document's length, then up to the count of samples after it.
+    std::vector<char> out(4);
+    size_t produced = 0;
+    bool haveLength = false;
+    while (true) {
+        stream.next_out = reinterpret_cast<Bytef*>(out.data() + produced);
+        stream.avail_out = out.size() - produced;
+        const int ret = inflate(&stream, Z_SYNC_FLUSH);
+        produced = out.size() - stream.avail_out;
+
+        if (produced == out.size()) {
+            if (haveLength) {
+                break;
+            }
+            const int32_t refLength = ConstDataView(out.data()).read<LittleEndian<int32_t>>();
+            if (refLength < BSONObj::kMinBSONLength ||
+                uint64_t(refLength) + 8 > uncompressedLength) {
+                return corruptChunk("invalid reference document");
+            }
+            out.resize(refLength + 8);
+            haveLength = true;
+            continue;
+        }
+        if (ret != Z_OK) {
+            return corruptChunk(stream.msg ? stream.msg : "truncated");
+        }
+    }
+
+    const uint32_t deltaSamples =
+        ConstDataView(out.data() + out.size() - 4).read<LittleEndian<uint32_t>>();
+    return size_t(deltaSamples) + 1;
+}
+
+bool isMetricChunk(const BSONObj& fileDoc) {
+    auto swType = FTDCBSONUtil::getBSONDocumentType(fileDoc);
+    return swType.isOK() && swType.getValue() == FTDCBSONUtil::FTDCType::kMetricChunk;
+}
+
+}  // namespace
+
+Status FTDCSampleIndex::append(const BSONObj& fileDoc) {
+    size_t samples = 1;
+    Status status = Status::OK();
+    if (isMetricChunk(fileDoc)) {
+        BSONElement data = fileDoc[kFTDCDataField];
+        if (data.type() != BinData) {
+            status = corruptChunk("no data");
+        } else {
+            int length;
+            const char* buffer = data.binData(length);
+            auto swSamples = countSamples(buffer, length);
+            if (swSamples.isOK()) {
+                samples = swSamples.getValue();
+            } else {
+                status = swSamples.getStatus();
+            }
+        }
+    }
+
+    // A corrupt chunk still takes its place, as one sample, so that the numbering of the samples
+    // after it doesn't depend on it.
+    _firstSample.push_back(_size);
+    _size += samples;
+    return status;
+}
+
+void FTDCSampleIndex::truncate(size_t numFileDocs) {
+    if (numFileDocs >= _firstSample.size()) {
+        return;
+    }
+    _size = _firstSample[numFileDocs];
+    _firstSample.resize(numFileDocs);
+
+    for (auto it = _lru.begin(); it != _lru.end();) {
+        if (*it >= numFileDocs) {
+            _cachedBytes -= _cache[*it].bytes;
+            _cache.erase(*it);
+            it = _lru.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+size_t FTDCSampleIndex::fileDocFor(size_t i) const {
+    return std::upper_bound(_firstSample.begin(), _firstSample.end(), i) - _firstSample.begin() -
+        1;
+}
+
+StatusWith<BSONObj> FTDCSampleIndex::sample(size_t i, const BSONObj& fileDoc) {
+    if (!isMetricChunk(fileDoc)) {
+        return fileDoc;
+    }
+
+    const size_t fileDocIndex = fileDocFor(i);
+    auto swSamples = _decompress(fileDocIndex, fileDoc);
+    if (!swSamples.isOK()) {
+        return swSamples.getStatus();
+    }
+    const auto& samples = *swSamples.getValue();
+    const size_t n = i - _firstSample[fileDocIndex];
+    if (n >= samples.size()) {
+        return corruptChunk("fewer samples than its header says");
+    }
+    return samples[n];
+}
+
+StatusWith<const std::vector<BSONObj>*> FTDCSampleIndex::_decompress(size_t fileDoc,
+                                                                     const BSONObj& chunk) {
+    auto it = _cache.find(fileDoc);
+    if (it != _cache.end()) {
+        _lru.splice(_lru.begin(), _lru, it->second.lruPos);
+        return &it->second.samples;
+    }
+
+    auto swSamples = FTDCBSONUtil::getMetricsFromMetricDoc(chunk, &_decompressor);
+    if (!swSamples.isOK()) {
+        return swSamples.getStatus();
+    }
+
+    CachedChunk& cached = _cache[fileDoc];
+    cached.samples = std::move(swSamples.getValue());
+    cached.bytes = 0;
+    for (auto&& sample : cached.samples) {
+        cached.bytes += sample.objsize();
+    }
+    _lru.push_front(fileDoc);
+    cached.lruPos = _lru.begin();
+    _cachedBytes += cached.bytes;
+
+    // Always keep the chunk just decompressed, however big.
+    while (_cachedBytes > _cacheBytes && _lru.size() > 1) {
+        auto evicted = _cache.find(_lru.back());
+        _cachedBytes -= evicted->second.bytes;
+        _cache.erase(evicted);
+        _lru.pop_back();
+    }
+
+    return &cached.samples;
+}
+
+StatusWith<std::vector<std::string>> listFTDCFiles(const std::string& dir) {
+    DIR* d = opendir(dir.c_str());
+    if (!d) {
+        auto errorString = errnoWithDescription();
+        return {ErrorCodes::FileNotOpen,
+                str::stream() << "Unable to open directory " << dir << ": " << errorString};
+    }
+    ON_BLOCK_EXIT([&] { closedir(d); });
+
+    // Archive files are named by when they were started, so sort oldest first.  The interim file
+    // holds the newest samples.
+    const std::string prefix = str::stream() << kFTDCArchiveFile << ".";
+    std::vector<std::string> files;
+    bool haveInterim = false;
+    while (dirent* entry = readdir(d)) {
+        const StringData name(entry->d_name);
+        if (name == kFTDCInterimFile) {
+            haveInterim = true;
+        } else if (name.startsWith(prefix)) {
+            files.push_back(name.toString());
+        }
+    }
+    std::sort(files.begin(), files.end());
+    if (haveInterim) {
+        files.push_back(kFTDCInterimFile);
+    }
+    if (files.empty()) {
+        return {ErrorCodes::FileNotOpen, str::stream() << "No FTDC files in " << dir};
+    }
+
+    for (auto&& file : files) {
+        file = dir + "/" + file;
+    }
+    return {std::move(files)};
+}
+
+}  // namespace mongo
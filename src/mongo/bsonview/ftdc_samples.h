@@ -0,0 +1,121 @@
+/**
+ *    Copyright (C) 2019-present MongoDB, Inc.
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the Server Side Public License, version 1,
+ *    as published by MongoDB, Inc.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    Server Side Public License for more details.
+ *
+ *    You should have received a copy of the Server Side Public License
+ *    along with this program. If not, see
+ *    <http://www.mongodb.com/licensing/server-side-public-license>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the Server Side Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "mongo/base/status_with.h"
+#include "mongo/bson/bsonobj.h"
+#include "mongo/db/ftdc/decompressor.h"
+
+namespace mongo {
+
+/**
+ * Presents the samples in an FTDC file (diagnostic.data/metrics.*) as documents.
+ *
+ * An FTDC file is a series of BSON documents, most of which hold a chunk of samples (typically
+ * 300), compressed together.  Chunks are only decompressed when their samples are looked at, and
+ * the most recently used are kept decompressed, up to a budget.  So that the samples can be
+ * numbered without decompressing everything, a chunk's sample count is read from the start of
+ * its compressed data, which only needs the chunk's reference document to be inflated.
+ *
+ * Other documents (metadata) are presented as they are, as one sample each.
+ */
+class FTDCSampleIndex {
+public:
+    static constexpr size_t kDefaultCacheBytes = 64 * 1024 * 1024;
+
+    explicit FTDCSampleIndex(size_t cacheBytes = kDefaultCacheBytes) : _cacheBytes(cacheBytes) {}
+
+    /**
+     * Adds the samples of the next document of the file.  If it's a corrupt chunk, it's counted as
+     * one sample (which sample() fails to return), and the reason is returned.
+     */
+    Status append(const BSONObj& fileDoc);
+
+    /**
+     * Number of samples.
+     */
+    size_t size() const {
+        return _size;
+    }
+
+    size_t numFileDocs() const {
+        return _firstSample.size();
+    }
+
+    /**
+     * Discards all but the samples of the first `numFileDocs` documents of the file.
+     */
+    void truncate(size_t numFileDocs);
+
+    /**
+     * Returns which document of the file sample `i` is in.
+     */
+    size_t fileDocFor(size_t i) const;
+
+    /**
+     * Returns sample `i`, given the document of the file it's in (see fileDocFor()).
+     */
+    StatusWith<BSONObj> sample(size_t i, const BSONObj& fileDoc);
+
+private:
+    struct CachedChunk {
+        std::vector<BSONObj> samples;
+        size_t bytes;
+        std::list<size_t>::iterator lruPos;
+    };
+
+    StatusWith<const std::vector<BSONObj>*> _decompress(size_t fileDoc, const BSONObj& chunk);
+
+    // Index of the first sample of each document of the file.
+    std::vector<uint64_t> _firstSample;
+    uint64_t _size = 0;
+
+    FTDCDecompressor _decompressor;
+
+    // Decompressed chunks, by document of the file, most recently used at the front of _lru.
+    const size_t _cacheBytes;
+    size_t _cachedBytes = 0;
+    std::unordered_map<size_t, CachedChunk> _cache;
+    std::list<size_t> _lru;
+};
+
+/**
+ * Returns the FTDC files in `dir` (eg. a diagnostic.data directory), oldest first.
+ */
+StatusWith<std::vector<std::string>> listFTDCFiles(const std::string& dir);
+
+}  // namespace mongo
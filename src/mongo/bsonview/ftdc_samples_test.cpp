@@ -0,0 +1,200 @@
+/**
+ *    Copyright (C) 2019-present MongoDB, Inc.
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the Server Side Public License, version 1,
+ *    as published by MongoDB, Inc.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    Server Side Public License for more details.
+ *
+ *    You should have received a copy of the Server Side Public License
+ *    along with this program. If not, see
+ *    <http://www.mongodb.com/licensing/server-side-public-license>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the Server Side Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include <fcntl.h>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+#include "mongo/bson/bsonobjbuilder.h"
+#include "mongo/bsonview/ftdc_samples.h"
+#include "mongo/db/ftdc/compressor.h"
+#include "mongo/db/ftdc/config.h"
+#include "mongo/db/ftdc/constants.h"
+#include "mongo/db/ftdc/util.h"
+#include "mongo/unittest/temp_dir.h"
+#include "mongo/unittest/unittest.h"
+
+namespace mongo {
+namespace {
+
+BSONObj makeSample(int i) {
+    return BSON("start" << Date_t::fromMillisSinceEpoch(i * 1000) << "serverStatus"
+                        << BSON("connections" << BSON("current" << i % 7 << "total" << i)));
+}
+
+/**
+ * Returns a metrics chunk document of samples [first, first + count).
+ */
+BSONObj makeChunk(int first, int count) {
+    FTDCConfig config;
+    config.maxSamplesPerArchiveMetricChunk = count + 1;
+    FTDCCompressor compressor(&config);
+    for (int i = first; i < first + count; i++) {
+        auto swFull = compressor.addSample(makeSample(i), Date_t::fromMillisSinceEpoch(i * 1000));
+        ASSERT_OK(swFull.getStatus());
+        ASSERT_FALSE(swFull.getValue());
+    }
+    auto swCompressed = compressor.getCompressedSamples();
+    ASSERT_OK(swCompressed.getStatus());
+    return FTDCBSONUtil::createBSONMetricChunkDocument(std::get<0>(swCompressed.getValue()),
+                                                       Date_t::fromMillisSinceEpoch(first * 1000))
+        .getOwned();
+}
+
+BSONObj makeMetadata() {
+    return FTDCBSONUtil::createBSONMetadataDocument(BSON("hostInfo" << BSON("os"
+                                                                            << "linux")),
+                                                    Date_t::now());
+}
+
+TEST(FTDCSampleIndexTest, CountsSamplesWithoutDecompressing) {
+    FTDCSampleIndex index;
+    ASSERT_OK(index.append(makeMetadata()));
+    ASSERT_OK(index.append(makeChunk(0, 300)));
+    ASSERT_OK(index.append(makeChunk(300, 1)));
+    ASSERT_OK(index.append(makeChunk(301, 50)));
+
+    ASSERT_EQ(index.numFileDocs(), 4U);
+    ASSERT_EQ(index.size(), 1U + 300 + 1 + 50);
+    ASSERT_EQ(index.fileDocFor(0), 0U);
+    ASSERT_EQ(index.fileDocFor(1), 1U);
+    ASSERT_EQ(index.fileDocFor(300), 1U);
+    ASSERT_EQ(index.fileDocFor(301), 2U);
+    ASSERT_EQ(index.fileDocFor(302), 3U);
+    ASSERT_EQ(index.fileDocFor(351), 3U);
+}
+
+TEST(FTDCSampleIndexTest, DecompressesSamples) {
+    const std::vector<BSONObj> fileDocs{makeMetadata(), makeChunk(0, 300), makeChunk(300, 50)};
+    FTDCSampleIndex index(1);  // Only keep one chunk decompressed at a time.
+    for (auto&& doc : fileDocs) {
+        ASSERT_OK(index.append(doc));
+    }
+
+    auto swSample = index.sample(0, fileDocs[0]);
+    ASSERT_OK(swSample.getStatus());
+    ASSERT_BSONOBJ_EQ(swSample.getValue(), fileDocs[0]);
+
+    // Back and forth between chunks.
+    for (int i : {0, 299, 300, 349, 5, 320}) {
+        const size_t sample = i + 1;
+        auto swSample = index.sample(sample, fileDocs[index.fileDocFor(sample)]);
+        ASSERT_OK(swSample.getStatus());
+        ASSERT_BSONOBJ_EQ(swSample.getValue(), makeSample(i));
+    }
+}
+
+TEST(FTDCSampleIndexTest, Truncate) {
+    FTDCSampleIndex index;
+    ASSERT_OK(index.append(makeChunk(0, 10)));
+    const BSONObj second = makeChunk(10, 10);
+    ASSERT_OK(index.append(second));
+    ASSERT_OK(index.sample(15, second).getStatus());
+
+    index.truncate(1);
+    ASSERT_EQ(index.size(), 10U);
+    ASSERT_EQ(index.numFileDocs(), 1U);
+
+    ASSERT_OK(index.append(makeChunk(10, 5)));
+    ASSERT_EQ(index.size(), 15U);
+}
+
+/**
+ * Returns `chunk` with its compressed data cut short at `length` bytes.
+ */
+BSONObj truncateChunk(const BSONObj& chunk, int length) {
+    int dataLength;
+    const char* data = chunk[kFTDCDataField].binData(dataLength);
+    ASSERT_LT(length, dataLength);
+
+    BSONObjBuilder corrupt;
+    corrupt.appendElements(chunk.removeField(kFTDCDataField));
+    corrupt.appendBinData(kFTDCDataField, length, BinDataGeneral, data);
+    return corrupt.obj();
+}
+
+TEST(FTDCSampleIndexTest, CountsUnreadableChunkAsOneSample) {
+    const BSONObj corrupt = truncateChunk(makeChunk(0, 10), 8);
+    const BSONObj next = makeChunk(10, 10);
+
+    FTDCSampleIndex index;
+    ASSERT_NOT_OK(index.append(corrupt));
+    ASSERT_OK(index.append(next));
+    ASSERT_EQ(index.size(), 11U);
+    ASSERT_EQ(index.fileDocFor(0), 0U);
+    ASSERT_EQ(index.fileDocFor(1), 1U);
+
+    ASSERT_NOT_OK(index.sample(0, corrupt).getStatus());
+    auto swSample = index.sample(1, next);
+    ASSERT_OK(swSample.getStatus());
+    ASSERT_BSONOBJ_EQ(swSample.getValue(), makeSample(10));
+}
+
+TEST(FTDCSampleIndexTest, FailsToDecompressCorruptChunk) {
+    // Without its checksum, the sample count can still be read, but the chunk can't be inflated.
+    const BSONObj chunk = makeChunk(0, 10);
+    int length;
+    chunk[kFTDCDataField].binData(length);
+    const BSONObj corrupt = truncateChunk(chunk, length - 4);
+
+    FTDCSampleIndex index;
+    ASSERT_OK(index.append(corrupt));
+    ASSERT_EQ(index.size(), 10U);
+    ASSERT_NOT_OK(index.sample(5, corrupt).getStatus());
+}
+
+TEST(FTDCSampleIndexTest, ListsFiles) {
+    unittest::TempDir dir("ftdc_samples_test");
+    for (auto&& name : {"metrics.interim",
+                        "metrics.2020-01-02T00-00-00Z-00000",
+                        "metrics.2020-01-01T00-00-00Z-00000",
+                        "other"}) {
+        int fd = ::open((dir.path() + "/" + name).c_str(), O_WRONLY | O_CREAT, 0644);
+        ASSERT_GTE(fd, 0);
+        ::close(fd);
+    }
+
+    auto swFiles = listFTDCFiles(dir.path());
+    ASSERT_OK(swFiles.getStatus());
+    const std::vector<std::string> expected{
+        dir.path() + "/metrics.2020-01-01T00-00-00Z-00000",
+        dir.path() + "/metrics.2020-01-02T00-00-00Z-00000",
+        dir.path() + "/metrics.interim",
+    };
+    ASSERT(swFiles.getValue() == expected);
+
+    unittest::TempDir empty("ftdc_samples_test");
+    ASSERT_NOT_OK(listFTDCFiles(empty.path()).getStatus());
+}
+
+}  // namespace
+}  // namespace mongo
@@ -0,0 +1,74 @@
+/**
+ *    Copyright (C) 2019-present MongoDB, Inc.
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the Server Side Public License, version 1,
+ *    as published by MongoDB, Inc.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    Server Side Public License for more details.
+ *
+ *    You should have received a copy of the Server Side Public License
+ *    along with this program. If not, see
+ *    <http://www.mongodb.com/licensing/server-side-public-license>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the Server Side Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/bsonview/layout_cache.h"
+
+namespace mongo {
+
+DocumentLayout::DocumentLayout(std::string text) : _text(std::move(text)) {
+    _lineStarts.push_back(0);
+    for (size_t pos = _text.find('\n'); pos != std::string::npos;
+         pos = _text.find('\n', pos + 1)) {
+        _lineStarts.push_back(pos + 1);
+    }
+    _lineStarts.shrink_to_fit();
+}
+
+std::shared_ptr<const DocumentLayout> LayoutCache::get(
+    const Key& key, const std::function<std::string()>& render) {
+    auto it = _entries.find(key);
+    if (it != _entries.end()) {
+        _lru.splice(_lru.begin(), _lru, it->second.lruPos);
+        return it->second.layout;
+    }
+
+    auto layout = std::make_shared<const DocumentLayout>(render());
+    _lru.push_front(key);
+    _entries[key] = {layout, _lru.begin()};
+    _bytesUsed += layout->bytesUsed();
+
+    while (_bytesUsed > _budget && _lru.size() > 1) {
+        auto evicted = _entries.find(_lru.back());
+        _bytesUsed -= evicted->second.layout->bytesUsed();
+        _entries.erase(evicted);
+        _lru.pop_back();
+    }
+
+    return layout;
+}
+
+void LayoutCache::clear() {
+    _entries.clear();
+    _lru.clear();
+    _bytesUsed = 0;
+}
+
+}  // namespace mongo
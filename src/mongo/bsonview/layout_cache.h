@@ -0,0 +1,141 @@
+/**
+ *    Copyright (C) 2019-present MongoDB, Inc.
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the Server Side Public License, version 1,
+ *    as published by MongoDB, Inc.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    Server Side Public License for more details.
+ *
+ *    You should have received a copy of the Server Side Public License
+ *    along with this program. If not, see
+ *    <http://www.mongodb.com/licensing/server-side-public-license>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the Server Side Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "mongo/base/string_data.h"
+
+namespace mongo {
+
+/**
+ * A document rendered as text, split into lines.
+ */
+class DocumentLayout {
+public:
+    explicit DocumentLayout(std::string text);
+
+    size_t numLines() const {
+        return _lineStarts.size();
+    }
+
+    /**
+     * Line `i`, without its newline.
+     */
+    StringData line(size_t i) const {
+        const size_t end = i + 1 < _lineStarts.size() ? _lineStarts[i + 1] - 1 : _text.size();
+        return StringData(_text.data() + _lineStarts[i], end - _lineStarts[i]);
+    }
+
+    const std::string& text() const {
+        return _text;
+    }
+
+    size_t bytesUsed() const {
+        return sizeof(*this) + _text.capacity() + _lineStarts.capacity() * sizeof(uint32_t);
+    }
+
+private:
+    const std::string _text;
+    std::vector<uint32_t> _lineStarts;
+};
+
+/**
+ * Layouts of recently displayed documents, so that moving around the screen doesn't render them
+ * all again.  A layout depends on how the document is rendered as well as which document it is,
+ * so the key includes the render mode and JSON format (as opaque ints).  Lines aren't wrapped, so
+ * the width of the screen doesn't matter.
+ *
+ * The least recently used layouts are dropped once they come to more than the budget, except
+ * that the most recent is always kept, however big.
+ */
+class LayoutCache {
+public:
+    static constexpr size_t kDefaultBudget = 128 * 1024 * 1024;
+
+    struct Key {
+        uint64_t doc;
+        int mode;
+        int format;
+
+        bool operator==(const Key& other) const {
+            return doc == other.doc && mode == other.mode && format == other.format;
+        }
+    };
+
+    explicit LayoutCache(size_t budget = kDefaultBudget) : _budget(budget) {}
+
+    /**
+     * Returns the layout for `key`, calling `render` to make it if it isn't cached.
+     */
+    std::shared_ptr<const DocumentLayout> get(const Key& key,
+                                              const std::function<std::string()>& render);
+
+    /**
+     * Forgets every layout, eg. because the documents have been renumbered.
+     */
+    void clear();
+
+    size_t size() const {
+        return _entries.size();
+    }
+
+    size_t bytesUsed() const {
+        return _bytesUsed;
+    }
+
+private:
+    struct KeyHash {
+        size_t operator()(const Key& key) const {
+            return std::hash<uint64_t>()(key.doc) ^ (size_t(key.mode) << 56) ^
+                (size_t(key.format) << 48);
+        }
+    };
+
+    struct Entry {
+        std::shared_ptr<const DocumentLayout> layout;
+        std::list<Key>::iterator lruPos;
+    };
+
+    const size_t _budget;
+    size_t _bytesUsed = 0;
+    std::unordered_map<Key, Entry, KeyHash> _entries;
+
+    // Most recently used at the front.
+    std::list<Key> _lru;
+};
+
+}  // namespace mongo
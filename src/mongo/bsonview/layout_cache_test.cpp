@@ -0,0 +1,121 @@
+/**
+ *    Copyright (C) 2019-present MongoDB, Inc.
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the Server Side Public License, version 1,
+ *    as published by MongoDB, Inc.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    Server Side Public License for more details.
+ *
+ *    You should have received a copy of the Server Side Public License
+ *    along with this program. If not, see
+ *    <http://www.mongodb.com/licensing/server-side-public-license>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the Server Side Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/bsonview/layout_cache.h"
+#include "mongo/unittest/unittest.h"
+
+namespace mongo {
+namespace {
+
+TEST(DocumentLayoutTest, SplitsLines) {
+    DocumentLayout layout("{\n  \"a\": 1\n}");
+    ASSERT_EQ(layout.numLines(), 3U);
+    ASSERT_EQ(layout.line(0), "{");
+    ASSERT_EQ(layout.line(1), "  \"a\": 1");
+    ASSERT_EQ(layout.line(2), "}");
+}
+
+TEST(DocumentLayoutTest, EmptyAndTrailingLines) {
+    DocumentLayout empty("");
+    ASSERT_EQ(empty.numLines(), 1U);
+    ASSERT_EQ(empty.line(0), "");
+
+    DocumentLayout trailing("a\n");
+    ASSERT_EQ(trailing.numLines(), 2U);
+    ASSERT_EQ(trailing.line(0), "a");
+    ASSERT_EQ(trailing.line(1), "");
+}
+
+TEST(LayoutCacheTest, RendersOnlyOnMiss) {
+    LayoutCache cache;
+    int renders = 0;
+    auto render = [&] {
+        renders++;
+        return std::string("doc");
+    };
+
+    auto first = cache.get({1, 0, 0}, render);
+    auto again = cache.get({1, 0, 0}, render);
+    ASSERT_EQ(renders, 1);
+    ASSERT_EQ(first.get(), again.get());
+
+    // A different mode or format is a different layout.
+    cache.get({1, 1, 0}, render);
+    cache.get({1, 0, 1}, render);
+    ASSERT_EQ(renders, 3);
+    ASSERT_EQ(cache.size(), 3U);
+
+    cache.clear();
+    ASSERT_EQ(cache.size(), 0U);
+    ASSERT_EQ(cache.bytesUsed(), 0U);
+    cache.get({1, 0, 0}, render);
+    ASSERT_EQ(renders, 4);
+}
+
+TEST(LayoutCacheTest, EvictsLeastRecentlyUsed) {
+    const std::string text(1000, 'x');
+    const size_t each = DocumentLayout(text).bytesUsed();
+    LayoutCache cache(each * 3);
+    int renders = 0;
+    auto render = [&] {
+        renders++;
+        return text;
+    };
+
+    cache.get({1, 0, 0}, render);
+    cache.get({2, 0, 0}, render);
+    cache.get({3, 0, 0}, render);
+    cache.get({1, 0, 0}, render);  // Now 2 is the least recently used.
+    cache.get({4, 0, 0}, render);
+    ASSERT_EQ(renders, 4);
+    ASSERT_EQ(cache.size(), 3U);
+    ASSERT_LTE(cache.bytesUsed(), each * 3);
+
+    cache.get({1, 0, 0}, render);
+    cache.get({3, 0, 0}, render);
+    ASSERT_EQ(renders, 4);
+    cache.get({2, 0, 0}, render);
+    ASSERT_EQ(renders, 5);
+}
+
+TEST(LayoutCacheTest, KeepsMostRecentEvenIfOverBudget) {
+    LayoutCache cache(10);
+    auto layout = cache.get({1, 0, 0}, [] { return std::string(1000, 'x'); });
+    ASSERT_EQ(cache.size(), 1U);
+    cache.get({2, 0, 0}, [] { return std::string(1000, 'y'); });
+    ASSERT_EQ(cache.size(), 1U);
+
+    // Still usable after being evicted.
+    ASSERT_EQ(layout->line(0).size(), 1000U);
+}
+
+}  // namespace
+}  // namespace mongo
@@ -37,6 +37,7 @@
 #include <sys/stat.h>
 #include <fcntl.h>
 #include <iostream>
+#include <sstream>
 //#include <pcrecpp.h>
 //#include <signal.h>
 //#include <stdio.h>
@@ -44,12 +45,37 @@
 #include <unistd.h>
 #include <sys/mman.h>
 
+#include "mongo/base/data_type_endian.h"
+#include "mongo/base/data_view.h"
 #include "mongo/bson/bsonobj.h"
+#include "mongo/base/initializer.h"
+#include "mongo/base/parse_number.h"
 #include "mongo/bson/json.h"
+#include "mongo/bsonview/aggregation_stream.h"
+#include "mongo/bsonview/archive_index.h"
+#include "mongo/bsonview/background_search.h"
+#include "mongo/bsonview/byte_search.h"
+#include "mongo/bsonview/decompressor.h"
+#include "mongo/bsonview/doc_bitmap.h"
+#include "mongo/bsonview/document_boundary.h"
+#include "mongo/bsonview/field_projection.h"
+#include "mongo/bsonview/field_stats.h"
+#include "mongo/bsonview/ftdc_samples.h"
+#include "mongo/bsonview/layout_cache.h"
+#include "mongo/bsonview/mapped_file.h"
+#include "mongo/bsonview/offset_index.h"
+#include "mongo/bsonview/parallel_indexer.h"
+#include "mongo/bsonview/regex_search.h"
+#include "mongo/bsonview/sidecar_index.h"
+#include "mongo/bsonview/sorted_order.h"
+#include "mongo/bsonview/stream_storage.h"
+#include "mongo/bsonview/time_index.h"
 #include "mongo/db/matcher/matcher.h"
 #include "mongo/db/operation_context_noop.h"
+#include "mongo/db/service_context.h"
 #include "mongo/util/assert_util.h"
 #include "mongo/util/errno_util.h"
+#include "mongo/util/hex.h"
 #include "mongo/util/quick_exit.h"
 
 #include <tickit.h>
@@ -73,6 +99,9 @@ void noop() {}
 class BSONCache {
 
 public:
+    // How much of a damaged stretch of the file is looked through at a time, for the next doc.
+    static constexpr uint64_t kResyncStepBytes = 1024 * 1024;
+
     BSONCache()
     : _base(nullptr), _end(nullptr), _complete(false)
     {
@@ -81,33 +110,286 @@ public:
     BSONCache(const char* base, const char* end)
     : _base(base), _end(end), _complete(false)
     {
-        _docs.push_back(BSONObj(base));
+        _checkComplete();
+        _loadNext();
     }
 
-    void init(const char* base, const char* end) {
-        _base = base;
-        _end = end;
+    void init(BSONStorage* storage) {
+        _storage = storage;
+        _base = storage->base();
+        _end = storage->end();
+        _complete = false;
+        _docs.clear();
+        _nextOffset = 0;
+        _scannedOffset = 0;
+        _checkComplete();
+        // (if the file starts with something that isn't a doc, however long, the first doc after it)
+        while (_docs.empty() && ! isComplete()) {
+            _loadNext();
+        }
+    }
+
+    // Start from an index saved by a previous run, which covers (at least) the first doc.
+    void init(BSONStorage* storage, std::unique_ptr<SidecarIndex> sidecar) {
+        _storage = storage;
+        _base = storage->base();
+        _end = storage->end();
+        _complete = false;
+        _docs = std::move(sidecar->index());
+        _nextOffset = sidecar->indexedEnd();
+        _savedOffset = _nextOffset;
+        _scannedOffset = _nextOffset;
+        _sidecarDocs = _docs.size();
+        _sidecarEnd = _nextOffset;
+        _sidecar = std::move(sidecar);
+        _checkComplete();
+    }
+
+    // A mongodump archive.  Each namespace in it has its own docs, and only one namespace is
+    // shown at a time, starting with whichever the first doc is in.
+    void initArchive(BSONStorage* storage) {
+        _storage = storage;
+        _base = storage->base();
+        _end = storage->end();
         _complete = false;
-        _docs.empty();
-        _docs.push_back(BSONObj(base));
+        _docs.clear();
+        _nextOffset = 0;
+        _scannedOffset = 0;
+        _archive = std::make_unique<ArchiveIndex>(_base);
+        _namespace = 0;
+        _namespaceChosen = false;
+        _checkComplete();
+        while ( ! isComplete() && ! _namespaceChosen) {
+            _loadNext();
+        }
+    }
+
+    // Show the samples in an FTDC file, rather than its docs (which are mostly compressed chunks
+    // of samples).
+    void showFTDCSamples() {
+        _ftdc = std::make_unique<FTDCSampleIndex>();
+        _indexSamples();
+    }
+
+    ~BSONCache() {
+        _stopIndexer();
+    }
+
+    // Show the results of an aggregation over the docs, rather than the docs themselves.  (It is
+    // fed the docs by aggregate_step().)
+    void aggregate(std::unique_ptr<AggregationStream> aggregation) {
+        _aggregation = std::move(aggregation);
+    }
+
+    // Show the docs again.
+    void stopAggregating() {
+        _aggregation.reset();
+    }
+
+    AggregationStream* aggregation() const {
+        return _aggregation.get();
+    }
+
+    BSONObj operator[](unsigned long index) {
+        if (_aggregation) {
+            return _aggregation->result(index);
+        }
+        return sourceDoc(index);
+    }
+
+    // Whether there is a doc at index, loading up to it if need be.
+    bool hasDoc(unsigned long index) {
+        if (_aggregation) {
+            // (the results are still coming, there's nothing to load)
+            return index < _aggregation->numResults();
+        }
+        return hasSourceDoc(index);
+    }
+
+    // The docs of the file (or namespace, or FTDC samples) themselves, even while aggregating.
+    // Docs are only materialised on demand, _docs just has their offsets.
+    BSONObj sourceDoc(unsigned long index) {
+        _loadTo(index);
+        if (_ftdc) {
+            const uint64_t offset = _docs[_ftdc->fileDocFor(index)];
+            const BSONObj chunk(_getBase() + offset);
+            auto swSample = _ftdc->sample(index, chunk);
+            if ( ! swSample.isOK()) {
+                // Better to show the chunk as it is than nothing.
+                _ftdcProblem = swSample.getStatus().reason();
+                return chunk;
+            }
+            return swSample.getValue();
+        }
+        if ( ! _checkSidecarDoc(index) && ! hasSourceDoc(index)) {
+            // (the docs from there on are being found again, and that one is no longer there)
+            return BSONObj();
+        }
+        return BSONObj(_getBase() + _currentDocs()[index]);
     }
 
-    const BSONObj& operator[](unsigned long index) {
+    bool hasSourceDoc(unsigned long index) {
         _loadTo(index);
-        return _docs[index];
+        return index < numSourceDocs();
+    }
+
+    // Scan the rest of the file on all cores, if it's big enough to be worth it.
+    void startBackgroundIndexing() {
+        // (Archives interleave namespace headers with the docs, so have to be read in order.)
+        if (isComplete() || _indexer || _archive || sizeOfFile() - _nextOffset < ParallelDocumentIndexer::kMinimumFileSize) {
+            return;
+        }
+        _indexer = std::make_unique<ParallelDocumentIndexer>(_getBase(), _getEnd(), 0, ParallelDocumentIndexer::kDefaultChunkSize, _nextOffset);
+        if (_storage && ! _storage->fitsBudget()) {
+            BSONStorage* storage = _storage;
+            _indexer->setScannedCallback([storage](uint64_t begin, uint64_t end) { storage->scanned(begin, end); });
+        }
+        _indexer->start();
+    }
+
+    bool isIndexingInBackground() const {
+        return !!_indexer;
+    }
+
+    // The file has grown (because we're following it).
+    void extend(const char* end) {
+        _end = end;
+        if (_complete) {
+            _complete = false;
+            _checkComplete();
+        }
+    }
+
+    // The file has been truncated, so forget the docs that are no longer wholly in it.  (If it
+    // was rewritten rather than just cut short, the remaining docs may be wrong, but there's no
+    // cheap way to tell.)
+    void truncate(const char* end) {
+        _stopIndexer();
+        _end = end;
+
+        if (_archive) {
+            // Rather than pick apart the namespaces, index the archive again.
+            const std::string ns = currentNamespace();
+            _archive = std::make_unique<ArchiveIndex>(_getBase());
+            _nextOffset = 0;
+            _scannedOffset = 0;
+            _damaged.clear();
+            _complete = false;
+            _checkComplete();
+            loadAll();
+            if ( ! selectNamespace(ns)) {
+                _namespace = 0;
+            }
+            return;
+        }
+
+        size_t keep = 0;
+        if (sizeOfFile() > 0) {
+            if (auto last = _docs.findAtOrBefore(sizeOfFile() - 1)) {
+                keep = *last + 1;
+                if ( ! _isWholeDocAt(_docs[*last])) {
+                    keep--;
+                }
+            }
+        }
+        _docs.truncate(keep);
+        if (_ftdc) {
+            _ftdc->truncate(keep);
+        }
+        _sidecarDocs = std::min(_sidecarDocs, keep);
+        _nextOffset = keep ? _docs.back() + BSONObj(_getBase() + _docs.back()).objsize() : 0;
+        while ( ! _damaged.empty() && _damaged.back().begin >= _nextOffset) {
+            _damaged.pop_back();
+        }
+        _resyncing = false;
+        _savedOffset = std::min(_savedOffset, _nextOffset);
+        _scannedOffset = std::min(_scannedOffset, _nextOffset);
+
+        _complete = false;
+        _checkComplete();
     }
 
     bool isComplete() const {
         return _complete;
     }
 
+    // A stretch of the file that isn't docs (eg. a bad length, or a doc that's been overwritten),
+    // which was skipped, up to where the docs seem to start again.
+    struct DamagedRange {
+        uint64_t begin;
+        uint64_t end;
+    };
+
+    // Where the file has been found to be damaged so far, in file order, including a doc cut short
+    // at the end of the file (which may just be one still being written, if it's growing).
+    std::vector<DamagedRange> damaged() const {
+        std::vector<DamagedRange> damaged = _damaged;
+        if (isComplete() && ! _archive && _nextOffset < sizeOfFile()) {
+            damaged.push_back({_nextOffset, sizeOfFile()});
+        }
+        return damaged;
+    }
+
+    // Why the last corrupt FTDC chunk found couldn't be read, if there is one.
+    const std::string& ftdcProblem() const {
+        return _ftdcProblem;
+    }
+
     unsigned long numDocs() const {
-        return _docs.size();
+        return _aggregation ? _aggregation->numResults() : numSourceDocs();
+    }
+
+    unsigned long numSourceDocs() const {
+        return _ftdc ? _ftdc->size() : _currentDocs().size();
+    }
+
+    bool hasAllDocs() const {
+        return _aggregation ? _aggregation->isDone() : hasAllSourceDocs();
+    }
+
+    // Whether no more docs will be found, either because the whole file has been read, or (for
+    // an archive) because the end of the namespace has been.
+    bool hasAllSourceDocs() const {
+        return isComplete() || (_archive && _namespace < _archive->numNamespaces() && _archive->getNamespace(_namespace).complete);
+    }
+
+    bool isArchive() const {
+        return !!_archive;
+    }
+
+    const ArchiveIndex* archive() const {
+        return _archive.get();
+    }
+
+    std::string currentNamespace() const {
+        if ( ! _archive || _namespace >= _archive->numNamespaces()) {
+            return "";
+        }
+        return _archive->getNamespace(_namespace).ns();
+    }
+
+    bool selectNamespace(StringData ns) {
+        if ( ! _archive) {
+            return false;
+        }
+        auto found = _archive->findNamespace(ns);
+        if ( ! found) {
+            return false;
+        }
+        _namespace = *found;
+        _namespaceChosen = true;
+        return true;
     }
 
     void loadAll(std::function<void(void)> cb = noop) {
         unsigned long i = 0;
         while ( ! isComplete()) {
+            if (_indexer) {
+                _mergeChunk(_indexer->takeNext());
+                _checkIndexerDone();
+                cb();
+                continue;
+            }
             _loadNext();
             if (i % 1000 == 0) {
                 cb();
@@ -118,6 +400,12 @@ public:
 
     // TODO: convert the limit to be a Duration
     void loadSome(unsigned long maxDocs = 100) {
+        if (_indexer) {
+            // the indexer threads do the scanning, just pick up whatever they've finished.
+            while (_mergeReadyChunk()) {
+            }
+            return;
+        }
         unsigned long i = 0;
         while ( ! isComplete() && i < maxDocs) {
             _loadNext();
@@ -134,23 +422,93 @@ public:
     }
 
     double percOfFileSeen() const {
+        if (sizeOfFile() == 0) {
+            return 100.0;
+        }
         return ((double)sizeOfFileSeen()) / ((double)sizeOfFile()) * 100.0;
     }
 
-private:
+    // A search is about to read the docs before doc, backwards.
+    void readingBackwards(unsigned long doc) {
+        // (FTDC samples have already been decompressed, and aggregation results are in memory)
+        if ( ! _storage || _ftdc || _aggregation || doc >= numDocs()) {
+            return;
+        }
+        _storage->readingBackwards(_currentDocs()[doc]);
+    }
 
-    void _loadTo(unsigned long index) {
-        while (index >= _docs.size()) {
-            _loadNext();
+    // Docs [first, last] are on screen.
+    void viewing(unsigned long first, unsigned long last) {
+        if ( ! _storage || _aggregation || last >= numDocs() || first > last) {
+            return;
+        }
+        if (_ftdc) {
+            first = _ftdc->fileDocFor(first);
+            last = _ftdc->fileDocFor(last);
+        }
+        const uint64_t lastOffset = _currentDocs()[last];
+        _storage->viewing(_currentDocs()[first], lastOffset + BSONObj(_getBase() + lastOffset).objsize());
+    }
+
+    // The doc that the byte at offset is in (or the last doc before it), once the file has been
+    // indexed that far.  For FTDC, the first sample of that doc.  (Aggregation results aren't in
+    // the file.)
+    boost::optional<unsigned long> docAtOffset(uint64_t offset) const {
+        if (_aggregation || numSourceDocs() == 0 || (offset >= sizeOfFileSeen() && ! hasAllSourceDocs())) {
+            return boost::none;
+        }
+        // (before the first doc, eg. in an archive's header, is as good as at it)
+        const unsigned long doc = _currentDocs().findAtOrBefore(offset).value_or(0);
+        if (_ftdc) {
+            unsigned long first = 0;
+            unsigned long count = _ftdc->size();
+            while (count > 0) {
+                const unsigned long half = count / 2;
+                if (_ftdc->fileDocFor(first + half) < doc) {
+                    first += half + 1;
+                    count -= half + 1;
+                } else {
+                    count = half;
+                }
+            }
+            return std::min(first, numSourceDocs() - 1);
+        }
+        return doc;
+    }
+
+    // Where in the file a doc (or FTDC sample's doc) starts.
+    boost::optional<uint64_t> offsetOfDoc(unsigned long doc) const {
+        if (_aggregation || doc >= numSourceDocs()) {
+            return boost::none;
         }
+        return _ftdc ? _docs[_ftdc->fileDocFor(doc)] : _currentDocs()[doc];
+    }
+
+    // (a sidecar doesn't record damage, so a damaged file would look clean when reopened with one)
+    bool hasUnsavedIndex() const {
+        return ! _archive && _damaged.empty() && _nextOffset > _savedOffset;
+    }
+
+    Status saveIndex(const std::string& dataFile, const SidecarFileIdentity& identity) {
+        _savedOffset = _nextOffset;
+        return SidecarIndex::write(dataFile, identity, _getBase(), _docs, _nextOffset);
     }
 
-    const BSONObj& _getLast() const {
-        return _docs.back();
+private:
+
+    void _loadTo(unsigned long index) {
+        while (index >= numSourceDocs() && ! hasAllSourceDocs()) {
+            if ( ! _mergeReadyChunk()) {
+                _loadNext();
+            }
+        }
     }
 
-    const BSONObj& _getFirst() const {
-        return _docs.front();
+    const DocumentOffsetIndex& _currentDocs() const {
+        if (_archive && _namespace < _archive->numNamespaces()) {
+            return _archive->getNamespace(_namespace).docs;
+        }
+        return _docs;
     }
 
     const char* _getBase() const {
@@ -162,37 +520,253 @@ private:
     }
 
     const char* _getNextBase() const {
-        auto last = _getLast();
-        return last.objdata() + last.objsize();
+        return _getBase() + _nextOffset;
     }
 
-    void _loadNext() {
-        if ( ! isComplete()) {
-            auto nextBase = _getNextBase();
-            // TODO: catch bson exceptions and don't abort the whole program on them
-            _docs.push_back(BSONObj(nextBase));
+    void _appendDoc(uint64_t offset, size_t length) {
+        _docs.append(offset);
+        _nextOffset = offset + length;
+        _indexSamples();
+    }
+
+    // Count the samples in any new docs of an FTDC file.
+    void _indexSamples() {
+        if (_ftdc) {
+            for (size_t i = _ftdc->numFileDocs(); i < _docs.size(); i++) {
+                if ( ! _checkSidecarDoc(i)) {
+                    // (the rest are found again, and counted as they are)
+                    break;
+                }
+                // (a corrupt chunk is still counted, as one sample)
+                Status s = _ftdc->append(BSONObj(_getBase() + _docs[i]));
+                if ( ! s.isOK()) {
+                    _ftdcProblem = s.reason();
+                }
+            }
+        }
+    }
 
-            nextBase = _getNextBase();
-            if (nextBase >= _getEnd()) {
+    void _loadNext() {
+        if ( ! isComplete() && _archive) {
+            auto swNamespace = _archive->next();
+            if ( ! swNamespace.isOK()) {
+                // There's no telling where the next item starts after a damaged one (unlike docs,
+                // headers and terminators can't be resynchronised to), so the archive ends here.
+                _markDamaged(_archive->offset(), sizeOfFile());
                 _complete = true;
+                return;
+            }
+            if (swNamespace.getValue() && ! _namespaceChosen) {
+                _namespace = *swNamespace.getValue();
+                _namespaceChosen = true;
+            }
+            _nextOffset = _archive->offset();
+            _checkComplete();
+            _checkScanned();
+        } else if ( ! isComplete()) {
+            // (every doc is validated before it's indexed, so it's safe to show, search, etc.)
+            const size_t length = _resyncing ? 0 : validDocumentLength(_getNextBase(), _getEnd());
+            if (length) {
+                _appendDoc(_nextOffset, length);
+            } else {
+                _resync();
+            }
+            _checkComplete();
+            _checkScanned();
+        }
+    }
+
+    // Skip what isn't a doc at _nextOffset, up to where the docs seem to start again, remembering
+    // where that was.  This looks a step at a time, so that a long stretch of garbage doesn't hold
+    // everything else up.
+    void _resync() {
+        const char* from = _getNextBase() + (_resyncing ? 0 : 1);
+        const char* limit = from + std::min<uint64_t>(kResyncStepBytes, _getEnd() - from);
+        const char* found = findNextDocumentStart(from, limit, _getEnd());
+        const uint64_t next = (found ? found : limit) - _getBase();
+        _markDamaged(_nextOffset, next);
+        _nextOffset = next;
+        _resyncing = ! found;
+    }
+
+    // (continuing the last damaged range, if it ends at begin)
+    void _markDamaged(uint64_t begin, uint64_t end) {
+        if ( ! _damaged.empty() && _damaged.back().end >= begin) {
+            _damaged.back().end = std::max(_damaged.back().end, end);
+        } else {
+            _damaged.push_back({begin, end});
+        }
+    }
+
+    // The docs from a sidecar are only checked when they're first used, since checking them all
+    // up front would read the whole file.  If one isn't a doc that ends before the next, the
+    // sidecar is wrong from there on (eg. the file was rewritten in place), so the docs from there
+    // are found again by scanning, and whatever isn't a doc is skipped as damage.
+    bool _checkSidecarDoc(size_t index) {
+        if (_archive || index >= _sidecarDocs || _sidecarChecked.contains(index)) {
+            return true;
+        }
+        const uint64_t offset = _docs[index];
+        const uint64_t limit = index + 1 < _sidecarDocs ? _docs[index + 1] : _sidecarEnd;
+        if (validDocumentLength(_getBase() + offset, _getBase() + limit)) {
+            _sidecarChecked.add(index);
+            return true;
+        }
+
+        _docs.truncate(index);
+        if (_ftdc) {
+            _ftdc->truncate(index);
+        }
+        _sidecarDocs = index;
+        _nextOffset = offset;
+        while ( ! _damaged.empty() && _damaged.back().begin >= _nextOffset) {
+            _damaged.pop_back();
+        }
+        _resyncing = false;
+        _savedOffset = std::min(_savedOffset, _nextOffset);
+        _scannedOffset = std::min(_scannedOffset, _nextOffset);
+        _complete = false;
+        _checkComplete();
+        return false;
+    }
+
+    // Let the storage drop what the sequential scan has passed (the indexer threads do this
+    // themselves).
+    void _checkScanned() {
+        if (_storage && ! _indexer && _nextOffset - _scannedOffset >= BSONStorage::kSegmentSize && ! _storage->fitsBudget()) {
+            _storage->scanned(_scannedOffset, _nextOffset);
+            _scannedOffset = _nextOffset;
+        }
+    }
+
+    bool _isWholeDocAt(uint64_t offset) const {
+        const uint64_t remaining = sizeOfFile() - offset;
+        return remaining >= 4 && ConstDataView(_getBase() + offset).read<LittleEndian<uint32_t>>() <= remaining;
+    }
+
+    // Whether there's the start of a doc at offset that runs past the end of the file (rather than
+    // a length that no doc could have, which is damage).
+    bool _isCutShortDocAt(uint64_t offset) const {
+        const uint64_t remaining = sizeOfFile() - offset;
+        if (remaining < static_cast<uint64_t>(BSONObj::kMinBSONLength)) {
+            return true;
+        }
+        const int length = ConstDataView(_getBase() + offset).read<LittleEndian<int>>();
+        return length >= BSONObj::kMinBSONLength && length <= BSONObjMaxInternalSize && static_cast<uint64_t>(length) > remaining;
+    }
+
+    // A doc that runs past the end of the file is left alone, since it's probably still being
+    // written (if we're following the file).
+    void _checkComplete() {
+        if (_archive ? ! _archive->hasNext(_getEnd()) : (_getNextBase() >= _getEnd() || ( ! _resyncing && _isCutShortDocAt(_nextOffset)))) {
+            _complete = true;
+            _stopIndexer();
+        }
+    }
+
+    bool _mergeReadyChunk() {
+        if ( ! _indexer) {
+            return false;
+        }
+        auto chunk = _indexer->tryTakeNext();
+        if ( ! chunk) {
+            return false;
+        }
+        _mergeChunk(*chunk);
+        _checkIndexerDone();
+        return true;
+    }
+
+    // Splice the docs found by an indexer thread onto the end of _docs.
+    // The chunk's first doc came from resyncing at an arbitrary offset, so it is only trusted once
+    // it lines up with where the docs we already have end.  Until then (or if the chunk stopped
+    // early), walk the docs here, one at a time.
+    void _mergeChunk(const ParallelDocumentIndexer::Chunk& chunk) {
+        bool spliced = false;
+        while ( ! isComplete() && _nextOffset < chunk.end) {
+            if ( ! spliced) {
+                auto it = std::lower_bound(chunk.offsets.begin(), chunk.offsets.end(), _nextOffset);
+                if (it != chunk.offsets.end() && *it == _nextOffset) {
+                    // no need to touch the docs themselves, the indexer already walked them.
+                    for (; it != chunk.offsets.end(); ++it) {
+                        _docs.append(*it);
+                    }
+                    _indexSamples();
+                    _nextOffset = chunk.next;
+                    // (a resync that got as far as one of the chunk's docs has found it)
+                    _resyncing = false;
+                    spliced = true;
+                    _checkComplete();
+                    continue;
+                }
             }
+            _loadNext();
+        }
+    }
+
+    void _checkIndexerDone() {
+        if (_indexer && _indexer->isDone()) {
+            // anything left over (eg. after a chunk that stopped early) gets loaded sequentially.
+            _stopIndexer();
+        }
+    }
+
+    void _stopIndexer() {
+        if (_indexer) {
+            _indexer->shutdown();
+            _indexer.reset();
+            _scannedOffset = _nextOffset;
         }
     }
 
-    std::vector<BSONObj> _docs;
+    DocumentOffsetIndex _docs;
+    uint64_t _nextOffset = 0;
+    // The stretches of the file that have been skipped because they aren't docs, in file order.
+    std::vector<DamagedRange> _damaged;
+    // Whether _nextOffset is in the middle of one of them, still looking for the next doc.
+    bool _resyncing = false;
     const char* _base;
     const char* _end;
     bool _complete;
+    std::unique_ptr<ParallelDocumentIndexer> _indexer;
+    // _docs may be reading directly from the sidecar's mapping.
+    std::unique_ptr<SidecarIndex> _sidecar;
+    // How many of the first docs came from the sidecar, up to where, and which have been checked.
+    size_t _sidecarDocs = 0;
+    uint64_t _sidecarEnd = 0;
+    DocBitmap _sidecarChecked;
+    uint64_t _savedOffset = 0;
+    BSONStorage* _storage = nullptr;
+    // Where the sequential scan last told _storage it had got to.
+    uint64_t _scannedOffset = 0;
+    // For an archive, _docs is unused, and the docs are those of the chosen namespace.
+    std::unique_ptr<ArchiveIndex> _archive;
+    size_t _namespace = 0;
+    bool _namespaceChosen = false;
+    // For FTDC, the docs are the samples, which are found in (the chunks in) _docs.
+    std::unique_ptr<FTDCSampleIndex> _ftdc;
+    // Why the last corrupt chunk found couldn't be read (it's shown as it is, instead).
+    std::string _ftdcProblem;
+    // While aggregating, the docs shown are its results.
+    std::unique_ptr<AggregationStream> _aggregation;
 };
 
 
 
 const char* infname = nullptr;
+std::unique_ptr<BSONStorage> input;
+// The same as input, when it's a file (rather than stdin).
+MappedFile* infile = nullptr;
+bool followFile = false;
+// Keep the last doc on screen as the file grows, like `less +F`.
+bool followTail = false;
 
 
 Tickit *t = nullptr;
 TickitWindow *root = nullptr;
 TickitWindow *mainwin = nullptr;
+// The column names of the table view, above mainwin (and hidden otherwise).
+TickitWindow *headerwin = nullptr;
 
 bool jumpToEndAfterLoadingComplete;
 
@@ -469,17 +1043,152 @@ private:
 };
 
 
+// A page of text over the docs (eg. the `:stats` report), which scrolls like the docs do, and
+// closes with q or Esc.
+class TextPanel {
+public:
+    void init(TickitWindow* parent, TickitWindow* returnFocusTo) {
+        _parent = parent;
+        _returnFocusTo = returnFocusTo;
+
+        _win = tickit_window_new(root, _geometry(), (TickitWindowFlags)(TICKIT_WINDOW_HIDDEN));
+
+        tickit_window_bind_event(_win, TICKIT_WINDOW_ON_EXPOSE, (TickitBindFlags)0, &_render_cb, this);
+        tickit_window_bind_event(_win, TICKIT_WINDOW_ON_KEY, (TickitBindFlags)0, &_event_key_cb, this);
+    }
+
+    void show(const std::string& text) {
+        _lines.clear();
+        std::istringstream in(text);
+        for (std::string line; std::getline(in, line); ) {
+            _lines.push_back(line);
+        }
+        _top = 0;
+
+        tickit_window_raise_to_front(_win);
+        tickit_window_show(_win);
+        tickit_window_take_focus(_win);
+        tickit_window_expose(_win, NULL);
+    }
+
+    void exit() {
+        tickit_window_hide(_win);
+        if (_returnFocusTo) {
+            tickit_window_take_focus(_returnFocusTo);
+        }
+    }
+
+    void resize() {
+        tickit_window_set_geometry(_win, _geometry());
+    }
+
+private:
+    // (everything but the status bar)
+    TickitRect _geometry() const {
+        return (TickitRect){ .top = 0, .left = 0, .lines = tickit_window_lines(_parent) - 1, .cols = tickit_window_cols(_parent) };
+    }
+
+    static int _render_cb(TickitWindow *win, TickitEventFlags flags, void *_info, void *data) {
+        TextPanel* panel = static_cast<TextPanel*>(data);
+        if (panel) {
+            return panel->_render(win, flags, _info);
+        }
+        return 1;
+    }
+
+    int _render(TickitWindow *win, TickitEventFlags flags, void *_info) {
+        TickitExposeEventInfo *info = static_cast<TickitExposeEventInfo*>(_info);
+        TickitRenderBuffer *rb = info->rb;
+
+        tickit_renderbuffer_eraserect(rb, &info->rect);
+        const int lines = tickit_window_lines(win);
+        for (int line = 0; line < lines; line++) {
+            if (_top + line < _lines.size()) {
+                tickit_renderbuffer_text_at(rb, line, 0, _lines[_top + line].c_str());
+            } else {
+                tickit_renderbuffer_text_at(rb, line, 0, "~");
+            }
+        }
+        return 1;
+    }
+
+    static int _event_key_cb(TickitWindow *win, TickitEventFlags flags, void *_info, void *data) {
+        TextPanel* panel = static_cast<TextPanel*>(data);
+        if (panel) {
+            return panel->_event_key(win, flags, _info);
+        }
+        return 0;
+    }
+
+    int _event_key(TickitWindow *win, TickitEventFlags flags, void *_info) {
+        TickitKeyEventInfo *info = static_cast<TickitKeyEventInfo*>(_info);
+
+        if ( ! info->str) {
+            return 1;
+        }
+
+        const size_t lines = tickit_window_lines(win);
+        const size_t bottom = _lines.size() > lines ? _lines.size() - lines : 0;
+        size_t top = _top;
+        if (isKey(info, 'q') || isKey(info, 'Q') || isKey(info, "Escape")) {
+            exit();
+            return 1;
+        } else if (isKey(info, 'j') || isKey(info, "Down")) {
+            top++;
+        } else if (isKey(info, 'k') || isKey(info, "Up")) {
+            top = top ? top - 1 : 0;
+        } else if (isKey(info, "PageDown") || isKey(info, "C-f") || isKey(info, ' ')) {
+            top += lines;
+        } else if (isKey(info, "PageUp") || isKey(info, "C-b")) {
+            top = top > lines ? top - lines : 0;
+        } else if (isKey(info, 'g') || isKey(info, "Home")) {
+            top = 0;
+        } else if (isKey(info, 'G') || isKey(info, "End")) {
+            top = bottom;
+        }
+        top = std::min(top, bottom);
+        if (top != _top) {
+            _top = top;
+            tickit_window_expose(_win, NULL);
+        }
+
+        return 1;
+    }
+
+
+    TickitWindow* _parent;
+    TickitWindow* _win = nullptr;
+    TickitWindow* _returnFocusTo = nullptr;
+
+    std::vector<std::string> _lines;
+    size_t _top = 0;
+
+};
+
+
 class BSONCacheView;
+struct DocRenderer;
 
 class Search {
 public:
     Search(const std::string& s);
     virtual ~Search();
 
-    virtual bool matches(unsigned long doc, BSONCacheView& view) const = 0;
+    // Whether doc matches, when rendered by render.
+    virtual bool matches(const BSONObj& doc, const DocRenderer& render) const = 0;
+
+    // The same, for a search thread to use.  By default this just calls matches(), which must
+    // then be safe to call concurrently.
+    virtual BackgroundSearch::Predicate predicate(const DocRenderer& render) const;
+
+    // Whether doc matches as the view currently shows it.
+    bool matches(unsigned long doc, BSONCacheView& view) const;
 
     virtual bool isValid() const = 0;
 
+    // Whether it looks at the docs as rendered, so its hits change along with the render mode.
+    virtual bool usesRendering() const = 0;
+
 protected:
     const std::string& getText() const;
 
@@ -493,10 +1202,17 @@ public:
     SearchRenderedText(const std::string& s);
     virtual ~SearchRenderedText();
 
-    virtual bool matches(unsigned long doc, BSONCacheView& view) const;
+    using Search::matches;
+    virtual bool matches(const BSONObj& doc, const DocRenderer& render) const;
 
     virtual bool isValid() const;
 
+    virtual bool usesRendering() const;
+
+private:
+    // For JSON, most text can be looked for without rendering the whole doc.
+    boost::optional<JSONTextSearch> _jsonSearch;
+    SubstringSearcher _searcher;
 };
 
 
@@ -505,10 +1221,15 @@ public:
     SearchMQL(const std::string& s);
     virtual ~SearchMQL();
 
-    virtual bool matches(unsigned long doc, BSONCacheView& view) const;
+    using Search::matches;
+    virtual bool matches(const BSONObj& doc, const DocRenderer& render) const;
+
+    virtual BackgroundSearch::Predicate predicate(const DocRenderer& render) const;
 
     virtual bool isValid() const;
 
+    virtual bool usesRendering() const;
+
 private:
     BSONObj _pattern;
     static const boost::intrusive_ptr<ExpressionContext> _expCtx;
@@ -519,11 +1240,29 @@ private:
 const boost::intrusive_ptr<ExpressionContext> SearchMQL::_expCtx = new ExpressionContext(nullptr, nullptr);
 
 
+// `re:<pattern>` looks for a regex in the string values of the docs (whatever the render mode).
+class SearchRegex : public Search {
+public:
+    SearchRegex(const std::string& s);
+    virtual ~SearchRegex();
 
-std::string textLogs(const BSONObj& doc) {
-    // TODO: this code is foul
-    StringBuilder sb;
-    int i = 1;
+    using Search::matches;
+    virtual bool matches(const BSONObj& doc, const DocRenderer& render) const;
+
+    virtual bool isValid() const;
+
+    virtual bool usesRendering() const;
+
+private:
+    boost::optional<RegexSearch> _regex;
+};
+
+
+
+std::string textLogs(const BSONObj& doc) {
+    // TODO: this code is foul
+    StringBuilder sb;
+    int i = 1;
     for (auto&& elem : doc) {
         if (i == 1) {
             sb << elem.Date().toString();
@@ -551,16 +1290,136 @@ std::string textLogs(const BSONObj& doc) {
 }
 
 
-class BSONCacheView {
-public:
-
-    enum DocumentRenderMode {
+// How docs are shown as text.  Text searches look in the same text, so they take a copy of this
+// when they start, rather than following the view as it changes.
+struct DocRenderer {
+    enum Mode {
         kJSONOneline,
         kJSONPretty,
         kToString,
         kTextLogs,
+        kProjected,
+        kTable,
     };
 
+    Mode mode = kJSONOneline;
+    JsonStringFormat format = Strict;
+    // The fields shown by kProjected, or the columns of kTable.
+    std::shared_ptr<const FieldProjection> projection;
+
+    std::string operator()(const BSONObj& doc) const {
+        switch (mode) {
+            case kJSONOneline: return doc.jsonString(format);
+            case kJSONPretty:  return doc.jsonString(format, 1);
+            case kToString:    return doc.toString();
+            case kTextLogs:    return textLogs(doc);
+            case kProjected:   return projection->render(doc, format);
+            case kTable:       return projection->renderRow(doc, format);
+        }
+        return "--- unknown render mode ---";
+    }
+};
+
+
+// The docs that the last search has found to match, so far.  A search goes one way from the
+// cursor (forwards, or backwards for `?`), then wraps around to check the rest in order, so the
+// docs it has checked are two ranges.  Whether any other doc matches isn't known yet.
+struct SearchHits {
+    struct Next {
+        enum State {
+            kFound,
+            kNotFound,
+            kNotYetKnown,
+        };
+
+        State state;
+        unsigned long doc;
+        bool wrapped;
+    };
+
+    // [begin, end)
+    struct Range {
+        unsigned long begin = 0;
+        unsigned long end = 0;
+
+        bool contains(unsigned long doc) const {
+            return begin <= doc && doc < end;
+        }
+    };
+
+    DocBitmap docs;
+    bool valid = false;  // (false if there's no search, or it's for a different rendering)
+    Range checked;
+    Range wrappedChecked;
+
+    void reset() {
+        docs.clear();
+        valid = true;
+        checked = wrappedChecked = Range();
+    }
+
+    void clear() {
+        reset();
+        valid = false;
+    }
+
+    bool isChecked(unsigned long doc) const {
+        return checked.contains(doc) || wrappedChecked.contains(doc);
+    }
+
+    // Whether every doc in [first, last) has been checked.
+    bool allChecked(unsigned long first, unsigned long last) const {
+        // (either range may carry on from the other)
+        while (first < last) {
+            if (checked.contains(first)) {
+                first = checked.end;
+            } else if (wrappedChecked.contains(first)) {
+                first = wrappedChecked.end;
+            } else {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // The first hit after `from`, wrapping around after the last of numDocs docs, if the docs in
+    // between have all been checked.
+    Next nextHit(unsigned long from, unsigned long numDocs) const {
+        if (auto doc = docs.next(from)) {
+            return {allChecked(from + 1, *doc) ? Next::kFound : Next::kNotYetKnown, *doc, false};
+        }
+        if ( ! allChecked(from + 1, numDocs)) {
+            return {Next::kNotYetKnown, 0, false};
+        }
+        if (docs.empty()) {
+            return {allChecked(0, from + 1) ? Next::kNotFound : Next::kNotYetKnown, 0, false};
+        }
+        const unsigned long first = docs.select(0);
+        return {allChecked(0, first) ? Next::kFound : Next::kNotYetKnown, first, true};
+    }
+
+    // The same, backwards.
+    Next prevHit(unsigned long from, unsigned long numDocs) const {
+        if (auto doc = docs.prev(from)) {
+            return {allChecked(*doc + 1, from) ? Next::kFound : Next::kNotYetKnown, *doc, false};
+        }
+        if ( ! allChecked(0, from)) {
+            return {Next::kNotYetKnown, 0, false};
+        }
+        if (docs.empty()) {
+            return {allChecked(from, numDocs) ? Next::kNotFound : Next::kNotYetKnown, 0, false};
+        }
+        const unsigned long last = docs.select(docs.size() - 1);
+        return {allChecked(last + 1, numDocs) ? Next::kFound : Next::kNotYetKnown, last, true};
+    }
+};
+
+
+class BSONCacheView {
+public:
+
+    using DocumentRenderMode = DocRenderer::Mode;
+
 
     BSONCacheView(BSONCache* cache = nullptr, std::function<void(void)> redrawFullFn = noop, std::function<void(void)> redrawStatusFn = noop)
     : _cache(cache), _redrawFullFn(redrawFullFn), _redrawStatusFn(redrawStatusFn) {
@@ -578,6 +1437,10 @@ public:
     }
 
     void moveLeft() {
+        if (_renderer.mode == DocRenderer::kTable) {
+            _moveToColumn(false);
+            return;
+        }
         if (_startCol > 0) {
             _startCol--;
             computeVisible();
@@ -586,6 +1449,10 @@ public:
     }
 
     void moveRight() {
+        if (_renderer.mode == DocRenderer::kTable) {
+            _moveToColumn(true);
+            return;
+        }
         if (_startCol < _longestLineStartCol) {
             _startCol++;
             computeVisible();
@@ -676,7 +1543,7 @@ public:
     }
 
     bool nextDoc() {
-        if (!cache().isComplete() || _startDoc < cache().numDocs() - 1) {
+        if (_hasRow(_startDoc + 1)) {
             _startDoc++;
             _startLine = 0;
             return true;
@@ -709,6 +1576,9 @@ public:
 
     void moveDown() {
         computeVisible();
+        if (_docLines.empty()) {
+            return;
+        }
         if (_startLine == _docLines[0] - 1) {
             if (nextDoc()) {
                 _startLine = 0;
@@ -726,6 +1596,9 @@ public:
 
     void moveUp() {
         computeVisible();
+        if (_docLines.empty()) {
+            return;
+        }
         if (_startLine == 0) {
             if (prevDoc()) {
                 _startLine = _docLines[0] - 1;
@@ -752,19 +1625,21 @@ public:
     }
 
     void jumpDown() {
-        if ( ! cache().isComplete()) {
+        if ( ! _hasAllRows()) {
             // TODO: indicate to the user that there might be a delay?
             jumpToEndAfterLoadingComplete = true;
+        } else if (_numRows() == 0) {
+            jumpToEndAfterLoadingComplete = false;
         } else {
-            unsigned long targetStartDoc = cache().numDocs() - 1;
+            unsigned long targetStartDoc = _numRows() - 1;
             _startDoc = targetStartDoc;
             computeVisible();
-            while (_lastDisplayedLine < _mainLines - 2) {
+            while (_lastDisplayedLine < _mainLines - 2 && _startDoc > 0) {
                 _startDoc--;
                 computeVisible();
             }
             auto totalLines = getTotalDocLines();
-            _startLine = totalLines - (_mainLines - 2);
+            _startLine = std::max(0, totalLines - (_mainLines - 2));
             computeVisible();
             redrawFull();
             cursorBottom();
@@ -774,6 +1649,9 @@ public:
     }
 
     void pageUp() {
+        if (_docLines.empty()) {
+            return;
+        }
         if (_startDoc == 0 && _startLine == 0) {
             // we are at the top of the first page.  cannot page up any further.
             cursorTop();
@@ -822,7 +1700,7 @@ public:
             _startLine = _docLines.back() - (getTotalDocLines() - _startLine - _mainLines);
             cursorTop();
             computeVisible();
-            if (_lastDisplayedDoc == cache().numDocs() - 1) {
+            if (_lastDisplayedDoc + 1 == _numRows()) {
                 int emptyLines = _mainLines - 1 - _lastDisplayedLine;
                 jumpDown();
                 _cursorLine = emptyLines;
@@ -832,13 +1710,52 @@ public:
         }
     }
 
+    // The cache is showing different docs (eg. another namespace of an archive), so start again
+    // from the top.
+    void reset() {
+        _startDoc = 0;
+        _startLine = 0;
+        _startCol = 0;
+        _cursorLine = 0;
+        _markedDocs.clear();
+        _layouts.clear();
+        _tableFitted.clear();
+        _hits.clear();
+        _filtered = false;
+        _order.reset();
+        computeVisible();
+        redrawFull();
+    }
+
+    // After the cache has shrunk (the file was truncated), make sure we're not past the end.
+    void clampToDocs() {
+        // (the hits and the sorted order are of the old docs, so forget them)
+        if (_filtered || _order) {
+            _startDoc = _rowDoc(_startDoc);
+            _startLine = 0;
+            _filtered = false;
+            _order.reset();
+        }
+        _hits.clear();
+        const unsigned long numDocs = cache().numDocs();
+        if (_startDoc >= numDocs) {
+            _startDoc = numDocs ? numDocs - 1 : 0;
+            _startLine = 0;
+        }
+        _markedDocs.erase(_markedDocs.lower_bound(numDocs), _markedDocs.end());
+        _layouts.clear();
+        _tableFitted.clear();
+        computeVisible();
+        redrawFull();
+    }
+
     int getTotalDocLines() {
         return std::accumulate(_docLines.begin(), _docLines.end(), 0);
     }
 
 
     void setDocumentRenderMode(DocumentRenderMode documentRenderMode) {
-        _documentRenderMode = documentRenderMode;
+        _renderer.mode = documentRenderMode;
         _startCol = 0;
         // TODO: take some care to keep the cursor on the same doc, if possible / at all costs.
         computeVisible();
@@ -846,17 +1763,58 @@ public:
     }
 
     DocumentRenderMode getDocumentRenderMode() {
-        return _documentRenderMode;
+        return _renderer.mode;
+    }
+
+    // Show only some fields of each doc, in columns wide enough for the docs on screen.
+    void setProjection(FieldProjection projection) {
+        for (unsigned long row = _startDoc; row < _startDoc + _mainLines && _hasRow(row); row++) {
+            projection.fitColumns(cache()[_rowDoc(row)], _renderer.format);
+        }
+        _renderer.projection = std::make_shared<const FieldProjection>(std::move(projection));
+        // (layouts from an earlier projection have the same key)
+        _layouts.clear();
+        setDocumentRenderMode(DocRenderer::kProjected);
+    }
+
+    // Show the docs as the rows of a table, with these columns, or (if none) the fields of the
+    // first few docs from the top of the screen.  The columns widen to fit the rows as they come
+    // on screen, and only the rows on screen are looked at.
+    void setTable(boost::optional<FieldProjection> columns) {
+        if ( ! columns) {
+            std::vector<BSONObj> sample;
+            for (unsigned long row = _startDoc; sample.size() < kTableSampleDocs && _hasRow(row); row++) {
+                sample.push_back(cache()[_rowDoc(row)]);
+            }
+            columns = FieldProjection::inferColumns(sample);
+        }
+        _renderer.projection = std::make_shared<const FieldProjection>(std::move(*columns));
+        _tableFitted.clear();
+        _layouts.clear();
+        setDocumentRenderMode(DocRenderer::kTable);
+    }
+
+    // The table's column names, scrolled along with the rows.
+    void drawTableHeader(TickitRenderBuffer* rb) {
+        if (_renderer.mode != DocRenderer::kTable) {
+            return;
+        }
+        const std::string header = _renderer.projection->renderHeader();
+        if (_startCol < static_cast<int>(header.size())) {
+            tickit_renderbuffer_textn_at(rb, 0, 0, header.data() + _startCol, header.size() - _startCol);
+        }
     }
 
     void setExtendedJSONMode(JsonStringFormat extendedJSONMode) {
-        _extendedJSONMode = extendedJSONMode;
+        _renderer.format = extendedJSONMode;
+        // (the values are wider or narrower in the other format, so the columns need fitting again)
+        _tableFitted.clear();
         computeVisible();
         redrawFull();
     }
 
     JsonStringFormat getExtendedJSONMode() {
-        return _extendedJSONMode;
+        return _renderer.format;
     }
 
     void toggleExtendedJSONMode() {
@@ -868,13 +1826,17 @@ public:
     }
 
     std::string renderDoc(unsigned long doc) {
-        switch (_documentRenderMode) {
-            case kJSONOneline: return cache()[doc].jsonString(_extendedJSONMode);
-            case kJSONPretty:  return cache()[doc].jsonString(_extendedJSONMode, 1);
-            case kToString:    return cache()[doc].toString();
-            case kTextLogs:    return textLogs(cache()[doc]);
-        }
-        return "--- unknown render mode ---";
+        return _renderer(cache()[doc]);
+    }
+
+    const DocRenderer& renderer() const {
+        return _renderer;
+    }
+
+    // The rendered doc split into lines, from the layout cache if it's been on screen recently.
+    std::shared_ptr<const DocumentLayout> layoutDoc(unsigned long doc) {
+        return _layouts.get({doc, _renderer.mode, _renderer.format},
+                            [&] { return renderDoc(doc); });
     }
 
 
@@ -891,137 +1853,116 @@ public:
 
 
     void drawStatusBar(TickitRenderBuffer* rb) {
-        tickit_renderbuffer_textf_at(rb, 0, 0, "%s [doc %ld] [docs %ld-%ld/%ld%s%s] [loaded %.0lf%% %.0lf/%.0lf MiB]", infname, _cursorDoc, _startDoc, _lastDisplayedDoc, cache().numDocs(), cache().isComplete() ? "" : "+", cache().isComplete() && _lastDisplayedDoc == cache().numDocs() - 1 ? " (END)" : "", cache().percOfFileSeen(), cache().sizeOfFileSeen()/1048576.0, cache().sizeOfFile()/1048576.0);
+        tickit_renderbuffer_textf_at(rb, 0, 0, "%s [doc %ld] [docs %ld-%ld/%ld%s%s] [loaded %.0lf%% %.0lf/%.0lf MiB]", infname, _cursorDoc, _startDoc, _lastDisplayedDoc, cache().numDocs(), cache().hasAllDocs() ? "" : "+", cache().hasAllDocs() && _lastDisplayedDoc + 1 == cache().numDocs() ? " (END)" : "", cache().percOfFileSeen(), cache().sizeOfFileSeen()/1048576.0, cache().sizeOfFile()/1048576.0);
     }
 
 
     void computeVisible() {
+        if (_renderer.mode == DocRenderer::kTable) {
+            _fitTableColumns();
+        }
+
         int line = 0;
         int longestLine = 0;
         unsigned long doc = _startDoc;
         _docLines.clear();
         int skipLines = _startLine;
-        while (line < _mainLines && (!cache().isComplete() || doc < cache().numDocs()) ) {
-
-            std::string str = renderDoc(doc);
-
-            const char* ss = str.c_str();
+        while (line < _mainLines && _hasRow(doc)) {
 
-            const char* s = ss;
-            const char* e;
+            auto layout = layoutDoc(_rowDoc(doc));
 
-            // TODO: when we directly render docs (for color syntax highlighting), it should be possible to more quickly compute the number of lines each visible doc will need (for a given rendering mode)
-            int thisDocLines = 0;
+            // Lines above the top of the screen still count towards the doc, but don't need looking at.
+            int thisDocLines = std::min<size_t>(skipLines, layout->numLines());
+            skipLines -= thisDocLines;
 
-            while (line < _mainLines) {
-
-                e = strchr(s, '\n');
-                int len = e ? (e - s) : strlen(s);
-
-                if (skipLines > 0) {
-                    skipLines--;
-                } else {
-
-                    if (longestLine < len) {
-                        longestLine = len;
-                    }
-
-                    if (line == _cursorLine) {
-                        _cursorDoc = doc;
-                    }
+            for (size_t i = thisDocLines; i < layout->numLines() && line < _mainLines; i++) {
+                int len = layout->line(i).size();
+                if (longestLine < len) {
+                    longestLine = len;
+                }
 
-                    line++;
+                if (line == _cursorLine) {
+                    _cursorDoc = doc;
                 }
 
+                line++;
                 thisDocLines++;
-
-                if ( ! e) {
-                    // last sub-line, get out
-                    break;
-                }
-                s = e + 1;
             }
             _docLines.push_back(thisDocLines);
-            // this should no longer ever happen
-            //if (line < _startLine) {
-            //    // _startLine means we're skipping that whole doc
-            //    view.nextDoc();
-            //}
             _lastDisplayedDoc = doc;
             doc++;
         }
         _lastDisplayedLine = line - 1;
-        //if (_startLine) {
-        //    _lastDisplayedLine--; // bleh there are better ways to fix this (like understanding the problem properly), but this band-aid will do for now
-        //}
+        if ( ! _docLines.empty() && (_filtered || _order)) {
+            // (the docs shown aren't next to each other)
+            for (unsigned long row = _startDoc; row <= _lastDisplayedDoc; row++) {
+                const unsigned long d = _rowDoc(row);
+                cache().viewing(d, d);
+            }
+        } else if ( ! _docLines.empty()) {
+            cache().viewing(_startDoc, _lastDisplayedDoc);
+        }
         _longestLineStartCol = longestLine - _mainCols;
     }
 
 
     void drawMainLines(TickitRenderBuffer* rb) {
         int line = 0;
-        unsigned long doc = _startDoc;
+        unsigned long row = _startDoc;
         int skipLines = _startLine;
-        while (line < _mainLines && (!cache().isComplete() || doc < cache().numDocs()) ) {
+        while (line < _mainLines && _hasRow(row)) {
 
-            std::string str = renderDoc(doc);
+            const unsigned long doc = _rowDoc(row);
+            auto layout = layoutDoc(doc);
 
+            // Once the search has checked a doc, there's no need to check it again.
             auto lastSearch = getLastSearch();
-            bool docMatch = lastSearch ? (*lastSearch)->matches(doc, *this) : false;
-
-            const char* ss = str.c_str();
-
-            const char* s = ss;
-            const char* e;
-
-            while (line < _mainLines) {
-
-                e = strchr(s, '\n');
-                int len = e ? (e - s) : strlen(s);
-
-                if (skipLines > 0) {
-                    skipLines--;
-                } else {
+            bool docMatch = false;
+            if (_hits.isChecked(doc)) {
+                docMatch = _hits.docs.contains(doc);
+            } else if (lastSearch) {
+                docMatch = (*lastSearch)->matches(doc, *this);
+            }
 
-                    TickitPen* specialPen = nullptr;
-                    if (line == _cursorLine) {
-                        specialPen = mkpen_cursorLine();
-                    } else if (docMatch) {
-                        specialPen = mkpen_matchedDoc();
-                    } else if (isMarkedDoc(doc)) {
-                        specialPen = mkpen_markedDoc();
-                    }
-                    if (specialPen) {
-                        tickit_renderbuffer_savepen(rb);
-                        tickit_renderbuffer_setpen(rb, specialPen);
-                        TickitRect thisLineRect{ .top = line, .left = 0, .lines = 1, .cols = _mainCols };
-                        tickit_renderbuffer_eraserect(rb, &thisLineRect);
-                    }
+            size_t first = std::min<size_t>(skipLines, layout->numLines());
+            skipLines -= first;
 
-                    if (_startCol < len) {
-                        tickit_renderbuffer_textn_at(rb, line, 0, s + _startCol, len - _startCol);
-                    }
-                    if (_startCol > 0) {
-                        tickit_renderbuffer_text_at(rb, line, 0, "<");
-                    }
-                    if (len - _startCol > _mainCols) {
-                        tickit_renderbuffer_text_at(rb, line, _mainCols - 1, ">");
-                    }
+            for (size_t i = first; i < layout->numLines() && line < _mainLines; i++) {
+                StringData s = layout->line(i);
+                int len = s.size();
 
-                    if (specialPen) {
-                        tickit_renderbuffer_restore(rb);
-                    }
+                TickitPen* specialPen = nullptr;
+                if (line == _cursorLine) {
+                    specialPen = mkpen_cursorLine();
+                } else if (docMatch) {
+                    specialPen = mkpen_matchedDoc();
+                } else if (isMarkedDoc(doc)) {
+                    specialPen = mkpen_markedDoc();
+                }
+                if (specialPen) {
+                    tickit_renderbuffer_savepen(rb);
+                    tickit_renderbuffer_setpen(rb, specialPen);
+                    TickitRect thisLineRect{ .top = line, .left = 0, .lines = 1, .cols = _mainCols };
+                    tickit_renderbuffer_eraserect(rb, &thisLineRect);
+                }
 
-                    line++;
+                if (_startCol < len) {
+                    tickit_renderbuffer_textn_at(rb, line, 0, s.rawData() + _startCol, len - _startCol);
+                }
+                if (_startCol > 0) {
+                    tickit_renderbuffer_text_at(rb, line, 0, "<");
+                }
+                if (len - _startCol > _mainCols) {
+                    tickit_renderbuffer_text_at(rb, line, _mainCols - 1, ">");
                 }
 
-                if ( ! e) {
-                    // last sub-line, get out
-                    break;
+                if (specialPen) {
+                    tickit_renderbuffer_restore(rb);
                 }
-                s = e + 1;
+
+                line++;
             }
-            doc++;
+            row++;
         }
     }
 
@@ -1045,38 +1986,40 @@ public:
 
     bool isMarkedDoc(unsigned long doc) const {
         if (_dragMarked) {
-            if ( (_dragFirst <= _dragLast && _dragFirst <= doc && doc <= _dragLast ) ||
-                 (_dragFirst >  _dragLast && _dragLast  <= doc && doc <= _dragFirst) ) {
+            const unsigned long row = _docRow(doc);
+            if ( (_dragFirst <= _dragLast && _dragFirst <= row && row <= _dragLast ) ||
+                 (_dragFirst >  _dragLast && _dragLast  <= row && row <= _dragFirst) ) {
                 return *_dragMarked;
             }
         }
         return _markedDocs.find(doc) != _markedDocs.end();
     }
 
-    void dragStart(unsigned long doc) {
-        _dragMarked = ! isMarkedDoc(doc);
-        _dragFirst = _dragLast = doc;
+    // Dragging marks the docs shown on the rows dragged over.
+    void dragStart(unsigned long row) {
+        _dragMarked = ! isMarkedDoc(_rowDoc(row));
+        _dragFirst = _dragLast = row;
         redrawFull();
     }
 
-    void dragUpdate(unsigned long doc) {
-        _dragLast = doc;
+    void dragUpdate(unsigned long row) {
+        _dragLast = row;
         redrawFull();
     }
 
-    void dragEnd(unsigned long doc) {
-        _dragLast = doc;
+    void dragEnd(unsigned long row) {
+        _dragLast = row;
 
         // make permanent
         if (_dragFirst > _dragLast) {
             // upwards drag
             std::swap(_dragFirst, _dragLast);
         }
-        for (unsigned long doc = _dragFirst; doc <= _dragLast; doc++) {
+        for (unsigned long row = _dragFirst; row <= _dragLast; row++) {
             if (*_dragMarked) {
-                markDoc(doc);
+                markDoc(_rowDoc(row));
             } else {
-                unmarkDoc(doc);
+                unmarkDoc(_rowDoc(row));
             }
         }
 
@@ -1086,23 +2029,23 @@ public:
     }
 
     void dragStartLine(int line) {
-        auto doc = docForLine(line);
-        if (doc) {
-            dragStart(*doc);
+        auto row = _rowForLine(line);
+        if (row) {
+            dragStart(*row);
         }
     }
 
     void dragUpdateLine(int line) {
-        auto doc = docForLine(line);
-        if (doc) {
-            dragUpdate(*doc);
+        auto row = _rowForLine(line);
+        if (row) {
+            dragUpdate(*row);
         }
     }
 
     void dragEndLine(int line) {
-        auto doc = docForLine(line);
-        if (doc) {
-            dragEnd(*doc);
+        auto row = _rowForLine(line);
+        if (row) {
+            dragEnd(*row);
         }
     }
 
@@ -1150,21 +2093,23 @@ public:
 
 
     void markCursorDoc() {
-        markDoc(_cursorDoc);
+        markDoc(getCursorDoc());
         redrawFull();
     }
 
     void unmarkCursorDoc() {
-        unmarkDoc(_cursorDoc);
+        unmarkDoc(getCursorDoc());
         redrawFull();
     }
 
     void toggleMarkCursorDoc() {
-        toggleMarkDoc(_cursorDoc);
+        toggleMarkDoc(getCursorDoc());
         redrawFull();
     }
 
+    // When filtered, and doc isn't shown, this jumps to the next doc that is.
     void jumpToDoc(unsigned long doc) {
+        doc = _docRow(doc);
         if (doc < _startDoc || (doc == _startDoc && _startLine > 0)) {
             // we are jumping backwards
             _jumpToDocBackwards(doc);
@@ -1180,27 +2125,23 @@ public:
     }
 
     void jumpNextMarkedDoc() {
-        auto target = nextMarkedDoc(_cursorDoc);
+        auto target = nextMarkedDoc(getCursorDoc());
         if (target) {
             jumpToDoc(*target);
         }
     }
 
     void jumpPrevMarkedDoc() {
-        auto target = prevMarkedDoc(_cursorDoc);
+        auto target = prevMarkedDoc(getCursorDoc());
         if (target) {
             jumpToDoc(*target);
         }
     }
 
     boost::optional<unsigned long> docForLine(int line) const {
-        int l = - _startLine;
-        for (unsigned long doc = 0; doc < _docLines.size(); doc++) {
-            int prevl = l;
-            l += _docLines[doc];
-            if (prevl <= line && line < l) {
-                return _startDoc + doc;
-            }
+        auto row = _rowForLine(line);
+        if (row) {
+            return _rowDoc(*row);
         }
         return boost::none;
     }
@@ -1238,20 +2179,12 @@ public:
     }
 
 
-    boost::optional<unsigned long> searchFor(const Search* s) {
-        for (unsigned long curr = _cursorDoc + 1; curr < cache().numDocs(); curr++) {
-            if (s->matches(curr, *this)) {
-                return curr;
-            }
-        }
-        return boost::none;
-    }
-
     void registerSearch(Search* s) {
         if (_lastSearch) {
             delete _lastSearch;
         }
         _lastSearch = s;
+        clearHits();
     }
 
     boost::optional<const Search*> getLastSearch() const {
@@ -1263,28 +2196,257 @@ public:
     }
 
     unsigned long getCursorDoc() {
-        return _cursorDoc;
+        return _rowDoc(_cursorDoc);
     }
 
     unsigned long getStartDoc() {
-        return _startDoc;
+        return _rowDoc(_startDoc);
     }
 
     unsigned long getLastDisplayedDoc() {
-        return _lastDisplayedDoc;
+        return _rowDoc(_lastDisplayedDoc);
+    }
+
+
+    const SearchHits& hits() const {
+        return _hits;
+    }
+
+    // A new search is starting.
+    void resetHits() {
+        _hits.reset();
+        if (_filtered) {
+            _startDoc = 0;
+            _startLine = 0;
+            computeVisible();
+            redrawFull();
+        }
+    }
+
+    // The hits no longer apply (eg. the render mode has changed under a text search).
+    void clearHits() {
+        if (_filtered) {
+            toggleFilter();
+        }
+        _hits.clear();
+    }
+
+    void addHits(const std::vector<uint64_t>& docs) {
+        if (docs.empty()) {
+            return;
+        }
+        // Hits found before the first one shown (after the search wraps around) renumber the
+        // rows, so keep showing the same doc.
+        const unsigned long startDoc = _rowDoc(_startDoc);
+        for (auto doc : docs) {
+            _hits.docs.add(doc);
+        }
+        if (_filtered) {
+            _startDoc = _docRow(startDoc);
+            computeVisible();
+        }
+    }
+
+    void setHitsChecked(SearchHits::Range checked, SearchHits::Range wrappedChecked) {
+        _hits.checked = checked;
+        _hits.wrappedChecked = wrappedChecked;
+    }
+
+    // Whether every doc has been checked, so all the hits are known.
+    bool hasAllHits() {
+        return _hits.valid && cache().hasAllDocs() && _hits.allChecked(0, cache().numDocs());
+    }
+
+    // The first hit after doc, wrapping around at the end (if the end has been found).
+    SearchHits::Next nextHit(unsigned long doc) {
+        return _hits.nextHit(doc, cache().hasAllDocs() ? cache().numDocs() : ULONG_MAX);
+    }
+
+    SearchHits::Next prevHit(unsigned long doc) {
+        return _hits.prevHit(doc, cache().hasAllDocs() ? cache().numDocs() : ULONG_MAX);
+    }
+
+    uint64_t markHits() {
+        if ( ! _hits.docs.empty()) {
+            for (boost::optional<uint64_t> doc = _hits.docs.select(0); doc; doc = _hits.docs.next(*doc)) {
+                markDoc(*doc);
+            }
+        }
+        redrawFull();
+        return _hits.docs.size();
+    }
+
+    // Show only the hits (including those the search has yet to find), or all the docs again.
+    // (The hits are shown in file order.)
+    void toggleFilter() {
+        const unsigned long doc = getCursorDoc();
+        _filtered = ! _filtered;
+        _order.reset();
+        _jumpToDocOffscreen(_docRow(doc));
+    }
+
+    bool isFiltered() const {
+        return _filtered;
+    }
+
+    // For the status bar: how many hits the search has found (so far), and which the cursor is on.
+    std::string describeHits() {
+        if ( ! _hits.valid) {
+            return "";
+        }
+        const unsigned long doc = getCursorDoc();
+        str::stream sb;
+        sb << " [";
+        if (_hits.docs.contains(doc)) {
+            sb << "hit " << _hits.docs.rank(doc) + 1 << "/" << _hits.docs.size();
+        } else {
+            sb << _hits.docs.size() << " hits";
+        }
+        sb << (hasAllHits() ? "" : "+") << (_filtered ? " (FILTERED)" : "") << "]";
+        return sb;
+    }
+
+    // Show the docs in this order (from the top), or in file order again (keeping the cursor on
+    // the same doc).  Docs found after the order was made aren't shown.
+    void setOrder(std::unique_ptr<SortedOrder> order) {
+        const unsigned long doc = getCursorDoc();
+        _filtered = false;
+        _order = std::move(order);
+        if (_order) {
+            _startDoc = 0;
+            _startLine = 0;
+            _cursorLine = 0;
+            computeVisible();
+            redrawFull();
+        } else {
+            _jumpToDocOffscreen(_docRow(doc));
+        }
     }
 
-    const MatchDetails* getMatchDetails() const {
-        return &_matchDetails;
+    const SortedOrder* order() const {
+        return _order.get();
     }
 
-    MatchDetails* getMatchDetails() {
-        return &_matchDetails;
+    // For the status bar: what the docs are sorted by, if anything.
+    std::string describeOrder() const {
+        if ( ! _order) {
+            return "";
+        }
+        return " [sorted by " + _order->spec().toString() + "]";
     }
 
 
 private:
 
+    // Docs looked at to choose the columns of a table.
+    static constexpr size_t kTableSampleDocs = 100;
+
+    // Widen the table's columns for the rows about to be shown, unless they've been on screen
+    // before.  (Searches may be using the old columns, so they're replaced rather than changed.)
+    void _fitTableColumns() {
+        std::unique_ptr<FieldProjection> wider;
+        bool widened = false;
+        for (unsigned long row = _startDoc; row < _startDoc + _mainLines && _hasRow(row); row++) {
+            const unsigned long doc = _rowDoc(row);
+            if (_tableFitted.contains(doc)) {
+                continue;
+            }
+            _tableFitted.add(doc);
+            if ( ! wider) {
+                wider = std::make_unique<FieldProjection>(*_renderer.projection);
+            }
+            widened |= wider->fitColumns(cache()[doc], _renderer.format);
+        }
+        if (widened) {
+            _renderer.projection = std::move(wider);
+            _layouts.clear();
+        }
+    }
+
+    // Scroll a table sideways to the start of the next (or previous) column.
+    void _moveToColumn(bool right) {
+        const auto starts = _renderer.projection->columnStarts();
+        int target = 0;
+        if (right) {
+            if (_startCol >= _longestLineStartCol) {
+                return;
+            }
+            auto next = std::upper_bound(starts.begin(), starts.end(), static_cast<size_t>(_startCol));
+            target = next != starts.end() ? *next : _longestLineStartCol;
+        } else {
+            auto prev = std::lower_bound(starts.begin(), starts.end(), static_cast<size_t>(_startCol));
+            target = prev != starts.begin() ? *(prev - 1) : 0;
+        }
+        if (target != _startCol) {
+            _startCol = target;
+            computeVisible();
+            redrawFull();
+        }
+    }
+
+    // When filtered, only the hits are shown, and when sorted, the docs are shown in that order,
+    // so the rows of the view (_startDoc, _cursorDoc, etc.) are numbered differently to the docs.
+    bool _hasRow(unsigned long row) {
+        if (_order) {
+            return row < _order->numDocs();
+        }
+        return _filtered ? row < _hits.docs.size() : cache().hasDoc(row);
+    }
+
+    unsigned long _numRows() {
+        if (_order) {
+            return _order->numDocs();
+        }
+        return _filtered ? _hits.docs.size() : cache().numDocs();
+    }
+
+    bool _hasAllRows() {
+        if (_order) {
+            return true;
+        }
+        return _filtered ? hasAllHits() : cache().hasAllDocs();
+    }
+
+    unsigned long _rowDoc(unsigned long row) const {
+        if (_order) {
+            // (the sorted order is read as far as the row, so paging down reads more of it)
+            return _order->numDocs() ? _order->doc(std::min<uint64_t>(row, _order->numDocs() - 1)) : 0;
+        }
+        if ( ! _filtered) {
+            return row;
+        }
+        // (when nothing matches there are no rows, but there's still a cursor)
+        return _hits.docs.empty() ? 0 : _hits.docs.select(std::min<uint64_t>(row, _hits.docs.size() - 1));
+    }
+
+    // The row showing doc, or if it isn't shown, the next row that is.
+    unsigned long _docRow(unsigned long doc) const {
+        if (_order) {
+            // (docs found since the sort aren't shown, so go to the last row instead)
+            if (doc >= _order->numDocs()) {
+                return _order->numDocs() ? _order->numDocs() - 1 : 0;
+            }
+            return _order->row(doc, (*_cache)[doc]);
+        }
+        if ( ! _filtered) {
+            return doc;
+        }
+        const uint64_t row = _hits.docs.rank(doc);
+        return row < _hits.docs.size() ? row : (_hits.docs.empty() ? 0 : _hits.docs.size() - 1);
+    }
+
+    boost::optional<unsigned long> _rowForLine(int line) const {
+        int l = - _startLine;
+        for (unsigned long row = 0; row < _docLines.size(); row++) {
+            int prevl = l;
+            l += _docLines[row];
+            if (prevl <= line && line < l) {
+                return _startDoc + row;
+            }
+        }
+        return boost::none;
+    }
+
     void _jumpToDocOffscreen(unsigned long doc, boost::optional<int> targetLine = boost::none) {
         _startDoc = doc;
         _startLine = 0;
@@ -1331,12 +2493,14 @@ private:
 
     BSONCache* _cache;
 
-    DocumentRenderMode _documentRenderMode = kJSONOneline;
+    DocRenderer _renderer;
 
     int _startCol = 0;
     int _longestLineStartCol = 0;
+    // The docs whose values the table's columns have been widened to fit.
+    DocBitmap _tableFitted;
 
-    unsigned long _startDoc = 0;   // index of first doc to display on the screen
+    unsigned long _startDoc = 0;   // index of first doc (or row, if filtered) to display on the screen
     int _startLine = 0;            // number of lines of the _startDoc to skip displaying
     unsigned long _lastDisplayedDoc = 0;
     int _lastDisplayedLine = 0;
@@ -1359,10 +2523,13 @@ private:
 
     // TODO: length-limited list instead
     Search* _lastSearch = nullptr;
+    SearchHits _hits;
+    bool _filtered = false;
 
-    JsonStringFormat _extendedJSONMode = Strict;
+    // The docs in the order of some of their fields' values, if they've been sorted.
+    std::unique_ptr<SortedOrder> _order;
 
-    MatchDetails _matchDetails;
+    LayoutCache _layouts;
 
 };
 
@@ -1379,27 +2546,45 @@ const std::string& Search::getText() const {
     return _text;
 }
 
+bool Search::matches(unsigned long doc, BSONCacheView& view) const {
+    return matches(view.cache()[doc], view.renderer());
+}
+
+BackgroundSearch::Predicate Search::predicate(const DocRenderer& render) const {
+    return [this, render](const BSONObj& doc) { return matches(doc, render); };
+}
+
 
 SearchRenderedText::SearchRenderedText(const std::string& s)
-: Search(s)
+: Search(s), _jsonSearch(JSONTextSearch::make(s)), _searcher(s)
 {
 }
 
 SearchRenderedText::~SearchRenderedText() {
 }
 
-bool SearchRenderedText::matches(unsigned long doc, BSONCacheView& view) const {
+bool SearchRenderedText::matches(const BSONObj& doc, const DocRenderer& render) const {
     if ( ! isValid()) {
         return false;
     }
-    // TODO: ergh this is so horribly slow
-    return (view.renderDoc(doc).find(getText()) != std::string::npos);
+    if (_jsonSearch && (render.mode == DocRenderer::kJSONOneline || render.mode == DocRenderer::kJSONPretty)) {
+        switch (_jsonSearch->search(doc)) {
+            case JSONTextSearch::Result::kMatch:   return true;
+            case JSONTextSearch::Result::kNoMatch: return false;
+            case JSONTextSearch::Result::kMaybe:   break;
+        }
+    }
+    return _searcher.contains(render(doc));
 }
 
 bool SearchRenderedText::isValid() const {
     return (getText() != "");
 }
 
+bool SearchRenderedText::usesRendering() const {
+    return true;
+}
+
 
 SearchMQL::SearchMQL(const std::string& s)
 : Search(s), _valid(false)
@@ -1421,23 +2606,62 @@ SearchMQL::~SearchMQL() {
     delete _matcher;
 }
 
-bool SearchMQL::matches(unsigned long doc, BSONCacheView& view) const {
+bool SearchMQL::matches(const BSONObj& doc, const DocRenderer& render) const {
     if ( ! isValid()) {
         return false;
     }
-    return (_matcher->matches(view.cache()[doc], view.getMatchDetails()));
+    return (_matcher->matches(doc, nullptr));
+}
+
+BackgroundSearch::Predicate SearchMQL::predicate(const DocRenderer& render) const {
+    if ( ! isValid()) {
+        return [](const BSONObj&) { return false; };
+    }
+    // A copy of the parsed query for each thread, rather than sharing _matcher.
+    std::shared_ptr<MatchExpression> expression = _matcher->getMatchExpression()->shallowClone();
+    return [expression](const BSONObj& doc) { return expression->matchesBSON(doc); };
 }
 
 bool SearchMQL::isValid() const {
     return _valid;
 }
 
+bool SearchMQL::usesRendering() const {
+    return false;
+}
 
-class SingleLineStatus {
-public:
-    SingleLineStatus(BSONCache* cache = nullptr, BSONCacheView* view = nullptr)
-    : _cache(cache), _view(view)
-    {
+
+SearchRegex::SearchRegex(const std::string& s)
+: Search(s)
+{
+    auto swRegex = RegexSearch::make(StringData(s).substr(strlen("re:")));
+    if (swRegex.isOK()) {
+        _regex = std::move(swRegex.getValue());
+    }
+}
+
+SearchRegex::~SearchRegex() {
+}
+
+bool SearchRegex::matches(const BSONObj& doc, const DocRenderer& render) const {
+    // (safe for the search threads to share)
+    return _regex && _regex->matches(doc);
+}
+
+bool SearchRegex::isValid() const {
+    return !! _regex;
+}
+
+bool SearchRegex::usesRendering() const {
+    return false;
+}
+
+
+class SingleLineStatus {
+public:
+    SingleLineStatus(BSONCache* cache = nullptr, BSONCacheView* view = nullptr)
+    : _cache(cache), _view(view)
+    {
     }
 
     SingleLineStatus(BSONCache* cache, BSONCacheView* view, TickitWindow* parent, int line = -1)
@@ -1500,12 +2724,22 @@ private:
         tickit_renderbuffer_setpen(rb, _pen);
         tickit_renderbuffer_clear(rb);
 
+        const size_t numDamaged = cache().damaged().size();
+        const std::string damaged = numDamaged ? str::stream() << " [damaged " << numDamaged << "]" : std::string();
+        const std::string& ftdcProblem = cache().ftdcProblem();
+
         // TODO: elide fields that aren't needed
         tickit_renderbuffer_textf_at(rb, 0, 0,
-            "%s [doc %ld] [docs %ld-%ld/%ld%s%s] [loaded %.0lf%% %.0lf/%.0lf MiB]%s%s%s",
+            "%s%s%s%s%s%s [doc %ld] [docs %ld-%ld/%ld%s%s]%s%s%s%s%s [loaded %.0lf%% %.0lf/%.0lf MiB]%s%s%s",
             infname,
+            cache().isArchive() ? " [" : "", cache().currentNamespace().c_str(), cache().isArchive() ? "]" : "",
+            cache().aggregation() ? " [aggregation]" : "",
+            view().describeOrder().c_str(),
             view().getCursorDoc(),
-            view().getStartDoc(), view().getLastDisplayedDoc(), cache().numDocs(), cache().isComplete() ? "" : "+", cache().isComplete() && view().getLastDisplayedDoc() == cache().numDocs() - 1 ? " (END)" : "",
+            view().getStartDoc(), view().getLastDisplayedDoc(), cache().numDocs(), cache().hasAllDocs() ? "" : "+", followTail ? " (FOLLOWING)" : cache().hasAllDocs() && view().getLastDisplayedDoc() + 1 == cache().numDocs() ? " (END)" : "",
+            view().describeHits().c_str(),
+            damaged.c_str(),
+            ftdcProblem == "" ? "" : " [", ftdcProblem.c_str(), ftdcProblem == "" ? "" : "]",
             cache().percOfFileSeen(), cache().sizeOfFileSeen()/1048576.0, cache().sizeOfFile()/1048576.0,
             _extra == "" ? "" : " [", _extra.c_str(), _extra == "" ? "" : "]"
             );
@@ -1537,6 +2771,7 @@ BSONCache cache;
 BSONCacheView view;
 SingleLinePrompt prompt;
 SingleLineStatus status;
+TextPanel panel;
 
 
 int _dispatch(Tickit* t, TickitEventFlags flags, void* info, void* user) {
@@ -1553,46 +2788,984 @@ void defer(std::function<void(void)> cb) {
 }
 
 
-void doSearch() {
+static int render_header(TickitWindow *win, TickitEventFlags flags, void *_info, void *data) {
+    TickitExposeEventInfo *info = static_cast<TickitExposeEventInfo*>(_info);
+    TickitRenderBuffer *rb = info->rb;
 
-    // TODO: better user feedback (updates)
-    status.setExtra("Searching...");
-    defer([&] () {
-        auto lastSearch = view.getLastSearch();
-        if (lastSearch) {
-            if ((*lastSearch)->isValid()) {
-                auto doc = view.searchFor(*lastSearch);
-                if (doc) {
-                    status.setExtra("");
-                    view.jumpToDoc(*doc);
-                } else {
-                    // notify the user
-                    status.setExtra("Pattern not found");
-                }
+    static TickitPen* pen = mkpen_highlight();
+    tickit_renderbuffer_setpen(rb, pen);
+    tickit_renderbuffer_eraserect(rb, &info->rect);
+    view.drawTableHeader(rb);
+
+    return 1;
+}
+
+
+// Make room for the table's header above the docs, or not.
+static bool headerShown = false;
+
+static void layoutWindows() {
+    int lines = tickit_window_lines(root);
+    int cols = tickit_window_cols(root);
+
+    headerShown = view.getDocumentRenderMode() == DocRenderer::kTable;
+    const int top = headerShown ? 1 : 0;
+    tickit_window_set_geometry(headerwin, (TickitRect){ .top = 0, .left = 0, .lines = 1, .cols = cols });
+    tickit_window_set_geometry(mainwin, (TickitRect){ .top = top, .left = 0, .lines = lines - 1 - top, .cols = cols });
+    if (headerShown) {
+        tickit_window_show(headerwin);
+    } else {
+        tickit_window_hide(headerwin);
+    }
+}
+
+void updateTableHeader() {
+    if (headerShown != (view.getDocumentRenderMode() == DocRenderer::kTable)) {
+        layoutWindows();
+    }
+}
+
+
+// The search in progress, if any.  search_step() hands it docs (loading more of the file as need
+// be), from the cursor to one end and then around from the other, and collects its hits in the
+// view until every doc has been checked.
+std::unique_ptr<BackgroundSearch> runningSearch;
+bool searchBackwards = false;
+unsigned long searchStart = 0;
+unsigned long searchNextDoc = 0;
+// Once the search has wrapped around, how many docs it checked before then.
+boost::optional<uint64_t> searchDocsBeforeWrapping;
+// Jump to the first hit after (or before) this doc, as soon as it's known.
+boost::optional<unsigned long> searchJumpFrom;
+bool searchJumpBackwards = false;
+// Mark all the hits once they're known.
+bool searchMarkWhenDone = false;
+Date_t searchStarted;
+
+// Which way `/` or `?` last searched, for `n` (and the other way for `N`).
+bool lastSearchBackwards = false;
+
+const int kSearchStepMillis = 20;
+
+// Docs looked at to find which field they're in time order by.
+const unsigned long kTimeSampleDocs = 32;
+
+void cancelSearch() {
+    // (waits for the search threads to stop)
+    runningSearch.reset();
+}
+
+// Jump to the first hit after doc `from` (or before it), wrapping around, if that's known yet.
+bool jumpToHit(unsigned long from, bool backwards) {
+    const auto next = backwards ? view.prevHit(from) : view.nextHit(from);
+    switch (next.state) {
+        case SearchHits::Next::kNotYetKnown:
+            return false;
+        case SearchHits::Next::kNotFound:
+            status.setExtra("Pattern not found");
+            return true;
+        case SearchHits::Next::kFound:
+            if ( ! next.wrapped) {
+                status.setExtra("");
+            } else if (backwards) {
+                status.setExtra("Search hit TOP, continuing at BOTTOM");
             } else {
-                status.setExtra("Invalid search pattern");
+                status.setExtra("Search hit BOTTOM, continuing at TOP");
+            }
+            view.jumpToDoc(next.doc);
+            return true;
+    }
+    return false;
+}
+
+void reportMarkedHits(uint64_t marked) {
+    if (marked) {
+        status.setExtra(str::stream() << "Marked " << marked << " matching docs");
+    } else {
+        status.setExtra("Pattern not found");
+    }
+}
+
+static bool searchHasNextDoc() {
+    if ( ! searchDocsBeforeWrapping) {
+        return searchBackwards ? searchNextDoc > 0 : cache.hasDoc(searchNextDoc);
+    }
+    // (after wrapping around, the search ends where it started)
+    return searchBackwards ? cache.hasDoc(searchNextDoc) : searchNextDoc < searchStart;
+}
+
+static int search_step(Tickit *t, TickitEventFlags flags, void *_info, void *data) {
+    if ( ! runningSearch) {
+        return 0;
+    }
+
+    // Only load docs for a little while at a time, so that keys (eg. Esc) still get handled.
+    const Date_t deadline = Date_t::now() + Milliseconds(kSearchStepMillis);
+    while (runningSearch->wantsMore() && Date_t::now() < deadline) {
+        if ( ! searchDocsBeforeWrapping && ! searchHasNextDoc()) {
+            searchDocsBeforeWrapping = searchBackwards ? searchStart : searchNextDoc - searchStart;
+            searchNextDoc = searchBackwards ? searchStart : 0;
+        }
+        if ( ! searchHasNextDoc()) {
+            runningSearch->finish();
+            break;
+        }
+        unsigned long first = searchNextDoc;
+        std::vector<BSONObj> docs;
+        if (searchBackwards && ! searchDocsBeforeWrapping) {
+            // (a batch at a time, reading ahead of them since the kernel won't)
+            cache.readingBackwards(searchNextDoc);
+            first = searchNextDoc - std::min<unsigned long>(searchNextDoc, BackgroundSearch::kBatchSize);
+            for (unsigned long doc = first; doc < searchNextDoc; doc++) {
+                docs.push_back(cache[doc]);
             }
+            searchNextDoc = first;
         } else {
-            // notify the user
-            status.setExtra("No search pattern");
+            while (docs.size() < BackgroundSearch::kBatchSize && searchHasNextDoc()) {
+                docs.push_back(cache[searchNextDoc++]);
+            }
+        }
+        runningSearch->add(first, std::move(docs));
+    }
+
+    // (the hits must be taken after seeing how far the search has got, so none are missed)
+    const uint64_t resolved = runningSearch->docsResolved();
+    view.addHits(runningSearch->takeMatches());
+    const uint64_t beforeWrapping = std::min(resolved, searchDocsBeforeWrapping.value_or(ULONG_MAX));
+    const unsigned long wrappedBegin = searchBackwards ? searchStart : 0;
+    view.setHitsChecked(
+        searchBackwards ? SearchHits::Range{searchStart - beforeWrapping, searchStart}
+                        : SearchHits::Range{searchStart, searchStart + beforeWrapping},
+        SearchHits::Range{wrappedBegin, wrappedBegin + (resolved - beforeWrapping)});
+
+    if (searchJumpFrom && jumpToHit(*searchJumpFrom, searchJumpBackwards)) {
+        searchJumpFrom = boost::none;
+    }
+
+    if (runningSearch->isDone()) {
+        runningSearch.reset();
+        if (searchJumpFrom) {
+            // (only if the file has grown meanwhile)
+            status.setExtra("Pattern not found");
+            searchJumpFrom = boost::none;
+        } else if (searchMarkWhenDone) {
+            reportMarkedHits(view.markHits());
+        }
+        if (jumpToEndAfterLoadingComplete) {
+            view.jumpDown();
+        }
+        view.redrawFull();
+        return 0;
+    }
+
+    if (Date_t::now() - status.getLastRenderTime() > Milliseconds(100)) {
+        const uint64_t checked = runningSearch->docsChecked();
+        const auto millis = durationCount<Milliseconds>(Date_t::now() - searchStarted);
+        // Until all the docs have been found, the best guess is how much of the file has been.
+        const double perc = cache.hasAllDocs()
+            ? 100.0 * checked / std::max(1ul, cache.numDocs())
+            : cache.percOfFileSeen();
+        str::stream progress;
+        progress << "Searching... " << static_cast<int>(perc) << "% "
+                 << (millis ? checked * 1000 / millis : 0) << " docs/s, "
+                 << view.hits().docs.size() << " found (Esc to cancel)";
+        status.setExtra(progress);
+        // (and show the hits so far)
+        view.redrawFull();
+    }
+
+    if (runningSearch->wantsMore()) {
+        // the search threads are waiting on us.
+        tickit_watch_later(t, (TickitBindFlags)0, &search_step, NULL);
+    } else {
+        tickit_watch_timer_after_msec(t, kSearchStepMillis, (TickitBindFlags)0, &search_step, NULL);
+    }
+    return 0;
+}
+
+// Find every doc that matches the last search, in the background, starting after the cursor (or
+// before it) and wrapping around, and jump to the first.
+void doSearch(bool backwards) {
+    cancelSearch();
+
+    auto lastSearch = view.getLastSearch();
+    if ( ! lastSearch) {
+        // notify the user
+        status.setExtra("No search pattern");
+        return;
+    }
+    if ( ! (*lastSearch)->isValid()) {
+        status.setExtra("Invalid search pattern");
+        return;
+    }
+
+    const Search* search = *lastSearch;
+    const DocRenderer render = view.renderer();
+    runningSearch = std::make_unique<BackgroundSearch>(
+        [search, render] { return search->predicate(render); }, BackgroundSearch::Mode::kAll);
+    const unsigned long from = view.getCursorDoc();
+    view.resetHits();
+    searchBackwards = backwards;
+    searchStart = backwards ? from : std::min(from + 1, cache.numDocs());
+    searchNextDoc = searchStart;
+    searchDocsBeforeWrapping = boost::none;
+    searchJumpFrom = from;
+    searchJumpBackwards = backwards;
+    searchMarkWhenDone = false;
+    searchStarted = Date_t::now();
+    status.setExtra("Searching...");
+    tickit_watch_later(t, (TickitBindFlags)0, &search_step, NULL);
+}
+
+// `n` and `N`: the next hit either way is often already known.
+void searchAgain(bool backwards) {
+    if ( ! view.getLastSearch()) {
+        status.setExtra("No previous search");
+        return;
+    }
+    const unsigned long from = view.getCursorDoc();
+    if (jumpToHit(from, backwards)) {
+        return;
+    }
+    if (runningSearch) {
+        searchJumpFrom = from;
+        searchJumpBackwards = backwards;
+    } else {
+        doSearch(backwards);
+    }
+}
+
+// `*`: mark every doc that matches, once they're all known.
+void markAllHits() {
+    if ( ! view.getLastSearch()) {
+        status.setExtra("No previous search");
+        return;
+    }
+    if (view.hasAllHits()) {
+        reportMarkedHits(view.markHits());
+        return;
+    }
+    if ( ! runningSearch) {
+        doSearch(lastSearchBackwards);
+        searchJumpFrom = boost::none;
+    }
+    searchMarkWhenDone = true;
+}
+
+// `&`: show only the docs that match (as they're found), or all of them again.
+void toggleFilter() {
+    if ( ! view.getLastSearch()) {
+        status.setExtra("No previous search");
+        return;
+    }
+    if ( ! view.hits().valid) {
+        doSearch(lastSearchBackwards);
+        if ( ! runningSearch) {
+            return;
         }
-    });
+        searchJumpFrom = boost::none;
+    }
+    view.toggleFilter();
+}
+
+// Text searches look at the docs as rendered, so their hits no longer apply.
+void renderingChanged() {
+    auto lastSearch = view.getLastSearch();
+    if (lastSearch && (*lastSearch)->usesRendering()) {
+        cancelSearch();
+        view.clearHits();
+    }
 }
 
 
-void submitSearchString(const std::string& s) {
+void submitSearchString(const std::string& s, bool backwards) {
     Search *search;
     // check the format (mql etc), handle appropriately
     if (s[0] == '{') {
         search = new SearchMQL(s);
+    } else if (str::startsWith(s, "re:")) {
+        search = new SearchRegex(s);
     } else {
         search = new SearchRenderedText(s);
     }
 
+    // (the running search, if any, is using the last one)
+    cancelSearch();
+
     // save the search string in history, both for n/N and up/down-arrow in search input
     view.registerSearch(search);
+    lastSearchBackwards = backwards;
+
+    doSearch(backwards);
+}
+
+void submitSearchForwards(const std::string& s) {
+    submitSearchString(s, false);
+}
+
+void submitSearchBackwards(const std::string& s) {
+    submitSearchString(s, true);
+}
+
+
+// `:project <paths>` shows only those fields of each doc, eg. `:project ts,op,o._id`.  `:project`
+// on its own shows the whole docs again.
+void commandProject(const std::string& arg) {
+    if (arg.empty()) {
+        if (view.getDocumentRenderMode() == DocRenderer::kProjected) {
+            renderingChanged();
+            view.setDocumentRenderMode(DocRenderer::kJSONOneline);
+        }
+        return;
+    }
+
+    auto swProjection = FieldProjection::parse(arg);
+    if ( ! swProjection.isOK()) {
+        status.setExtra(swProjection.getStatus().reason());
+        return;
+    }
+    renderingChanged();
+    view.setProjection(std::move(swProjection.getValue()));
+}
+
+
+// `:table` shows the docs as a table, with a column for each field of the docs at the top of the
+// screen, or with the columns given, eg. `:table ts,op,ns`.
+void commandTable(const std::string& arg) {
+    boost::optional<FieldProjection> columns;
+    if ( ! arg.empty()) {
+        auto swColumns = FieldProjection::parse(arg);
+        if ( ! swColumns.isOK()) {
+            status.setExtra(swColumns.getStatus().reason());
+            return;
+        }
+        columns = std::move(swColumns.getValue());
+    }
+    renderingChanged();
+    view.setTable(std::move(columns));
+}
+
+
+// The profile of the docs' fields in progress, if any.  stats_step() hands it all the docs
+// (loading more of the file as need be), and then shows it in the panel.
+std::unique_ptr<BackgroundFieldStats> runningStats;
+unsigned long statsNextDoc = 0;
+Date_t statsStarted;
+
+void cancelStats() {
+    // (waits for the worker threads to stop)
+    runningStats.reset();
+}
+
+static int stats_step(Tickit *t, TickitEventFlags flags, void *_info, void *data) {
+    if ( ! runningStats) {
+        return 0;
+    }
+
+    // Only load docs for a little while at a time, so that keys (eg. Esc) still get handled.
+    const Date_t deadline = Date_t::now() + Milliseconds(kSearchStepMillis);
+    while (runningStats->wantsMore() && Date_t::now() < deadline) {
+        if ( ! cache.hasDoc(statsNextDoc)) {
+            runningStats->finish();
+            break;
+        }
+        std::vector<BSONObj> docs;
+        while (docs.size() < BackgroundSearch::kBatchSize && cache.hasDoc(statsNextDoc)) {
+            docs.push_back(cache[statsNextDoc++]);
+        }
+        runningStats->add(std::move(docs));
+    }
+
+    if (runningStats->isDone()) {
+        const std::string report = runningStats->result().report();
+        runningStats.reset();
+        status.setExtra("");
+        panel.show(report);
+        return 0;
+    }
+
+    if (Date_t::now() - status.getLastRenderTime() > Milliseconds(100)) {
+        const uint64_t profiled = runningStats->docsProfiled();
+        const auto millis = durationCount<Milliseconds>(Date_t::now() - statsStarted);
+        const double perc = cache.hasAllDocs()
+            ? 100.0 * profiled / std::max(1ul, cache.numDocs())
+            : cache.percOfFileSeen();
+        str::stream progress;
+        progress << "Profiling... " << static_cast<int>(perc) << "% "
+                 << (millis ? profiled * 1000 / millis : 0) << " docs/s (Esc to cancel)";
+        status.setExtra(progress);
+    }
+
+    if (runningStats->wantsMore()) {
+        // the worker threads are waiting on us.
+        tickit_watch_later(t, (TickitBindFlags)0, &stats_step, NULL);
+    } else {
+        tickit_watch_timer_after_msec(t, kSearchStepMillis, (TickitBindFlags)0, &stats_step, NULL);
+    }
+    return 0;
+}
+
+// `:stats` profiles the fields of all the docs (or the aggregation's results), in the background,
+// and shows which paths there are, with their types, sizes, and distinct and most common values.
+void commandStats() {
+    cancelStats();
+    runningStats = std::make_unique<BackgroundFieldStats>();
+    statsNextDoc = 0;
+    statsStarted = Date_t::now();
+    status.setExtra("Profiling...");
+    tickit_watch_later(t, (TickitBindFlags)0, &stats_step, NULL);
+}
+
+
+// The sort in progress, if any.  sort_step() hands it all the docs (loading more of the file as
+// need be), and then the view shows the docs in its order.
+std::unique_ptr<SortedOrder> runningSort;
+unsigned long sortNextDoc = 0;
+Date_t sortStarted;
+
+void cancelSort() {
+    // (waits for the worker thread to stop)
+    runningSort.reset();
+}
+
+
+// Where the docs are in time, once `:time` has found which field they're in time order by, and
+// the time it's waiting to jump to (once the docs have been loaded as far as that), if any.
+std::unique_ptr<TimeIndex> timeIndex;
+boost::optional<Date_t> timeTarget;
+
+// The docs have changed (eg. another namespace is being shown), so the times are of the old ones.
+void forgetTimeIndex() {
+    timeIndex.reset();
+    timeTarget = boost::none;
+}
+
+
+// The doc, or byte of the file, that `:doc`, `:offset` or `:<n>%` is waiting to jump to, until the
+// file has been indexed that far.
+struct SeekTarget {
+    bool isOffset;
+    uint64_t value;
+};
+boost::optional<SeekTarget> seekTarget;
+
+void cancelSeek() {
+    seekTarget = boost::none;
+}
+
+// The docs are about to be replaced (or renumbered), so stop whatever is working through the old
+// ones, and forget what was found about them.
+void cancelBackgroundWork() {
+    cancelSearch();
+    cancelStats();
+    cancelSort();
+    forgetTimeIndex();
+    cancelSeek();
+}
+
+
+// The aggregation being shown, if any, is owned by the cache.  aggregate_step() feeds it the docs
+// (loading more of the file as need be), from the first to the last, until it has them all.
+unsigned long aggregationNextDoc = 0;
+Date_t aggregationStarted;
+
+// Blocking stages ($sort, $group) spill here, once they've used their memory limit.
+std::string aggregationTempDir() {
+    const char* tmp = getenv("TMPDIR");
+    return str::stream() << (tmp && *tmp ? tmp : "/tmp") << "/bv-" << getpid();
+}
+
+bool isAggregating() {
+    return cache.aggregation() && ! cache.aggregation()->isDone();
+}
+
+// Show the docs again.
+void stopAggregating() {
+    // (the search may be of the results)
+    cancelBackgroundWork();
+    // (waits for the pipeline to stop)
+    cache.stopAggregating();
+    followTail = false;
+    view.reset();
+}
+
+static int aggregate_step(Tickit *t, TickitEventFlags flags, void *_info, void *data) {
+    AggregationStream* aggregation = cache.aggregation();
+    if ( ! aggregation) {
+        return 0;
+    }
+
+    // Only load docs for a little while at a time, so that keys (eg. Esc) still get handled.
+    const Date_t deadline = Date_t::now() + Milliseconds(kSearchStepMillis);
+    while (aggregation->wantsMore() && Date_t::now() < deadline) {
+        if ( ! cache.hasSourceDoc(aggregationNextDoc)) {
+            aggregation->finish();
+            break;
+        }
+        std::vector<BSONObj> docs;
+        while (docs.size() < BackgroundSearch::kBatchSize && cache.hasSourceDoc(aggregationNextDoc)) {
+            docs.push_back(cache.sourceDoc(aggregationNextDoc++));
+        }
+        aggregation->add(std::move(docs));
+    }
+
+    if (aggregation->isDone()) {
+        const Status s = aggregation->getStatus();
+        if (s.isOK()) {
+            status.setExtra(str::stream() << "Aggregated " << aggregation->docsConsumed() << " docs into " << aggregation->numResults());
+        } else {
+            status.setExtra(str::stream() << "Aggregation failed after " << aggregation->numResults() << " results: " << s.reason());
+        }
+        view.redrawFull();
+        return 0;
+    }
+
+    if (Date_t::now() - status.getLastRenderTime() > Milliseconds(100)) {
+        const uint64_t consumed = aggregation->docsConsumed();
+        const auto millis = durationCount<Milliseconds>(Date_t::now() - aggregationStarted);
+        const double perc = cache.hasAllSourceDocs()
+            ? 100.0 * consumed / std::max(1ul, cache.numSourceDocs())
+            : cache.percOfFileSeen();
+        str::stream progress;
+        progress << "Aggregating... " << static_cast<int>(perc) << "% "
+                 << (millis ? consumed * 1000 / millis : 0) << " docs/s, "
+                 << aggregation->numResults() << " results (Esc to cancel)";
+        status.setExtra(progress);
+        // (and show the results so far)
+        view.redrawFull();
+    }
+
+    if (aggregation->wantsMore()) {
+        // the pipeline is waiting on us.
+        tickit_watch_later(t, (TickitBindFlags)0, &aggregate_step, NULL);
+    } else {
+        tickit_watch_timer_after_msec(t, kSearchStepMillis, (TickitBindFlags)0, &aggregate_step, NULL);
+    }
+    return 0;
+}
+
+// `:aggregate <pipeline>` shows the results of running the docs through an aggregation pipeline
+// (a JSON array of stages, or just one stage), as they're produced.  `:aggregate` on its own shows
+// the docs again.
+void commandAggregate(const std::string& arg) {
+    if (arg.empty()) {
+        if ( ! cache.aggregation()) {
+            status.setExtra("Not aggregating");
+            return;
+        }
+        stopAggregating();
+        return;
+    }
+
+    auto swStages = AggregationStream::parseStages(arg);
+    if ( ! swStages.isOK()) {
+        status.setExtra("Invalid pipeline: " + swStages.getStatus().reason());
+        return;
+    }
+    auto swAggregation = AggregationStream::make(getGlobalServiceContext(), swStages.getValue(), aggregationTempDir());
+    if ( ! swAggregation.isOK()) {
+        status.setExtra("Invalid pipeline: " + swAggregation.getStatus().reason());
+        return;
+    }
+
+    // (any search was of the docs being replaced)
+    cancelBackgroundWork();
+    cache.aggregate(std::move(swAggregation.getValue()));
+    aggregationNextDoc = 0;
+    aggregationStarted = Date_t::now();
+    followTail = false;
+    view.reset();
+    status.setExtra("Aggregating...");
+    tickit_watch_later(t, (TickitBindFlags)0, &aggregate_step, NULL);
+}
+
+
+static int sort_step(Tickit *t, TickitEventFlags flags, void *_info, void *data) {
+    if ( ! runningSort) {
+        return 0;
+    }
+
+    // Only load docs for a little while at a time, so that keys (eg. Esc) still get handled.
+    const Date_t deadline = Date_t::now() + Milliseconds(kSearchStepMillis);
+    bool waitingForDocs = false;
+    while (runningSort->wantsMore() && Date_t::now() < deadline) {
+        if ( ! cache.hasDoc(sortNextDoc)) {
+            // (an aggregation's results are sorted once they're all in)
+            if (isAggregating()) {
+                waitingForDocs = true;
+            } else {
+                runningSort->finish();
+            }
+            break;
+        }
+        std::vector<BSONObj> docs;
+        while (docs.size() < BackgroundSearch::kBatchSize && cache.hasDoc(sortNextDoc)) {
+            docs.push_back(cache[sortNextDoc++]);
+        }
+        runningSort->add(std::move(docs));
+    }
+
+    if (runningSort->isDone()) {
+        const Status s = runningSort->getStatus();
+        if (s.isOK()) {
+            status.setExtra(str::stream() << "Sorted " << runningSort->numDocs() << " docs" << (runningSort->usedDisk() ? " (using disk)" : ""));
+            view.setOrder(std::move(runningSort));
+        } else {
+            status.setExtra("Sort failed: " + s.reason());
+            runningSort.reset();
+        }
+        return 0;
+    }
+
+    if (Date_t::now() - status.getLastRenderTime() > Milliseconds(100)) {
+        const uint64_t keyed = runningSort->docsKeyed();
+        const auto millis = durationCount<Milliseconds>(Date_t::now() - sortStarted);
+        const double perc = cache.hasAllDocs()
+            ? 100.0 * keyed / std::max(1ul, cache.numDocs())
+            : cache.percOfFileSeen();
+        str::stream progress;
+        progress << "Sorting... " << static_cast<int>(perc) << "% "
+                 << (millis ? keyed * 1000 / millis : 0) << " docs/s (Esc to cancel)";
+        status.setExtra(progress);
+    }
+
+    if (runningSort->wantsMore() && ! waitingForDocs) {
+        // the worker thread is waiting on us.
+        tickit_watch_later(t, (TickitBindFlags)0, &sort_step, NULL);
+    } else {
+        tickit_watch_timer_after_msec(t, kSearchStepMillis, (TickitBindFlags)0, &sort_step, NULL);
+    }
+    return 0;
+}
+
+// `:sort <spec>` shows the docs (or the aggregation's results) in the order of some of their
+// fields, eg. `:sort {ts: -1}`, once they've all been sorted in the background.  `:sort` on its
+// own shows them in file order again.
+void commandSort(const std::string& arg) {
+    if (arg.empty()) {
+        if (runningSort) {
+            cancelSort();
+        } else if (view.order()) {
+            view.setOrder(nullptr);
+        } else {
+            status.setExtra("Not sorted");
+        }
+        return;
+    }
+
+    auto swSpec = SortedOrder::parseSpec(arg);
+    if ( ! swSpec.isOK()) {
+        status.setExtra("Invalid sort: " + swSpec.getStatus().reason());
+        return;
+    }
+    cancelSort();
+    // (the keys spill next to an aggregation's)
+    runningSort = std::make_unique<SortedOrder>(swSpec.getValue(), aggregationTempDir());
+    sortNextDoc = 0;
+    sortStarted = Date_t::now();
+    status.setExtra("Sorting...");
+    tickit_watch_later(t, (TickitBindFlags)0, &sort_step, NULL);
+}
+
+
+static boost::optional<Date_t> docTime(unsigned long doc) {
+    return TimeIndex::docTime(cache[doc], timeIndex->field());
+}
+
+static int time_step(Tickit *t, TickitEventFlags flags, void *_info, void *data) {
+    if ( ! timeTarget || ! timeIndex) {
+        return 0;
+    }
+
+    // Only binary search once the docs are loaded as far as the target (or the end), loading
+    // them for a little while at a time, so that keys (eg. Esc) still get handled.
+    const Date_t deadline = Date_t::now() + Milliseconds(kSearchStepMillis);
+    bool loaded = cache.hasAllDocs();
+    while ( ! loaded && Date_t::now() < deadline) {
+        const auto lastTime = cache.numDocs() ? docTime(cache.numDocs() - 1) : boost::none;
+        if (lastTime && *lastTime >= *timeTarget) {
+            loaded = true;
+        } else if ( ! cache.hasDoc(cache.numDocs() + BackgroundSearch::kBatchSize)) {
+            // (an aggregation's results may still be coming)
+            loaded = cache.hasAllDocs();
+            break;
+        }
+    }
+
+    if ( ! loaded) {
+        status.setExtra(str::stream() << "Seeking... " << static_cast<int>(cache.percOfFileSeen()) << "% (Esc to cancel)");
+        tickit_watch_timer_after_msec(t, kSearchStepMillis, (TickitBindFlags)0, &time_step, NULL);
+        return 0;
+    }
+
+    const Date_t target = *timeTarget;
+    timeTarget = boost::none;
+    const unsigned long numDocs = cache.numDocs();
+    const unsigned long doc = timeIndex->seek(target, numDocs, docTime);
+    if (doc == numDocs) {
+        const auto lastTime = docTime(numDocs - 1);
+        status.setExtra(str::stream() << "The docs end before then" << (lastTime ? ", at " + dateToISOStringUTC(*lastTime) : ""));
+        view.jumpToDoc(numDocs - 1);
+        return 0;
+    }
+    const auto time = docTime(doc);
+    status.setExtra(str::stream() << timeIndex->field() << ": " << (time ? dateToISOStringUTC(*time) : "none"));
+    view.jumpToDoc(doc);
+    return 0;
+}
+
+// `:time <date>` jumps to the first doc at or after a time, in docs that are in time order by a
+// top-level Date or Timestamp field (eg. an oplog's `ts`), eg. `:time 2019-05-21T14:32:05Z`, or
+// `:time 14:32:05` (on the same day as the doc at the cursor).  The docs are binary searched, so
+// only a few are looked at, and fewer for later jumps nearby.
+void commandTime(const std::string& arg) {
+    if (arg.empty()) {
+        status.setExtra("Usage: :time <iso-date>");
+        return;
+    }
+    if ( ! cache.hasDoc(0)) {
+        status.setExtra("No docs");
+        return;
+    }
+
+    if ( ! timeIndex) {
+        // (the docs loaded so far, spread from the first to the last)
+        const unsigned long numDocs = cache.numDocs();
+        std::vector<BSONObj> sample;
+        for (unsigned long i = 0; i < kTimeSampleDocs && i < numDocs; i++) {
+            sample.push_back(cache[numDocs <= kTimeSampleDocs ? i : i * (numDocs - 1) / (kTimeSampleDocs - 1)]);
+        }
+        auto field = TimeIndex::detectField(sample);
+        if ( ! field) {
+            status.setExtra("The docs aren't in order by a Date or Timestamp field");
+            return;
+        }
+        timeIndex = std::make_unique<TimeIndex>(*field);
+    }
+
+    // (just a time of day is on the cursor's day)
+    auto swTarget = TimeIndex::parseTarget(arg, docTime(view.getCursorDoc()));
+    if ( ! swTarget.isOK()) {
+        status.setExtra("Invalid time: " + swTarget.getStatus().reason());
+        return;
+    }
+
+    // (a seek still waiting for the docs to load just goes somewhere else)
+    const bool seeking = !! timeTarget;
+    timeTarget = swTarget.getValue();
+    if ( ! seeking) {
+        tickit_watch_later(t, (TickitBindFlags)0, &time_step, NULL);
+    }
+}
+
+
+static bool seekTargetReached() {
+    if (seekTarget->isOffset) {
+        return cache.docAtOffset(seekTarget->value) || cache.hasAllSourceDocs();
+    }
+    return cache.numDocs() > seekTarget->value || cache.hasAllDocs();
+}
+
+static int seek_step(Tickit *t, TickitEventFlags flags, void *_info, void *data) {
+    if ( ! seekTarget) {
+        return 0;
+    }
+
+    // Doc numbers (and which doc a byte is in) are only known once the file has been indexed up
+    // to there, which the indexer threads (or a sidecar index) make quick, even for the end of a
+    // big file.  This just picks up what they've found, or reads on if there are none.
+    const Date_t deadline = Date_t::now() + Milliseconds(kSearchStepMillis);
+    while ( ! seekTargetReached() && Date_t::now() < deadline) {
+        if (cache.aggregation() || cache.isIndexingInBackground()) {
+            // (aggregate_step() and the indexer threads are doing the work)
+            cache.loadSome();
+            break;
+        }
+        cache.loadSome(BackgroundSearch::kBatchSize);
+    }
+
+    if ( ! seekTargetReached()) {
+        status.setExtra(str::stream() << "Seeking... " << static_cast<int>(cache.percOfFileSeen()) << "% (Esc to cancel)");
+        tickit_watch_timer_after_msec(t, kSearchStepMillis, (TickitBindFlags)0, &seek_step, NULL);
+        return 0;
+    }
+
+    const SeekTarget target = *seekTarget;
+    seekTarget = boost::none;
+    if (cache.numDocs() == 0) {
+        status.setExtra("No docs");
+        return 0;
+    }
+    unsigned long doc = cache.numDocs() - 1;
+    if (target.isOffset) {
+        auto atOffset = cache.docAtOffset(target.value);
+        if (atOffset) {
+            doc = *atOffset;
+        }
+    } else if (target.value < cache.numDocs()) {
+        doc = target.value;
+    }
+
+    StringBuilder sb;
+    sb << "Doc " << doc;
+    if (auto offset = cache.offsetOfDoc(doc)) {
+        sb << " at 0x" << integerToHex(static_cast<unsigned long long>(*offset));
+    }
+    if (target.isOffset ? target.value >= cache.sizeOfFileSeen() : target.value >= cache.numDocs()) {
+        sb << " (the last)";
+    }
+    status.setExtra(sb.str());
+    view.jumpToDoc(doc);
+    return 0;
+}
+
+static void seekTo(SeekTarget target) {
+    // (a seek still waiting for the file to be indexed just goes somewhere else)
+    const bool seeking = !! seekTarget;
+    seekTarget = target;
+    if ( ! seeking) {
+        tickit_watch_later(t, (TickitBindFlags)0, &seek_step, NULL);
+    }
+}
+
+// `:doc <n>` jumps to the nth doc (from 0), eg. one mentioned in an error message.
+void commandDoc(const std::string& arg) {
+    unsigned long long n;
+    if ( ! NumberParser().base(10)(arg, &n).isOK()) {
+        status.setExtra("Usage: :doc <n>");
+        return;
+    }
+    seekTo({false, n});
+}
+
+// `:offset <n>` jumps to the doc containing a byte of the file, eg. `:offset 0x1f3a000`.
+void commandOffset(const std::string& arg) {
+    unsigned long long offset;
+    const bool hex = str::startsWith(arg, "0x") || str::startsWith(arg, "0X");
+    if ( ! NumberParser().base(hex ? 16 : 10)(arg, &offset).isOK()) {
+        status.setExtra("Usage: :offset <n>|0x<hex>");
+        return;
+    }
+    if (cache.aggregation()) {
+        status.setExtra("Not while aggregating");
+        return;
+    }
+    seekTo({true, offset});
+}
+
+// `:<n>%` jumps n percent of the way through the file, as in less, eg. `:50%`.
+void commandPercent(const std::string& command) {
+    double percent;
+    if ( ! NumberParser()(command.substr(0, command.size() - 1), &percent).isOK() || percent < 0 || percent > 100) {
+        status.setExtra("Usage: :<0-100>%");
+        return;
+    }
+    if (cache.aggregation()) {
+        status.setExtra("Not while aggregating");
+        return;
+    }
+    seekTo({true, static_cast<uint64_t>(cache.sizeOfFile() * percent / 100)});
+}
+
+// `:damaged` jumps to the next stretch of the file (after the cursor, wrapping around) that was
+// skipped because it isn't docs, or rather to the doc after it.
+void commandDamaged() {
+    if (cache.aggregation()) {
+        status.setExtra("Not while aggregating");
+        return;
+    }
+    const auto damaged = cache.damaged();
+    if (damaged.empty()) {
+        status.setExtra(cache.isComplete() ? "No damage found" : "No damage found so far");
+        return;
+    }
+
+    const uint64_t cursor = cache.offsetOfDoc(view.getCursorDoc()).value_or(0);
+    size_t i = 0;
+    while (i < damaged.size() && damaged[i].begin <= cursor) {
+        i++;
+    }
+    if (i == damaged.size()) {
+        i = 0;
+    }
+    const auto& range = damaged[i];
+    status.setExtra(str::stream() << "Damaged " << i + 1 << "/" << damaged.size() << ": 0x" << integerToHex(static_cast<unsigned long long>(range.begin)) << "-0x" << integerToHex(static_cast<unsigned long long>(range.end)) << " (" << range.end - range.begin << " bytes)");
+    // (the doc found after it, or the one before it if it's still being looked through)
+    auto doc = cache.docAtOffset(range.end);
+    if ( ! doc) {
+        doc = cache.docAtOffset(range.begin);
+    }
+    if (doc) {
+        view.jumpToDoc(*doc);
+    }
+}
+
+
+// `:ns` lists the namespaces in an archive, `:ns <name>` switches to one of them.
+void commandNamespace(const std::string& arg) {
+    if ( ! cache.isArchive()) {
+        status.setExtra("Not a mongodump archive");
+        return;
+    }
+
+    if (arg.empty()) {
+        const ArchiveIndex* archive = cache.archive();
+        StringBuilder sb;
+        for (size_t i = 0; i < archive->numNamespaces(); i++) {
+            const auto& ns = archive->getNamespace(i);
+            sb << (i ? ", " : "") << ns.ns() << " (" << ns.docs.size() << (ns.complete ? "" : "+") << ")";
+        }
+        status.setExtra(sb.str());
+        return;
+    }
+
+    if ( ! cache.selectNamespace(arg)) {
+        status.setExtra("No (unique) namespace " + arg);
+        return;
+    }
+    cancelBackgroundWork();
+    // (the aggregation was of the other namespace)
+    cache.stopAggregating();
+    followTail = false;
+    view.reset();
+}
 
-    doSearch();
+
+void submitCommand(const std::string& s) {
+    std::istringstream in(s);
+    std::string command;
+    std::string arg;
+    in >> command;
+    std::getline(in >> std::ws, arg);
+
+    if (command.empty()) {
+        return;
+    } else if (command == "aggregate" || command == "agg") {
+        commandAggregate(arg);
+    } else if (command == "damaged") {
+        commandDamaged();
+    } else if (command == "doc") {
+        commandDoc(arg);
+    } else if (command == "ns") {
+        commandNamespace(arg);
+    } else if (command == "offset") {
+        commandOffset(arg);
+    } else if (command == "project") {
+        commandProject(arg);
+    } else if (command == "sort") {
+        commandSort(arg);
+    } else if (command == "stats") {
+        commandStats();
+    } else if (command == "table") {
+        commandTable(arg);
+    } else if (command == "time") {
+        commandTime(arg);
+    } else if (str::endsWith(command, "%")) {
+        commandPercent(command);
+    } else {
+        status.setExtra("Unknown command " + command);
+    }
+    updateTableHeader();
 }
 
 
@@ -1609,19 +3782,49 @@ static int event_key(TickitWindow *win, TickitEventFlags flags, void *_info, voi
     if (isKey(info, 'q') || isKey(info, 'Q')/* || isKey(info, "Escape")*/) {
         tickit_stop(t);
 
+    } else if (isKey(info, "Escape")) {
+        if (runningSearch) {
+            cancelSearch();
+            status.setExtra("Search cancelled");
+        } else if (runningStats) {
+            cancelStats();
+            status.setExtra("Profiling cancelled");
+        } else if (runningSort) {
+            cancelSort();
+            status.setExtra("Sort cancelled");
+        } else if (timeTarget) {
+            timeTarget = boost::none;
+            status.setExtra("Seek cancelled");
+        } else if (seekTarget) {
+            cancelSeek();
+            status.setExtra("Seek cancelled");
+        } else if (isAggregating()) {
+            stopAggregating();
+            status.setExtra("Aggregation cancelled");
+        }
+
     } else if (isKey(info, '1')) {
-        view.setDocumentRenderMode(BSONCacheView::kJSONOneline);
+        renderingChanged();
+        view.setDocumentRenderMode(DocRenderer::kJSONOneline);
 
     } else if (isKey(info, '2')) {
-        view.setDocumentRenderMode(BSONCacheView::kJSONPretty);
+        renderingChanged();
+        view.setDocumentRenderMode(DocRenderer::kJSONPretty);
 
     } else if (isKey(info, '3')) {
-        view.setDocumentRenderMode(BSONCacheView::kToString);
+        renderingChanged();
+        view.setDocumentRenderMode(DocRenderer::kToString);
 
     } else if (isKey(info, '4')) {
-        view.setDocumentRenderMode(BSONCacheView::kTextLogs);
+        renderingChanged();
+        view.setDocumentRenderMode(DocRenderer::kTextLogs);
+
+    } else if (isKey(info, '5')) {
+        renderingChanged();
+        view.setTable(boost::none);
 
     } else if (isKey(info, 's')) {
+        renderingChanged();
         view.toggleExtendedJSONMode();
 
     } else if (isKey(info, 'h') || isKey(info, "Left")) {
@@ -1653,11 +3856,20 @@ static int event_key(TickitWindow *win, TickitEventFlags flags, void *_info, voi
         //view.moveCursorPrevDoc();
 
     } else if (isKey(info, 'g') || isKey(info, "Home")) {
+        followTail = false;
         view.jumpUp();
 
     } else if (isKey(info, 'G') || isKey(info, "End")) {
         view.jumpDown();
 
+    } else if (isKey(info, 'F')) {
+        // keep the end of the file on screen as it grows
+        followTail = ! followTail;
+        if (followTail) {
+            view.jumpDown();
+        }
+        view.redrawStatus();
+
     } else if (isKey(info, 'H')) {
         view.cursorTop();
 
@@ -1671,10 +3883,12 @@ static int event_key(TickitWindow *win, TickitEventFlags flags, void *_info, voi
         view.pageDown();
 
     } else if (isKey(info, "PageUp") || isKey(info, "C-b")) {
+        followTail = false;
         view.pageUp();
 
     } else if (isKey(info, '?')) {
-        // TODO: show online help (key reference)
+        // search backwards
+        prompt.enter("?", "", submitSearchBackwards);
 
     } else if (isKey(info, "Enter")) {
         view.toggleMarkCursorDoc();
@@ -1687,23 +3901,35 @@ static int event_key(TickitWindow *win, TickitEventFlags flags, void *_info, voi
 
     } else if (isKey(info, '/')) {
         // search forwards
-        prompt.enter("/", "", submitSearchString);
+        prompt.enter("/", "", submitSearchForwards);
 
     } else if (isKey(info, 'n')) {
-        // search forwards again
-        if (view.getLastSearch()) {
-            doSearch();
-        } else {
-            // TODO: notify user
-            status.setExtra("No previous search");
-        }
+        // search again
+        searchAgain(lastSearchBackwards);
+
+    } else if (isKey(info, 'N')) {
+        // search again, the other way
+        searchAgain( ! lastSearchBackwards);
+
+    } else if (isKey(info, '*')) {
+        // mark every doc that matches
+        markAllHits();
+
+    } else if (isKey(info, '&')) {
+        // show only the docs that match
+        toggleFilter();
 
     } else if (isKey(info, '{')) {
         // search forwards for doc
-        prompt.enter("/", "{", submitSearchString);
+        prompt.enter("/", "{", submitSearchForwards);
+
+    } else if (isKey(info, ':')) {
+        prompt.enter(":", "", submitCommand);
 
     }
 
+    updateTableHeader();
+
     return 1;
 }
 
@@ -1754,110 +3980,274 @@ static int render_main(TickitWindow *win, TickitEventFlags flags, void *_info, v
 
 
 static int event_resize(TickitWindow *root, TickitEventFlags flags, void *_info, void *data) {
-    int lines = tickit_window_lines(root);
-    int cols = tickit_window_cols(root);
-
-    tickit_window_set_geometry(mainwin, (TickitRect){ .top = 0, .left = 0, .lines = lines - 1, .cols = cols });
+    layoutWindows();
     status.resize();
     prompt.resize();
+    panel.resize();
 
     tickit_window_expose(root, NULL);
 
     return 1;
 }
 
+// Files smaller than this are quick enough to scan that saving their index isn't worthwhile.
+const size_t kMinimumSidecarFileSize = 64 * 1024 * 1024;
+
+static void save_index() {
+    if ( ! infile || cache.sizeOfFile() < kMinimumSidecarFileSize || ! cache.hasUnsavedIndex()) {
+        return;
+    }
+    Status s = cache.saveIndex(infname, SidecarIndex::identify(infile->stat(), infile->base()));
+    if ( ! s.isOK()) {
+        status.setExtra(s.reason());
+    }
+}
+
 static int load_more(Tickit *t, TickitEventFlags flags, void *_info, void *data) {
     if ( ! cache.isComplete()) {
         cache.loadSome();
         if (Date_t::now() - status.getLastRenderTime() > Milliseconds(100)) {
             view.redrawStatus();
         }
-        tickit_watch_later(t, (TickitBindFlags)0, &load_more, NULL);
+        if (cache.isIndexingInBackground()) {
+            // the indexer threads are doing the work, so just poll for their results.
+            tickit_watch_timer_after_msec(t, 20, (TickitBindFlags)0, &load_more, NULL);
+        } else {
+            tickit_watch_later(t, (TickitBindFlags)0, &load_more, NULL);
+        }
     } else {
-        if (jumpToEndAfterLoadingComplete) {
+        if (jumpToEndAfterLoadingComplete || followTail) {
             view.jumpDown();
         }
+        if ( ! followFile) {
+            // a followed file is only saved on exit, rather than every time we catch up with it.
+            save_index();
+        }
         view.redrawStatus();
     }
     return 0;
 }
 
+const int kWatchFileIntervalMillis = 100;
 
+// Notice the file growing (or being truncated) underneath us.
+static int watch_file(Tickit *t, TickitEventFlags flags, void *_info, void *data) {
+    auto swChange = input->refresh();
+    if ( ! swChange.isOK()) {
+        // stop watching, rather than repeating the error forever.
+        status.setExtra(swChange.getStatus().reason());
+        return 0;
+    }
 
-int _main(int argc, char* argv[], char** envp) {
-
-    if (argc != 2) {
-        std::cerr << "Usage: bv <bsonfile>" << std::endl;
-        std::cerr << "  Exactly one input file is supported." << std::endl;
-        return kInputFileError;
+    const bool wasLoading = ! cache.isComplete();
+    switch (swChange.getValue()) {
+        case MappedFile::Change::kNone:
+            break;
+        case MappedFile::Change::kGrew:
+            cache.extend(input->end());
+            break;
+        case MappedFile::Change::kTruncated:
+            // the docs are about to be renumbered.
+            cancelBackgroundWork();
+            if (cache.aggregation()) {
+                stopAggregating();
+            }
+            cache.truncate(input->end());
+            view.clampToDocs();
+            status.setExtra("File truncated");
+            break;
+    }
+    if ( ! wasLoading && ! cache.isComplete()) {
+        tickit_watch_later(t, (TickitBindFlags)0, &load_more, NULL);
     }
 
-    infname = argv[1];
+    tickit_watch_timer_after_msec(t, kWatchFileIntervalMillis, (TickitBindFlags)0, &watch_file, NULL);
+    return 0;
+}
 
-    // Check that the file's fd is a regular file, no pipes or funny business.
-    struct stat sb;
-    if (::stat(infname, &sb) == -1) {
-        int res = errno;
-        std::cerr << "bv: Error: Unable to stat input file '" << infname << "': " << errnoWithDescription(res) << std::endl;
-        return kInputFileError;
+
+
+// Parses a number of bytes, with an optional K/M/G/T suffix (eg. "512M").
+static boost::optional<uint64_t> parseSize(const char* s) {
+    char* end;
+    errno = 0;
+    const unsigned long long n = strtoull(s, &end, 10);
+    if (end == s || errno != 0) {
+        return boost::none;
     }
-    if ((sb.st_mode & S_IFMT) != S_IFREG) {
-        std::cerr << "bv: Error: Input file '" << infname << "' is not a regular file." << std::endl;
-        return kInputFileError;
+    int shift = 0;
+    switch (toupper(*end)) {
+        case 'K': shift = 10; end++; break;
+        case 'M': shift = 20; end++; break;
+        case 'G': shift = 30; end++; break;
+        case 'T': shift = 40; end++; break;
     }
-
-    // Open the file.
-    const int fd = ::open(infname, O_RDONLY);
-    if (fd == -1) {
-        int res = errno;
-        std::cerr << "bv: Error: Unable to open input file '" << infname << "': " << errnoWithDescription(res) << std::endl;
-        return kInputFileError;
+    if (*end != '\0') {
+        return boost::none;
     }
+    return uint64_t(n) << shift;
+}
 
-    // Double check that the file's fd is a regular file, no pipes or funny business.
-    if (::fstat(fd, &sb) == -1) {
-        int res = errno;
-        std::cerr << "bv: Error: Unable to fstat input file '" << infname << "': " << errnoWithDescription(res) << std::endl;
-        return kInputFileError;
+// Waits for the first doc, so there's something to show.
+void waitForFirstDoc(StreamStorage* stream) {
+    stream->waitFor(4);
+    if (stream->size() >= 4) {
+        const uint32_t firstDocSize = ConstDataView(stream->base()).read<LittleEndian<uint32_t>>();
+        stream->waitFor(std::min<uint64_t>(firstDocSize, BSONObjMaxInternalSize));
     }
-    if ((sb.st_mode & S_IFMT) != S_IFREG) {
-        std::cerr << "bv: Error: Input file '" << infname << "' is not a regular file." << std::endl;
-        return kInputFileError;
+}
+
+// `--stats`: the same as `:stats`, but printed, without the UI.
+static void printStats() {
+    BackgroundFieldStats stats;
+    unsigned long next = 0;
+    while (cache.hasDoc(next)) {
+        std::vector<BSONObj> docs;
+        while (docs.size() < BackgroundSearch::kBatchSize && cache.hasDoc(next)) {
+            docs.push_back(cache[next++]);
+        }
+        stats.waitUntilWantsMore();
+        stats.add(std::move(docs));
     }
+    stats.finish();
+    stats.waitUntilDone();
+    std::cout << stats.result().report();
+}
 
-    // TODO: notice if the length of the file increases, and remap.  this will allow running on files that are currently downloading/uncompressing.
-    // TODO: notice if the length of the file decreases, and abort.
-    void* fbase = ::mmap(NULL, sb.st_size, PROT_READ, MAP_SHARED, fd, 0);
-    if (fbase == MAP_FAILED) {
-        int res = errno;
-        std::cerr << "bv: Error: Unable to mmap input file '" << infname << "': " << errnoWithDescription(res) << std::endl;
-        return kInputFileError;
+int _main(int argc, char* argv[], char** envp) {
+
+    // By default, a file can use up to a quarter of RAM before pages start being dropped.
+    uint64_t residentBudget = uint64_t(sysconf(_SC_PHYS_PAGES)) * sysconf(_SC_PAGESIZE) / 4;
+
+    bool ftdc = false;
+    bool statsOnly = false;
+
+    int argi = 1;
+    for ( ; argi < argc && argv[argi][0] == '-' && argv[argi][1] != '\0'; argi++) {
+        if (strcmp(argv[argi], "-f") == 0 || strcmp(argv[argi], "--follow") == 0) {
+            followFile = true;
+            followTail = true;
+        } else if (strcmp(argv[argi], "--ftdc") == 0) {
+            ftdc = true;
+        } else if (strcmp(argv[argi], "--stats") == 0) {
+            statsOnly = true;
+        } else if ((strcmp(argv[argi], "-m") == 0 || strcmp(argv[argi], "--max-resident") == 0) && argi + 1 < argc && parseSize(argv[argi + 1])) {
+            residentBudget = *parseSize(argv[++argi]);
+        } else {
+            argi = argc;
+            break;
+        }
     }
 
-#if _POSIX_C_SOURCE >= 200112L
-    if (::posix_madvise(fbase, sb.st_size, POSIX_MADV_WILLNEED) != 0) {
-        int res = errno;
-        std::cerr << "bv: Error: Unable to posix_madvise input file '" << infname << "': " << errnoWithDescription(res) << std::endl;
+    if (argc - argi != 1) {
+        std::cerr << "Usage: bv [-f] [-m <size>] [--ftdc] [--stats] <bsonfile>" << std::endl;
+        std::cerr << "  Exactly one input file is supported.  Use - for stdin." << std::endl;
+        std::cerr << "  gzip, zstd and (framed) snappy files are decompressed as they're read." << std::endl;
+        std::cerr << "  -f, --follow  Keep reading the file as it grows, like `tail -f`." << std::endl;
+        std::cerr << "  -m, --max-resident <size>  Keep at most this much of the file in memory (eg. 512M, 4G, or 0 for no limit).  Default is a quarter of RAM." << std::endl;
+        std::cerr << "  --ftdc  Show the samples in an FTDC file (diagnostic.data/metrics.*), or in all the FTDC files in a directory." << std::endl;
+        std::cerr << "  --stats  Print a profile of the fields in the docs (paths, types, sizes, distinct and common values), rather than showing them." << std::endl;
         return kInputFileError;
     }
-#endif
-#if _DEFAULT_SOURCE
-    if (::madvise(fbase, sb.st_size, MADV_DONTDUMP) != 0) {
-        int res = errno;
-        std::cerr << "bv: Error: Unable to madvise input file '" << infname << "': " << errnoWithDescription(res) << std::endl;
-        return kInputFileError;
+
+    infname = argv[argi];
+
+    struct stat st;
+    const bool fromStdin = strcmp(infname, "-") == 0;
+    const bool fromDirectory = ftdc && ! fromStdin && ::stat(infname, &st) == 0 && S_ISDIR(st.st_mode);
+    if (fromDirectory) {
+        // The files of a diagnostic.data directory, one after the other.
+        auto swFiles = listFTDCFiles(infname);
+        if ( ! swFiles.isOK()) {
+            std::cerr << "bv: Error: " << swFiles.getStatus().reason() << std::endl;
+            return kInputFileError;
+        }
+        auto swStream = StreamStorage::open(std::move(swFiles.getValue()), residentBudget);
+        if ( ! swStream.isOK()) {
+            std::cerr << "bv: Error: " << swStream.getStatus().reason() << std::endl;
+            return kInputFileError;
+        }
+        waitForFirstDoc(swStream.getValue().get());
+        input = std::move(swStream.getValue());
+
+    } else if (fromStdin) {
+        infname = "<stdin>";
+
+        // tickit wants the terminal on stdin, so read the input from a copy of it.
+        const int inputFd = ::dup(STDIN_FILENO);
+        const int ttyFd = ::open("/dev/tty", O_RDWR);
+        if (inputFd == -1 || ttyFd == -1 || ::dup2(ttyFd, STDIN_FILENO) == -1) {
+            int res = errno;
+            std::cerr << "bv: Error: Unable to open the terminal for input: " << errnoWithDescription(res) << std::endl;
+            return kTermError;
+        }
+        ::close(ttyFd);
+
+        auto swStream = StreamStorage::open(inputFd, residentBudget);
+        if ( ! swStream.isOK()) {
+            std::cerr << "bv: Error: " << swStream.getStatus().reason() << std::endl;
+            return kInputFileError;
+        }
+
+        waitForFirstDoc(swStream.getValue().get());
+        input = std::move(swStream.getValue());
+
+    } else {
+        auto swFile = MappedFile::open(infname, followFile, residentBudget);
+        if ( ! swFile.isOK()) {
+            std::cerr << "bv: Error: " << swFile.getStatus().reason() << std::endl;
+            return kInputFileError;
+        }
+        const CompressionFormat format = detectCompression(swFile.getValue()->base(), swFile.getValue()->end());
+        if (format == CompressionFormat::kNone) {
+            infile = swFile.getValue().get();
+            input = std::move(swFile.getValue());
+        } else {
+            // Decompressed as a stream, which (like stdin) has no sidecar index and can't be followed.
+            if (followFile) {
+                std::cerr << "bv: Error: Unable to follow a " << compressionFormatName(format) << " compressed file" << std::endl;
+                return kInputFileError;
+            }
+            auto swStream = StreamStorage::open(makeDecompressor(format, std::move(swFile.getValue())), residentBudget);
+            if ( ! swStream.isOK()) {
+                std::cerr << "bv: Error: " << swStream.getStatus().reason() << std::endl;
+                return kInputFileError;
+            }
+            waitForFirstDoc(swStream.getValue().get());
+            input = std::move(swStream.getValue());
+        }
     }
-#endif
 
-    const char* base = static_cast<const char*>(fbase);
+    const bool isArchive = ! ftdc && ArchiveIndex::isArchive(input->base(), input->end());
+    auto swSidecar = infile && ! isArchive ? SidecarIndex::open(infname, SidecarIndex::identify(infile->stat(), infile->base()), infile->base())
+                                           : StatusWith<std::unique_ptr<SidecarIndex>>(ErrorCodes::FileNotOpen, "No sidecar index");
 
     try {
-        cache.init(base, base + sb.st_size);
+        if (isArchive) {
+            cache.initArchive(input.get());
+        } else if (swSidecar.isOK()) {
+            cache.init(input.get(), std::move(swSidecar.getValue()));
+        } else {
+            cache.init(input.get());
+        }
+        if (cache.numDocs() == 0 && ! followFile && ! isArchive) {
+            uasserted(ErrorCodes::InvalidBSON, "No whole document at the start of the file");
+        }
+        if (ftdc) {
+            cache.showFTDCSamples();
+        }
     } catch (mongo::DBException& e) {
         std::cerr << "bv: Error: Unable to read/parse first document from input file '" << infname << "', is this a BSON file?" << std::endl;
         throw;
     }
 
+    cache.startBackgroundIndexing();
+
+    if (statsOnly) {
+        printStats();
+        return 0;
+    }
+
     t = tickit_new_stdio();
 
     root = tickit_get_rootwin(t);
@@ -1874,6 +4264,10 @@ int _main(int argc, char* argv[], char** envp) {
     mainwin = tickit_window_new(root, (TickitRect){ .top = 0, .left = 0, .lines = lines - 1, .cols = cols }, (TickitWindowFlags)0);
     tickit_window_bind_event(mainwin, TICKIT_WINDOW_ON_EXPOSE, (TickitBindFlags)0, &render_main, NULL);
 
+    headerwin = tickit_window_new(root, (TickitRect){ .top = 0, .left = 0, .lines = 1, .cols = cols }, (TickitWindowFlags)0);
+    tickit_window_bind_event(headerwin, TICKIT_WINDOW_ON_EXPOSE, (TickitBindFlags)0, &render_header, NULL);
+    tickit_window_hide(headerwin);
+
     tickit_window_bind_event(mainwin, TICKIT_WINDOW_ON_KEY, (TickitBindFlags)0, &event_key, NULL);
     tickit_window_bind_event(mainwin, TICKIT_WINDOW_ON_MOUSE, (TickitBindFlags)0, &event_mouse, NULL);
 
@@ -1883,15 +4277,27 @@ int _main(int argc, char* argv[], char** envp) {
 
     prompt.init(root, mainwin);
 
+    panel.init(root, mainwin);
+
     tickit_window_bind_event(root, TICKIT_WINDOW_ON_GEOMCHANGE, (TickitBindFlags)0, &event_resize, NULL);
 
     tickit_window_take_focus(mainwin);
     tickit_window_set_cursor_visible(mainwin, false);
 
     tickit_watch_later(t, (TickitBindFlags)0, &load_more, NULL);
+    tickit_watch_timer_after_msec(t, kWatchFileIntervalMillis, (TickitBindFlags)0, &watch_file, NULL);
 
     tickit_run(t);
 
+    cancelSearch();
+    cancelStats();
+    cancelSort();
+    cache.stopAggregating();
+
+    if (followFile) {
+        save_index();
+    }
+
     return 0;
 }
 
@@ -1908,6 +4314,10 @@ void tickitDone() {
 }
 
 int main(int argc, char* argv[], char** envp) {
+    // (for the aggregation stages, which register themselves as initializers)
+    runGlobalInitializersOrDie(argc, argv, envp);
+    setGlobalServiceContext(ServiceContext::make());
+
     int returnCode;
     try {
         returnCode = _main(argc, argv, envp);
@@ -0,0 +1,330 @@
+/**
+ *    Copyright (C) 2019-present MongoDB, Inc.
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the Server Side Public License, version 1,
+ *    as published by MongoDB, Inc.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    Server Side Public License for more details.
+ *
+ *    You should have received a copy of the Server Side Public License
+ *    along with this program. If not, see
+ *    <http://www.mongodb.com/licensing/server-side-public-license>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the Server Side Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/bsonview/mapped_file.h"
+
+#include <csignal>
+#include <fcntl.h>
+#include <sys/inotify.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "mongo/util/assert_util.h"
+#include "mongo/util/errno_util.h"
+#include "mongo/util/str.h"
+
+namespace mongo {
+
+namespace {
+
+// When inotify is watching the file, still stat it this often (in calls to refresh()), in case
+// the filesystem doesn't report changes (eg. NFS).
+constexpr uint64_t kRefreshesPerForcedStat = 10;
+
+// The address range of the (only) MappedFile, for the SIGBUS handler.
+char* volatile gMappingBase = nullptr;
+volatile uint64_t gMappingLength = 0;
+uint64_t gPageSize = 0;
+volatile sig_atomic_t gSawTruncation = 0;
+
+/**
+ * Touching a page of a MAP_SHARED mapping which is past the end of the file raises SIGBUS.  If
+ * that page is ours then the file was truncated, so replace the page with zeroes and let the
+ * access be retried.  refresh() will notice the truncation properly later.
+ */
+void handleSigbus(int, siginfo_t* info, void*) {
+    char* addr = static_cast<char*>(info->si_addr);
+    char* base = gMappingBase;
+    if (base && addr >= base && addr < base + gMappingLength) {
+        void* page = reinterpret_cast<void*>(reinterpret_cast<uintptr_t>(addr) & ~(gPageSize - 1));
+        if (mmap(page, gPageSize, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0) !=
+            MAP_FAILED) {
+            gSawTruncation = 1;
+            return;
+        }
+    }
+    // Not ours, so let the retried access get the default behaviour.
+    signal(SIGBUS, SIG_DFL);
+}
+
+void installSigbusHandler() {
+    struct sigaction sa = {};
+    sa.sa_sigaction = &handleSigbus;
+    sa.sa_flags = SA_SIGINFO;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGBUS, &sa, nullptr);
+}
+
+uint64_t roundUpToPage(uint64_t n) {
+    return (n + gPageSize - 1) & ~(gPageSize - 1);
+}
+
+bool isRegularFile(const struct stat& sb) {
+    return (sb.st_mode & S_IFMT) == S_IFREG;
+}
+
+}  // namespace
+
+MappedFile::~MappedFile() {
+    gMappingBase = nullptr;
+    gMappingLength = 0;
+    if (_base) {
+        munmap(_base, _reserved);
+    }
+    if (_inotifyFd >= 0) {
+        ::close(_inotifyFd);
+    }
+    if (_fd >= 0) {
+        ::close(_fd);
+    }
+}
+
+StatusWith<std::unique_ptr<MappedFile>> MappedFile::open(const std::string& path,
+                                                         bool follow,
+                                                         uint64_t residentBudget) {
+    invariant(!gMappingBase);
+    gPageSize = sysconf(_SC_PAGESIZE);
+
+    std::unique_ptr<MappedFile> file(new MappedFile());
+    file->_path = path;
+    file->_follow = follow;
+    file->setResidentBudget(residentBudget);
+
+    // Check that the file is a regular file, no pipes or funny business.
+    struct stat sb;
+    if (::stat(path.c_str(), &sb) == -1) {
+        auto errorString = errnoWithDescription();
+        return {ErrorCodes::FileNotOpen,
+                str::stream() << "Unable to stat input file '" << path << "': " << errorString};
+    }
+    if (!isRegularFile(sb)) {
+        return {ErrorCodes::FileNotOpen,
+                str::stream() << "Input file '" << path << "' is not a regular file."};
+    }
+
+    file->_fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (file->_fd == -1) {
+        auto errorString = errnoWithDescription();
+        return {ErrorCodes::FileNotOpen,
+                str::stream() << "Unable to open input file '" << path << "': " << errorString};
+    }
+
+    // Double check that the file's fd is a regular file.
+    if (::fstat(file->_fd, &sb) == -1) {
+        auto errorString = errnoWithDescription();
+        return {ErrorCodes::FileNotOpen,
+                str::stream() << "Unable to fstat input file '" << path << "': " << errorString};
+    }
+    if (!isRegularFile(sb)) {
+        return {ErrorCodes::FileNotOpen,
+                str::stream() << "Input file '" << path << "' is not a regular file."};
+    }
+    file->_stat = sb;
+    file->_size = sb.st_size;
+
+    if (follow) {
+        // Reserve the address space, and map the file into the start of it.
+        if (file->_size > kFollowReservation) {
+            return {ErrorCodes::FileNotOpen,
+                    str::stream() << "Input file '" << path << "' is too large to follow."};
+        }
+        void* reservation = mmap(nullptr,
+                                 kFollowReservation,
+                                 PROT_NONE,
+                                 MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE,
+                                 -1,
+                                 0);
+        if (reservation == MAP_FAILED) {
+            auto errorString = errnoWithDescription();
+            return {ErrorCodes::FileNotOpen,
+                    str::stream() << "Unable to reserve address space for input file '" << path
+                                  << "': " << errorString};
+        }
+        file->_base = static_cast<char*>(reservation);
+        file->_reserved = kFollowReservation;
+
+        // Without inotify, refresh() falls back to polling.
+        file->_inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (file->_inotifyFd >= 0 &&
+            inotify_add_watch(file->_inotifyFd,
+                              path.c_str(),
+                              IN_MODIFY | IN_ATTRIB | IN_CLOSE_WRITE | IN_MOVE_SELF |
+                                  IN_DELETE_SELF) < 0) {
+            ::close(file->_inotifyFd);
+            file->_inotifyFd = -1;
+        }
+    } else {
+        void* mapping = mmap(nullptr, file->_size, PROT_READ, MAP_SHARED, file->_fd, 0);
+        if (mapping == MAP_FAILED) {
+            auto errorString = errnoWithDescription();
+            return {ErrorCodes::FileNotOpen,
+                    str::stream() << "Unable to mmap input file '" << path << "': "
+                                  << errorString};
+        }
+        file->_base = static_cast<char*>(mapping);
+        file->_reserved = roundUpToPage(file->_size);
+        file->_mapped = file->_reserved;
+    }
+
+    if (follow) {
+        Status s = file->_mapRange(0, roundUpToPage(file->_size));
+        if (!s.isOK()) {
+            return s;
+        }
+    }
+    Status s = file->_advise(0, file->_mapped);
+    if (!s.isOK()) {
+        return s;
+    }
+
+    gMappingBase = file->_base;
+    gMappingLength = file->_reserved;
+    installSigbusHandler();
+
+    return {std::move(file)};
+}
+
+Status MappedFile::_mapRange(uint64_t from, uint64_t to) {
+    if (from < to) {
+        if (mmap(_base + from, to - from, PROT_READ, MAP_SHARED | MAP_FIXED, _fd, from) ==
+            MAP_FAILED) {
+            auto errorString = errnoWithDescription();
+            return {ErrorCodes::FileNotOpen,
+                    str::stream() << "Unable to mmap input file '" << _path << "': "
+                                  << errorString};
+        }
+    }
+    _mapped = to;
+    return Status::OK();
+}
+
+Status MappedFile::_advise(uint64_t from, uint64_t to) {
+    if (from >= to) {
+        return Status::OK();
+    }
+#if _POSIX_C_SOURCE >= 200112L
+    // Read everything in if it'll all fit, otherwise just read ahead of the indexer.
+    const int advice = fitsBudget() ? POSIX_MADV_WILLNEED : POSIX_MADV_SEQUENTIAL;
+    if (::posix_madvise(_base + from, to - from, advice) != 0) {
+        auto errorString = errnoWithDescription();
+        return {ErrorCodes::FileNotOpen,
+                str::stream() << "Unable to posix_madvise input file '" << _path
+                              << "': " << errorString};
+    }
+#endif
+#if _DEFAULT_SOURCE
+    if (::madvise(_base + from, to - from, MADV_DONTDUMP) != 0) {
+        auto errorString = errnoWithDescription();
+        return {ErrorCodes::FileNotOpen,
+                str::stream() << "Unable to madvise input file '" << _path << "': "
+                              << errorString};
+    }
+#endif
+    return Status::OK();
+}
+
+void MappedFile::_zeroRange(uint64_t from, uint64_t to) {
+    if (from < to) {
+        mmap(_base + from, to - from, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0);
+    }
+}
+
+bool MappedFile::_shouldStat() {
+    if (_inotifyFd < 0) {
+        return true;
+    }
+
+    bool sawEvent = false;
+    char buf[4096];
+    while (::read(_inotifyFd, buf, sizeof(buf)) > 0) {
+        sawEvent = true;
+    }
+    if (sawEvent || ++_refreshesSinceStat >= kRefreshesPerForcedStat) {
+        _refreshesSinceStat = 0;
+        return true;
+    }
+    return false;
+}
+
+StatusWith<MappedFile::Change> MappedFile::refresh() {
+    const bool sawTruncation = gSawTruncation;
+    if (!sawTruncation && !_shouldStat()) {
+        return Change::kNone;
+    }
+    gSawTruncation = 0;
+
+    struct stat sb;
+    if (::fstat(_fd, &sb) == -1) {
+        auto errorString = errnoWithDescription();
+        return {ErrorCodes::FileStreamFailed,
+                str::stream() << "Unable to fstat input file '" << _path << "': "
+                              << errorString};
+    }
+    const uint64_t newSize = sb.st_size;
+
+    if (sawTruncation || newSize < _size) {
+        // Pages zeroed by the SIGBUS handler may be back in the file, so map all of it afresh.
+        // Without a reservation, the mapping can only shrink.
+        const uint64_t oldMapped = _mapped;
+        const uint64_t newMapped =
+            std::min(roundUpToPage(newSize), _follow ? _reserved : oldMapped);
+        Status s = _mapRange(0, newMapped);
+        if (!s.isOK()) {
+            return s;
+        }
+        _zeroRange(newMapped, oldMapped);
+        _size = _follow ? std::min(newSize, _reserved) : std::min(newSize, _size);
+        _stat = sb;
+        return Change::kTruncated;
+    }
+
+    if (newSize > _size && _follow) {
+        if (newSize > _reserved) {
+            return {ErrorCodes::FileStreamFailed,
+                    str::stream() << "Input file '" << _path << "' is too large to follow."};
+        }
+        const uint64_t oldMapped = _mapped;
+        Status s = _mapRange(oldMapped, roundUpToPage(newSize));
+        if (s.isOK()) {
+            s = _advise(oldMapped, _mapped);
+        }
+        if (!s.isOK()) {
+            return s;
+        }
+        _size = newSize;
+        _stat = sb;
+        return Change::kGrew;
+    }
+
+    return Change::kNone;
+}
+
+}  // namespace mongo
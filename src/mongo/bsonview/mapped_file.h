@@ -0,0 +1,114 @@
+/**
+ *    Copyright (C) 2019-present MongoDB, Inc.
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the Server Side Public License, version 1,
+ *    as published by MongoDB, Inc.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    Server Side Public License for more details.
+ *
+ *    You should have received a copy of the Server Side Public License
+ *    along with this program. If not, see
+ *    <http://www.mongodb.com/licensing/server-side-public-license>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the Server Side Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <sys/stat.h>
+
+#include "mongo/base/status_with.h"
+#include "mongo/bsonview/storage.h"
+
+namespace mongo {
+
+/**
+ * A read-only mapping of a regular file.
+ *
+ * When following, enough address space is reserved up front that the mapping can be extended in
+ * place as the file grows, so that base() never changes and pointers into the file stay valid.
+ *
+ * If the file is truncated, the lost pages are replaced with zeroes rather than left to raise
+ * SIGBUS, including when they are touched before refresh() has noticed the truncation.  Only
+ * one MappedFile may exist at a time.
+ */
+class MappedFile : public BSONStorage {
+public:
+    // Largest file that can be followed.  Costs nothing but address space.
+    static constexpr uint64_t kFollowReservation = 1ULL << 40;
+
+    ~MappedFile();
+
+    /**
+     * See BSONStorage for what `residentBudget` does.
+     */
+    static StatusWith<std::unique_ptr<MappedFile>> open(const std::string& path,
+                                                        bool follow,
+                                                        uint64_t residentBudget = 0);
+
+    const char* base() const override {
+        return _base;
+    }
+
+    uint64_t size() const override {
+        return _size;
+    }
+
+    const struct stat& stat() const {
+        return _stat;
+    }
+
+    bool isFollowing() const {
+        return _follow;
+    }
+
+    /**
+     * Checks whether the file has changed size, and adjusts the mapping to match.  Growth is only
+     * mapped when following.  Cheap enough to call frequently: when inotify is available, the
+     * file is only stat'd after it reports a change (or occasionally, in case it can't see
+     * changes on this filesystem).
+     */
+    StatusWith<Change> refresh() override;
+
+private:
+    MappedFile() = default;
+
+    Status _mapRange(uint64_t from, uint64_t to);
+    Status _advise(uint64_t from, uint64_t to);
+    void _zeroRange(uint64_t from, uint64_t to);
+    bool _shouldStat();
+
+    std::string _path;
+    int _fd = -1;
+    int _inotifyFd = -1;
+    bool _follow = false;
+
+    char* _base = nullptr;
+    // Size of the address range at _base (the reservation, when following).
+    uint64_t _reserved = 0;
+    // Bytes at _base which are mapped from the file, a multiple of the page size.
+    uint64_t _mapped = 0;
+    uint64_t _size = 0;
+    struct stat _stat = {};
+
+    uint64_t _refreshesSinceStat = 0;
+};
+
+}  // namespace mongo
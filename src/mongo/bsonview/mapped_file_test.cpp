@@ -0,0 +1,147 @@
+/**
+ *    Copyright (C) 2019-present MongoDB, Inc.
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the Server Side Public License, version 1,
+ *    as published by MongoDB, Inc.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    Server Side Public License for more details.
+ *
+ *    You should have received a copy of the Server Side Public License
+ *    along with this program. If not, see
+ *    <http://www.mongodb.com/licensing/server-side-public-license>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the Server Side Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include <fcntl.h>
+#include <string>
+#include <unistd.h>
+
+#include "mongo/bsonview/mapped_file.h"
+#include "mongo/unittest/temp_dir.h"
+#include "mongo/unittest/unittest.h"
+
+namespace mongo {
+namespace {
+
+void appendToFile(const std::string& path, size_t len, char c) {
+    const std::string data(len, c);
+    int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+    ASSERT_GTE(fd, 0);
+    ASSERT_EQ(::write(fd, data.data(), data.size()), ssize_t(data.size()));
+    ::close(fd);
+}
+
+TEST(MappedFileTest, Open) {
+    unittest::TempDir dir("mapped_file_test");
+    const std::string path = dir.path() + "/data";
+    appendToFile(path, 100, 'a');
+
+    auto swFile = MappedFile::open(path, false);
+    ASSERT_OK(swFile.getStatus());
+    auto& file = swFile.getValue();
+    ASSERT_EQ(file->size(), 100U);
+    ASSERT_EQ(file->base()[99], 'a');
+
+    // Growth isn't picked up unless following.
+    appendToFile(path, 100, 'b');
+    auto swChange = file->refresh();
+    ASSERT_OK(swChange.getStatus());
+    ASSERT(swChange.getValue() == MappedFile::Change::kNone);
+    ASSERT_EQ(file->size(), 100U);
+}
+
+TEST(MappedFileTest, NotARegularFile) {
+    unittest::TempDir dir("mapped_file_test");
+    ASSERT_NOT_OK(MappedFile::open(dir.path(), false).getStatus());
+    ASSERT_NOT_OK(MappedFile::open(dir.path() + "/missing", true).getStatus());
+}
+
+TEST(MappedFileTest, FollowGrowth) {
+    unittest::TempDir dir("mapped_file_test");
+    const std::string path = dir.path() + "/data";
+    appendToFile(path, 100, 'a');
+
+    auto swFile = MappedFile::open(path, true);
+    ASSERT_OK(swFile.getStatus());
+    auto& file = swFile.getValue();
+    const char* base = file->base();
+
+    appendToFile(path, 100000, 'b');
+    auto swChange = file->refresh();
+    ASSERT_OK(swChange.getStatus());
+    ASSERT(swChange.getValue() == MappedFile::Change::kGrew);
+    ASSERT_EQ(file->size(), 100100U);
+    ASSERT_EQ(file->base(), base);
+    ASSERT_EQ(base[99], 'a');
+    ASSERT_EQ(base[100099], 'b');
+
+    swChange = file->refresh();
+    ASSERT_OK(swChange.getStatus());
+    ASSERT(swChange.getValue() == MappedFile::Change::kNone);
+}
+
+TEST(MappedFileTest, FollowEmptyFile) {
+    unittest::TempDir dir("mapped_file_test");
+    const std::string path = dir.path() + "/data";
+    appendToFile(path, 0, 'a');
+
+    auto swFile = MappedFile::open(path, true);
+    ASSERT_OK(swFile.getStatus());
+    auto& file = swFile.getValue();
+    ASSERT_EQ(file->size(), 0U);
+
+    appendToFile(path, 10, 'a');
+    auto swChange = file->refresh();
+    ASSERT_OK(swChange.getStatus());
+    ASSERT(swChange.getValue() == MappedFile::Change::kGrew);
+    ASSERT_EQ(file->base()[9], 'a');
+}
+
+TEST(MappedFileTest, Truncation) {
+    unittest::TempDir dir("mapped_file_test");
+    const std::string path = dir.path() + "/data";
+    appendToFile(path, 1024 * 1024, 'a');
+
+    auto swFile = MappedFile::open(path, true);
+    ASSERT_OK(swFile.getStatus());
+    auto& file = swFile.getValue();
+
+    ASSERT_EQ(::truncate(path.c_str(), 10), 0);
+
+    // Reading the lost part before refresh() has noticed gets zeroes, rather than SIGBUS.
+    ASSERT_EQ(file->base()[1024 * 1024 - 1], 0);
+
+    auto swChange = file->refresh();
+    ASSERT_OK(swChange.getStatus());
+    ASSERT(swChange.getValue() == MappedFile::Change::kTruncated);
+    ASSERT_EQ(file->size(), 10U);
+    ASSERT_EQ(file->base()[9], 'a');
+    ASSERT_EQ(file->base()[512 * 1024], 0);
+
+    // And it can grow again afterwards.
+    appendToFile(path, 1024 * 1024, 'b');
+    swChange = file->refresh();
+    ASSERT_OK(swChange.getStatus());
+    ASSERT(swChange.getValue() == MappedFile::Change::kGrew);
+    ASSERT_EQ(file->base()[512 * 1024], 'b');
+}
+
+}  // namespace
+}  // namespace mongo
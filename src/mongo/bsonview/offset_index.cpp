@@ -0,0 +1,400 @@
+/**
+ *    Copyright (C) 2019-present MongoDB, Inc.
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the Server Side Public License, version 1,
+ *    as published by MongoDB, Inc.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    Server Side Public License for more details.
+ *
+ *    You should have received a copy of the Server Side Public License
+ *    along with this program. If not, see
+ *    <http://www.mongodb.com/licensing/server-side-public-license>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the Server Side Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/bsonview/offset_index.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "mongo/base/data_range_cursor.h"
+#include "mongo/db/ftdc/varint.h"
+#include "mongo/platform/overflow_arithmetic.h"
+#include "mongo/util/assert_util.h"
+#include "mongo/util/str.h"
+
+namespace mongo {
+
+namespace {
+
+// Enough for the smallest gap plus kDocsPerBlock - 1 gap residuals.
+constexpr size_t kMaxEncodedBlockSize =
+    DocumentOffsetIndex::kDocsPerBlock * FTDCVarInt::kMaxSizeBytes64;
+
+size_t alignedSize(size_t len) {
+    return (len + 7) & ~size_t(7);
+}
+
+}  // namespace
+
+void DocumentOffsetIndex::append(uint64_t offset) {
+    if (!empty()) {
+        invariant(offset > back());
+    }
+
+    _tail[_tailSize++] = offset;
+    if (_tailSize == kDocsPerBlock) {
+        _encodeTail();
+    }
+}
+
+void DocumentOffsetIndex::_ensureOwned() {
+    if (!_isView) {
+        return;
+    }
+
+    _ownedBlocks.assign(_blocks, _blocks + _blockCount);
+    _blocks = _ownedBlocks.data();
+
+    _ownedPages.clear();
+    for (size_t i = 0; i < _pages.size(); i++) {
+        _ownedPages.push_back(std::make_unique<char[]>(kPageSize));
+        const size_t used = (i == _pages.size() - 1) ? _pageUsed : kPageSize;
+        memcpy(_ownedPages.back().get(), _pages[i], used);
+        _pages[i] = _ownedPages.back().get();
+    }
+
+    _isView = false;
+}
+
+void DocumentOffsetIndex::_encodeTail() {
+    _ensureOwned();
+
+    if (_pageUsed + kMaxEncodedBlockSize > kPageSize) {
+        _ownedPages.push_back(std::make_unique<char[]>(kPageSize));
+        _pages.push_back(_ownedPages.back().get());
+        _pageUsed = 0;
+    }
+
+    uint64_t minGap = _tail[1] - _tail[0];
+    for (size_t i = 2; i < kDocsPerBlock; i++) {
+        minGap = std::min(minGap, _tail[i] - _tail[i - 1]);
+    }
+
+    char* start = _ownedPages.back().get() + _pageUsed;
+    DataRangeCursor cursor(start, start + kMaxEncodedBlockSize);
+    cursor.writeAndAdvance(FTDCVarInt(minGap));
+    for (size_t i = 1; i < kDocsPerBlock; i++) {
+        cursor.writeAndAdvance(FTDCVarInt(_tail[i] - _tail[i - 1] - minGap));
+    }
+
+    _ownedBlocks.push_back(Block{_tail[0],
+                                 static_cast<uint32_t>(_pages.size() - 1),
+                                 static_cast<uint32_t>(_pageUsed)});
+    _blocks = _ownedBlocks.data();
+    _blockCount = _ownedBlocks.size();
+    _pageUsed += cursor.data() - start;
+    _tailSize = 0;
+}
+
+void DocumentOffsetIndex::_decodeBlock(size_t block, uint64_t* out) const {
+    const Block& b = _blocks[block];
+    const char* start = _pages[b.page] + b.pos;
+    ConstDataRangeCursor cursor(start, start + kMaxEncodedBlockSize);
+
+    const uint64_t minGap = cursor.readAndAdvance<FTDCVarInt>();
+    out[0] = b.firstOffset;
+    for (size_t i = 1; i < kDocsPerBlock; i++) {
+        out[i] = out[i - 1] + minGap + cursor.readAndAdvance<FTDCVarInt>();
+    }
+}
+
+uint64_t DocumentOffsetIndex::operator[](size_t i) const {
+    dassert(i < size());
+
+    const size_t block = i / kDocsPerBlock;
+    const size_t within = i % kDocsPerBlock;
+    if (block == _blockCount) {
+        return _tail[within];
+    }
+
+    const Block& b = _blocks[block];
+    if (within == 0) {
+        return b.firstOffset;
+    }
+
+    const char* start = _pages[b.page] + b.pos;
+    ConstDataRangeCursor cursor(start, start + kMaxEncodedBlockSize);
+    const uint64_t minGap = cursor.readAndAdvance<FTDCVarInt>();
+    uint64_t offset = b.firstOffset + within * minGap;
+    for (size_t j = 1; j <= within; j++) {
+        offset += cursor.readAndAdvance<FTDCVarInt>();
+    }
+    return offset;
+}
+
+void DocumentOffsetIndex::decodeRange(size_t begin, size_t count, uint64_t* out) const {
+    dassert(begin + count <= size());
+
+    uint64_t block[kDocsPerBlock];
+    while (count > 0) {
+        const size_t b = begin / kDocsPerBlock;
+        const size_t within = begin % kDocsPerBlock;
+        const size_t n = std::min(count, kDocsPerBlock - within);
+        if (b == _blockCount) {
+            std::copy_n(&_tail[within], n, out);
+        } else {
+            _decodeBlock(b, block);
+            std::copy_n(&block[within], n, out);
+        }
+        begin += n;
+        count -= n;
+        out += n;
+    }
+}
+
+boost::optional<size_t> DocumentOffsetIndex::findAtOrBefore(uint64_t offset) const {
+    if (empty() || offset < operator[](0)) {
+        return boost::none;
+    }
+
+    if (_tailSize > 0 && offset >= _tail[0]) {
+        auto it = std::upper_bound(_tail.begin(), _tail.begin() + _tailSize, offset);
+        return _blockCount * kDocsPerBlock + (it - _tail.begin()) - 1;
+    }
+
+    // Last block whose first doc is at or before `offset`.
+    auto it = std::upper_bound(
+        _blocks, _blocks + _blockCount, offset, [](uint64_t off, const Block& b) {
+            return off < b.firstOffset;
+        });
+    const size_t block = (it - _blocks) - 1;
+
+    uint64_t decoded[kDocsPerBlock];
+    _decodeBlock(block, decoded);
+    auto within = std::upper_bound(decoded, decoded + kDocsPerBlock, offset);
+    return block * kDocsPerBlock + (within - decoded) - 1;
+}
+
+void DocumentOffsetIndex::truncate(size_t n) {
+    if (n >= size()) {
+        return;
+    }
+    _ensureOwned();
+
+    const size_t block = n / kDocsPerBlock;
+    if (block < _blockCount) {
+        // The block containing doc n becomes the tail again, and the encoded form is cut back to
+        // where it started.
+        _decodeBlock(block, _tail.data());
+        const Block b = _ownedBlocks[block];
+        _ownedBlocks.resize(block);
+        _blocks = _ownedBlocks.data();
+        _blockCount = block;
+        if (_blockCount == 0) {
+            _pages.clear();
+            _ownedPages.clear();
+            _pageUsed = kPageSize;
+        } else {
+            _pages.resize(b.page + 1);
+            _ownedPages.resize(b.page + 1);
+            _pageUsed = b.pos;
+        }
+    }
+    _tailSize = n % kDocsPerBlock;
+}
+
+void DocumentOffsetIndex::clear() {
+    _blocks = nullptr;
+    _blockCount = 0;
+    _pages.clear();
+    _pageUsed = kPageSize;
+    _ownedBlocks.clear();
+    _ownedPages.clear();
+    _isView = false;
+    _tailSize = 0;
+}
+
+size_t DocumentOffsetIndex::bytesUsed() const {
+    if (_isView) {
+        return sizeof(*this) + _pages.capacity() * sizeof(const char*);
+    }
+    return sizeof(*this) + _ownedBlocks.capacity() * sizeof(Block) +
+        _ownedPages.size() * kPageSize;
+}
+
+/**
+ * The serialized form is:
+ *   SerializedHeader
+ *   Block[numBlocks]
+ *   the encoded pages, each kPageSize bytes except the last (lastPageUsed bytes), padded to 8
+ *   uint64_t[tailSize]
+ *
+ * All in native (little endian) byte order.
+ */
+Status DocumentOffsetIndex::serialize(const std::function<Status(ConstDataRange)>& write) const {
+    SerializedHeader header{_blockCount, _pages.size(), _pages.empty() ? 0 : _pageUsed, _tailSize};
+    Status s = write(ConstDataRange(reinterpret_cast<const char*>(&header), sizeof(header)));
+    if (!s.isOK()) {
+        return s;
+    }
+
+    if (_blockCount > 0) {
+        s = write(ConstDataRange(reinterpret_cast<const char*>(_blocks),
+                                 _blockCount * sizeof(Block)));
+        if (!s.isOK()) {
+            return s;
+        }
+    }
+
+    size_t pagesLen = 0;
+    for (size_t i = 0; i < _pages.size(); i++) {
+        const size_t used = (i == _pages.size() - 1) ? _pageUsed : kPageSize;
+        s = write(ConstDataRange(_pages[i], used));
+        if (!s.isOK()) {
+            return s;
+        }
+        pagesLen += used;
+    }
+    const char padding[8] = {};
+    if (alignedSize(pagesLen) != pagesLen) {
+        s = write(ConstDataRange(padding, alignedSize(pagesLen) - pagesLen));
+        if (!s.isOK()) {
+            return s;
+        }
+    }
+
+    return write(ConstDataRange(reinterpret_cast<const char*>(_tail.data()),
+                                _tailSize * sizeof(uint64_t)));
+}
+
+StatusWith<DocumentOffsetIndex> DocumentOffsetIndex::view(ConstDataRange serialized,
+                                                          uint64_t end) {
+    ConstDataRangeCursor cursor(serialized);
+    auto swHeader = cursor.readAndAdvanceNoThrow<SerializedHeader>();
+    if (!swHeader.isOK()) {
+        return swHeader.getStatus();
+    }
+    const SerializedHeader& header = swHeader.getValue();
+
+    // (a corrupt header could make any of these overflow)
+    uint64_t blocksLen = 0;
+    uint64_t pagesLen = 0;
+    uint64_t expectedLen = sizeof(header);
+    if (header.tailSize >= kDocsPerBlock || header.lastPageUsed > kPageSize ||
+        (header.numPages == 0) != (header.numBlocks == 0) ||
+        mongoUnsignedMultiplyOverflow64(header.numBlocks, sizeof(Block), &blocksLen) ||
+        (header.numPages > 0 &&
+         (mongoUnsignedMultiplyOverflow64(header.numPages - 1, kPageSize, &pagesLen) ||
+          mongoUnsignedAddOverflow64(pagesLen, header.lastPageUsed, &pagesLen))) ||
+        mongoUnsignedAddOverflow64(expectedLen, blocksLen, &expectedLen) ||
+        mongoUnsignedAddOverflow64(expectedLen, pagesLen, &expectedLen) ||
+        expectedLen > serialized.length() ||
+        alignedSize(expectedLen) + header.tailSize * sizeof(uint64_t) != serialized.length()) {
+        return {ErrorCodes::BadValue,
+                str::stream() << "Corrupt document offset index (" << serialized.length()
+                              << " bytes, which doesn't match its header)"};
+    }
+
+    DocumentOffsetIndex index;
+    index._isView = true;
+    index._blocks = reinterpret_cast<const Block*>(cursor.data());
+    index._blockCount = header.numBlocks;
+    cursor.advance(blocksLen);
+
+    for (size_t i = 0; i < header.numPages; i++) {
+        index._pages.push_back(cursor.data() + i * kPageSize);
+    }
+    index._pageUsed = header.numPages ? header.lastPageUsed : kPageSize;
+    cursor.advance(alignedSize(pagesLen));
+
+    memcpy(index._tail.data(), cursor.data(), header.tailSize * sizeof(uint64_t));
+    index._tailSize = header.tailSize;
+
+    Status s = index._validate(end);
+    if (!s.isOK()) {
+        return s;
+    }
+    return {std::move(index)};
+}
+
+/**
+ * Decodes every block, bounded by the used part of its page, so that reading the index later
+ * can't run off the end of the serialized data, and can't return offsets that aren't in the file.
+ */
+Status DocumentOffsetIndex::_validate(uint64_t end) const {
+    auto corrupt = [](StringData reason) {
+        return Status(ErrorCodes::BadValue,
+                      str::stream() << "Corrupt document offset index (" << reason << ")");
+    };
+
+    bool first = true;
+    uint64_t prev = 0;
+    auto inOrder = [&](uint64_t offset) {
+        if ((!first && offset <= prev) || offset >= end) {
+            return false;
+        }
+        first = false;
+        prev = offset;
+        return true;
+    };
+
+    for (size_t block = 0; block < _blockCount; block++) {
+        const Block& b = _blocks[block];
+        if (b.page >= _pages.size()) {
+            return corrupt("block in a page that doesn't exist");
+        }
+        const size_t used = (b.page == _pages.size() - 1) ? _pageUsed : kPageSize;
+        if (b.pos >= used) {
+            return corrupt("block past the end of its page");
+        }
+        if (!inOrder(b.firstOffset)) {
+            return corrupt("offsets out of order or past the end of the file");
+        }
+
+        ConstDataRangeCursor cursor(_pages[b.page] + b.pos, _pages[b.page] + used);
+        auto swMinGap = cursor.readAndAdvanceNoThrow<FTDCVarInt>();
+        if (!swMinGap.isOK()) {
+            return corrupt("block cut short");
+        }
+        const uint64_t minGap = swMinGap.getValue();
+        uint64_t offset = b.firstOffset;
+        for (size_t i = 1; i < kDocsPerBlock; i++) {
+            auto swResidual = cursor.readAndAdvanceNoThrow<FTDCVarInt>();
+            if (!swResidual.isOK()) {
+                return corrupt("block cut short");
+            }
+            uint64_t gap;
+            if (mongoUnsignedAddOverflow64(minGap, swResidual.getValue(), &gap) ||
+                mongoUnsignedAddOverflow64(offset, gap, &offset) || !inOrder(offset)) {
+                return corrupt("offsets out of order or past the end of the file");
+            }
+        }
+    }
+
+    for (size_t i = 0; i < _tailSize; i++) {
+        if (!inOrder(_tail[i])) {
+            return corrupt("offsets out of order or past the end of the file");
+        }
+    }
+    return Status::OK();
+}
+
+}  // namespace mongo
@@ -0,0 +1,162 @@
+/**
+ *    Copyright (C) 2019-present MongoDB, Inc.
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the Server Side Public License, version 1,
+ *    as published by MongoDB, Inc.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    Server Side Public License for more details.
+ *
+ *    You should have received a copy of the Server Side Public License
+ *    along with this program. If not, see
+ *    <http://www.mongodb.com/licensing/server-side-public-license>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the Server Side Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#pragma once
+
+#include <array>
+#include <boost/optional.hpp>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "mongo/base/data_range.h"
+#include "mongo/base/status_with.h"
+
+namespace mongo {
+
+/**
+ * Compact, append-only table of the byte offsets of the documents in a BSON file.
+ *
+ * Offsets are grouped into blocks of kDocsPerBlock documents.  The top-level table holds the
+ * absolute offset of the first document of each block, and where the rest of the block is encoded.
+ * The rest of the block is stored as the smallest gap between consecutive documents in the block,
+ * followed by how much bigger than that each gap is, all as FTDC varints.  For a collection of
+ * similarly sized documents this comes to a little over 1 byte per document, compared to 8 for a
+ * plain vector of offsets (or 16+ for a vector of BSONObj).
+ *
+ * Encoded blocks are stored in fixed-size pages, so growing the index never reallocates or copies
+ * the bulk of it.  The block currently being filled is kept unencoded until it is full.
+ *
+ * Random access decodes at most one block, so is O(1).  Offsets must be appended in strictly
+ * increasing order.  Not synchronized; concurrent readers need the writer to be excluded.
+ *
+ * An index can be written out with serialize(), and used in place (eg. from an mmapped file)
+ * with view().  Views are read-only until something is appended, at which point the encoded
+ * data is copied.
+ */
+class DocumentOffsetIndex {
+public:
+    static constexpr size_t kDocsPerBlock = 128;
+
+    DocumentOffsetIndex() = default;
+    DocumentOffsetIndex(DocumentOffsetIndex&&) = default;
+    DocumentOffsetIndex& operator=(DocumentOffsetIndex&&) = default;
+
+    void append(uint64_t offset);
+
+    uint64_t operator[](size_t i) const;
+
+    uint64_t back() const {
+        return operator[](size() - 1);
+    }
+
+    size_t size() const {
+        return _blockCount * kDocsPerBlock + _tailSize;
+    }
+
+    bool empty() const {
+        return size() == 0;
+    }
+
+    void clear();
+
+    /**
+     * Passes the serialized form of the index to `write`, in pieces.  Stops at (and returns) the
+     * first error returned by `write`.
+     */
+    Status serialize(const std::function<Status(ConstDataRange)>& write) const;
+
+    /**
+     * Returns an index that reads directly from `serialized`, which must stay valid (and
+     * unchanged) for as long as the index is used, and must be 8-byte aligned.  Fails unless
+     * every offset in it is before `end` (eg. the length of the file they're offsets into), which
+     * means decoding all of it, but that's still much cheaper than rebuilding it.
+     */
+    static StatusWith<DocumentOffsetIndex> view(ConstDataRange serialized, uint64_t end);
+
+    /**
+     * Discards all but the first `n` documents.
+     */
+    void truncate(size_t n);
+
+    /**
+     * Returns the index of the last document whose offset is <= `offset`, or boost::none if
+     * `offset` is before the first document.
+     */
+    boost::optional<size_t> findAtOrBefore(uint64_t offset) const;
+
+    /**
+     * Decodes the offsets of documents [begin, begin + count) into `out`.  Faster than repeated
+     * operator[] for runs of documents.
+     */
+    void decodeRange(size_t begin, size_t count, uint64_t* out) const;
+
+    /**
+     * Approximate number of bytes of memory used by the index.
+     */
+    size_t bytesUsed() const;
+
+private:
+    struct Block {
+        uint64_t firstOffset;
+        // Position of the encoded remainder of the block, as page number and offset within it.
+        uint32_t page;
+        uint32_t pos;
+    };
+
+    static constexpr size_t kPageSize = 1024 * 1024;
+
+    struct SerializedHeader {
+        uint64_t numBlocks;
+        uint64_t numPages;
+        uint64_t lastPageUsed;
+        uint64_t tailSize;
+    };
+
+    void _encodeTail();
+    void _decodeBlock(size_t block, uint64_t* out) const;
+    void _ensureOwned();
+    Status _validate(uint64_t end) const;
+
+    // Either point into _ownedBlocks/_ownedPages, or into the data passed to view().
+    const Block* _blocks = nullptr;
+    size_t _blockCount = 0;
+    std::vector<const char*> _pages;
+    size_t _pageUsed = kPageSize;
+
+    std::vector<Block> _ownedBlocks;
+    std::vector<std::unique_ptr<char[]>> _ownedPages;
+    bool _isView = false;
+
+    std::array<uint64_t, kDocsPerBlock> _tail;
+    size_t _tailSize = 0;
+};
+
+}  // namespace mongo
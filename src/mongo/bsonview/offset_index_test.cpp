@@ -0,0 +1,238 @@
+/**
+ *    Copyright (C) 2019-present MongoDB, Inc.
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the Server Side Public License, version 1,
+ *    as published by MongoDB, Inc.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    Server Side Public License for more details.
+ *
+ *    You should have received a copy of the Server Side Public License
+ *    along with this program. If not, see
+ *    <http://www.mongodb.com/licensing/server-side-public-license>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the Server Side Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "mongo/bsonview/offset_index.h"
+#include "mongo/platform/random.h"
+#include "mongo/unittest/unittest.h"
+
+namespace mongo {
+namespace {
+
+std::vector<uint64_t> makeOffsets(size_t n, int64_t seed, int maxGap) {
+    PseudoRandom rand(seed);
+    std::vector<uint64_t> offsets;
+    uint64_t offset = 0;
+    for (size_t i = 0; i < n; i++) {
+        offsets.push_back(offset);
+        offset += 5 + rand.nextInt32(maxGap);
+    }
+    return offsets;
+}
+
+TEST(DocumentOffsetIndexTest, RandomAccess) {
+    auto offsets = makeOffsets(10000, 1, 20000);
+    DocumentOffsetIndex index;
+    for (size_t i = 0; i < offsets.size(); i++) {
+        index.append(offsets[i]);
+        ASSERT_EQ(index.size(), i + 1);
+        ASSERT_EQ(index.back(), offsets[i]);
+    }
+
+    for (size_t i = 0; i < offsets.size(); i++) {
+        ASSERT_EQ(index[i], offsets[i]);
+    }
+
+    std::vector<uint64_t> decoded(offsets.size() - 1000);
+    index.decodeRange(1000, decoded.size(), decoded.data());
+    ASSERT(std::equal(decoded.begin(), decoded.end(), offsets.begin() + 1000));
+}
+
+TEST(DocumentOffsetIndexTest, FindAtOrBefore) {
+    auto offsets = makeOffsets(1000, 2, 100);
+    DocumentOffsetIndex index;
+    for (auto offset : offsets) {
+        index.append(offset + 10);
+    }
+
+    ASSERT(!index.findAtOrBefore(0));
+    ASSERT(!index.findAtOrBefore(9));
+    for (size_t i = 0; i < offsets.size(); i++) {
+        ASSERT_EQ(*index.findAtOrBefore(offsets[i] + 10), i);
+        ASSERT_EQ(*index.findAtOrBefore(offsets[i] + 14), i);
+    }
+    ASSERT_EQ(*index.findAtOrBefore(1ULL << 60), offsets.size() - 1);
+}
+
+TEST(DocumentOffsetIndexTest, LargeOffsets) {
+    DocumentOffsetIndex index;
+    uint64_t offset = 1ULL << 40;
+    for (int i = 0; i < 1000; i++) {
+        index.append(offset);
+        offset += (i % 7 == 0) ? (16 * 1024 * 1024) : 5;
+    }
+    offset = 1ULL << 40;
+    for (int i = 0; i < 1000; i++) {
+        ASSERT_EQ(index[i], offset);
+        offset += (i % 7 == 0) ? (16 * 1024 * 1024) : 5;
+    }
+}
+
+TEST(DocumentOffsetIndexTest, CompactForSimilarSizes) {
+    // Documents of 300-400 bytes should need little more than a byte each.
+    auto offsets = makeOffsets(1000000, 3, 100);
+    DocumentOffsetIndex index;
+    for (size_t i = 0; i < offsets.size(); i++) {
+        index.append(offsets[i] + i * 300);
+    }
+    ASSERT_LT(index.bytesUsed(), 2 * offsets.size());
+}
+
+TEST(DocumentOffsetIndexTest, SerializeAndView) {
+    for (size_t n : {0, 1, 127, 128, 129, 20000}) {
+        auto offsets = makeOffsets(n, 4, 50000);
+        DocumentOffsetIndex index;
+        for (auto offset : offsets) {
+            index.append(offset);
+        }
+
+        std::string buf;
+        ASSERT_OK(index.serialize([&](ConstDataRange cdr) {
+            buf.append(cdr.data(), cdr.length());
+            return Status::OK();
+        }));
+        ASSERT_EQ(buf.size() % 8, 0U);
+
+        // std::string's buffer is suitably aligned.
+        const uint64_t end = n ? offsets.back() + 1 : 0;
+        auto swView = DocumentOffsetIndex::view(ConstDataRange(buf.data(), buf.size()), end);
+        ASSERT_OK(swView.getStatus());
+        auto& view = swView.getValue();
+        ASSERT_EQ(view.size(), n);
+        for (size_t i = 0; i < n; i++) {
+            ASSERT_EQ(view[i], offsets[i]);
+        }
+
+        // Appending to a view copies it, leaving the serialized data alone.
+        std::string before = buf;
+        uint64_t next = n ? offsets.back() + 1 : 0;
+        for (int i = 0; i < 300; i++) {
+            view.append(next + i);
+        }
+        ASSERT(buf == before);
+        ASSERT_EQ(view.size(), n + 300);
+        for (size_t i = 0; i < n; i++) {
+            ASSERT_EQ(view[i], offsets[i]);
+        }
+        ASSERT_EQ(view.back(), next + 299);
+
+        ASSERT_NOT_OK(
+            DocumentOffsetIndex::view(ConstDataRange(buf.data(), buf.size() - 8), end)
+                .getStatus());
+        if (n > 0) {
+            // The last offset is past the end.
+            ASSERT_NOT_OK(DocumentOffsetIndex::view(ConstDataRange(buf.data(), buf.size()), end - 1)
+                              .getStatus());
+        }
+    }
+}
+
+TEST(DocumentOffsetIndexTest, ViewRejectsCorruptIndex) {
+    auto offsets = makeOffsets(1000, 5, 1000);
+    DocumentOffsetIndex index;
+    for (auto offset : offsets) {
+        index.append(offset);
+    }
+    std::string buf;
+    ASSERT_OK(index.serialize([&](ConstDataRange cdr) {
+        buf.append(cdr.data(), cdr.length());
+        return Status::OK();
+    }));
+    const uint64_t end = offsets.back() + 1;
+
+    // Returns whether `buf`, with the bytes at `pos` overwritten with `value`, can be viewed.
+    auto viewWith = [&](size_t pos, auto value) {
+        std::string corrupt = buf;
+        memcpy(&corrupt[pos], &value, sizeof(value));
+        return DocumentOffsetIndex::view(ConstDataRange(corrupt.data(), corrupt.size()), end)
+            .getStatus();
+    };
+    ASSERT_OK(viewWith(0, uint64_t(1000 / DocumentOffsetIndex::kDocsPerBlock)));
+
+    // The header is numBlocks, numPages, lastPageUsed and tailSize.  Big enough counts make the
+    // lengths they imply overflow.
+    ASSERT_NOT_OK(viewWith(0, uint64_t(1) << 60));
+    ASSERT_NOT_OK(viewWith(8, uint64_t(1) << 45));
+    ASSERT_NOT_OK(viewWith(8, ~uint64_t(0)));
+
+    // Then each block is firstOffset, page and pos.
+    const size_t secondBlock = 32 + 16;
+    ASSERT_NOT_OK(viewWith(secondBlock, offsets[0]));
+    ASSERT_NOT_OK(viewWith(secondBlock, end));
+    ASSERT_NOT_OK(viewWith(secondBlock + 8, uint32_t(1)));
+    ASSERT_NOT_OK(viewWith(secondBlock + 12, uint32_t(1024 * 1024 - 1)));
+
+    // Then the encoded gaps, which mustn't take the offsets past the next block's.
+    const size_t pages = 32 + 16 * (1000 / DocumentOffsetIndex::kDocsPerBlock);
+    ASSERT_NOT_OK(viewWith(pages, uint8_t(0x7f)));
+}
+
+TEST(DocumentOffsetIndexTest, Truncate) {
+    auto offsets = makeOffsets(1000, 4, 1000);
+    for (size_t n : {0, 1, 127, 128, 129, 500, 999, 1000}) {
+        DocumentOffsetIndex index;
+        for (auto offset : offsets) {
+            index.append(offset);
+        }
+
+        index.truncate(n);
+        ASSERT_EQ(index.size(), n);
+        for (size_t i = 0; i < n; i++) {
+            ASSERT_EQ(index[i], offsets[i]);
+        }
+
+        // Appending carries on from the truncated end.
+        for (size_t i = n; i < offsets.size(); i++) {
+            index.append(offsets[i]);
+        }
+        ASSERT_EQ(index.size(), offsets.size());
+        for (size_t i = 0; i < offsets.size(); i++) {
+            ASSERT_EQ(index[i], offsets[i]);
+        }
+    }
+}
+
+TEST(DocumentOffsetIndexTest, Clear) {
+    DocumentOffsetIndex index;
+    for (int i = 0; i < 300; i++) {
+        index.append(i * 10);
+    }
+    index.clear();
+    ASSERT(index.empty());
+    index.append(7);
+    ASSERT_EQ(index[0], 7U);
+}
+
+}  // namespace
+}  // namespace mongo
@@ -0,0 +1,160 @@
+/**
+ *    Copyright (C) 2019-present MongoDB, Inc.
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the Server Side Public License, version 1,
+ *    as published by MongoDB, Inc.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    Server Side Public License for more details.
+ *
+ *    You should have received a copy of the Server Side Public License
+ *    along with this program. If not, see
+ *    <http://www.mongodb.com/licensing/server-side-public-license>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the Server Side Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/bsonview/parallel_indexer.h"
+
+#include <algorithm>
+
+#include "mongo/bsonview/document_boundary.h"
+#include "mongo/stdx/thread.h"
+#include "mongo/util/assert_util.h"
+#include "mongo/util/concurrency/thread_pool.h"
+
+namespace mongo {
+
+ParallelDocumentIndexer::ParallelDocumentIndexer(const char* base,
+                                                 const char* end,
+                                                 size_t numThreads,
+                                                 uint64_t chunkSize,
+                                                 uint64_t startOffset)
+    : _base(base),
+      _end(end),
+      _startOffset(startOffset),
+      _numThreads(numThreads
+                      ? numThreads
+                      : std::max(1u, static_cast<unsigned>(stdx::thread::hardware_concurrency()))) {
+    invariant(chunkSize > 0);
+
+    const uint64_t size = _end - _base;
+    for (uint64_t begin = _startOffset; begin < size; begin += chunkSize) {
+        Chunk chunk;
+        chunk.begin = begin;
+        chunk.end = std::min(begin + chunkSize, size);
+        _chunks.push_back(std::move(chunk));
+    }
+    _ready.resize(_chunks.size(), false);
+}
+
+ParallelDocumentIndexer::~ParallelDocumentIndexer() {
+    shutdown();
+}
+
+void ParallelDocumentIndexer::start() {
+    invariant(!_pool);
+
+    ThreadPool::Options options;
+    options.poolName = "bsonview indexer";
+    options.threadNamePrefix = "bsonview-indexer-";
+    options.minThreads = 0;
+    options.maxThreads = _numThreads;
+    _pool = std::make_unique<ThreadPool>(options);
+    _pool->startup();
+
+    for (size_t i = 0; i < _chunks.size(); i++) {
+        _pool->schedule([this, i](Status status) {
+            if (status.isOK()) {
+                _scanChunk(i);
+            }
+        });
+    }
+}
+
+void ParallelDocumentIndexer::shutdown() {
+    if (_pool) {
+        _shutdown.store(true);
+        _pool->shutdown();
+        _pool->join();
+        _pool.reset();
+    }
+}
+
+bool ParallelDocumentIndexer::isDone() const {
+    stdx::lock_guard<stdx::mutex> lk(_mutex);
+    return _nextToTake == _chunks.size();
+}
+
+boost::optional<ParallelDocumentIndexer::Chunk> ParallelDocumentIndexer::tryTakeNext() {
+    stdx::lock_guard<stdx::mutex> lk(_mutex);
+    if (_nextToTake == _chunks.size() || !_ready[_nextToTake]) {
+        return boost::none;
+    }
+    return std::move(_chunks[_nextToTake++]);
+}
+
+ParallelDocumentIndexer::Chunk ParallelDocumentIndexer::takeNext() {
+    stdx::unique_lock<stdx::mutex> lk(_mutex);
+    invariant(_nextToTake < _chunks.size());
+    _readyCV.wait(lk, [&] { return _ready[_nextToTake]; });
+    return std::move(_chunks[_nextToTake++]);
+}
+
+void ParallelDocumentIndexer::_scanChunk(size_t i) {
+    uint64_t begin;
+    uint64_t end;
+    {
+        stdx::lock_guard<stdx::mutex> lk(_mutex);
+        begin = _chunks[i].begin;
+        end = _chunks[i].end;
+    }
+
+    std::vector<uint64_t> offsets;
+    const char* p = _base + begin;
+    if (begin > _startOffset) {
+        // Candidates may be anywhere in this chunk, but their confirming documents may extend
+        // into the following chunks.
+        p = findNextDocumentStart(p, _base + end, _end);
+        if (!p) {
+            // Nothing plausible starts here, leave it to the consumer to work out.
+            p = _base + begin;
+        }
+    }
+
+    while (p < _base + end && !_shutdown.load()) {
+        size_t len = validDocumentLength(p, _end);
+        if (len == 0) {
+            break;
+        }
+        offsets.push_back(p - _base);
+        p += len;
+    }
+
+    if (_onScanned) {
+        _onScanned(begin, std::min<uint64_t>(p - _base, end));
+    }
+
+    stdx::lock_guard<stdx::mutex> lk(_mutex);
+    _chunks[i].offsets = std::move(offsets);
+    _chunks[i].next = p - _base;
+    _ready[i] = true;
+    _readyCV.notify_all();
+}
+
+}  // namespace mongo
@@ -0,0 +1,157 @@
+/**
+ *    Copyright (C) 2019-present MongoDB, Inc.
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the Server Side Public License, version 1,
+ *    as published by MongoDB, Inc.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    Server Side Public License for more details.
+ *
+ *    You should have received a copy of the Server Side Public License
+ *    along with this program. If not, see
+ *    <http://www.mongodb.com/licensing/server-side-public-license>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the Server Side Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#pragma once
+
+#include <boost/optional.hpp>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "mongo/platform/atomic_word.h"
+#include "mongo/stdx/condition_variable.h"
+#include "mongo/stdx/mutex.h"
+
+namespace mongo {
+
+class ThreadPool;
+
+/**
+ * Builds the document offset table for a large file of concatenated BSON documents using all
+ * available cores.
+ *
+ * The file is split into fixed-size chunks, which are scanned concurrently on a ThreadPool.
+ * Every chunk except the first resynchronises to a plausible document start (see
+ * document_boundary.h) and then walks the documents which start inside the chunk, validating each
+ * one, so that the consumer never has to look inside them to know they are safe to read.  Since
+ * resynchronisation is only a heuristic, the results of a chunk must be checked against the
+ * end of the previous chunk before they are used.  That is the job of the consumer, which takes
+ * the chunks strictly in file order via tryTakeNext()/takeNext().
+ *
+ * Chunks are scheduled in file order, so the start of the file becomes available first.
+ */
+class ParallelDocumentIndexer {
+    ParallelDocumentIndexer(const ParallelDocumentIndexer&) = delete;
+    ParallelDocumentIndexer& operator=(const ParallelDocumentIndexer&) = delete;
+
+public:
+    static constexpr uint64_t kDefaultChunkSize = 32 * 1024 * 1024;
+
+    /**
+     * Files smaller than this are quicker to just scan sequentially.
+     */
+    static constexpr uint64_t kMinimumFileSize = 4 * kDefaultChunkSize;
+
+    struct Chunk {
+        // The byte range covered by this chunk, relative to the start of the file.
+        uint64_t begin = 0;
+        uint64_t end = 0;
+
+        // Offsets (relative to the start of the file) of the documents found starting within
+        // [begin, end), in ascending order.
+        std::vector<uint64_t> offsets;
+
+        // Where the walk of this chunk stopped.  Normally this is the offset of the first document
+        // at or after `end` (ie. the first document of the next chunk), but it may be before `end`
+        // if the walk ran into something that is not a valid document.
+        uint64_t next = 0;
+    };
+
+    /**
+     * Indexes [base + startOffset, end), where startOffset must be the start of a document.
+     * Offsets are relative to base.  A numThreads of 0 means one thread per available core.
+     */
+    ParallelDocumentIndexer(const char* base,
+                            const char* end,
+                            size_t numThreads = 0,
+                            uint64_t chunkSize = kDefaultChunkSize,
+                            uint64_t startOffset = 0);
+    ~ParallelDocumentIndexer();
+
+    /**
+     * Has `fn` called (on a worker thread) with the range of each chunk that has been walked,
+     * eg. so its pages can be released.  Must be set before start().
+     */
+    void setScannedCallback(std::function<void(uint64_t begin, uint64_t end)> fn) {
+        _onScanned = std::move(fn);
+    }
+
+    /**
+     * Schedules all chunks for scanning.
+     */
+    void start();
+
+    /**
+     * Abandons any chunks that are not yet being scanned, and waits for the worker threads.
+     */
+    void shutdown();
+
+    size_t numChunks() const {
+        return _chunks.size();
+    }
+
+    /**
+     * True once every chunk has been handed to the consumer.
+     */
+    bool isDone() const;
+
+    /**
+     * Returns the next chunk in file order if it has finished being scanned, without blocking.
+     */
+    boost::optional<Chunk> tryTakeNext();
+
+    /**
+     * Returns the next chunk in file order, waiting for it to be scanned if necessary.
+     * Must not be called once isDone().
+     */
+    Chunk takeNext();
+
+private:
+    void _scanChunk(size_t i);
+
+    const char* const _base;
+    const char* const _end;
+    const uint64_t _startOffset;
+    const size_t _numThreads;
+    std::function<void(uint64_t, uint64_t)> _onScanned;
+
+    std::unique_ptr<ThreadPool> _pool;
+
+    AtomicWord<bool> _shutdown{false};
+
+    // Guards _ready and _nextToTake (and the contents of _chunks, once scanning has started).
+    mutable stdx::mutex _mutex;
+    stdx::condition_variable _readyCV;
+    std::vector<Chunk> _chunks;
+    std::vector<bool> _ready;
+    size_t _nextToTake = 0;
+};
+
+}  // namespace mongo
@@ -0,0 +1,179 @@
+/**
+ *    Copyright (C) 2019-present MongoDB, Inc.
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the Server Side Public License, version 1,
+ *    as published by MongoDB, Inc.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    Server Side Public License for more details.
+ *
+ *    You should have received a copy of the Server Side Public License
+ *    along with this program. If not, see
+ *    <http://www.mongodb.com/licensing/server-side-public-license>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the Server Side Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#include "mongo/bson/bsonobjbuilder.h"
+#include "mongo/bsonview/document_boundary.h"
+#include "mongo/bsonview/parallel_indexer.h"
+#include "mongo/unittest/unittest.h"
+
+namespace mongo {
+namespace {
+
+/**
+ * Concatenates `n` documents of varying sizes, recording the offset of each one.
+ */
+std::string makeDocs(int n, std::vector<uint64_t>* offsets) {
+    std::string buf;
+    for (int i = 0; i < n; i++) {
+        BSONObjBuilder bob;
+        bob.append("_id", i);
+        bob.append("s", std::string(i % 97, 'x'));
+        if (i % 3 == 0) {
+            bob.append("sub", BSON("a" << i << "b" << BSON_ARRAY(1 << 2 << 3)));
+        }
+        BSONObj obj = bob.obj();
+        offsets->push_back(buf.size());
+        buf.append(obj.objdata(), obj.objsize());
+    }
+    return buf;
+}
+
+// Where the length of "s" is, in the docs from makeDocs().
+const size_t kStringLengthOffset = 4 + (1 + strlen("_id") + 1 + 4) + (1 + strlen("s") + 1);
+
+TEST(DocumentBoundaryTest, PlausibleDocumentLength) {
+    std::vector<uint64_t> offsets;
+    std::string buf = makeDocs(10, &offsets);
+    const char* base = buf.data();
+    const char* end = base + buf.size();
+
+    for (size_t i = 0; i < offsets.size(); i++) {
+        ASSERT_EQ(plausibleDocumentLength(base + offsets[i], end),
+                  BSONObj(base + offsets[i]).objsize());
+    }
+
+    // Truncated document.
+    ASSERT_EQ(plausibleDocumentLength(base + offsets[9], end - 1), 0U);
+
+    // Empty document is plausible, garbage isn't.
+    BSONObj empty;
+    ASSERT_EQ(plausibleDocumentLength(empty.objdata(), empty.objdata() + empty.objsize()), 5U);
+    const char garbage[] = {5, 0, 0, 0, 1, 0};
+    ASSERT_EQ(plausibleDocumentLength(garbage, garbage + sizeof(garbage)), 0U);
+}
+
+TEST(DocumentBoundaryTest, ValidDocumentLength) {
+    std::vector<uint64_t> offsets;
+    std::string buf = makeDocs(10, &offsets);
+    const char* base = buf.data();
+    const char* end = base + buf.size();
+
+    ASSERT_EQ(validDocumentLength(base + offsets[3], end), BSONObj(base + offsets[3]).objsize());
+
+    // The length is fine, but the string inside runs past the end of the document.
+    buf[offsets[3] + kStringLengthOffset] = 0x7f;
+    ASSERT_NE(plausibleDocumentLength(base + offsets[3], end), 0U);
+    ASSERT_EQ(validDocumentLength(base + offsets[3], end), 0U);
+}
+
+TEST(DocumentBoundaryTest, FindNextDocumentStart) {
+    std::vector<uint64_t> offsets;
+    std::string buf = makeDocs(20, &offsets);
+    const char* base = buf.data();
+    const char* end = base + buf.size();
+
+    for (size_t i = 1; i < offsets.size(); i++) {
+        // From anywhere inside the previous document, the next one is found.
+        for (uint64_t from = offsets[i - 1] + 1; from <= offsets[i]; from++) {
+            ASSERT_EQ(findNextDocumentStart(base + from, end, end) - base, (long)offsets[i]);
+        }
+    }
+
+    // Nothing after the start of the last doc.
+    ASSERT(!findNextDocumentStart(base + offsets.back() + 1, end, end));
+}
+
+TEST(ParallelDocumentIndexerTest, ChunksCoverAllDocuments) {
+    std::vector<uint64_t> offsets;
+    std::string buf = makeDocs(5000, &offsets);
+
+    ParallelDocumentIndexer indexer(buf.data(), buf.data() + buf.size(), 4, 4096);
+    ASSERT_EQ(indexer.numChunks(), (buf.size() + 4095) / 4096);
+    indexer.start();
+
+    // Splice the chunks together the way BSONCache does: a chunk is only trusted from the point
+    // where it lines up with the end of the previous one, anything before that is walked here.
+    std::vector<uint64_t> found;
+    uint64_t next = 0;
+    while (!indexer.isDone()) {
+        auto chunk = indexer.takeNext();
+        ASSERT_GTE(chunk.next, chunk.end);
+        bool spliced = false;
+        while (next < chunk.end) {
+            auto it = std::lower_bound(chunk.offsets.begin(), chunk.offsets.end(), next);
+            if (!spliced && it != chunk.offsets.end() && *it == next) {
+                found.insert(found.end(), it, chunk.offsets.end());
+                next = chunk.next;
+                spliced = true;
+                continue;
+            }
+            found.push_back(next);
+            next += BSONObj(buf.data() + next).objsize();
+        }
+    }
+
+    ASSERT_EQ(next, buf.size());
+    ASSERT(found == offsets);
+}
+
+TEST(ParallelDocumentIndexerTest, StopsAtGarbage) {
+    std::vector<uint64_t> offsets;
+    std::string buf = makeDocs(100, &offsets);
+    uint64_t corruptAt = offsets[50];
+    buf[corruptAt + 3] = 0x7f;  // absurd length
+
+    ParallelDocumentIndexer indexer(buf.data(), buf.data() + buf.size(), 2, buf.size());
+    indexer.start();
+    auto chunk = indexer.takeNext();
+    ASSERT(indexer.isDone());
+    ASSERT_EQ(chunk.offsets.size(), 50U);
+    ASSERT_EQ(chunk.next, corruptAt);
+}
+
+TEST(ParallelDocumentIndexerTest, StopsAtInvalidDocument) {
+    std::vector<uint64_t> offsets;
+    std::string buf = makeDocs(100, &offsets);
+    uint64_t corruptAt = offsets[60];
+    buf[corruptAt + kStringLengthOffset] = 0x7f;
+
+    ParallelDocumentIndexer indexer(buf.data(), buf.data() + buf.size(), 2, buf.size());
+    indexer.start();
+    auto chunk = indexer.takeNext();
+    ASSERT_EQ(chunk.offsets.size(), 60U);
+    ASSERT_EQ(chunk.next, corruptAt);
+}
+
+}  // namespace
+}  // namespace mongo
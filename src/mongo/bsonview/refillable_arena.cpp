@@ -0,0 +1,240 @@
+/**
+ *    Copyright (C) 2019-present MongoDB, Inc.
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the Server Side Public License, version 1,
+ *    as published by MongoDB, Inc.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    Server Side Public License for more details.
+ *
+ *    You should have received a copy of the Server Side Public License
+ *    along with this program. If not, see
+ *    <http://www.mongodb.com/licensing/server-side-public-license>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the Server Side Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/bsonview/refillable_arena.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <linux/userfaultfd.h>
+
+// Older headers don't have it, though the kernel may still.
+#ifndef UFFD_USER_MODE_ONLY
+#define UFFD_USER_MODE_ONLY 1
+#endif
+#endif
+
+#include "mongo/util/errno_util.h"
+#include "mongo/util/str.h"
+
+namespace mongo {
+
+namespace {
+
+// How often the fault handler checks whether it should stop.
+constexpr int kPollIntervalMillis = 100;
+
+}  // namespace
+
+RefillableArena::~RefillableArena() {
+    _shutdown.store(true);
+    if (_faultHandler.joinable()) {
+        _faultHandler.join();
+    }
+    if (_base) {
+        munmap(_base, kReservation);
+    }
+    if (_fd >= 0) {
+        ::close(_fd);
+    }
+}
+
+uint64_t RefillableArena::pageSize() {
+    static const uint64_t size = sysconf(_SC_PAGESIZE);
+    return size;
+}
+
+StatusWith<std::unique_ptr<RefillableArena>> RefillableArena::make(RefillFn refill) {
+#ifdef __NR_userfaultfd
+    std::unique_ptr<RefillableArena> arena(new RefillableArena());
+    arena->_refillFn = std::move(refill);
+
+    // Catching only faults from user space is all that's needed, and is allowed even where
+    // unprivileged userfaultfd otherwise isn't (vm.unprivileged_userfaultfd = 0).
+    arena->_fd = syscall(__NR_userfaultfd, O_CLOEXEC | O_NONBLOCK);
+    if (arena->_fd < 0 && errno == EPERM) {
+        arena->_fd = syscall(__NR_userfaultfd, O_CLOEXEC | O_NONBLOCK | UFFD_USER_MODE_ONLY);
+    }
+    if (arena->_fd < 0) {
+        auto errorString = errnoWithDescription();
+        return {ErrorCodes::NotImplemented,
+                str::stream() << "userfaultfd isn't available: " << errorString};
+    }
+
+    uffdio_api api{};
+    api.api = UFFD_API;
+    if (ioctl(arena->_fd, UFFDIO_API, &api) != 0) {
+        auto errorString = errnoWithDescription();
+        return {ErrorCodes::NotImplemented,
+                str::stream() << "userfaultfd isn't available: " << errorString};
+    }
+
+    void* reservation = mmap(nullptr,
+                             kReservation,
+                             PROT_READ | PROT_WRITE,
+                             MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE,
+                             -1,
+                             0);
+    if (reservation == MAP_FAILED) {
+        auto errorString = errnoWithDescription();
+        return {ErrorCodes::FileNotOpen,
+                str::stream() << "Unable to reserve address space: " << errorString};
+    }
+    arena->_base = static_cast<char*>(reservation);
+
+    uffdio_register registration{};
+    registration.range.start = reinterpret_cast<uint64_t>(arena->_base);
+    registration.range.len = kReservation;
+    registration.mode = UFFDIO_REGISTER_MODE_MISSING;
+    if (ioctl(arena->_fd, UFFDIO_REGISTER, &registration) != 0) {
+        auto errorString = errnoWithDescription();
+        return {ErrorCodes::NotImplemented,
+                str::stream() << "userfaultfd isn't available: " << errorString};
+    }
+
+    arena->_refillBuffer.reset(new char[kRefillSize]);
+    RefillableArena* a = arena.get();
+    arena->_faultHandler = stdx::thread([a] { a->_handleFaults(); });
+
+    return {std::move(arena)};
+#else
+    return {ErrorCodes::NotImplemented, "userfaultfd isn't available on this platform"};
+#endif
+}
+
+Status RefillableArena::append(const char* data, size_t len) {
+    const uint64_t offset = _appended.load();
+    if (offset + len > kReservation) {
+        return {ErrorCodes::ExceededMemoryLimit,
+                str::stream() << "Input would be larger than " << (kReservation >> 30) << "GiB"};
+    }
+
+    const size_t whole = len & ~(pageSize() - 1);
+    auto status = _copy(offset, data, whole);
+    if (status.isOK() && whole < len) {
+        // The last page, padded.
+        std::unique_ptr<char[]> page(new char[pageSize()]());
+        memcpy(page.get(), data + whole, len - whole);
+        status = _copy(offset + whole, page.get(), pageSize());
+    }
+    if (!status.isOK()) {
+        return status;
+    }
+    _appended.store(offset + len);
+    return Status::OK();
+}
+
+void RefillableArena::_handleFaults() {
+#ifdef __NR_userfaultfd
+    while (!_shutdown.load()) {
+        pollfd pfd{_fd, POLLIN, 0};
+        if (::poll(&pfd, 1, kPollIntervalMillis) <= 0) {
+            continue;
+        }
+        uffd_msg msg;
+        if (::read(_fd, &msg, sizeof(msg)) != sizeof(msg) || msg.event != UFFD_EVENT_PAGEFAULT) {
+            continue;
+        }
+
+        const uint64_t page =
+            (msg.arg.pagefault.address - reinterpret_cast<uint64_t>(_base)) & ~(pageSize() - 1);
+        if (!_refill(page).isOK()) {
+            uffdio_zeropage zero{};
+            zero.range.start = reinterpret_cast<uint64_t>(_base + page);
+            zero.range.len = pageSize();
+            ioctl(_fd, UFFDIO_ZEROPAGE, &zero);
+        }
+
+        // Whatever happened (eg. another thread faulted on the same page, which has since been
+        // filled), the thread that touched it mustn't be left waiting.
+        uffdio_range range{reinterpret_cast<uint64_t>(_base + page), pageSize()};
+        ioctl(_fd, UFFDIO_WAKE, &range);
+    }
+#endif
+}
+
+Status RefillableArena::_refill(uint64_t page) {
+    // The whole of the block around the page, as far as has been appended.
+    const uint64_t appended = _appended.load();
+    const uint64_t from = page / kRefillSize * kRefillSize;
+    const uint64_t to = std::min(from + kRefillSize, appended);
+    if (page >= to) {
+        return {ErrorCodes::BadValue, "Page hasn't been filled"};
+    }
+
+    // If it fails, the whole block is zeroes, rather than failing again page by page.
+    const uint64_t paddedLength = (to - from + pageSize() - 1) & ~(pageSize() - 1);
+    if (_refillFn(from, _refillBuffer.get(), to - from).isOK()) {
+        memset(_refillBuffer.get() + (to - from), 0, paddedLength - (to - from));
+    } else {
+        memset(_refillBuffer.get(), 0, paddedLength);
+    }
+    return _copy(from, _refillBuffer.get(), paddedLength);
+}
+
+Status RefillableArena::_copy(uint64_t offset, const char* data, size_t len) {
+#ifdef __NR_userfaultfd
+    while (len > 0) {
+        uffdio_copy copy{};
+        copy.dst = reinterpret_cast<uint64_t>(_base + offset);
+        copy.src = reinterpret_cast<uint64_t>(data);
+        copy.len = len;
+        if (ioctl(_fd, UFFDIO_COPY, &copy) == 0) {
+            break;
+        }
+
+        // Stops short at pages that are already there (which are left as they are).
+        size_t done;
+        if (errno == EAGAIN) {
+            done = copy.copy > 0 ? copy.copy : 0;
+        } else if (errno == EEXIST) {
+            done = pageSize();
+        } else {
+            auto errorString = errnoWithDescription();
+            return {ErrorCodes::InternalError,
+                    str::stream() << "Unable to fill memory: " << errorString};
+        }
+        offset += done;
+        data += done;
+        len -= done;
+    }
+#endif
+    return Status::OK();
+}
+
+}  // namespace mongo
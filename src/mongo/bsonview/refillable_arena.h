@@ -0,0 +1,108 @@
+/**
+ *    Copyright (C) 2019-present MongoDB, Inc.
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the Server Side Public License, version 1,
+ *    as published by MongoDB, Inc.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    Server Side Public License for more details.
+ *
+ *    You should have received a copy of the Server Side Public License
+ *    along with this program. If not, see
+ *    <http://www.mongodb.com/licensing/server-side-public-license>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the Server Side Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+
+#include "mongo/base/status_with.h"
+#include "mongo/platform/atomic_word.h"
+#include "mongo/stdx/thread.h"
+
+namespace mongo {
+
+/**
+ * An append-only arena in anonymous memory whose pages, once dropped (with MADV_DONTNEED), are
+ * filled again when they're next touched, by a function that recreates them (eg. by
+ * decompressing them again).  So, like a TempArena, what's been written never moves, but it
+ * takes up neither memory nor disk once it's been dropped.
+ *
+ * Touched pages are caught with userfaultfd(2), on a thread of the arena's own, so this is only
+ * available on Linux, and only where userfaultfd is allowed.
+ *
+ * One thread fills the arena, and others may read what they've been told has been filled.
+ */
+class RefillableArena {
+    RefillableArena(const RefillableArena&) = delete;
+    RefillableArena& operator=(const RefillableArena&) = delete;
+
+public:
+    // Largest arena.  Costs nothing but address space.
+    static constexpr uint64_t kReservation = 1ULL << 40;
+
+    // How much is refilled at a time, around a page that's touched.
+    static constexpr uint64_t kRefillSize = 1024 * 1024;
+
+    /**
+     * Writes [offset, offset + len) of the arena, as it was filled, into `buf`.  Called on the
+     * arena's thread, so mustn't touch the arena itself.  If it fails, the pages read as zeroes.
+     */
+    using RefillFn = std::function<Status(uint64_t offset, char* buf, size_t len)>;
+
+    ~RefillableArena();
+
+    /**
+     * Fails if userfaultfd isn't available.
+     */
+    static StatusWith<std::unique_ptr<RefillableArena>> make(RefillFn refill);
+
+    static uint64_t pageSize();
+
+    const char* base() const {
+        return _base;
+    }
+
+    /**
+     * Appends `len` bytes, which must be a whole number of pages unless they're the last.  Only
+     * what has been appended may be read.
+     */
+    Status append(const char* data, size_t len);
+
+private:
+    RefillableArena() = default;
+
+    void _handleFaults();
+    Status _refill(uint64_t page);
+    Status _copy(uint64_t offset, const char* data, size_t len);
+
+    RefillFn _refillFn;
+    int _fd = -1;
+    char* _base = nullptr;
+
+    // Only pages with some of this in them are refilled.
+    AtomicWord<uint64_t> _appended{0};
+    std::unique_ptr<char[]> _refillBuffer;
+
+    stdx::thread _faultHandler;
+    AtomicWord<bool> _shutdown{false};
+};
+
+}  // namespace mongo
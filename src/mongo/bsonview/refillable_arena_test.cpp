@@ -0,0 +1,116 @@
+/**
+ *    Copyright (C) 2019-present MongoDB, Inc.
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the Server Side Public License, version 1,
+ *    as published by MongoDB, Inc.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    Server Side Public License for more details.
+ *
+ *    You should have received a copy of the Server Side Public License
+ *    along with this program. If not, see
+ *    <http://www.mongodb.com/licensing/server-side-public-license>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the Server Side Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include <cstring>
+#include <string>
+#include <sys/mman.h>
+
+#include "mongo/bsonview/refillable_arena.h"
+#include "mongo/unittest/unittest.h"
+
+namespace mongo {
+namespace {
+
+// The arena's contents: byte i is the low byte of i / 7.
+char expected(uint64_t i) {
+    return char(i / 7);
+}
+
+bool isResident(const char* p) {
+    unsigned char vec;
+    const uint64_t page = RefillableArena::pageSize();
+    void* start = reinterpret_cast<void*>(reinterpret_cast<uintptr_t>(p) & ~(page - 1));
+    ASSERT_EQ(mincore(start, page, &vec), 0);
+    return vec & 1;
+}
+
+TEST(RefillableArenaTest, RefillsDroppedPages) {
+    uint64_t refilled = 0;
+    auto swArena = RefillableArena::make([&](uint64_t offset, char* buf, size_t len) {
+        for (size_t i = 0; i < len; i++) {
+            buf[i] = expected(offset + i);
+        }
+        refilled += len;
+        return Status::OK();
+    });
+    if (!swArena.isOK()) {
+        // Eg. in a container which doesn't allow userfaultfd.
+        return;
+    }
+    auto& arena = swArena.getValue();
+
+    // Some whole pages, then a partial one.
+    const uint64_t size = 3 * RefillableArena::kRefillSize + 100;
+    std::string data(size, '\0');
+    for (size_t i = 0; i < size; i++) {
+        data[i] = expected(i);
+    }
+    const size_t whole = 2 * RefillableArena::kRefillSize;
+    ASSERT_OK(arena->append(data.data(), whole));
+    ASSERT_OK(arena->append(data.data() + whole, size - whole));
+    ASSERT_EQ(std::string(arena->base(), size), data);
+    ASSERT_EQ(refilled, 0U);
+
+    char* base = const_cast<char*>(arena->base());
+    ASSERT_EQ(madvise(base, size, MADV_DONTNEED), 0);
+    ASSERT_FALSE(isResident(base + RefillableArena::kRefillSize));
+
+    // Touching a page brings back the block around it.
+    const uint64_t touched = RefillableArena::kRefillSize + 5;
+    ASSERT_EQ(arena->base()[touched], expected(touched));
+    ASSERT_EQ(refilled, RefillableArena::kRefillSize);
+    ASSERT_TRUE(isResident(base + 2 * RefillableArena::kRefillSize - 1));
+    ASSERT_FALSE(isResident(base));
+
+    // Only as far as was appended, and padded with zeroes.
+    ASSERT_EQ(std::string(arena->base(), size), data);
+    ASSERT_EQ(refilled, size);
+    ASSERT_EQ(arena->base()[size], '\0');
+}
+
+TEST(RefillableArenaTest, FailedRefillReadsAsZeroes) {
+    auto swArena = RefillableArena::make([](uint64_t offset, char* buf, size_t len) {
+        return Status(ErrorCodes::FileStreamFailed, "gone");
+    });
+    if (!swArena.isOK()) {
+        return;
+    }
+    auto& arena = swArena.getValue();
+
+    const std::string data(RefillableArena::pageSize(), 'x');
+    ASSERT_OK(arena->append(data.data(), data.size()));
+    ASSERT_EQ(arena->base()[0], 'x');
+    ASSERT_EQ(madvise(const_cast<char*>(arena->base()), data.size(), MADV_DONTNEED), 0);
+    ASSERT_EQ(arena->base()[0], '\0');
+}
+
+}  // namespace
+}  // namespace mongo
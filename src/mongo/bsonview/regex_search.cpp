@@ -0,0 +1,94 @@
+/**
+ *    Copyright (C) 2019-present MongoDB, Inc.
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the Server Side Public License, version 1,
+ *    as published by MongoDB, Inc.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    Server Side Public License for more details.
+ *
+ *    You should have received a copy of the Server Side Public License
+ *    along with this program. If not, see
+ *    <http://www.mongodb.com/licensing/server-side-public-license>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the Server Side Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/bsonview/regex_search.h"
+
+#include "mongo/util/str.h"
+
+namespace mongo {
+
+StatusWith<RegexSearch> RegexSearch::make(StringData pattern) {
+    const std::string terminated = pattern.toString();
+    const char* error;
+    int errorOffset;
+    std::shared_ptr<pcre> re(
+        pcre_compile(terminated.c_str(), PCRE_UTF8, &error, &errorOffset, nullptr), pcre_free);
+    if (!re) {
+        return Status(ErrorCodes::BadValue,
+                      str::stream() << "Invalid regex at " << errorOffset << ": " << error);
+    }
+
+    // (JIT compiling isn't enabled in the vendored PCRE, so this just finds what it can about the
+    // subjects that could match)
+    std::shared_ptr<pcre_extra> extra(pcre_study(re.get(), 0, &error), pcre_free_study);
+    if (error) {
+        return Status(ErrorCodes::BadValue, str::stream() << "Invalid regex: " << error);
+    }
+    return RegexSearch(std::move(re), std::move(extra));
+}
+
+RegexSearch::RegexSearch(std::shared_ptr<pcre> re, std::shared_ptr<pcre_extra> extra)
+    : _re(std::move(re)), _extra(std::move(extra)) {}
+
+bool RegexSearch::matches(const BSONObj& doc) const {
+    return _matchesObj(doc, 0);
+}
+
+bool RegexSearch::matches(StringData s) const {
+    // (no ovector, since where it matches doesn't matter, so nothing is shared between threads)
+    // Strings that aren't valid UTF-8, or that take too long to match (eg. catastrophic
+    // backtracking), don't match.
+    return pcre_exec(_re.get(), _extra.get(), s.rawData(), s.size(), 0, 0, nullptr, 0) >= 0;
+}
+
+bool RegexSearch::_matchesObj(const BSONObj& obj, int depth) const {
+    for (auto&& elem : obj) {
+        switch (elem.type()) {
+            case String:
+                // (the string is in place in the doc, and its size excludes the terminating NUL)
+                if (matches(StringData(elem.valuestr(), elem.valuestrsize() - 1))) {
+                    return true;
+                }
+                break;
+            case Object:
+            case Array:
+                if (depth < kMaxDepth && _matchesObj(elem.Obj(), depth + 1)) {
+                    return true;
+                }
+                break;
+            default:
+                break;
+        }
+    }
+    return false;
+}
+
+}  // namespace mongo
@@ -0,0 +1,74 @@
+/**
+ *    Copyright (C) 2019-present MongoDB, Inc.
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the Server Side Public License, version 1,
+ *    as published by MongoDB, Inc.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    Server Side Public License for more details.
+ *
+ *    You should have received a copy of the Server Side Public License
+ *    along with this program. If not, see
+ *    <http://www.mongodb.com/licensing/server-side-public-license>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the Server Side Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#pragma once
+
+#include <memory>
+#include <pcre.h>
+
+#include "mongo/base/status_with.h"
+#include "mongo/base/string_data.h"
+#include "mongo/bson/bsonobj.h"
+
+namespace mongo {
+
+/**
+ * Looks for a (PCRE) regex in the string values of a doc, at any depth, straight from the doc's
+ * bytes rather than rendering it.  Field names and values of other types aren't looked in.
+ *
+ * The pattern is compiled and studied once, and only read after that, so matches() can be called
+ * from any number of threads at once.
+ */
+class RegexSearch {
+public:
+    /**
+     * Strings nested deeper than this aren't looked in.
+     */
+    static constexpr int kMaxDepth = 100;
+
+    /**
+     * Fails if the pattern doesn't compile.  Options can be given inline, eg. "(?i)error".
+     */
+    static StatusWith<RegexSearch> make(StringData pattern);
+
+    bool matches(const BSONObj& doc) const;
+
+    bool matches(StringData s) const;
+
+private:
+    RegexSearch(std::shared_ptr<pcre> re, std::shared_ptr<pcre_extra> extra);
+
+    bool _matchesObj(const BSONObj& obj, int depth) const;
+
+    std::shared_ptr<pcre> _re;
+    // What studying the pattern found (eg. the bytes a match can start with), if anything.
+    std::shared_ptr<pcre_extra> _extra;
+};
+
+}  // namespace mongo
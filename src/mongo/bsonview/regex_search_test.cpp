@@ -0,0 +1,96 @@
+/**
+ *    Copyright (C) 2019-present MongoDB, Inc.
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the Server Side Public License, version 1,
+ *    as published by MongoDB, Inc.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    Server Side Public License for more details.
+ *
+ *    You should have received a copy of the Server Side Public License
+ *    along with this program. If not, see
+ *    <http://www.mongodb.com/licensing/server-side-public-license>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the Server Side Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include <string>
+
+#include "mongo/bson/bsonobjbuilder.h"
+#include "mongo/bsonview/regex_search.h"
+#include "mongo/unittest/unittest.h"
+
+namespace mongo {
+namespace {
+
+RegexSearch makeSearch(StringData pattern) {
+    auto search = RegexSearch::make(pattern);
+    ASSERT_OK(search.getStatus());
+    return std::move(search.getValue());
+}
+
+TEST(RegexSearchTest, LooksInStringsAtAnyDepth) {
+    RegexSearch search = makeSearch("conn[0-9]+");
+    BSONObj top = BSON("ctx" << "conn123");
+    BSONObj nested = BSON("a" << BSON("b" << BSON_ARRAY(1 << "x" << BSON("c" << "at conn7 ok"))));
+    BSONObj none = BSON("ctx" << "connection" << "n" << 12);
+    ASSERT(search.matches(top));
+    ASSERT(search.matches(nested));
+    ASSERT(!search.matches(none));
+    ASSERT(!search.matches(BSONObj()));
+}
+
+TEST(RegexSearchTest, OnlyLooksInStringValues) {
+    RegexSearch search = makeSearch("^12");
+    BSONObj fieldName = BSON("12" << "x");
+    BSONObj number = BSON("n" << 123);
+    BSONObj code = BSON("c" << BSONCode("12"));
+    BSONObj string = BSON("s" << "123");
+    ASSERT(!search.matches(fieldName));
+    ASSERT(!search.matches(number));
+    ASSERT(!search.matches(code));
+    ASSERT(search.matches(string));
+}
+
+TEST(RegexSearchTest, AnchorsApplyToEachString) {
+    RegexSearch search = makeSearch("^b.*c$");
+    BSONObj split = BSON("x" << "ab" << "y" << "cd");
+    BSONObj whole = BSON("x" << "a" << "y" << "bxc");
+    ASSERT(!search.matches(split));
+    ASSERT(search.matches(whole));
+}
+
+TEST(RegexSearchTest, InlineOptions) {
+    ASSERT(!makeSearch("error").matches(StringData("ERROR: oops")));
+    ASSERT(makeSearch("(?i)error").matches(StringData("ERROR: oops")));
+}
+
+TEST(RegexSearchTest, Utf8) {
+    RegexSearch search = makeSearch("^caf.$");
+    ASSERT(search.matches(StringData("caf\xc3\xa9")));
+    // (invalid UTF-8 doesn't match, rather than failing)
+    ASSERT(!search.matches(StringData("caf\xc3")));
+}
+
+TEST(RegexSearchTest, InvalidPattern) {
+    ASSERT_NOT_OK(RegexSearch::make("a(b").getStatus());
+    ASSERT_NOT_OK(RegexSearch::make("*").getStatus());
+}
+
+}  // namespace
+}  // namespace mongo
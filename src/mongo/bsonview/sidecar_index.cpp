@@ -0,0 +1,347 @@
+/**
+ *    Copyright (C) 2019-present MongoDB, Inc.
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the Server Side Public License, version 1,
+ *    as published by MongoDB, Inc.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    Server Side Public License for more details.
+ *
+ *    You should have received a copy of the Server Side Public License
+ *    along with this program. If not, see
+ *    <http://www.mongodb.com/licensing/server-side-public-license>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the Server Side Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/bsonview/sidecar_index.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "mongo/base/data_view.h"
+#include "mongo/util/errno_util.h"
+#include "mongo/util/hex.h"
+#include "mongo/util/str.h"
+#include <third_party/murmurhash3/MurmurHash3.h>
+
+namespace mongo {
+
+namespace {
+
+constexpr char kMagic[8] = {'B', 'S', 'O', 'N', 'V', 'I', 'D', 'X'};
+constexpr uint32_t kFlagComplete = 1;
+
+/**
+ * The fixed size header at the start of a sidecar file.  Offsets are from the start of the file,
+ * and are multiples of 8.  All in native (little endian) byte order.
+ */
+struct SidecarHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t docsPerBlock;
+    uint64_t fileSize;
+    int64_t mtimeSecs;
+    int64_t mtimeNanos;
+    uint64_t headHash;
+    // End of the last indexed document, and a hash of the kHashedBytes before it.
+    uint64_t indexedEnd;
+    uint64_t indexedEndHash;
+    uint64_t numDocs;
+    uint32_t flags;
+    uint32_t reserved;
+    uint64_t indexOffset;
+    uint64_t indexLength;
+};
+
+uint64_t hashBytes(const char* p, size_t len) {
+    uint64_t out[2];
+    MurmurHash3_x64_128(p, len, 0, out);
+    return out[0];
+}
+
+uint64_t hashBefore(const char* base, uint64_t end) {
+    const uint64_t len = std::min<uint64_t>(end, SidecarIndex::kHashedBytes);
+    return hashBytes(base + end - len, len);
+}
+
+Status writeFully(int fd, const char* p, size_t len) {
+    while (len > 0) {
+        const ssize_t n = ::write(fd, p, len);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return {ErrorCodes::FileStreamFailed, errnoWithDescription()};
+        }
+        p += n;
+        len -= n;
+    }
+    return Status::OK();
+}
+
+std::string cacheDirectory() {
+    if (const char* xdg = getenv("XDG_CACHE_HOME"); xdg && *xdg) {
+        return str::stream() << xdg << "/bsonview";
+    }
+    if (const char* home = getenv("HOME"); home && *home) {
+        return str::stream() << home << "/.cache/bsonview";
+    }
+    return "";
+}
+
+}  // namespace
+
+SidecarIndex::~SidecarIndex() {
+    if (_mapping) {
+        munmap(_mapping, _mappingSize);
+    }
+}
+
+SidecarFileIdentity SidecarIndex::identify(const struct stat& sb, const char* base) {
+    SidecarFileIdentity identity;
+    identity.fileSize = sb.st_size;
+    identity.mtimeSecs = sb.st_mtim.tv_sec;
+    identity.mtimeNanos = sb.st_mtim.tv_nsec;
+    identity.headHash =
+        hashBytes(base, std::min<uint64_t>(identity.fileSize, kHashedBytes));
+    return identity;
+}
+
+std::vector<std::string> SidecarIndex::candidatePaths(const std::string& dataFile) {
+    std::vector<std::string> paths{dataFile + ".bvidx"};
+
+    const std::string dir = cacheDirectory();
+    if (dir.empty()) {
+        return paths;
+    }
+
+    // Name the cached copy after the file, plus a hash of its full path so that files with the
+    // same name in different directories don't collide.
+    std::string fullPath = dataFile;
+    if (char* resolved = realpath(dataFile.c_str(), nullptr)) {
+        fullPath = resolved;
+        free(resolved);
+    }
+    const auto slash = fullPath.rfind('/');
+    const std::string name = slash == std::string::npos ? fullPath : fullPath.substr(slash + 1);
+    const uint64_t pathHash = hashBytes(fullPath.data(), fullPath.size());
+    paths.push_back(str::stream() << dir << "/" << name << "." << toHexLower(&pathHash, sizeof(pathHash))
+                                  << ".bvidx");
+    return paths;
+}
+
+StatusWith<std::unique_ptr<SidecarIndex>> SidecarIndex::open(const std::string& dataFile,
+                                                             const SidecarFileIdentity& identity,
+                                                             const char* base) {
+    Status firstError(ErrorCodes::FileNotOpen, "No sidecar index");
+    for (const auto& path : candidatePaths(dataFile)) {
+        auto swSidecar = _open(path, identity, base);
+        if (swSidecar.isOK()) {
+            return swSidecar;
+        }
+        if (firstError.code() == ErrorCodes::FileNotOpen) {
+            firstError = swSidecar.getStatus();
+        }
+    }
+    return firstError;
+}
+
+StatusWith<std::unique_ptr<SidecarIndex>> SidecarIndex::_open(const std::string& path,
+                                                              const SidecarFileIdentity& identity,
+                                                              const char* base) {
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return {ErrorCodes::FileNotOpen,
+                str::stream() << "Can't open " << path << ": " << errnoWithDescription()};
+    }
+
+    struct stat sb;
+    if (fstat(fd, &sb) != 0 || size_t(sb.st_size) < sizeof(SidecarHeader)) {
+        ::close(fd);
+        return {ErrorCodes::BadValue, str::stream() << path << " is too short"};
+    }
+
+    void* mapping = mmap(nullptr, sb.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED) {
+        return {ErrorCodes::FileNotOpen,
+                str::stream() << "Can't map " << path << ": " << errnoWithDescription()};
+    }
+
+    std::unique_ptr<SidecarIndex> sidecar(new SidecarIndex());
+    sidecar->_path = path;
+    sidecar->_mapping = mapping;
+    sidecar->_mappingSize = sb.st_size;
+
+    const char* data = static_cast<const char*>(mapping);
+    SidecarHeader header;
+    memcpy(&header, data, sizeof(header));
+
+    if (memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 || header.version != kVersion ||
+        header.docsPerBlock != DocumentOffsetIndex::kDocsPerBlock) {
+        return {ErrorCodes::BadValue,
+                str::stream() << path << " is not a version " << kVersion << " sidecar index"};
+    }
+
+    const uint64_t fileLen = sb.st_size;
+    if (header.indexOffset % 8 || header.indexOffset > fileLen ||
+        header.indexLength > fileLen - header.indexOffset) {
+        return {ErrorCodes::BadValue, str::stream() << path << " is corrupt"};
+    }
+
+    // The index applies if the file is unchanged, or if it has only been appended to since (in
+    // which case the index covers a prefix of it).
+    if (header.fileSize > identity.fileSize || header.indexedEnd > header.fileSize) {
+        return {ErrorCodes::BadValue, str::stream() << path << " is for a different file"};
+    }
+    // When the file was smaller than kHashedBytes, less of it was hashed.
+    const uint64_t headHash = header.fileSize == identity.fileSize
+        ? identity.headHash
+        : hashBytes(base, std::min<uint64_t>(header.fileSize, kHashedBytes));
+    if (header.headHash != headHash) {
+        return {ErrorCodes::BadValue, str::stream() << path << " is for a different file"};
+    }
+    const bool unchanged = header.fileSize == identity.fileSize &&
+        header.mtimeSecs == identity.mtimeSecs && header.mtimeNanos == identity.mtimeNanos;
+    if (!unchanged && header.indexedEndHash != hashBefore(base, header.indexedEnd)) {
+        return {ErrorCodes::BadValue, str::stream() << path << " is out of date"};
+    }
+
+    // (indexedEnd is within the file, as checked above, so all the offsets are too)
+    auto swIndex = DocumentOffsetIndex::view(
+        ConstDataRange(data + header.indexOffset, header.indexLength), header.indexedEnd);
+    if (!swIndex.isOK()) {
+        return swIndex.getStatus();
+    }
+    if (swIndex.getValue().size() != header.numDocs || header.numDocs == 0) {
+        return {ErrorCodes::BadValue, str::stream() << path << " is corrupt"};
+    }
+    // The last doc should be the one that ends at indexedEnd.
+    const uint64_t last = swIndex.getValue().back();
+    if (header.indexedEnd - last < 4 ||
+        ConstDataView(base + last).read<LittleEndian<int32_t>>() !=
+            int64_t(header.indexedEnd - last)) {
+        return {ErrorCodes::BadValue, str::stream() << path << " is corrupt"};
+    }
+    sidecar->_index = std::move(swIndex.getValue());
+    sidecar->_indexedEnd = header.indexedEnd;
+
+    return {std::move(sidecar)};
+}
+
+Status SidecarIndex::write(const std::string& dataFile,
+                           const SidecarFileIdentity& identity,
+                           const char* base,
+                           const DocumentOffsetIndex& index,
+                           uint64_t indexedEnd) {
+    Status firstError = Status::OK();
+    for (const auto& path : candidatePaths(dataFile)) {
+        const auto slash = path.rfind('/');
+        if (slash != std::string::npos && path.compare(0, slash, cacheDirectory()) == 0) {
+            // Best effort; if this fails then so will the write.
+            const std::string dir = path.substr(0, slash);
+            ::mkdir(dir.substr(0, dir.rfind('/')).c_str(), 0755);
+            ::mkdir(dir.c_str(), 0755);
+        }
+
+        Status s = _write(path, identity, base, index, indexedEnd);
+        if (s.isOK()) {
+            return s;
+        }
+        if (firstError.isOK()) {
+            firstError = s;
+        }
+    }
+    return firstError;
+}
+
+Status SidecarIndex::_write(const std::string& path,
+                            const SidecarFileIdentity& identity,
+                            const char* base,
+                            const DocumentOffsetIndex& index,
+                            uint64_t indexedEnd) {
+    // Write to a temporary file and rename it into place, so that readers never see a partially
+    // written sidecar.
+    const std::string tmpPath = str::stream() << path << ".tmp." << getpid();
+    int fd = ::open(tmpPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        return {ErrorCodes::FileNotOpen,
+                str::stream() << "Can't create " << tmpPath << ": " << errnoWithDescription()};
+    }
+
+    auto fail = [&](const Status& s) {
+        ::close(fd);
+        ::unlink(tmpPath.c_str());
+        return Status(s.code(), str::stream() << "Can't write " << path << ": " << s.reason());
+    };
+
+    SidecarHeader header{};
+    memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kVersion;
+    header.docsPerBlock = DocumentOffsetIndex::kDocsPerBlock;
+    header.fileSize = identity.fileSize;
+    header.mtimeSecs = identity.mtimeSecs;
+    header.mtimeNanos = identity.mtimeNanos;
+    header.headHash = identity.headHash;
+    header.indexedEnd = indexedEnd;
+    header.indexedEndHash = hashBefore(base, indexedEnd);
+    header.numDocs = index.size();
+    header.flags = indexedEnd == identity.fileSize ? kFlagComplete : 0;
+    header.indexOffset = sizeof(header);
+
+    // The header is rewritten once the index length is known.
+    Status s = writeFully(fd, reinterpret_cast<const char*>(&header), sizeof(header));
+    if (!s.isOK()) {
+        return fail(s);
+    }
+
+    uint64_t written = 0;
+    s = index.serialize([&](ConstDataRange piece) {
+        written += piece.length();
+        return writeFully(fd, piece.data(), piece.length());
+    });
+    if (!s.isOK()) {
+        return fail(s);
+    }
+    header.indexLength = written;
+
+    if (pwrite(fd, &header, sizeof(header), 0) != sizeof(header)) {
+        return fail({ErrorCodes::FileStreamFailed, errnoWithDescription()});
+    }
+    if (::close(fd) != 0) {
+        auto errorString = errnoWithDescription();
+        ::unlink(tmpPath.c_str());
+        return {ErrorCodes::FileStreamFailed,
+                str::stream() << "Can't write " << path << ": " << errorString};
+    }
+    if (::rename(tmpPath.c_str(), path.c_str()) != 0) {
+        auto errorString = errnoWithDescription();
+        ::unlink(tmpPath.c_str());
+        return {ErrorCodes::FileRenameFailed,
+                str::stream() << "Can't rename " << tmpPath << " to " << path << ": "
+                              << errorString};
+    }
+    return Status::OK();
+}
+
+}  // namespace mongo
@@ -0,0 +1,144 @@
+/**
+ *    Copyright (C) 2019-present MongoDB, Inc.
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the Server Side Public License, version 1,
+ *    as published by MongoDB, Inc.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    Server Side Public License for more details.
+ *
+ *    You should have received a copy of the Server Side Public License
+ *    along with this program. If not, see
+ *    <http://www.mongodb.com/licensing/server-side-public-license>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the Server Side Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "mongo/base/status_with.h"
+#include "mongo/bsonview/offset_index.h"
+
+struct stat;
+
+namespace mongo {
+
+/**
+ * What a sidecar index records about the data file it was built from, so that it can tell
+ * whether it still applies.
+ */
+struct SidecarFileIdentity {
+    uint64_t fileSize = 0;
+    int64_t mtimeSecs = 0;
+    int64_t mtimeNanos = 0;
+    // Hash of the first kHashedBytes of the file.
+    uint64_t headHash = 0;
+};
+
+/**
+ * A persistent copy of the document offset index of a BSON file, stored in a ".bvidx" file
+ * alongside it (or, if that isn't writable, under ~/.cache/bsonview), so that reopening the file
+ * doesn't need to rescan it.
+ *
+ * The sidecar is mmapped, and the offset index is used directly from the mapping, so opening
+ * it is O(1) in the size of the data file.
+ *
+ * A sidecar for a file which has since been appended to (eg. a log that is still being written)
+ * is still usable for the part of the file that it covers, provided the data just before the end
+ * of that part is unchanged.
+ *
+ * Opening one only checks that its offsets are in order and within that part of the file.
+ * Checking that each is a document would read the whole file, so that's left to whoever reads
+ * them, before each is first used.
+ */
+class SidecarIndex {
+    SidecarIndex(const SidecarIndex&) = delete;
+    SidecarIndex& operator=(const SidecarIndex&) = delete;
+
+public:
+    static constexpr uint32_t kVersion = 2;
+    static constexpr size_t kHashedBytes = 64 * 1024;
+
+    ~SidecarIndex();
+
+    static SidecarFileIdentity identify(const struct stat& sb, const char* base);
+
+    /**
+     * Where the sidecar for `dataFile` may live, most preferred first.
+     */
+    static std::vector<std::string> candidatePaths(const std::string& dataFile);
+
+    /**
+     * Finds and validates the sidecar index for `dataFile`, whose current contents are mapped at
+     * `base` and are described by `identity`.
+     */
+    static StatusWith<std::unique_ptr<SidecarIndex>> open(const std::string& dataFile,
+                                                          const SidecarFileIdentity& identity,
+                                                          const char* base);
+
+    /**
+     * Writes a sidecar index for `dataFile`, describing the documents in [0, indexedEnd).
+     */
+    static Status write(const std::string& dataFile,
+                        const SidecarFileIdentity& identity,
+                        const char* base,
+                        const DocumentOffsetIndex& index,
+                        uint64_t indexedEnd);
+
+    const std::string& path() const {
+        return _path;
+    }
+
+    /**
+     * The offset index, which reads from this sidecar's mapping (so must not outlive it).
+     */
+    DocumentOffsetIndex& index() {
+        return _index;
+    }
+
+    /**
+     * Offset just past the end of the last document in the index.
+     */
+    uint64_t indexedEnd() const {
+        return _indexedEnd;
+    }
+
+private:
+    SidecarIndex() = default;
+
+    static StatusWith<std::unique_ptr<SidecarIndex>> _open(const std::string& path,
+                                                           const SidecarFileIdentity& identity,
+                                                           const char* base);
+    static Status _write(const std::string& path,
+                         const SidecarFileIdentity& identity,
+                         const char* base,
+                         const DocumentOffsetIndex& index,
+                         uint64_t indexedEnd);
+
+    std::string _path;
+    void* _mapping = nullptr;
+    size_t _mappingSize = 0;
+
+    DocumentOffsetIndex _index;
+    uint64_t _indexedEnd = 0;
+};
+
+}  // namespace mongo
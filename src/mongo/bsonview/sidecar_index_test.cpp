@@ -0,0 +1,177 @@
+/**
+ *    Copyright (C) 2019-present MongoDB, Inc.
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the Server Side Public License, version 1,
+ *    as published by MongoDB, Inc.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    Server Side Public License for more details.
+ *
+ *    You should have received a copy of the Server Side Public License
+ *    along with this program. If not, see
+ *    <http://www.mongodb.com/licensing/server-side-public-license>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the Server Side Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include <string>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+#include "mongo/bson/bsonobjbuilder.h"
+#include "mongo/bsonview/sidecar_index.h"
+#include "mongo/unittest/temp_dir.h"
+#include "mongo/unittest/unittest.h"
+
+namespace mongo {
+namespace {
+
+/**
+ * A file's worth of BSON docs, and an index of them.
+ */
+struct TestFile {
+    explicit TestFile(size_t numDocs) {
+        for (size_t i = 0; i < numDocs; i++) {
+            BSONObj doc = BSON("_id" << int(i) << "s" << std::string(i % 50, 'x'));
+            index.append(data.size());
+            data.append(doc.objdata(), doc.objsize());
+        }
+    }
+
+    SidecarFileIdentity identity() const {
+        struct stat sb = {};
+        sb.st_size = data.size();
+        sb.st_mtim.tv_sec = 1234;
+        sb.st_mtim.tv_nsec = 5678;
+        return SidecarIndex::identify(sb, data.data());
+    }
+
+    std::string data;
+    DocumentOffsetIndex index;
+};
+
+void assertSameIndex(const DocumentOffsetIndex& a, const DocumentOffsetIndex& b) {
+    ASSERT_EQ(a.size(), b.size());
+    for (size_t i = 0; i < a.size(); i++) {
+        ASSERT_EQ(a[i], b[i]);
+    }
+}
+
+TEST(SidecarIndexTest, WriteAndOpen) {
+    unittest::TempDir dir("sidecar_index_test");
+    const std::string dataFile = dir.path() + "/data.bson";
+    TestFile file(10000);
+
+    ASSERT_OK(SidecarIndex::write(
+        dataFile, file.identity(), file.data.data(), file.index, file.data.size()));
+
+    auto swSidecar = SidecarIndex::open(dataFile, file.identity(), file.data.data());
+    ASSERT_OK(swSidecar.getStatus());
+    auto& sidecar = swSidecar.getValue();
+    ASSERT_EQ(sidecar->path(), dataFile + ".bvidx");
+    ASSERT_EQ(sidecar->indexedEnd(), file.data.size());
+    assertSameIndex(sidecar->index(), file.index);
+}
+
+TEST(SidecarIndexTest, Missing) {
+    unittest::TempDir dir("sidecar_index_test");
+    TestFile file(10);
+    ASSERT_NOT_OK(
+        SidecarIndex::open(dir.path() + "/data.bson", file.identity(), file.data.data())
+            .getStatus());
+}
+
+TEST(SidecarIndexTest, RejectsDifferentFile) {
+    unittest::TempDir dir("sidecar_index_test");
+    const std::string dataFile = dir.path() + "/data.bson";
+    TestFile file(1000);
+    ASSERT_OK(SidecarIndex::write(
+        dataFile, file.identity(), file.data.data(), file.index, file.data.size()));
+
+    // Same size, different contents.
+    TestFile other(1000);
+    other.data[10] ^= 1;
+    ASSERT_NOT_OK(
+        SidecarIndex::open(dataFile, other.identity(), other.data.data()).getStatus());
+
+    // Shorter.
+    TestFile shorter(999);
+    ASSERT_NOT_OK(
+        SidecarIndex::open(dataFile, shorter.identity(), shorter.data.data()).getStatus());
+}
+
+TEST(SidecarIndexTest, ReusedForAppendedFile) {
+    unittest::TempDir dir("sidecar_index_test");
+    const std::string dataFile = dir.path() + "/data.bson";
+    TestFile file(1000);
+    ASSERT_OK(SidecarIndex::write(
+        dataFile, file.identity(), file.data.data(), file.index, file.data.size()));
+
+    TestFile grown(2000);
+    auto swSidecar = SidecarIndex::open(dataFile, grown.identity(), grown.data.data());
+    ASSERT_OK(swSidecar.getStatus());
+    ASSERT_EQ(swSidecar.getValue()->indexedEnd(), file.data.size());
+    assertSameIndex(swSidecar.getValue()->index(), file.index);
+
+    // The indexed part was rewritten, not appended to.
+    grown.data[file.data.size() - 10] ^= 1;
+    ASSERT_NOT_OK(
+        SidecarIndex::open(dataFile, grown.identity(), grown.data.data()).getStatus());
+}
+
+TEST(SidecarIndexTest, RejectsCorruptSidecar) {
+    unittest::TempDir dir("sidecar_index_test");
+    const std::string dataFile = dir.path() + "/data.bson";
+    TestFile file(1000);
+    ASSERT_OK(SidecarIndex::write(
+        dataFile, file.identity(), file.data.data(), file.index, file.data.size()));
+
+    const std::string sidecarFile = dataFile + ".bvidx";
+    struct stat sb;
+    ASSERT_EQ(::stat(sidecarFile.c_str(), &sb), 0);
+    ASSERT_EQ(::truncate(sidecarFile.c_str(), sb.st_size - 8), 0);
+    ASSERT_NOT_OK(
+        SidecarIndex::open(dataFile, file.identity(), file.data.data()).getStatus());
+}
+
+TEST(SidecarIndexTest, RejectsOffsetsOutsideFile) {
+    unittest::TempDir dir("sidecar_index_test");
+    const std::string dataFile = dir.path() + "/data.bson";
+    TestFile file(1000);
+
+    // An offset past the end of what's indexed.
+    DocumentOffsetIndex past;
+    for (size_t i = 0; i < file.index.size(); i++) {
+        past.append(file.index[i]);
+    }
+    past.append(file.data.size() + 100);
+    ASSERT_OK(
+        SidecarIndex::write(dataFile, file.identity(), file.data.data(), past, file.data.size()));
+    ASSERT_NOT_OK(
+        SidecarIndex::open(dataFile, file.identity(), file.data.data()).getStatus());
+
+    // The last doc doesn't end where the index says.
+    ASSERT_OK(SidecarIndex::write(
+        dataFile, file.identity(), file.data.data(), file.index, file.data.size() - 1));
+    ASSERT_NOT_OK(
+        SidecarIndex::open(dataFile, file.identity(), file.data.data()).getStatus());
+}
+
+}  // namespace
+}  // namespace mongo
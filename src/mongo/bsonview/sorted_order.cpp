@@ -0,0 +1,412 @@
+/**
+ *    Copyright (C) 2019-present MongoDB, Inc.
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the Server Side Public License, version 1,
+ *    as published by MongoDB, Inc.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    Server Side Public License for more details.
+ *
+ *    You should have received a copy of the Server Side Public License
+ *    along with this program. If not, see
+ *    <http://www.mongodb.com/licensing/server-side-public-license>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the Server Side Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/bsonview/sorted_order.h"
+
+#include <algorithm>
+#include <boost/filesystem/operations.hpp>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "mongo/bson/bsonobjbuilder.h"
+#include "mongo/bson/json.h"
+#include "mongo/db/bson/dotted_path_support.h"
+#include "mongo/db/storage/key_string.h"
+#include "mongo/util/assert_util.h"
+#include "mongo/util/bufreader.h"
+#include "mongo/util/concurrency/thread_pool.h"
+#include "mongo/util/errno_util.h"
+#include "mongo/util/str.h"
+
+namespace mongo {
+
+namespace {
+
+// The Sorter needs this to name the files it spills to.
+std::string nextFileName() {
+    static AtomicWord<unsigned> sortedOrderFileCounter;
+    return "extsort-bsonview." + std::to_string(sortedOrderFileCounter.fetchAndAdd(1));
+}
+
+Status writeFully(int fd, const char* p, size_t len) {
+    while (len > 0) {
+        const ssize_t n = ::write(fd, p, len);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return {ErrorCodes::FileStreamFailed, errnoWithDescription()};
+        }
+        p += n;
+        len -= n;
+    }
+    return Status::OK();
+}
+
+}  // namespace
+
+/**
+ * The bytes of a KeyString (without its TypeBits, since it's never turned back into BSON).
+ */
+class SortedOrder::Key {
+public:
+    Key() = default;
+    Key(const char* data, size_t size) : _bytes(data, size) {}
+
+    int compare(const Key& other) const {
+        const size_t common = std::min(_bytes.size(), other._bytes.size());
+        const int cmp = common ? memcmp(_bytes.data(), other._bytes.data(), common) : 0;
+        if (cmp || _bytes.size() == other._bytes.size()) {
+            return cmp;
+        }
+        return _bytes.size() < other._bytes.size() ? -1 : 1;
+    }
+
+    struct SorterDeserializeSettings {};
+    void serializeForSorter(BufBuilder& buf) const {
+        buf.appendNum(static_cast<int>(_bytes.size()));
+        buf.appendBuf(_bytes.data(), _bytes.size());
+    }
+    static Key deserializeForSorter(BufReader& buf, const SorterDeserializeSettings&) {
+        const int size = buf.read<LittleEndian<int>>();
+        return Key(static_cast<const char*>(buf.skip(size)), size);
+    }
+    int memUsageForSorter() const {
+        return sizeof(Key) + _bytes.size();
+    }
+    Key getOwned() const {
+        return *this;
+    }
+
+private:
+    std::string _bytes;
+};
+
+class SortedOrder::DocNumber {
+public:
+    DocNumber(uint64_t doc = 0) : _doc(doc) {}
+    operator uint64_t() const {
+        return _doc;
+    }
+
+    struct SorterDeserializeSettings {};
+    void serializeForSorter(BufBuilder& buf) const {
+        buf.appendNum(static_cast<long long>(_doc));
+    }
+    static DocNumber deserializeForSorter(BufReader& buf, const SorterDeserializeSettings&) {
+        return static_cast<uint64_t>(buf.read<LittleEndian<long long>>().value);
+    }
+    int memUsageForSorter() const {
+        return sizeof(DocNumber);
+    }
+    DocNumber getOwned() const {
+        return *this;
+    }
+
+private:
+    uint64_t _doc;
+};
+
+/**
+ * By key, then (so that docs with the same values stay in file order) by doc number.
+ */
+class SortedOrder::Comparator {
+public:
+    int operator()(const std::pair<Key, DocNumber>& lhs,
+                   const std::pair<Key, DocNumber>& rhs) const {
+        const int cmp = lhs.first.compare(rhs.first);
+        if (cmp) {
+            return cmp;
+        }
+        const uint64_t l = lhs.second;
+        const uint64_t r = rhs.second;
+        return l < r ? -1 : (l > r ? 1 : 0);
+    }
+};
+
+StatusWith<BSONObj> SortedOrder::parseSpec(StringData json) {
+    BSONObj spec;
+    try {
+        spec = fromjson(json.toString());
+    } catch (const DBException& e) {
+        return e.toStatus();
+    }
+
+    if (spec.isEmpty()) {
+        return Status(ErrorCodes::BadValue, "Sort by which fields?");
+    }
+    if (static_cast<size_t>(spec.nFields()) > Ordering::kMaxCompoundIndexKeys) {
+        return Status(ErrorCodes::BadValue,
+                      str::stream() << "Can't sort by more than "
+                                    << Ordering::kMaxCompoundIndexKeys << " fields");
+    }
+    for (auto&& field : spec) {
+        if (!field.isNumber() || (field.numberDouble() != 1 && field.numberDouble() != -1)) {
+            return Status(ErrorCodes::BadValue,
+                          str::stream() << "Sort " << field.fieldNameStringData()
+                                        << " by 1 (ascending) or -1 (descending)");
+        }
+    }
+    return spec;
+}
+
+SortedOrder::SortedOrder(BSONObj spec, std::string tempDir, size_t maxMemoryUsageBytes)
+    : _spec(spec.getOwned()), _ordering(Ordering::make(_spec)), _tempDir(std::move(tempDir)) {
+    const SortOptions options = SortOptions()
+                                    .MaxMemoryUsageBytes(maxMemoryUsageBytes)
+                                    .ExtSortAllowed(!_tempDir.empty())
+                                    .TempDir(_tempDir);
+    _sorter.reset(Sorter<Key, DocNumber>::make(options, Comparator()));
+
+    // (one worker, since the Sorter isn't thread-safe, and the keys must be sorted after them all)
+    ThreadPool::Options poolOptions;
+    poolOptions.poolName = "bsonview sort";
+    poolOptions.threadNamePrefix = "bsonview-sort-";
+    poolOptions.minThreads = 0;
+    poolOptions.maxThreads = 1;
+    _pool = std::make_unique<ThreadPool>(poolOptions);
+    _pool->startup();
+}
+
+SortedOrder::~SortedOrder() {
+    cancel();
+    _sorter.reset();
+    if (_windowsFd >= 0) {
+        ::close(_windowsFd);
+    }
+
+    // The Sorter creates the directory if it spills at all.
+    boost::system::error_code ec;
+    if (!_tempDir.empty() && boost::filesystem::is_empty(_tempDir, ec)) {
+        boost::filesystem::remove(_tempDir, ec);
+    }
+}
+
+void SortedOrder::add(std::vector<BSONObj> docs) {
+    uint64_t first;
+    {
+        stdx::lock_guard<stdx::mutex> lk(_mutex);
+        invariant(!_finished);
+        _pendingBatches++;
+        first = _nextDoc;
+        _nextDoc += docs.size();
+    }
+
+    auto shared = std::make_shared<std::vector<BSONObj>>(std::move(docs));
+    _pool->schedule([this, first, shared](Status status) {
+        if (status.isOK()) {
+            _makeKeys(first, *shared);
+        }
+        stdx::lock_guard<stdx::mutex> lk(_mutex);
+        _pendingBatches--;
+    });
+}
+
+bool SortedOrder::wantsMore() const {
+    stdx::lock_guard<stdx::mutex> lk(_mutex);
+    return !_finished && !_done && _pendingBatches < kMaxPendingBatches;
+}
+
+void SortedOrder::finish() {
+    {
+        stdx::lock_guard<stdx::mutex> lk(_mutex);
+        _finished = true;
+    }
+    // (after all the batches, since there's only the one worker)
+    _pool->schedule([this](Status status) {
+        if (status.isOK()) {
+            _sort();
+        }
+    });
+}
+
+void SortedOrder::cancel() {
+    if (_pool) {
+        _cancelled.store(true);
+        _pool->shutdown();
+        _pool->join();
+        _pool.reset();
+    }
+}
+
+bool SortedOrder::isDone() const {
+    stdx::lock_guard<stdx::mutex> lk(_mutex);
+    return _done;
+}
+
+Status SortedOrder::getStatus() const {
+    stdx::lock_guard<stdx::mutex> lk(_mutex);
+    return _status;
+}
+
+bool SortedOrder::usedDisk() const {
+    stdx::lock_guard<stdx::mutex> lk(_mutex);
+    return _done && _status.isOK() && _sorter->usedDisk();
+}
+
+uint64_t SortedOrder::doc(uint64_t row) {
+    invariant(row < numDocs());
+    if (_windowsFd < 0) {
+        return _docs[row];
+    }
+    _readWindow(row / kRowsPerWindow);
+    return _docs[row % kRowsPerWindow];
+}
+
+uint64_t SortedOrder::row(uint64_t doc, const BSONObj& obj) {
+    invariant(doc < numDocs());
+    // The window it's in is the last to start before it.
+    const std::pair<Key, DocNumber> target(_makeKey(obj), doc);
+    const auto next = std::upper_bound(
+        _windowStarts.begin(),
+        _windowStarts.end(),
+        target,
+        [](const auto& lhs, const auto& rhs) { return Comparator()(lhs, rhs) < 0; });
+    const uint64_t first =
+        next == _windowStarts.begin() ? 0 : (next - _windowStarts.begin() - 1) * kRowsPerWindow;
+    const uint64_t end = std::min(first + kRowsPerWindow, numDocs());
+    for (uint64_t row = first; row < end; row++) {
+        if (this->doc(row) == doc) {
+            return row;
+        }
+    }
+    // (obj isn't what doc was when it was sorted)
+    return first;
+}
+
+SortedOrder::Key SortedOrder::_makeKey(const BSONObj& obj) const {
+    // (a missing field sorts as null, as it does for find())
+    BSONObjBuilder values;
+    for (auto&& field : _spec) {
+        BSONElement value =
+            dotted_path_support::extractElementAtPath(obj, field.fieldNameStringData());
+        if (value.eoo()) {
+            values.appendNull("");
+        } else {
+            values.appendAs(value, "");
+        }
+    }
+    KeyString key(KeyString::Version::V1, values.done(), _ordering);
+    return Key(key.getBuffer(), key.getSize());
+}
+
+void SortedOrder::_makeKeys(uint64_t first, const std::vector<BSONObj>& docs) {
+    try {
+        uint64_t doc = first;
+        for (auto&& obj : docs) {
+            if (_cancelled.load()) {
+                return;
+            }
+            _sorter->add(_makeKey(obj), DocNumber(doc++));
+            _docsKeyed.fetchAndAdd(1);
+        }
+    } catch (const DBException& e) {
+        // (eg. no space left to spill to, so there's no point in going on)
+        _cancelled.store(true);
+        stdx::lock_guard<stdx::mutex> lk(_mutex);
+        _status = e.toStatus();
+        _done = true;
+    }
+}
+
+void SortedOrder::_sort() {
+    Status status = Status::OK();
+    if (!_cancelled.load()) {
+        try {
+            // (the iterator removes the files the sorter spilled to, once they've been read)
+            std::unique_ptr<SortIteratorInterface<Key, DocNumber>> sorted(_sorter->done());
+            _writeWindows(sorted.get());
+        } catch (const DBException& e) {
+            status = e.toStatus();
+        }
+    }
+
+    stdx::lock_guard<stdx::mutex> lk(_mutex);
+    if (_status.isOK()) {
+        _status = status;
+    }
+    _done = true;
+}
+
+void SortedOrder::_writeWindows(SortIteratorInterface<Key, DocNumber>* sorted) {
+    // If the keys fitted in memory, so do the docs.
+    if (_sorter->usedDisk()) {
+        const std::string path = str::stream() << _tempDir << "/" << nextFileName();
+        _windowsFd = ::open(path.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+        if (_windowsFd < 0) {
+            uasserted(ErrorCodes::FileNotOpen,
+                      str::stream() << "Can't create " << path << ": " << errnoWithDescription());
+        }
+        // (so that it goes when it's closed, and the directory can be removed)
+        ::unlink(path.c_str());
+    }
+
+    while (sorted->more()) {
+        auto next = sorted->next();
+        if (_docs.size() % kRowsPerWindow == 0) {
+            if (_cancelled.load()) {
+                return;
+            }
+            _windowStarts.push_back(next);
+        }
+        _docs.push_back(next.second);
+        if (_windowsFd >= 0 && (_docs.size() == kRowsPerWindow || !sorted->more())) {
+            uassertStatusOK(writeFully(_windowsFd,
+                                       reinterpret_cast<const char*>(_docs.data()),
+                                       _docs.size() * sizeof(uint64_t)));
+            _docs.clear();
+        }
+    }
+}
+
+void SortedOrder::_readWindow(uint64_t window) {
+    if (window == _window && !_docs.empty()) {
+        return;
+    }
+    const uint64_t first = window * kRowsPerWindow;
+    _docs.resize(std::min(kRowsPerWindow, numDocs() - first));
+    const size_t size = _docs.size() * sizeof(uint64_t);
+    if (::pread(_windowsFd, _docs.data(), size, first * sizeof(uint64_t)) != ssize_t(size)) {
+        auto errorString = errnoWithDescription();
+        _docs.clear();
+        uasserted(ErrorCodes::FileStreamFailed,
+                  str::stream() << "Can't read the sorted order: " << errorString);
+    }
+    _window = window;
+}
+
+}  // namespace mongo
+
+#include "mongo/db/sorter/sorter.cpp"
+MONGO_CREATE_SORTER(mongo::SortedOrder::Key,
+                    mongo::SortedOrder::DocNumber,
+                    mongo::SortedOrder::Comparator);
@@ -0,0 +1,188 @@
+/**
+ *    Copyright (C) 2019-present MongoDB, Inc.
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the Server Side Public License, version 1,
+ *    as published by MongoDB, Inc.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    Server Side Public License for more details.
+ *
+ *    You should have received a copy of the Server Side Public License
+ *    along with this program. If not, see
+ *    <http://www.mongodb.com/licensing/server-side-public-license>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the Server Side Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "mongo/base/status_with.h"
+#include "mongo/base/string_data.h"
+#include "mongo/bson/bsonobj.h"
+#include "mongo/bson/ordering.h"
+#include "mongo/db/sorter/sorter.h"
+#include "mongo/platform/atomic_word.h"
+#include "mongo/stdx/mutex.h"
+
+namespace mongo {
+
+class ThreadPool;
+
+/**
+ * The docs of a file in the order of some of their fields' values (eg. `{ts: -1}`), as a
+ * permutation of their doc numbers.
+ *
+ * The docs are added a batch at a time, as with BackgroundSearch, and a worker thread turns the
+ * fields of each into a KeyString, so that keys compare with memcmp however their values are
+ * typed.  The keys go to the Sorter, which spills them to tempDir once they're using more than
+ * maxMemoryUsageBytes.  Once sorted, the worker reads the sorted order back, a window of
+ * kRowsPerWindow rows at a time, keeping the first key of each window.  If the keys were spilled,
+ * so are the windows, and they're read back one at a time as they're asked for.  A doc's row is
+ * found from its key, by which window it's in, so there's no doc-to-row index.
+ */
+class SortedOrder {
+    SortedOrder(const SortedOrder&) = delete;
+    SortedOrder& operator=(const SortedOrder&) = delete;
+
+public:
+    /**
+     * Batches waiting for the worker beyond which callers should stop adding more.
+     */
+    static constexpr size_t kMaxPendingBatches = 4;
+
+    static constexpr size_t kDefaultMaxMemoryUsageBytes = 100 * 1024 * 1024;
+
+    static constexpr uint64_t kRowsPerWindow = 4096;
+
+    /**
+     * Parses a sort spec as typed in, eg. `{ts: -1, op: 1}`.  Only 1 (ascending) and -1
+     * (descending) are allowed.
+     */
+    static StatusWith<BSONObj> parseSpec(StringData json);
+
+    SortedOrder(BSONObj spec,
+                std::string tempDir,
+                size_t maxMemoryUsageBytes = kDefaultMaxMemoryUsageBytes);
+    ~SortedOrder();
+
+    const BSONObj& spec() const {
+        return _spec;
+    }
+
+    /**
+     * Queues docs to be sorted.  They're numbered in the order they're added, from 0, and must
+     * stay valid until their keys have been made (or it's cancelled).
+     */
+    void add(std::vector<BSONObj> docs);
+
+    /**
+     * Whether the worker would run out of batches without more soon.
+     */
+    bool wantsMore() const;
+
+    /**
+     * No more docs will be added, so the keys can be sorted.
+     */
+    void finish();
+
+    /**
+     * Abandons the sort, and waits for the worker to stop.
+     */
+    void cancel();
+
+    /**
+     * Whether all the docs have been sorted (after finish()), or sorting failed (perhaps before).
+     */
+    bool isDone() const;
+
+    /**
+     * Why sorting failed (eg. spilling to disk), once it's done.
+     */
+    Status getStatus() const;
+
+    uint64_t docsKeyed() const {
+        return _docsKeyed.load();
+    }
+
+    /**
+     * Whether the keys didn't fit in memory, once it's done.
+     */
+    bool usedDisk() const;
+
+    /**
+     * The rest is only for once it's done (successfully), and not thread-safe.
+     */
+    uint64_t numDocs() const {
+        return _docsKeyed.load();
+    }
+
+    /**
+     * The doc at row, which must be < numDocs(), reading its window if need be.
+     */
+    uint64_t doc(uint64_t row);
+
+    /**
+     * The row of doc, which must be < numDocs(), and whose contents are obj (from which its key is
+     * made again, to find its window).
+     */
+    uint64_t row(uint64_t doc, const BSONObj& obj);
+
+private:
+    class Key;
+    class DocNumber;
+    class Comparator;
+
+    Key _makeKey(const BSONObj& obj) const;
+    void _makeKeys(uint64_t first, const std::vector<BSONObj>& docs);
+    void _sort();
+    void _writeWindows(SortIteratorInterface<Key, DocNumber>* sorted);
+    void _readWindow(uint64_t window);
+
+    const BSONObj _spec;
+    const Ordering _ordering;
+    const std::string _tempDir;
+    std::unique_ptr<ThreadPool> _pool;
+
+    // Only used by the worker (until it's done).
+    std::unique_ptr<Sorter<Key, DocNumber>> _sorter;
+
+    // The first key (and doc) of each window of the sorted order.
+    std::vector<std::pair<Key, DocNumber>> _windowStarts;
+    // The docs of every row, or if the windows were spilled (to _windowsFd, which is unlinked),
+    // those of the window last read.
+    std::vector<uint64_t> _docs;
+    int _windowsFd = -1;
+    uint64_t _window = 0;
+
+    AtomicWord<bool> _cancelled{false};
+    AtomicWord<uint64_t> _docsKeyed{0};
+
+    // Guards everything below.
+    mutable stdx::mutex _mutex;
+    size_t _pendingBatches = 0;
+    bool _finished = false;
+    bool _done = false;
+    Status _status = Status::OK();
+    // The number the next doc added will have.
+    uint64_t _nextDoc = 0;
+};
+
+}  // namespace mongo
@@ -0,0 +1,179 @@
+/**
+ *    Copyright (C) 2019-present MongoDB, Inc.
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the Server Side Public License, version 1,
+ *    as published by MongoDB, Inc.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    Server Side Public License for more details.
+ *
+ *    You should have received a copy of the Server Side Public License
+ *    along with this program. If not, see
+ *    <http://www.mongodb.com/licensing/server-side-public-license>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the Server Side Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include <boost/filesystem/operations.hpp>
+#include <memory>
+#include <vector>
+
+#include "mongo/bson/bsonobjbuilder.h"
+#include "mongo/bsonview/sorted_order.h"
+#include "mongo/db/service_context_test_fixture.h"
+#include "mongo/stdx/thread.h"
+#include "mongo/unittest/temp_dir.h"
+#include "mongo/unittest/unittest.h"
+
+namespace mongo {
+namespace {
+
+void waitUntilDone(const SortedOrder& order) {
+    while (!order.isDone()) {
+        stdx::this_thread::yield();
+    }
+}
+
+// The docs of the sorted order, from the first row to the last.
+std::vector<uint64_t> sortDocs(const BSONObj& spec, const std::vector<BSONObj>& docs) {
+    SortedOrder order(spec, "");
+    for (size_t first = 0; first < docs.size(); first += 100) {
+        order.add(std::vector<BSONObj>(docs.begin() + first,
+                                       docs.begin() + std::min(first + 100, docs.size())));
+    }
+    order.finish();
+    waitUntilDone(order);
+    ASSERT_OK(order.getStatus());
+    ASSERT_EQ(order.numDocs(), docs.size());
+
+    std::vector<uint64_t> sorted;
+    for (uint64_t row = 0; row < order.numDocs(); row++) {
+        sorted.push_back(order.doc(row));
+    }
+    return sorted;
+}
+
+TEST(SortedOrderTest, ParsesSpec) {
+    auto spec = SortedOrder::parseSpec("{ts: -1, 'o._id': 1}");
+    ASSERT_OK(spec.getStatus());
+    ASSERT_BSONOBJ_EQ(spec.getValue(), BSON("ts" << -1 << "o._id" << 1));
+
+    ASSERT_NOT_OK(SortedOrder::parseSpec("{}").getStatus());
+    ASSERT_NOT_OK(SortedOrder::parseSpec("{ts: 2}").getStatus());
+    ASSERT_NOT_OK(SortedOrder::parseSpec("{ts: 'asc'}").getStatus());
+    ASSERT_NOT_OK(SortedOrder::parseSpec("{ts: ").getStatus());
+}
+
+TEST(SortedOrderTest, NumbersCompareByValueWhateverTheirType) {
+    std::vector<BSONObj> docs{BSON("n" << 3.5),
+                              BSON("n" << 2),
+                              BSON("n" << 10LL),
+                              BSON("n" << -1.0),
+                              BSON("n" << 3)};
+    std::vector<uint64_t> ascending{3, 1, 4, 0, 2};
+    std::vector<uint64_t> descending{2, 0, 4, 1, 3};
+    ASSERT(sortDocs(BSON("n" << 1), docs) == ascending);
+    ASSERT(sortDocs(BSON("n" << -1), docs) == descending);
+}
+
+TEST(SortedOrderTest, TiesStayInFileOrderAndMissingFieldsSortAsNull) {
+    std::vector<BSONObj> docs{BSON("a" << 1),
+                              BSON("b" << 1),
+                              BSON("a" << 0),
+                              BSON("a" << 1),
+                              BSON("a" << BSONNULL)};
+    std::vector<uint64_t> ascending{1, 4, 2, 0, 3};
+    std::vector<uint64_t> descending{0, 3, 2, 1, 4};
+    ASSERT(sortDocs(BSON("a" << 1), docs) == ascending);
+    ASSERT(sortDocs(BSON("a" << -1), docs) == descending);
+}
+
+TEST(SortedOrderTest, CompoundAndDottedFields) {
+    std::vector<BSONObj> docs{BSON("op" << "u" << "o" << BSON("_id" << 1)),
+                              BSON("op" << "i" << "o" << BSON("_id" << 2)),
+                              BSON("op" << "u" << "o" << BSON("_id" << 3)),
+                              BSON("op" << "i" << "o" << BSON("_id" << 4))};
+    std::vector<uint64_t> expected{3, 1, 2, 0};
+    ASSERT(sortDocs(BSON("op" << 1 << "o._id" << -1), docs) == expected);
+}
+
+TEST(SortedOrderTest, RowIsTheInverseOfDoc) {
+    SortedOrder order(BSON("n" << -1), "");
+    std::vector<BSONObj> docs;
+    // (several windows, with ties across them)
+    for (int i = 0; i < 10000; i++) {
+        docs.push_back(BSON("n" << (i * 7919) % 1000));
+    }
+    order.add(docs);
+    order.finish();
+    waitUntilDone(order);
+    ASSERT_OK(order.getStatus());
+    ASSERT(!order.usedDisk());
+    for (uint64_t doc = 0; doc < docs.size(); doc++) {
+        ASSERT_EQ(order.doc(order.row(doc, docs[doc])), doc);
+    }
+}
+
+TEST(SortedOrderTest, Cancel) {
+    SortedOrder order(BSON("n" << 1), "");
+    std::vector<BSONObj> docs;
+    for (int i = 0; i < 1000; i++) {
+        docs.push_back(BSON("n" << i));
+    }
+    for (int i = 0; i < 100; i++) {
+        order.add(docs);
+    }
+    order.cancel();
+    ASSERT(!order.isDone());
+    ASSERT_LT(order.docsKeyed(), 100000U);
+}
+
+// Spilling needs a ServiceContext, for the encryption hooks.
+class SortedOrderSpillTest : public ServiceContextTest {};
+
+TEST_F(SortedOrderSpillTest, SpillsToDisk) {
+    unittest::TempDir tempDir("sorted_order_test");
+    const std::string dir = tempDir.path() + "/bv";
+    std::vector<BSONObj> docs;
+    for (int i = 0; i < 20000; i++) {
+        docs.push_back(BSON("s" << std::to_string((i * 7919) % 20000)));
+    }
+
+    {
+        SortedOrder order(BSON("s" << 1), dir, 64 * 1024);
+        for (size_t first = 0; first < docs.size(); first += 1000) {
+            order.add(std::vector<BSONObj>(docs.begin() + first, docs.begin() + first + 1000));
+        }
+        order.finish();
+        waitUntilDone(order);
+        ASSERT_OK(order.getStatus());
+        ASSERT(order.usedDisk());
+        for (uint64_t row = 1; row < order.numDocs(); row++) {
+            ASSERT_LT(docs[order.doc(row - 1)]["s"].String(), docs[order.doc(row)]["s"].String());
+        }
+        // (read back a window at a time, from the file the windows were spilled to)
+        for (uint64_t doc = 0; doc < docs.size(); doc += 7) {
+            ASSERT_EQ(order.doc(order.row(doc, docs[doc])), doc);
+        }
+    }
+    // (the files are removed, and then the directory they were in)
+    ASSERT(!boost::filesystem::exists(dir));
+}
+
+}  // namespace
+}  // namespace mongo
@@ -0,0 +1,154 @@
+/**
+ *    Copyright (C) 2019-present MongoDB, Inc.
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the Server Side Public License, version 1,
+ *    as published by MongoDB, Inc.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    Server Side Public License for more details.
+ *
+ *    You should have received a copy of the Server Side Public License
+ *    along with this program. If not, see
+ *    <http://www.mongodb.com/licensing/server-side-public-license>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the Server Side Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/bsonview/storage.h"
+
+#include <algorithm>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace mongo {
+
+namespace {
+
+uint64_t pageSize() {
+    static const uint64_t size = sysconf(_SC_PAGESIZE);
+    return size;
+}
+
+uint64_t roundDownToPage(uint64_t n) {
+    return n & ~(pageSize() - 1);
+}
+
+uint64_t roundUpToPage(uint64_t n) {
+    return roundDownToPage(n + pageSize() - 1);
+}
+
+}  // namespace
+
+void BSONStorage::scanned(uint64_t from, uint64_t to) {
+    stdx::lock_guard<stdx::mutex> lk(_mutex);
+    for (size_t segment = from / kSegmentSize; segment * kSegmentSize < to; segment++) {
+        const uint64_t segmentBegin = segment * kSegmentSize;
+        const uint64_t overlap =
+            std::min(to, segmentBegin + kSegmentSize) - std::max(from, segmentBegin);
+        if (segment >= _scannedBytes.size()) {
+            _scannedBytes.resize(segment + 1, 0);
+        }
+        const bool wasComplete = _scannedBytes[segment] >= kSegmentSize;
+        _scannedBytes[segment] += overlap;
+
+        // A partial segment at the end of the file is never complete, so is always kept.  That
+        // means a complete one is all within the file, and is safe to drop whole.
+        if (!wasComplete && _scannedBytes[segment] >= kSegmentSize &&
+            !_viewedPositions.count(segment)) {
+            _dropSegment(segment, segmentBegin + kSegmentSize);
+        }
+    }
+}
+
+void BSONStorage::viewing(uint64_t from, uint64_t to) {
+    const uint64_t limit = roundUpToPage(size());
+    from = std::min(from, size());
+    to = std::max(from, std::min(to, size()));
+    _prefetch(roundDownToPage(from > kViewPrefetch ? from - kViewPrefetch : 0),
+              std::min(roundUpToPage(to + kViewPrefetch), limit));
+
+    if (fitsBudget() || from == to) {
+        return;
+    }
+
+    stdx::lock_guard<stdx::mutex> lk(_mutex);
+    const size_t first = from / kSegmentSize;
+    const size_t last = (to - 1) / kSegmentSize;
+    for (size_t segment = first; segment <= last; segment++) {
+        auto it = _viewedPositions.find(segment);
+        if (it != _viewedPositions.end()) {
+            _viewed.erase(it->second);
+        }
+        _viewed.push_front(segment);
+        _viewedPositions[segment] = _viewed.begin();
+    }
+
+    // Whatever is on screen is kept, even if it's more than the budget.
+    const size_t maxViewed = std::max<size_t>(last - first + 1, _budget / kSegmentSize);
+    while (_viewed.size() > maxViewed) {
+        const size_t segment = _viewed.back();
+        _viewed.pop_back();
+        _viewedPositions.erase(segment);
+        _dropSegment(segment, limit);
+    }
+}
+
+void BSONStorage::readingBackwards(uint64_t to) {
+    to = std::min(to, size());
+    {
+        stdx::lock_guard<stdx::mutex> lk(_mutex);
+        if (_backwardsFrom + kBackwardsPrefetch / 2 <= to && to <= _backwardsTo) {
+            return;
+        }
+        _backwardsFrom = roundDownToPage(to > kBackwardsPrefetch ? to - kBackwardsPrefetch : 0);
+        _backwardsTo = to;
+    }
+    _prefetch(_backwardsFrom, std::min(roundUpToPage(to), roundUpToPage(size())));
+}
+
+void BSONStorage::_dropUnviewed(uint64_t from, uint64_t to) {
+    stdx::lock_guard<stdx::mutex> lk(_mutex);
+    for (size_t segment = from / kSegmentSize; segment * kSegmentSize < to; segment++) {
+        if (!_viewedPositions.count(segment)) {
+            _dropSegment(segment, to);
+        }
+    }
+}
+
+void BSONStorage::_dropSegment(size_t segment, uint64_t limit) {
+    const uint64_t begin = segment * kSegmentSize;
+    const uint64_t end = std::min(begin + kSegmentSize, limit);
+    if (begin < end) {
+        _drop(begin, end);
+    }
+}
+
+void BSONStorage::_drop(uint64_t from, uint64_t to) {
+    char* p = const_cast<char*>(base()) + from;
+    // Anything that comes back in is from jumping around, so don't read ahead around it.
+    ::madvise(p, to - from, MADV_RANDOM);
+    ::madvise(p, to - from, MADV_DONTNEED);
+}
+
+void BSONStorage::_prefetch(uint64_t from, uint64_t to) {
+    if (from < to) {
+        ::madvise(const_cast<char*>(base()) + from, to - from, MADV_WILLNEED);
+    }
+}
+
+}  // namespace mongo
@@ -0,0 +1,160 @@
+/**
+ *    Copyright (C) 2019-present MongoDB, Inc.
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the Server Side Public License, version 1,
+ *    as published by MongoDB, Inc.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    Server Side Public License for more details.
+ *
+ *    You should have received a copy of the Server Side Public License
+ *    along with this program. If not, see
+ *    <http://www.mongodb.com/licensing/server-side-public-license>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the Server Side Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <list>
+#include <unordered_map>
+#include <vector>
+
+#include "mongo/base/status_with.h"
+#include "mongo/stdx/mutex.h"
+
+namespace mongo {
+
+/**
+ * The bytes of a BSON file, as one contiguous, read-only range of memory which stays at the same
+ * address for as long as the storage exists.  How it gets there (a mapping of the file, a buffer
+ * filled from a pipe, ...) is up to the subclass.
+ *
+ * Storage also decides which parts are kept resident.  With a budget set, the pages of a file
+ * bigger than the budget are read ahead sequentially while it's being indexed, and dropped once
+ * they've been scanned.  Pages that are on screen are kept, most recently viewed first, up to
+ * the budget.  Without a budget, everything is read ahead and kept.
+ */
+class BSONStorage {
+    BSONStorage(const BSONStorage&) = delete;
+    BSONStorage& operator=(const BSONStorage&) = delete;
+
+public:
+    // Unit of residency tracking.
+    static constexpr uint64_t kSegmentSize = 16 * 1024 * 1024;
+
+    // How much either side of what's on screen to read ahead.
+    static constexpr uint64_t kViewPrefetch = 1024 * 1024;
+
+    // How much to read ahead of something reading backwards.
+    static constexpr uint64_t kBackwardsPrefetch = 8 * 1024 * 1024;
+
+    enum class Change {
+        kNone,
+        kGrew,
+        kTruncated,
+    };
+
+    BSONStorage() = default;
+    virtual ~BSONStorage() = default;
+
+    virtual const char* base() const = 0;
+    virtual uint64_t size() const = 0;
+
+    const char* end() const {
+        return base() + size();
+    }
+
+    /**
+     * Checks for and adjusts to changes in the underlying file, if it can change.
+     */
+    virtual StatusWith<Change> refresh() {
+        return Change::kNone;
+    }
+
+    /**
+     * Bytes of the storage to keep resident, or 0 for no limit.
+     */
+    uint64_t residentBudget() const {
+        return _budget;
+    }
+
+    void setResidentBudget(uint64_t budget) {
+        _budget = budget;
+    }
+
+    /**
+     * Whether everything fits within the budget, in which case nothing need be dropped.
+     */
+    bool fitsBudget() const {
+        return _budget == 0 || size() <= _budget;
+    }
+
+    /**
+     * [from, to) has been indexed, and won't be needed again unless it's viewed.  Segments are
+     * dropped once all of their bytes have been reported.  Only worth calling when the storage
+     * doesn't fit the budget.  May be called from any thread.
+     */
+    void scanned(uint64_t from, uint64_t to);
+
+    /**
+     * [from, to) is on screen.
+     */
+    void viewing(uint64_t from, uint64_t to);
+
+    /**
+     * Everything from `to` down is about to be read, backwards (eg. by a search).  The kernel
+     * only reads ahead of forward access, so this does it instead: in chunks, once half of the
+     * last chunk has been used.
+     */
+    void readingBackwards(uint64_t to);
+
+protected:
+    /**
+     * Pages in [from, to) are no longer needed.  Only called with whole pages.  Storage whose
+     * pages can't be dropped without losing them (eg. anonymous memory) should do nothing.
+     */
+    virtual void _drop(uint64_t from, uint64_t to);
+
+    /**
+     * Pages in [from, to) are about to be needed.  Only called with whole pages.
+     */
+    virtual void _prefetch(uint64_t from, uint64_t to);
+
+    /**
+     * Drops the segments in [from, to), which must be whole ones, unless they're on screen.  For
+     * storage that fills up faster than it's scanned.  May be called from any thread.
+     */
+    void _dropUnviewed(uint64_t from, uint64_t to);
+
+private:
+    void _dropSegment(size_t segment, uint64_t limit);
+
+    uint64_t _budget = 0;
+
+    stdx::mutex _mutex;
+    // Bytes of each segment that have been scanned.
+    std::vector<uint64_t> _scannedBytes;
+    // Segments that have been on screen, most recently first.
+    std::list<size_t> _viewed;
+    std::unordered_map<size_t, std::list<size_t>::iterator> _viewedPositions;
+    // What readingBackwards() last read ahead.
+    uint64_t _backwardsFrom = 0;
+    uint64_t _backwardsTo = 0;
+};
+
+}  // namespace mongo
@@ -0,0 +1,167 @@
+/**
+ *    Copyright (C) 2019-present MongoDB, Inc.
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the Server Side Public License, version 1,
+ *    as published by MongoDB, Inc.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    Server Side Public License for more details.
+ *
+ *    You should have received a copy of the Server Side Public License
+ *    along with this program. If not, see
+ *    <http://www.mongodb.com/licensing/server-side-public-license>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the Server Side Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include <utility>
+#include <vector>
+
+#include "mongo/bsonview/storage.h"
+#include "mongo/unittest/unittest.h"
+
+namespace mongo {
+namespace {
+
+constexpr uint64_t kSegment = BSONStorage::kSegmentSize;
+
+/**
+ * Storage that just records what it's asked to drop and prefetch.
+ */
+class RecordingStorage : public BSONStorage {
+public:
+    explicit RecordingStorage(uint64_t size) : _size(size) {}
+
+    const char* base() const override {
+        return nullptr;
+    }
+
+    uint64_t size() const override {
+        return _size;
+    }
+
+    std::vector<std::pair<uint64_t, uint64_t>> dropped;
+    std::vector<std::pair<uint64_t, uint64_t>> prefetched;
+
+protected:
+    void _drop(uint64_t from, uint64_t to) override {
+        dropped.emplace_back(from, to);
+    }
+
+    void _prefetch(uint64_t from, uint64_t to) override {
+        prefetched.emplace_back(from, to);
+    }
+
+private:
+    uint64_t _size;
+};
+
+TEST(BSONStorageTest, FitsBudget) {
+    RecordingStorage storage(10 * kSegment);
+    ASSERT_TRUE(storage.fitsBudget());
+    storage.setResidentBudget(10 * kSegment);
+    ASSERT_TRUE(storage.fitsBudget());
+    storage.setResidentBudget(2 * kSegment);
+    ASSERT_FALSE(storage.fitsBudget());
+}
+
+TEST(BSONStorageTest, ScannedSegmentsAreDropped) {
+    RecordingStorage storage(3 * kSegment + 100);
+    storage.setResidentBudget(kSegment);
+
+    storage.scanned(0, kSegment / 2);
+    ASSERT_EQ(storage.dropped.size(), 0U);
+
+    // Completes the first segment, and half of the second.
+    storage.scanned(kSegment / 2, kSegment + kSegment / 2);
+    ASSERT_EQ(storage.dropped.size(), 1U);
+    ASSERT_EQ(storage.dropped[0].first, 0U);
+    ASSERT_EQ(storage.dropped[0].second, kSegment);
+
+    // The partial segment at the end is kept.
+    storage.scanned(kSegment + kSegment / 2, 3 * kSegment + 100);
+    ASSERT_EQ(storage.dropped.size(), 3U);
+    ASSERT_EQ(storage.dropped[2].first, 2 * kSegment);
+    ASSERT_EQ(storage.dropped[2].second, 3 * kSegment);
+}
+
+TEST(BSONStorageTest, ViewedSegmentsAreKeptWithinBudget) {
+    RecordingStorage storage(10 * kSegment);
+    storage.setResidentBudget(2 * kSegment);
+
+    storage.viewing(5 * kSegment + 10, 5 * kSegment + 1000);
+    ASSERT_EQ(storage.prefetched.size(), 1U);
+    ASSERT_EQ(storage.prefetched[0].first, 5 * kSegment - BSONStorage::kViewPrefetch);
+    ASSERT_GTE(storage.prefetched[0].second, 5 * kSegment + 1000 + BSONStorage::kViewPrefetch);
+
+    // Scanning past it doesn't drop it, since it's being viewed.
+    storage.scanned(5 * kSegment, 6 * kSegment);
+    ASSERT_EQ(storage.dropped.size(), 0U);
+
+    storage.viewing(6 * kSegment, 6 * kSegment + 1000);
+    ASSERT_EQ(storage.dropped.size(), 0U);
+
+    // Viewing a third segment pushes the least recently viewed one out.
+    storage.viewing(7 * kSegment, 7 * kSegment + 1000);
+    ASSERT_EQ(storage.dropped.size(), 1U);
+    ASSERT_EQ(storage.dropped[0].first, 5 * kSegment);
+    ASSERT_EQ(storage.dropped[0].second, 6 * kSegment);
+
+    // Unless all of them are on screen at once.
+    storage.viewing(7 * kSegment, 9 * kSegment + 1000);
+    ASSERT_EQ(storage.dropped.size(), 2U);
+    ASSERT_EQ(storage.dropped[1].first, 6 * kSegment);
+}
+
+TEST(BSONStorageTest, ReadingBackwardsPrefetchesInChunks) {
+    RecordingStorage storage(10 * kSegment);
+    const uint64_t chunk = BSONStorage::kBackwardsPrefetch;
+
+    storage.readingBackwards(5 * kSegment);
+    ASSERT_EQ(storage.prefetched.size(), 1U);
+    ASSERT_EQ(storage.prefetched[0].first, 5 * kSegment - chunk);
+    ASSERT_EQ(storage.prefetched[0].second, 5 * kSegment);
+
+    // Not again until half of it has been read.
+    storage.readingBackwards(5 * kSegment - 1000);
+    storage.readingBackwards(5 * kSegment - chunk / 2);
+    ASSERT_EQ(storage.prefetched.size(), 1U);
+    storage.readingBackwards(5 * kSegment - chunk / 2 - 1000);
+    ASSERT_EQ(storage.prefetched.size(), 2U);
+    // (rounded down to a page)
+    ASSERT_LTE(storage.prefetched[1].first, 5 * kSegment - chunk / 2 - 1000 - chunk);
+    ASSERT_GT(storage.prefetched[1].first, 5 * kSegment - chunk / 2 - 1000 - chunk - 65536);
+    ASSERT_GTE(storage.prefetched[1].second, 5 * kSegment - chunk / 2 - 1000);
+
+    // Jumping elsewhere starts again, stopping at the start of the file.
+    storage.readingBackwards(1000);
+    ASSERT_EQ(storage.prefetched.size(), 3U);
+    ASSERT_EQ(storage.prefetched[2].first, 0U);
+}
+
+TEST(BSONStorageTest, NothingDroppedWithoutBudget) {
+    RecordingStorage storage(10 * kSegment);
+    for (uint64_t i = 0; i < 10; i++) {
+        storage.viewing(i * kSegment, i * kSegment + 1000);
+    }
+    ASSERT_EQ(storage.dropped.size(), 0U);
+    ASSERT_EQ(storage.prefetched.size(), 10U);
+}
+
+}  // namespace
+}  // namespace mongo
@@ -0,0 +1,380 @@
+/**
+ *    Copyright (C) 2019-present MongoDB, Inc.
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the Server Side Public License, version 1,
+ *    as published by MongoDB, Inc.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    Server Side Public License for more details.
+ *
+ *    You should have received a copy of the Server Side Public License
+ *    along with this program. If not, see
+ *    <http://www.mongodb.com/licensing/server-side-public-license>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the Server Side Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/bsonview/stream_storage.h"
+
+#include <cstring>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+
+#include "mongo/util/errno_util.h"
+#include "mongo/util/str.h"
+
+namespace mongo {
+
+namespace {
+
+// How often the reader thread checks whether it should stop, while waiting for input.
+constexpr int kPollIntervalMillis = 100;
+
+// Refillable streams are read into a buffer, and appended to the arena a page at a time, once
+// this much has been read, or nothing more is available yet.
+constexpr size_t kAppendSize = 1024 * 1024;
+constexpr size_t kBufferSize = 4 * 1024 * 1024;
+
+/**
+ * Reads from a file descriptor (eg. a pipe).
+ */
+class FdSource : public StreamStorage::Source {
+public:
+    explicit FdSource(int fd) : _fd(fd) {}
+
+    ~FdSource() {
+        ::close(_fd);
+    }
+
+    StatusWith<size_t> read(char* buf, size_t len) override {
+        // Wait a little while for input, so the reader thread can notice when it should stop.
+        pollfd pfd{_fd, POLLIN, 0};
+        const int ready = ::poll(&pfd, 1, kPollIntervalMillis);
+        if (ready == 0 || (ready < 0 && errno == EINTR)) {
+            return 0;
+        }
+        if (ready < 0) {
+            return {ErrorCodes::FileStreamFailed,
+                    str::stream() << "Unable to read input: " << errnoWithDescription()};
+        }
+
+        const ssize_t n = ::read(_fd, buf, len);
+        if (n < 0) {
+            if (errno == EINTR || errno == EAGAIN) {
+                return 0;
+            }
+            return {ErrorCodes::FileStreamFailed,
+                    str::stream() << "Unable to read input: " << errnoWithDescription()};
+        }
+        if (n == 0) {
+            _atEnd = true;
+        }
+        return size_t(n);
+    }
+
+    bool atEnd() const override {
+        return _atEnd;
+    }
+
+private:
+    const int _fd;
+    bool _atEnd = false;
+};
+
+/**
+ * Reads a list of files, one after the other.
+ */
+class FilesSource : public StreamStorage::Source {
+public:
+    explicit FilesSource(std::vector<std::string> paths) : _paths(std::move(paths)) {}
+
+    ~FilesSource() {
+        if (_fd >= 0) {
+            ::close(_fd);
+        }
+    }
+
+    StatusWith<size_t> read(char* buf, size_t len) override {
+        if (_fd < 0) {
+            _fd = ::open(_paths[_next].c_str(), O_RDONLY | O_CLOEXEC);
+            if (_fd < 0) {
+                auto errorString = errnoWithDescription();
+                return {ErrorCodes::FileNotOpen,
+                        str::stream() << "Unable to open " << _paths[_next] << ": "
+                                      << errorString};
+            }
+        }
+
+        const ssize_t n = ::read(_fd, buf, len);
+        if (n < 0) {
+            if (errno == EINTR) {
+                return 0;
+            }
+            auto errorString = errnoWithDescription();
+            return {ErrorCodes::FileStreamFailed,
+                    str::stream() << "Unable to read " << _paths[_next] << ": " << errorString};
+        }
+        if (n == 0) {
+            ::close(_fd);
+            _fd = -1;
+            _next++;
+        }
+        return size_t(n);
+    }
+
+    bool atEnd() const override {
+        return _next == _paths.size();
+    }
+
+private:
+    const std::vector<std::string> _paths;
+    size_t _next = 0;
+    int _fd = -1;
+};
+
+}  // namespace
+
+StreamStorage::~StreamStorage() {
+    _shutdown.store(true);
+    if (_reader.joinable()) {
+        _reader.join();
+    }
+}
+
+StatusWith<std::unique_ptr<StreamStorage>> StreamStorage::open(int fd, uint64_t residentBudget) {
+    return open(std::make_unique<FdSource>(fd), residentBudget);
+}
+
+StatusWith<std::unique_ptr<StreamStorage>> StreamStorage::open(std::vector<std::string> paths,
+                                                               uint64_t residentBudget) {
+    return open(std::make_unique<FilesSource>(std::move(paths)), residentBudget);
+}
+
+StatusWith<std::unique_ptr<StreamStorage>> StreamStorage::open(std::unique_ptr<Source> source,
+                                                               uint64_t residentBudget) {
+    std::unique_ptr<StreamStorage> stream(new StreamStorage());
+    stream->_source = std::move(source);
+    stream->setResidentBudget(residentBudget);
+    StreamStorage* s = stream.get();
+
+    // Where userfaultfd isn't available, fall back to a temporary file.
+    if (residentBudget) {
+        if (auto checkpoint = stream->_source->checkpoint()) {
+            auto swRefillable = RefillableArena::make([s](uint64_t offset, char* buf, size_t len) {
+                return s->_refill(offset, buf, len);
+            });
+            if (swRefillable.isOK()) {
+                stream->_checkpoints.emplace(0, std::move(checkpoint));
+                stream->_refillable = std::move(swRefillable.getValue());
+                stream->_base = stream->_refillable->base();
+                stream->_reader = stdx::thread([s] { s->_readRefillable(); });
+                return {std::move(stream)};
+            }
+        }
+    }
+
+    auto swArena = TempArena::make();
+    if (!swArena.isOK()) {
+        return swArena.getStatus();
+    }
+    stream->_arena = std::move(swArena.getValue());
+    stream->_base = stream->_arena->base();
+    stream->_reader = stdx::thread([s] { s->_read(); });
+
+    return {std::move(stream)};
+}
+
+void StreamStorage::_read() {
+    Status status = Status::OK();
+    uint64_t written = 0;
+
+    while (!_shutdown.load() && !_source->atEnd()) {
+        if (written == _arena->mapped()) {
+            status = _arena->ensureMapped(written + 1);
+            if (!status.isOK()) {
+                break;
+            }
+        }
+
+        auto swRead = _source->read(_arena->base() + written, _arena->mapped() - written);
+        if (!swRead.isOK()) {
+            status = swRead.getStatus();
+            break;
+        }
+        if (swRead.getValue() == 0) {
+            continue;
+        }
+
+        written += swRead.getValue();
+        _publish(written);
+    }
+
+    stdx::lock_guard<stdx::mutex> lk(_mutex);
+    _readStatus = status;
+    _ended.store(true);
+    _availableCV.notify_all();
+}
+
+void StreamStorage::_readRefillable() {
+    Status status = Status::OK();
+    std::unique_ptr<char[]> buffer(new char[kBufferSize]);
+    size_t buffered = 0;
+    uint64_t written = 0;
+    uint64_t lastCheckpoint = 0;
+    // Everything before this has been dropped by the reader.
+    uint64_t droppedTo = 0;
+
+    while (!_shutdown.load() && !_source->atEnd()) {
+        if (written - lastCheckpoint >= kCheckpointInterval) {
+            if (auto checkpoint = _source->checkpoint()) {
+                stdx::lock_guard<stdx::mutex> lk(_mutex);
+                _checkpoints.emplace(written, std::move(checkpoint));
+                lastCheckpoint = written;
+            }
+        }
+
+        auto swRead = _source->read(buffer.get() + buffered, kBufferSize - buffered);
+        if (!swRead.isOK()) {
+            status = swRead.getStatus();
+            break;
+        }
+        buffered += swRead.getValue();
+        written += swRead.getValue();
+        if (buffered < kAppendSize && swRead.getValue() != 0) {
+            continue;
+        }
+
+        // Whole pages only, until the end.
+        const size_t whole = buffered & ~(RefillableArena::pageSize() - 1);
+        if (whole == 0) {
+            continue;
+        }
+        status = _refillable->append(buffer.get(), whole);
+        if (!status.isOK()) {
+            break;
+        }
+        memmove(buffer.get(), buffer.get() + whole, buffered - whole);
+        buffered -= whole;
+        _publish(written - buffered);
+
+        // Whatever's this far behind has either been scanned already, or will have to be read
+        // again anyway.
+        while (written - droppedTo > residentBudget() + kSegmentSize) {
+            _dropUnviewed(droppedTo, droppedTo + kSegmentSize);
+            droppedTo += kSegmentSize;
+        }
+    }
+
+    if (status.isOK() && buffered) {
+        status = _refillable->append(buffer.get(), buffered);
+        if (status.isOK()) {
+            _publish(written);
+        }
+    }
+
+    stdx::lock_guard<stdx::mutex> lk(_mutex);
+    _readStatus = status;
+    _ended.store(true);
+    _availableCV.notify_all();
+}
+
+Status StreamStorage::_refill(uint64_t offset, char* buf, size_t len) {
+    const Source::Checkpoint* checkpoint;
+    uint64_t checkpointOffset;
+    {
+        stdx::lock_guard<stdx::mutex> lk(_mutex);
+        auto it = --_checkpoints.upper_bound(offset);
+        checkpoint = it->second.get();
+        checkpointOffset = it->first;
+    }
+
+    // Reading on from the last refill saves starting again when scrolling forwards.
+    if (!_refillSource || _refillOffset > offset || _refillOffset < checkpointOffset) {
+        _refillSource = _source->restart(*checkpoint);
+        _refillOffset = checkpointOffset;
+    }
+
+    Status status = Status::OK();
+    size_t filled = 0;
+    while (filled < len) {
+        if (_refillSource->atEnd()) {
+            status = {ErrorCodes::FileStreamFailed, "Input ended early when reading it again"};
+            break;
+        }
+
+        // What's before `offset` is read into `buf` too, and overwritten.
+        const size_t skip =
+            _refillOffset < offset ? std::min<uint64_t>(offset - _refillOffset, len) : 0;
+        auto swRead = _refillSource->read(buf + (skip ? 0 : filled), skip ? skip : len - filled);
+        if (!swRead.isOK()) {
+            status = swRead.getStatus();
+            break;
+        }
+        _refillOffset += swRead.getValue();
+        if (!skip) {
+            filled += swRead.getValue();
+        }
+    }
+    if (status.isOK()) {
+        return status;
+    }
+
+    _refillSource.reset();
+    stdx::lock_guard<stdx::mutex> lk(_mutex);
+    if (_refillStatus.isOK()) {
+        _refillStatus = status;
+    }
+    return status;
+}
+
+void StreamStorage::_publish(uint64_t written) {
+    stdx::lock_guard<stdx::mutex> lk(_mutex);
+    _available.store(written);
+    _availableCV.notify_all();
+}
+
+void StreamStorage::waitFor(uint64_t bytes) {
+    stdx::unique_lock<stdx::mutex> lk(_mutex);
+    _availableCV.wait(lk, [&] { return _available.load() >= bytes || _ended.load(); });
+    _size = _available.load();
+}
+
+StatusWith<BSONStorage::Change> StreamStorage::refresh() {
+    const uint64_t available = _available.load();
+    if (available > _size) {
+        _size = available;
+        return Change::kGrew;
+    }
+
+    // Only report a failure once everything that was read before it has been picked up.
+    stdx::lock_guard<stdx::mutex> lk(_mutex);
+    if (!_readStatus.isOK() && !_reportedReadStatus) {
+        _reportedReadStatus = true;
+        return _readStatus;
+    }
+
+    // What was read again is zeroes instead.
+    if (!_refillStatus.isOK() && !_reportedRefillStatus) {
+        _reportedRefillStatus = true;
+        return _refillStatus;
+    }
+    return Change::kNone;
+}
+
+}  // namespace mongo
@@ -0,0 +1,211 @@
+/**
+ *    Copyright (C) 2019-present MongoDB, Inc.
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the Server Side Public License, version 1,
+ *    as published by MongoDB, Inc.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    Server Side Public License for more details.
+ *
+ *    You should have received a copy of the Server Side Public License
+ *    along with this program. If not, see
+ *    <http://www.mongodb.com/licensing/server-side-public-license>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the Server Side Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "mongo/base/status_with.h"
+#include "mongo/bsonview/refillable_arena.h"
+#include "mongo/bsonview/storage.h"
+#include "mongo/bsonview/temp_arena.h"
+#include "mongo/platform/atomic_word.h"
+#include "mongo/stdx/condition_variable.h"
+#include "mongo/stdx/mutex.h"
+#include "mongo/stdx/thread.h"
+#include "mongo/util/assert_util.h"
+
+namespace mongo {
+
+/**
+ * Storage for a stream (eg. stdin, or a decompressor), which can't be mapped or seeked.
+ *
+ * A background thread appends everything read from the stream to an arena, so the stream appears
+ * as a file that keeps growing (see refresh()).  When more of it has been read than the resident
+ * budget allows, the parts that are dropped have to come back from somewhere:
+ *  - If the source can start again part way through (eg. a decompressor, which can start again
+ *    from a checkpoint in its compressed input), they're read again from the nearest checkpoint
+ *    before them, when they're touched.  Checkpoints are recorded every kCheckpointInterval or
+ *    so, and the reader thread drops what it has read once it's more than the budget behind, so
+ *    only about the budget stays in memory.  (See RefillableArena.)
+ *  - Otherwise, everything is kept in a TempArena, from whose file the dropped parts are read.
+ */
+class StreamStorage : public BSONStorage {
+public:
+    /**
+     * Where the bytes come from.  Only read() by the reader thread.
+     */
+    class Source {
+    public:
+        /**
+         * Somewhere in the stream that a source can start again from.
+         */
+        class Checkpoint {
+        public:
+            virtual ~Checkpoint() = default;
+        };
+
+        virtual ~Source() = default;
+
+        /**
+         * Reads up to `len` bytes into `buf`.  Shouldn't block for long (about 100ms), so may
+         * return 0 if nothing is available yet.
+         */
+        virtual StatusWith<size_t> read(char* buf, size_t len) = 0;
+
+        /**
+         * True once the stream has ended.
+         */
+        virtual bool atEnd() const = 0;
+
+        /**
+         * If the next read() could be the first of a source restart()ed from here, returns a
+         * checkpoint for here.  Sources that can't start again return null.
+         */
+        virtual std::unique_ptr<Checkpoint> checkpoint() {
+            return nullptr;
+        }
+
+        /**
+         * Returns a new source which reads on from `checkpoint`, which was returned by this one's
+         * checkpoint().  (The new one needn't return checkpoints itself.)  May be called from any
+         * thread, while this source is being read.
+         */
+        virtual std::unique_ptr<Source> restart(const Checkpoint& checkpoint) const {
+            MONGO_UNREACHABLE;
+        }
+    };
+
+    // About how much is read between checkpoints.
+    static constexpr uint64_t kCheckpointInterval = 8 * 1024 * 1024;
+
+    ~StreamStorage();
+
+    /**
+     * Starts reading from `source`.  If there's a temporary file, it's created in $TMPDIR (or
+     * /var/tmp).  Without a budget, everything is kept, so in a temporary file, whatever the
+     * source.
+     */
+    static StatusWith<std::unique_ptr<StreamStorage>> open(std::unique_ptr<Source> source,
+                                                           uint64_t residentBudget = 0);
+
+    /**
+     * Starts reading from `fd`, which the StreamStorage takes ownership of.
+     */
+    static StatusWith<std::unique_ptr<StreamStorage>> open(int fd, uint64_t residentBudget = 0);
+
+    /**
+     * Starts reading the files at `paths`, one after the other, as if they were one file.
+     */
+    static StatusWith<std::unique_ptr<StreamStorage>> open(std::vector<std::string> paths,
+                                                           uint64_t residentBudget = 0);
+
+    const char* base() const override {
+        return _base;
+    }
+
+    /**
+     * How much of the stream has been picked up by refresh().
+     */
+    uint64_t size() const override {
+        return _size;
+    }
+
+    /**
+     * Picks up whatever has been read from the stream since the last call.  Reports an error
+     * (once) if reading failed.
+     */
+    StatusWith<Change> refresh() override;
+
+    /**
+     * Blocks until at least `bytes` have been read, or the stream has ended, then refresh()es.
+     */
+    void waitFor(uint64_t bytes);
+
+    /**
+     * Whether dropped parts are read again from the source, rather than kept in a file.
+     */
+    bool isRefillable() const {
+        return bool(_refillable);
+    }
+
+    /**
+     * Whether the whole stream has been read (and picked up by refresh()).
+     */
+    bool isComplete() const {
+        return _ended.load() && _size == _available.load();
+    }
+
+private:
+    StreamStorage() = default;
+
+    void _read();
+    void _readRefillable();
+    Status _refill(uint64_t offset, char* buf, size_t len);
+
+    /**
+     * Makes the first `written` bytes available, and wakes anyone waiting for them.
+     */
+    void _publish(uint64_t written);
+
+    std::unique_ptr<Source> _source;
+    const char* _base = nullptr;
+    uint64_t _size = 0;
+
+    // Used by refills (on the RefillableArena's thread) to carry on from where the last one got
+    // to, if that's nearer than a checkpoint.
+    std::unique_ptr<Source> _refillSource;
+    uint64_t _refillOffset = 0;
+
+    stdx::thread _reader;
+
+    AtomicWord<uint64_t> _available{0};
+    AtomicWord<bool> _ended{false};
+    AtomicWord<bool> _shutdown{false};
+
+    stdx::mutex _mutex;
+    stdx::condition_variable _availableCV;
+    Status _readStatus = Status::OK();
+    bool _reportedReadStatus = false;
+    Status _refillStatus = Status::OK();
+    bool _reportedRefillStatus = false;
+    // Where the source can be restarted from, by offset.  Only ever added to.
+    std::map<uint64_t, std::unique_ptr<Source::Checkpoint>> _checkpoints;
+
+    // What's been read: one or the other of these, written by the reader thread.  The
+    // RefillableArena uses the members above from its own thread, so has to be destroyed first.
+    std::unique_ptr<TempArena> _arena;
+    std::unique_ptr<RefillableArena> _refillable;
+};
+
+}  // namespace mongo
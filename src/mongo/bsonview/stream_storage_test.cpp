@@ -0,0 +1,151 @@
+/**
+ *    Copyright (C) 2019-present MongoDB, Inc.
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the Server Side Public License, version 1,
+ *    as published by MongoDB, Inc.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    Server Side Public License for more details.
+ *
+ *    You should have received a copy of the Server Side Public License
+ *    along with this program. If not, see
+ *    <http://www.mongodb.com/licensing/server-side-public-license>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the Server Side Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include <fcntl.h>
+#include <string>
+#include <unistd.h>
+
+#include "mongo/bsonview/stream_storage.h"
+#include "mongo/stdx/thread.h"
+#include "mongo/unittest/temp_dir.h"
+#include "mongo/unittest/unittest.h"
+
+namespace mongo {
+namespace {
+
+void writeFully(int fd, const std::string& data) {
+    size_t done = 0;
+    while (done < data.size()) {
+        const ssize_t n = ::write(fd, data.data() + done, data.size() - done);
+        ASSERT_GT(n, 0);
+        done += n;
+    }
+}
+
+TEST(StreamStorageTest, ReadsUntilEnd) {
+    int fds[2];
+    ASSERT_EQ(::pipe(fds), 0);
+
+    auto swStream = StreamStorage::open(fds[0]);
+    ASSERT_OK(swStream.getStatus());
+    auto& stream = swStream.getValue();
+    ASSERT_EQ(stream->size(), 0U);
+
+    writeFully(fds[1], "hello");
+    stream->waitFor(5);
+    ASSERT_EQ(stream->size(), 5U);
+    ASSERT_EQ(std::string(stream->base(), 5), "hello");
+    ASSERT_FALSE(stream->isComplete());
+
+    writeFully(fds[1], " world");
+    ::close(fds[1]);
+    stream->waitFor(1000);
+    ASSERT_EQ(std::string(stream->base(), stream->size()), "hello world");
+    ASSERT_TRUE(stream->isComplete());
+
+    auto swChange = stream->refresh();
+    ASSERT_OK(swChange.getStatus());
+    ASSERT(swChange.getValue() == BSONStorage::Change::kNone);
+}
+
+TEST(StreamStorageTest, RefreshPicksUpGrowth) {
+    int fds[2];
+    ASSERT_EQ(::pipe(fds), 0);
+
+    auto swStream = StreamStorage::open(fds[0]);
+    ASSERT_OK(swStream.getStatus());
+    auto& stream = swStream.getValue();
+    const char* base = stream->base();
+
+    // More than one growth of the arena.
+    const size_t total = TempArena::kGrowthSize + TempArena::kGrowthSize / 2;
+    stdx::thread writer([&] {
+        std::string block(1024 * 1024, 'x');
+        for (size_t written = 0; written < total; written += block.size()) {
+            block[0] = 'a' + (written / block.size()) % 26;
+            writeFully(fds[1], block);
+        }
+        ::close(fds[1]);
+    });
+
+    uint64_t seen = 0;
+    while (!stream->isComplete()) {
+        auto swChange = stream->refresh();
+        ASSERT_OK(swChange.getStatus());
+        if (swChange.getValue() == BSONStorage::Change::kGrew) {
+            ASSERT_GT(stream->size(), seen);
+            seen = stream->size();
+        }
+        stream->waitFor(seen + 1);
+    }
+    writer.join();
+
+    ASSERT_EQ(stream->size(), total);
+    ASSERT_EQ(stream->base(), base);
+    for (size_t i = 0; i < total; i += 1024 * 1024) {
+        ASSERT_EQ(base[i], char('a' + (i / (1024 * 1024)) % 26));
+        ASSERT_EQ(base[i + 1], 'x');
+    }
+}
+
+TEST(StreamStorageTest, ReadsFilesInTurn) {
+    unittest::TempDir dir("stream_storage_test");
+    std::vector<std::string> paths;
+    for (auto&& contents : {"one ", "", "two ", "three"}) {
+        paths.push_back(dir.path() + "/" + std::to_string(paths.size()));
+        int fd = ::open(paths.back().c_str(), O_WRONLY | O_CREAT, 0644);
+        ASSERT_GTE(fd, 0);
+        writeFully(fd, contents);
+        ::close(fd);
+    }
+
+    auto swStream = StreamStorage::open(paths);
+    ASSERT_OK(swStream.getStatus());
+    auto& stream = swStream.getValue();
+    while (!stream->isComplete()) {
+        stream->waitFor(stream->size() + 1);
+    }
+    ASSERT_EQ(std::string(stream->base(), stream->size()), "one two three");
+    ASSERT_OK(stream->refresh().getStatus());
+}
+
+TEST(StreamStorageTest, MissingFileIsAnError) {
+    unittest::TempDir dir("stream_storage_test");
+    auto swStream = StreamStorage::open(std::vector<std::string>{dir.path() + "/missing"});
+    ASSERT_OK(swStream.getStatus());
+    auto& stream = swStream.getValue();
+    stream->waitFor(1);
+    ASSERT_TRUE(stream->isComplete());
+    ASSERT_NOT_OK(stream->refresh().getStatus());
+}
+
+}  // namespace
+}  // namespace mongo
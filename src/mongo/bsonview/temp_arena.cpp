@@ -0,0 +1,136 @@
+/**
+ *    Copyright (C) 2019-present MongoDB, Inc.
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the Server Side Public License, version 1,
+ *    as published by MongoDB, Inc.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    Server Side Public License for more details.
+ *
+ *    You should have received a copy of the Server Side Public License
+ *    along with this program. If not, see
+ *    <http://www.mongodb.com/licensing/server-side-public-license>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the Server Side Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/bsonview/temp_arena.h"
+
+#include <cstdlib>
+#include <fcntl.h>
+#include <string>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "mongo/util/errno_util.h"
+#include "mongo/util/str.h"
+
+namespace mongo {
+
+namespace {
+
+/**
+ * Creates a temporary file that's already unlinked, so it goes away with us however we exit.
+ */
+StatusWith<int> createArenaFile() {
+    const char* tmpdir = getenv("TMPDIR");
+    const std::string dir = tmpdir && *tmpdir ? tmpdir : "/var/tmp";
+
+    int fd = -1;
+#ifdef O_TMPFILE
+    fd = ::open(dir.c_str(), O_TMPFILE | O_RDWR | O_CLOEXEC, 0600);
+    if (fd >= 0) {
+        return fd;
+    }
+#endif
+
+    std::string path = dir + "/bv-arena-XXXXXX";
+    fd = mkostemp(&path[0], O_CLOEXEC);
+    if (fd < 0) {
+        auto errorString = errnoWithDescription();
+        return {ErrorCodes::FileNotOpen,
+                str::stream() << "Unable to create temporary file in " << dir << ": "
+                              << errorString};
+    }
+    ::unlink(path.c_str());
+    return fd;
+}
+
+}  // namespace
+
+TempArena::~TempArena() {
+    if (_base) {
+        munmap(_base, kReservation);
+    }
+    if (_fd >= 0) {
+        ::close(_fd);
+    }
+}
+
+StatusWith<std::unique_ptr<TempArena>> TempArena::make() {
+    std::unique_ptr<TempArena> arena(new TempArena());
+
+    auto swFd = createArenaFile();
+    if (!swFd.isOK()) {
+        return swFd.getStatus();
+    }
+    arena->_fd = swFd.getValue();
+
+    void* reservation =
+        mmap(nullptr, kReservation, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (reservation == MAP_FAILED) {
+        auto errorString = errnoWithDescription();
+        return {ErrorCodes::FileNotOpen,
+                str::stream() << "Unable to reserve address space: " << errorString};
+    }
+    arena->_base = static_cast<char*>(reservation);
+
+    return {std::move(arena)};
+}
+
+Status TempArena::ensureMapped(uint64_t bytes) {
+    if (bytes > kReservation) {
+        return {ErrorCodes::ExceededMemoryLimit,
+                str::stream() << "Temporary file would be larger than " << (kReservation >> 30)
+                              << "GiB"};
+    }
+
+    while (_mapped < bytes) {
+        // Allocate the space up front, so that running out of it is an error here, rather than
+        // SIGBUS when writing to the mapping.
+        if (int err = posix_fallocate(_fd, _mapped, kGrowthSize)) {
+            return {ErrorCodes::FileStreamFailed,
+                    str::stream() << "Unable to extend temporary file: "
+                                  << errnoWithDescription(err)};
+        }
+        if (mmap(_base + _mapped,
+                 kGrowthSize,
+                 PROT_READ | PROT_WRITE,
+                 MAP_SHARED | MAP_FIXED,
+                 _fd,
+                 _mapped) == MAP_FAILED) {
+            auto errorString = errnoWithDescription();
+            return {ErrorCodes::FileStreamFailed,
+                    str::stream() << "Unable to map temporary file: " << errorString};
+        }
+        _mapped += kGrowthSize;
+    }
+    return Status::OK();
+}
+
+}  // namespace mongo
@@ -0,0 +1,91 @@
+/**
+ *    Copyright (C) 2019-present MongoDB, Inc.
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the Server Side Public License, version 1,
+ *    as published by MongoDB, Inc.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    Server Side Public License for more details.
+ *
+ *    You should have received a copy of the Server Side Public License
+ *    along with this program. If not, see
+ *    <http://www.mongodb.com/licensing/server-side-public-license>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the Server Side Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+
+#include "mongo/base/status_with.h"
+
+namespace mongo {
+
+/**
+ * An append-only arena in an unlinked temporary file, mapped into a large reservation of address
+ * space.  So what's been written never moves, and rather than taking up memory, it can be paged
+ * out to the file when memory is short.  Used for what has to be kept, but can't be read again
+ * from where it came from (eg. stdin, or the results of an aggregation).
+ *
+ * Not synchronized: one thread writes (and grows the mapping), and others may read what they've
+ * been told has been written.
+ */
+class TempArena {
+    TempArena(const TempArena&) = delete;
+    TempArena& operator=(const TempArena&) = delete;
+
+public:
+    // Largest arena.  Costs nothing but address space.
+    static constexpr uint64_t kReservation = 1ULL << 40;
+
+    // The mapping grows by this much at a time.
+    static constexpr uint64_t kGrowthSize = 64 * 1024 * 1024;
+
+    ~TempArena();
+
+    /**
+     * The temporary file is created in $TMPDIR (or /var/tmp).
+     */
+    static StatusWith<std::unique_ptr<TempArena>> make();
+
+    char* base() const {
+        return _base;
+    }
+
+    /**
+     * How much of the arena can be written so far.
+     */
+    uint64_t mapped() const {
+        return _mapped;
+    }
+
+    /**
+     * Grows the mapping (by kGrowthSize at a time) until at least the first `bytes` can be
+     * written.
+     */
+    Status ensureMapped(uint64_t bytes);
+
+private:
+    TempArena() = default;
+
+    int _fd = -1;
+    char* _base = nullptr;
+    uint64_t _mapped = 0;
+};
+
+}  // namespace mongo
@@ -0,0 +1,71 @@
+/**
+ *    Copyright (C) 2019-present MongoDB, Inc.
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the Server Side Public License, version 1,
+ *    as published by MongoDB, Inc.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    Server Side Public License for more details.
+ *
+ *    You should have received a copy of the Server Side Public License
+ *    along with this program. If not, see
+ *    <http://www.mongodb.com/licensing/server-side-public-license>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the Server Side Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include <cstring>
+
+#include "mongo/bsonview/temp_arena.h"
+#include "mongo/unittest/unittest.h"
+
+namespace mongo {
+namespace {
+
+TEST(TempArenaTest, GrowsWithoutMoving) {
+    auto swArena = TempArena::make();
+    ASSERT_OK(swArena.getStatus());
+    auto& arena = swArena.getValue();
+    ASSERT_EQ(arena->mapped(), 0U);
+
+    ASSERT_OK(arena->ensureMapped(1));
+    ASSERT_EQ(arena->mapped(), TempArena::kGrowthSize);
+    char* const base = arena->base();
+    memcpy(base, "hello", 5);
+
+    // Across more than one growth at once.
+    ASSERT_OK(arena->ensureMapped(2 * TempArena::kGrowthSize + 1));
+    ASSERT_EQ(arena->mapped(), 3 * TempArena::kGrowthSize);
+    ASSERT_EQ(arena->base(), base);
+    ASSERT_EQ(std::string(base, 5), "hello");
+    memcpy(base + arena->mapped() - 5, "world", 5);
+
+    // Already mapped.
+    ASSERT_OK(arena->ensureMapped(5));
+    ASSERT_EQ(arena->mapped(), 3 * TempArena::kGrowthSize);
+}
+
+TEST(TempArenaTest, RefusesToGrowPastReservation) {
+    auto swArena = TempArena::make();
+    ASSERT_OK(swArena.getStatus());
+    ASSERT_NOT_OK(swArena.getValue()->ensureMapped(TempArena::kReservation + 1));
+    ASSERT_EQ(swArena.getValue()->mapped(), 0U);
+}
+
+}  // namespace
+}  // namespace mongo
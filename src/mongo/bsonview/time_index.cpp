@@ -0,0 +1,163 @@
+/**
+ *    Copyright (C) 2019-present MongoDB, Inc.
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the Server Side Public License, version 1,
+ *    as published by MongoDB, Inc.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    Server Side Public License for more details.
+ *
+ *    You should have received a copy of the Server Side Public License
+ *    along with this program. If not, see
+ *    <http://www.mongodb.com/licensing/server-side-public-license>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the Server Side Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/bsonview/time_index.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+#include "mongo/bson/bsonelement.h"
+
+namespace mongo {
+
+namespace {
+
+// Oplogs, logs, FTDC samples, and a few other guesses.
+const std::array<StringData, 7> kUsualFields{
+    "ts"_sd, "t"_sd, "wall"_sd, "start"_sd, "time"_sd, "timestamp"_sd, "date"_sd};
+
+}  // namespace
+
+boost::optional<std::string> TimeIndex::detectField(const std::vector<BSONObj>& sample) {
+    if (sample.empty()) {
+        return boost::none;
+    }
+
+    std::vector<std::string> candidates;
+    for (auto&& elem : sample.front()) {
+        if (elem.type() == Date || elem.type() == bsonTimestamp) {
+            candidates.push_back(elem.fieldName());
+        }
+    }
+    std::stable_sort(candidates.begin(), candidates.end(), [](const auto& a, const auto& b) {
+        return std::find(kUsualFields.begin(), kUsualFields.end(), a) <
+            std::find(kUsualFields.begin(), kUsualFields.end(), b);
+    });
+
+    for (auto&& field : candidates) {
+        bool ordered = true;
+        boost::optional<Date_t> last;
+        for (auto&& doc : sample) {
+            auto time = docTime(doc, field);
+            if (!time) {
+                continue;
+            }
+            if (last && *time < *last) {
+                ordered = false;
+                break;
+            }
+            last = time;
+        }
+        if (ordered) {
+            return field;
+        }
+    }
+    return boost::none;
+}
+
+StatusWith<Date_t> TimeIndex::parseTarget(StringData arg, boost::optional<Date_t> sameDayAs) {
+    auto swTarget = dateFromISOString(arg);
+    if (!swTarget.isOK() && sameDayAs) {
+        // (the day is taken from the UTC date, so the time of day is in UTC too)
+        const std::string day = dateToISOStringUTC(*sameDayAs).substr(0, strlen("YYYY-MM-DD"));
+        auto swTimeOfDay = dateFromISOString(day + "T" + arg + "Z");
+        if (swTimeOfDay.isOK()) {
+            return swTimeOfDay;
+        }
+    }
+    return swTarget;
+}
+
+boost::optional<Date_t> TimeIndex::docTime(const BSONObj& doc, StringData field) {
+    BSONElement elem = doc[field];
+    switch (elem.type()) {
+        case Date:
+            return elem.date();
+        case bsonTimestamp:
+            return Date_t::fromMillisSinceEpoch(elem.timestamp().getSecs() * 1000LL);
+        default:
+            return boost::none;
+    }
+}
+
+uint64_t TimeIndex::seek(Date_t target, uint64_t numDocs, const TimeOf& timeOf) {
+    // Everything before lo is before the target, and everything from hi on isn't.
+    uint64_t lo = 0;
+    uint64_t hi = numDocs;
+
+    // Start from the docs already looked at either side of it.
+    auto after = std::partition_point(
+        _entries.begin(), _entries.end(), [&](const auto& entry) { return entry.second < target; });
+    if (after != _entries.end() && after->first < hi) {
+        hi = after->first;
+    }
+    if (after != _entries.begin() && (after - 1)->first < hi) {
+        lo = (after - 1)->first + 1;
+    }
+
+    while (lo < hi) {
+        const uint64_t mid = lo + (hi - lo) / 2;
+        // (the first doc from mid on with a time, if any)
+        uint64_t doc = mid;
+        boost::optional<Date_t> time;
+        for (; doc < hi; doc++) {
+            time = timeOf(doc);
+            if (time) {
+                break;
+            }
+        }
+        if (!time) {
+            hi = mid;
+            continue;
+        }
+        _remember(doc, *time);
+        if (*time < target) {
+            lo = doc + 1;
+        } else {
+            hi = doc;
+        }
+    }
+    return lo;
+}
+
+void TimeIndex::_remember(uint64_t doc, Date_t time) {
+    auto pos = std::lower_bound(
+        _entries.begin(), _entries.end(), doc, [](const auto& entry, uint64_t d) {
+            return entry.first < d;
+        });
+    if ((pos != _entries.end() && pos->first == doc) || _entries.size() >= kMaxEntries) {
+        return;
+    }
+    _entries.insert(pos, {doc, time});
+}
+
+}  // namespace mongo
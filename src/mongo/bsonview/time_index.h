@@ -0,0 +1,106 @@
+/**
+ *    Copyright (C) 2019-present MongoDB, Inc.
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the Server Side Public License, version 1,
+ *    as published by MongoDB, Inc.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    Server Side Public License for more details.
+ *
+ *    You should have received a copy of the Server Side Public License
+ *    along with this program. If not, see
+ *    <http://www.mongodb.com/licensing/server-side-public-license>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the Server Side Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#pragma once
+
+#include <boost/optional.hpp>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "mongo/base/status_with.h"
+#include "mongo/base/string_data.h"
+#include "mongo/bson/bsonobj.h"
+#include "mongo/util/time_support.h"
+
+namespace mongo {
+
+/**
+ * Finds where a time falls in docs that are in time order (oplogs, logs, FTDC samples), by binary
+ * searching them on a top-level Date or Timestamp field, so only O(log n) docs are looked at.
+ *
+ * The times of the docs looked at are remembered, in a sparse time -> doc skip index that later
+ * searches start from, so jumping near somewhere already jumped to looks at very few docs, and
+ * jumping to the same time again looks at none.
+ */
+class TimeIndex {
+public:
+    using TimeOf = std::function<boost::optional<Date_t>(uint64_t doc)>;
+
+    /**
+     * Docs remembered, beyond which no more are.
+     */
+    static constexpr size_t kMaxEntries = 64 * 1024;
+
+    /**
+     * The top-level Date or Timestamp field that the sample (in doc order) is in time order by,
+     * preferring the usual names (eg. `ts` for an oplog, `t` for a log).
+     */
+    static boost::optional<std::string> detectField(const std::vector<BSONObj>& sample);
+
+    /**
+     * The time of a doc, if it has the field as a Date or Timestamp (to the second).
+     */
+    static boost::optional<Date_t> docTime(const BSONObj& doc, StringData field);
+
+    /**
+     * The time to seek to, given as an ISO date (eg. "2019-05-21T14:32:05Z"), or just a time of day
+     * (eg. "14:32:05", in UTC) on the same day as `sameDayAs`, if known.
+     */
+    static StatusWith<Date_t> parseTarget(StringData arg, boost::optional<Date_t> sameDayAs);
+
+    explicit TimeIndex(std::string field) : _field(std::move(field)) {}
+
+    const std::string& field() const {
+        return _field;
+    }
+
+    /**
+     * Where target falls in [0, numDocs): the doc after the last one before it, which is the first
+     * at or after it unless there are docs without a time in between, or numDocs if all the docs
+     * are before it.
+     */
+    uint64_t seek(Date_t target, uint64_t numDocs, const TimeOf& timeOf);
+
+    size_t numEntries() const {
+        return _entries.size();
+    }
+
+private:
+    void _remember(uint64_t doc, Date_t time);
+
+    const std::string _field;
+
+    // In doc order, and so (since the docs are in time order) in time order too.
+    std::vector<std::pair<uint64_t, Date_t>> _entries;
+};
+
+}  // namespace mongo
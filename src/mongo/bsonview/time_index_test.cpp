@@ -0,0 +1,159 @@
+/**
+ *    Copyright (C) 2019-present MongoDB, Inc.
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the Server Side Public License, version 1,
+ *    as published by MongoDB, Inc.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    Server Side Public License for more details.
+ *
+ *    You should have received a copy of the Server Side Public License
+ *    along with this program. If not, see
+ *    <http://www.mongodb.com/licensing/server-side-public-license>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the Server Side Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include <vector>
+
+#include "mongo/bson/bsonobjbuilder.h"
+#include "mongo/bsonview/time_index.h"
+#include "mongo/unittest/unittest.h"
+
+namespace mongo {
+namespace {
+
+// A doc a second, from the epoch, with some seconds repeated.
+std::vector<Date_t> makeTimes(int n) {
+    std::vector<Date_t> times;
+    for (int i = 0; i < n; i++) {
+        times.push_back(Date_t::fromMillisSinceEpoch((i - i % 3) * 1000LL));
+    }
+    return times;
+}
+
+struct CountingTimeOf {
+    TimeIndex::TimeOf timeOf() {
+        return [this](uint64_t doc) -> boost::optional<Date_t> {
+            lookedAt++;
+            return times[doc];
+        };
+    }
+
+    std::vector<boost::optional<Date_t>> times;
+    int lookedAt = 0;
+};
+
+Date_t secs(long long s) {
+    return Date_t::fromMillisSinceEpoch(s * 1000);
+}
+
+TEST(TimeIndexTest, DetectsTheOrderedTimeField) {
+    std::vector<BSONObj> oplog;
+    std::vector<BSONObj> log;
+    for (int i = 0; i < 10; i++) {
+        // (the first Date isn't in order)
+        oplog.push_back(BSON("created" << secs(100 - i) << "ts" << Timestamp(1000 + i, 1)
+                                       << "wall" << secs(1000 + i)));
+        log.push_back(BSON("msg"
+                           << "x"
+                           << "when" << secs(i)));
+    }
+    ASSERT_EQ(*TimeIndex::detectField(oplog), "ts");
+    ASSERT_EQ(*TimeIndex::detectField(log), "when");
+
+    std::vector<BSONObj> unordered{BSON("t" << secs(2)), BSON("t" << secs(1))};
+    ASSERT(!TimeIndex::detectField(unordered));
+    std::vector<BSONObj> noTimes{BSON("t" << 1), BSON("t" << 2)};
+    ASSERT(!TimeIndex::detectField(noTimes));
+}
+
+TEST(TimeIndexTest, DocTime) {
+    ASSERT_EQ(*TimeIndex::docTime(BSON("ts" << Timestamp(12, 3)), "ts"), secs(12));
+    ASSERT_EQ(*TimeIndex::docTime(BSON("t" << secs(5)), "t"), secs(5));
+    ASSERT(!TimeIndex::docTime(BSON("t" << 5), "t"));
+    ASSERT(!TimeIndex::docTime(BSON("x" << secs(5)), "t"));
+}
+
+TEST(TimeIndexTest, ParseTarget) {
+    const Date_t day = unittest::assertGet(dateFromISOString("2019-05-21T03:00:00Z"));
+    ASSERT_EQ(unittest::assertGet(TimeIndex::parseTarget("2019-05-20T14:32:05Z", day)),
+              unittest::assertGet(dateFromISOString("2019-05-20T14:32:05Z")));
+    ASSERT_EQ(unittest::assertGet(TimeIndex::parseTarget("2019-05-20T14:32:05Z", boost::none)),
+              unittest::assertGet(dateFromISOString("2019-05-20T14:32:05Z")));
+
+    // A time of day is on the same (UTC) day.
+    ASSERT_EQ(unittest::assertGet(TimeIndex::parseTarget("14:32:05", day)),
+              unittest::assertGet(dateFromISOString("2019-05-21T14:32:05Z")));
+    ASSERT_EQ(unittest::assertGet(TimeIndex::parseTarget("14:32:05.250", day)),
+              unittest::assertGet(dateFromISOString("2019-05-21T14:32:05.250Z")));
+    ASSERT_NOT_OK(TimeIndex::parseTarget("14:32:05", boost::none).getStatus());
+
+    ASSERT_NOT_OK(TimeIndex::parseTarget("yesterday", day).getStatus());
+}
+
+TEST(TimeIndexTest, SeeksToTheFirstDocAtOrAfter) {
+    const auto times = makeTimes(1000);
+    CountingTimeOf counting;
+    counting.times.assign(times.begin(), times.end());
+    TimeIndex index("t");
+
+    ASSERT_EQ(index.seek(secs(0), 1000, counting.timeOf()), 0U);
+    ASSERT_EQ(index.seek(secs(300), 1000, counting.timeOf()), 300U);
+    ASSERT_EQ(index.seek(secs(301), 1000, counting.timeOf()), 303U);
+    ASSERT_EQ(index.seek(secs(999), 1000, counting.timeOf()), 999U);
+    ASSERT_EQ(index.seek(secs(5000), 1000, counting.timeOf()), 1000U);
+    ASSERT_EQ(index.seek(secs(-1), 1000, counting.timeOf()), 0U);
+}
+
+TEST(TimeIndexTest, LooksAtLogNDocsThenFewerAgain) {
+    const auto times = makeTimes(1000000);
+    CountingTimeOf counting;
+    counting.times.assign(times.begin(), times.end());
+    TimeIndex index("t");
+
+    ASSERT_EQ(index.seek(secs(123456), times.size(), counting.timeOf()), 123456U);
+    ASSERT_LTE(counting.lookedAt, 21);
+    ASSERT_GT(index.numEntries(), 0U);
+
+    // (the same time again is already known)
+    counting.lookedAt = 0;
+    ASSERT_EQ(index.seek(secs(123456), times.size(), counting.timeOf()), 123456U);
+    ASSERT_EQ(counting.lookedAt, 0);
+
+    // (and a time nearby starts from what's known around it)
+    counting.lookedAt = 0;
+    ASSERT_EQ(index.seek(secs(123462), times.size(), counting.timeOf()), 123462U);
+    ASSERT_LT(counting.lookedAt, 21);
+}
+
+TEST(TimeIndexTest, SkipsDocsWithoutATime) {
+    CountingTimeOf counting;
+    for (int i = 0; i < 100; i++) {
+        counting.times.push_back(i % 10 == 5 ? boost::optional<Date_t>(secs(i))
+                                             : boost::optional<Date_t>());
+    }
+    TimeIndex index("t");
+    ASSERT_EQ(index.seek(secs(40), 100, counting.timeOf()), 36U);
+    ASSERT_EQ(index.seek(secs(45), 100, counting.timeOf()), 36U);
+    ASSERT_EQ(index.seek(secs(46), 100, counting.timeOf()), 46U);
+    ASSERT_EQ(index.seek(secs(96), 100, counting.timeOf()), 96U);
+}
+
+}  // namespace
+}  // namespace mongo